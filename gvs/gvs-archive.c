@@ -0,0 +1,760 @@
+/* gvs-archive.c: Indexed archives of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-archive.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <string.h>
+
+/*
+ * An archive is one document followed by an index of where each of its
+ * entities lives in the file. All integers outside the document and index
+ * are little-endian.
+ *
+ * Header (8 bytes):
+ *   "GVSA", byte order of the document and index ('l' or 'B'), archive
+ *   version (1), 16-bit document version (1, 2 or 3)
+ *
+ * The document, in GVariant's serialized form, padded to a multiple of 8
+ *
+ * The index, a GVariant of type (sa(tt)a(st)):
+ *   the name of the key property ("" if none), the file offset and size of
+ *   each entity's "(sv)" entry, by entity id, and (key, entity id) pairs
+ *   sorted by key
+ *
+ * Trailer (16 bytes):
+ *   64-bit document size, 32-bit index size, "GVSI"
+ *
+ * Entity ids in documents without column groups are simply rows of the
+ * entity array, so an entity and everything it refers to can be read
+ * straight out of a mapped file without touching the rest of the document.
+ */
+
+#define GVS_ARCHIVE_MAGIC             "GVSA"
+#define GVS_ARCHIVE_INDEX_MAGIC       "GVSI"
+#define GVS_ARCHIVE_VERSION           ((guint8) 1)
+#define GVS_ARCHIVE_HEADER_SIZE       8
+#define GVS_ARCHIVE_TRAILER_SIZE      16
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+#define GVS_ARCHIVE_NATIVE_ORDER      'B'
+#else
+#define GVS_ARCHIVE_NATIVE_ORDER      'l'
+#endif
+
+#define GVS_ARCHIVE_INDEX_TYPE        ((const GVariantType*) "(sa(tt)a(st))")
+
+G_DEFINE_QUARK(gvs-archive-error-quark, gvs_archive_error)
+
+struct _GvsArchivePrivate
+{
+    GBytes             *bytes;
+    GvsDeserializer    *deserializer;
+    gboolean            byteswap;
+
+    const GVariantType *document_type;
+    gsize               document_end;
+
+    GVariant           *extents;
+    GVariant           *keys;
+    char               *key_property;
+    gsize               n_entities;
+
+    /* The document's string table, read when first needed */
+    GVariant           *strings;
+    gboolean            strings_read;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvsArchive, gvs_archive, G_TYPE_OBJECT)
+
+/******************************************************************************
+ *
+ * Utility functions
+ *
+ ******************************************************************************/
+
+static void
+put_uint16(guint8 *data, guint16 value)
+{
+    value = GUINT16_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+put_uint32(guint8 *data, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+put_uint64(guint8 *data, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static guint16
+get_uint16(const guint8 *data)
+{
+    guint16 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT16_FROM_LE(value);
+}
+
+static guint32
+get_uint32(const guint8 *data)
+{
+    guint32 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static guint64
+get_uint64(const guint8 *data)
+{
+    guint64 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT64_FROM_LE(value);
+}
+
+/* Takes ownership of @variant, which must not be floating */
+static GVariant *
+to_native_order(GVariant *variant, gboolean byteswap)
+{
+    GVariant *swapped;
+
+    if (!byteswap)
+        return variant;
+
+    swapped = g_variant_ref_sink(g_variant_byteswap(variant));
+    g_variant_unref(variant);
+
+    return swapped;
+}
+
+/******************************************************************************
+ *
+ * Writing
+ *
+ ******************************************************************************/
+
+typedef struct
+{
+    char   *key;
+    guint64 id;
+} KeyEntry;
+
+static gint
+compare_key_entries(gconstpointer a, gconstpointer b)
+{
+    const KeyEntry *ka = a, *kb = b;
+    int cmp = strcmp(ka->key, kb->key);
+
+    if (cmp != 0)
+        return cmp;
+
+    return ka->id < kb->id ? -1 : ka->id > kb->id;
+}
+
+static void
+clear_key_entry(gpointer data)
+{
+    g_free(((KeyEntry *) data)->key);
+}
+
+/* Works out the index for @document, whose serialized data starts at @base,
+ * and whose string table is @strings, or %NULL */
+static GVariant *
+build_index(GVariant *entities, const guint8 *base, const char *key_property,
+            GVariant *strings)
+{
+    GVariantBuilder extents, keys;
+    GArray *key_entries;
+    gsize n_entities, i;
+
+    key_entries = g_array_new(FALSE, FALSE, sizeof(KeyEntry));
+    g_array_set_clear_func(key_entries, clear_key_entry);
+
+    g_variant_builder_init(&extents, G_VARIANT_TYPE("a(tt)"));
+    n_entities = g_variant_n_children(entities);
+
+    for (i = 0; i < n_entities; i++)
+    {
+        GVariant *entry = g_variant_get_child_value(entities, i);
+        const guint8 *data = g_variant_get_data(entry);
+        GVariant *payload;
+
+        g_variant_builder_add(&extents, "(tt)",
+                              (guint64) (GVS_ARCHIVE_HEADER_SIZE + (data - base)),
+                              (guint64) g_variant_get_size(entry));
+
+        /* Only objects with default serialization have a property
+         * dictionary to find the key in. Strings are stored as "ms", or as
+         * an "mh" index into the document's string table. */
+        g_variant_get_child(entry, 1, "v", &payload);
+        if (key_property && g_variant_is_of_type(payload, G_VARIANT_TYPE_VARDICT))
+        {
+            GVariant *key = g_variant_lookup_value(payload, key_property, NULL);
+            const char *key_string = NULL;
+
+            if (key && g_variant_is_of_type(key, GVS_STRING_REF_TYPE))
+            {
+                GVariant *resolved = _gvs_string_table_resolve(strings, key);
+
+                g_variant_unref(key);
+                key = resolved;
+            }
+
+            if (key && g_variant_is_of_type(key, G_VARIANT_TYPE("ms")))
+                g_variant_get(key, "m&s", &key_string);
+
+            if (key_string)
+            {
+                KeyEntry key_entry;
+
+                key_entry.key = g_strdup(key_string);
+                key_entry.id = i;
+                g_array_append_val(key_entries, key_entry);
+            }
+
+            if (key)
+                g_variant_unref(key);
+        }
+
+        g_variant_unref(payload);
+        g_variant_unref(entry);
+    }
+
+    g_array_sort(key_entries, compare_key_entries);
+
+    g_variant_builder_init(&keys, G_VARIANT_TYPE("a(st)"));
+    for (i = 0; i < key_entries->len; i++)
+    {
+        KeyEntry *key_entry = &g_array_index(key_entries, KeyEntry, i);
+
+        g_variant_builder_add(&keys, "(st)", key_entry->key, key_entry->id);
+    }
+
+    g_array_unref(key_entries);
+
+    return g_variant_ref_sink(g_variant_new("(sa(tt)a(st))",
+                                            key_property ? key_property : "",
+                                            &extents, &keys));
+}
+
+/**
+ * gvs_archive_write:
+ * @stream: The #GOutputStream to write to
+ * @document: A document produced by gvs_serializer_serialize_object()
+ *  without %GVS_SERIALIZER_COLUMNAR
+ * @key_property: (allow-none): The name of a string property to index
+ *  objects by, or %NULL
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Writes @document to @stream as an archive, with an index which lets
+ * gvs_archive_lookup_id() and gvs_archive_lookup() find an entity without
+ * reading the rest of the document. Objects whose @key_property is stored
+ * in the document, as a string, are indexed by its value; objects using
+ * custom serialization, or whose key was left out as a default value, are
+ * only indexed by id.
+ *
+ * Documents with column groups can't be archived, since their entities
+ * don't each occupy one range of bytes.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gvs_archive_write(GOutputStream *stream,
+                  GVariant *document,
+                  const char *key_property,
+                  GCancellable *cancellable,
+                  GError **error)
+{
+    static const guint8 padding[8] = { 0 };
+    guint8 header[GVS_ARCHIVE_HEADER_SIZE];
+    guint8 trailer[GVS_ARCHIVE_TRAILER_SIZE];
+    const guint8 *base;
+    GVariant *entities, *index;
+    GVariant *strings = NULL;
+    guint16 version;
+    gsize size;
+    gboolean ret;
+
+    g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+    g_return_val_if_fail(document != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    /* Entities are only slices of the document once it is serialized */
+    g_variant_ref_sink(document);
+    base = g_variant_get_data(document);
+    size = g_variant_get_size(document);
+
+    if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_TYPE))
+    {
+        version = 1;
+        entities = g_variant_get_child_value(document, 2);
+    }
+    else if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V2_TYPE) ||
+             g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V3_TYPE))
+    {
+        GVariant *groups = g_variant_get_child_value(document, 4);
+        gsize n_groups = g_variant_n_children(groups);
+
+        g_variant_unref(groups);
+
+        if (n_groups > 0)
+        {
+            g_set_error_literal(error, GVS_ARCHIVE_ERROR,
+                                GVS_ARCHIVE_ERROR_UNSUPPORTED,
+                                "Documents with column groups can't be archived");
+            g_variant_unref(document);
+            return FALSE;
+        }
+
+        version = g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V3_TYPE) ? 3 : 2;
+        entities = g_variant_get_child_value(document, 3);
+        strings = _gvs_document_get_string_table(document);
+    }
+    else
+    {
+        g_variant_unref(document);
+        g_return_val_if_reached(FALSE);
+    }
+
+    index = build_index(entities, base, key_property, strings);
+    if (strings)
+        g_variant_unref(strings);
+    g_variant_unref(entities);
+
+    memcpy(header, GVS_ARCHIVE_MAGIC, 4);
+    header[4] = GVS_ARCHIVE_NATIVE_ORDER;
+    header[5] = GVS_ARCHIVE_VERSION;
+    put_uint16(header + 6, version);
+
+    put_uint64(trailer, size);
+    put_uint32(trailer + 8, g_variant_get_size(index));
+    memcpy(trailer + 12, GVS_ARCHIVE_INDEX_MAGIC, 4);
+
+    ret = g_output_stream_write_all(stream, header, sizeof(header),
+                                    NULL, cancellable, error) &&
+          g_output_stream_write_all(stream, base, size,
+                                    NULL, cancellable, error) &&
+          g_output_stream_write_all(stream, padding, -size & 7,
+                                    NULL, cancellable, error) &&
+          g_output_stream_write_all(stream, g_variant_get_data(index),
+                                    g_variant_get_size(index),
+                                    NULL, cancellable, error) &&
+          g_output_stream_write_all(stream, trailer, sizeof(trailer),
+                                    NULL, cancellable, error);
+
+    g_variant_unref(index);
+    g_variant_unref(document);
+
+    return ret;
+}
+
+/******************************************************************************
+ *
+ * Reading
+ *
+ ******************************************************************************/
+
+/* Returns the document as stored, in the archive's byte order */
+static GVariant *
+get_stored_document(GvsArchivePrivate *priv)
+{
+    GVariant *document;
+    GBytes *slice;
+
+    slice = g_bytes_new_from_bytes(priv->bytes, GVS_ARCHIVE_HEADER_SIZE,
+                                   priv->document_end - GVS_ARCHIVE_HEADER_SIZE);
+    document = g_variant_ref_sink(g_variant_new_from_bytes(priv->document_type,
+                                                           slice, FALSE));
+    g_bytes_unref(slice);
+
+    return document;
+}
+
+GVariant *
+_gvs_archive_fetch_entity(gpointer user_data, gsize id)
+{
+    GvsArchivePrivate *priv = GVS_ARCHIVE(user_data)->priv;
+    guint64 offset, size;
+    GBytes *slice;
+    GVariant *entry;
+
+    g_variant_get_child(priv->extents, id, "(tt)", &offset, &size);
+
+    if (offset < GVS_ARCHIVE_HEADER_SIZE || offset > priv->document_end ||
+        size > priv->document_end - offset)
+    {
+        g_critical("Archive index entry for entity %" G_GSIZE_FORMAT
+                   " is out of range", id);
+        offset = GVS_ARCHIVE_HEADER_SIZE;
+        size = 0;
+    }
+
+    slice = g_bytes_new_from_bytes(priv->bytes, offset, size);
+    entry = g_variant_ref_sink(g_variant_new_from_bytes(GVS_ENTITY_TYPE, slice, FALSE));
+    g_bytes_unref(slice);
+
+    return to_native_order(entry, priv->byteswap);
+}
+
+/* Returns the string table of @archive's document, or %NULL if it has none.
+ * Only the table is byteswapped, if it needs to be, not the whole document. */
+GVariant *
+_gvs_archive_get_string_table(GvsArchive *archive)
+{
+    GvsArchivePrivate *priv = archive->priv;
+
+    if (!priv->strings_read)
+    {
+        GVariant *document = get_stored_document(priv);
+
+        priv->strings = _gvs_document_get_string_table(document);
+        if (priv->strings)
+            priv->strings = to_native_order(priv->strings, priv->byteswap);
+        priv->strings_read = TRUE;
+        g_variant_unref(document);
+    }
+
+    return priv->strings ? g_variant_ref(priv->strings) : NULL;
+}
+
+static void
+gvs_archive_finalize(GObject *object)
+{
+    GvsArchivePrivate *priv = GVS_ARCHIVE(object)->priv;
+
+    g_clear_pointer(&priv->extents, g_variant_unref);
+    g_clear_pointer(&priv->keys, g_variant_unref);
+    g_clear_pointer(&priv->strings, g_variant_unref);
+    g_clear_pointer(&priv->bytes, g_bytes_unref);
+    g_free(priv->key_property);
+    g_object_unref(priv->deserializer);
+
+    G_OBJECT_CLASS(gvs_archive_parent_class)->finalize(object);
+}
+
+static void
+gvs_archive_class_init(GvsArchiveClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_archive_finalize;
+}
+
+static void
+gvs_archive_init(GvsArchive *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_ARCHIVE, GvsArchivePrivate);
+
+    self->priv->deserializer = gvs_deserializer_new();
+}
+
+/**
+ * gvs_archive_new:
+ * @bytes: The contents of an archive written by gvs_archive_write()
+ * @error: Return location for a #GError
+ *
+ * Opens an archive held in memory. Only the header, trailer and the top of
+ * the index are read, so this takes the same time however large the archive
+ * is; damage elsewhere is found when the affected entities are looked up.
+ *
+ * Returns: (transfer full): A new #GvsArchive, or %NULL on error
+ */
+GvsArchive *
+gvs_archive_new(GBytes *bytes, GError **error)
+{
+    GvsArchive *self;
+    GvsArchivePrivate *priv;
+    const guint8 *data, *trailer;
+    const GVariantType *document_type;
+    guint64 document_size, index_offset, index_size;
+    GVariant *index;
+    GBytes *slice;
+    gsize size;
+
+    g_return_val_if_fail(bytes != NULL, NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    data = g_bytes_get_data(bytes, &size);
+
+    if (size < GVS_ARCHIVE_HEADER_SIZE + GVS_ARCHIVE_TRAILER_SIZE ||
+        memcmp(data, GVS_ARCHIVE_MAGIC, 4) != 0 ||
+        (data[4] != 'l' && data[4] != 'B'))
+    {
+        g_set_error_literal(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_INVALID,
+                            "Data is not a GVS archive");
+        return NULL;
+    }
+
+    if (data[5] != GVS_ARCHIVE_VERSION)
+    {
+        g_set_error(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_UNSUPPORTED,
+                    "Unsupported GVS archive version %u", data[5]);
+        return NULL;
+    }
+
+    switch (get_uint16(data + 6))
+    {
+        case 1:
+            document_type = GVS_SERIALIZED_OBJECT_TYPE;
+            break;
+        case 2:
+            document_type = GVS_SERIALIZED_OBJECT_V2_TYPE;
+            break;
+        case 3:
+            document_type = GVS_SERIALIZED_OBJECT_V3_TYPE;
+            break;
+        default:
+            g_set_error(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_UNSUPPORTED,
+                        "Unsupported GVS document version %u", get_uint16(data + 6));
+            return NULL;
+    }
+
+    trailer = data + size - GVS_ARCHIVE_TRAILER_SIZE;
+    document_size = get_uint64(trailer);
+    index_size = get_uint32(trailer + 8);
+    index_offset = GVS_ARCHIVE_HEADER_SIZE + ((document_size + 7) & ~(guint64) 7);
+
+    if (memcmp(trailer + 12, GVS_ARCHIVE_INDEX_MAGIC, 4) != 0 ||
+        document_size > size ||
+        index_offset + index_size + GVS_ARCHIVE_TRAILER_SIZE != size)
+    {
+        g_set_error_literal(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_INVALID,
+                            "GVS archive index is missing or damaged");
+        return NULL;
+    }
+
+    self = g_object_new(GVS_TYPE_ARCHIVE, NULL);
+    priv = self->priv;
+
+    priv->bytes = g_bytes_ref(bytes);
+    priv->byteswap = data[4] != GVS_ARCHIVE_NATIVE_ORDER;
+    priv->document_type = document_type;
+    priv->document_end = GVS_ARCHIVE_HEADER_SIZE + document_size;
+
+    slice = g_bytes_new_from_bytes(bytes, index_offset, index_size);
+    index = g_variant_ref_sink(g_variant_new_from_bytes(GVS_ARCHIVE_INDEX_TYPE,
+                                                        slice, FALSE));
+    index = to_native_order(index, priv->byteswap);
+    g_bytes_unref(slice);
+
+    g_variant_get(index, "(s@a(tt)@a(st))",
+                  &priv->key_property, &priv->extents, &priv->keys);
+    priv->n_entities = g_variant_n_children(priv->extents);
+    g_variant_unref(index);
+
+    return self;
+}
+
+/**
+ * gvs_archive_new_for_path:
+ * @path: The name of a file written by gvs_archive_write()
+ * @error: Return location for a #GError
+ *
+ * Opens an archive by mapping it into memory, so that only the parts which
+ * are looked up are ever read from disk.
+ *
+ * Returns: (transfer full): A new #GvsArchive, or %NULL on error
+ */
+GvsArchive *
+gvs_archive_new_for_path(const char *path, GError **error)
+{
+    GMappedFile *file;
+    GvsArchive *self;
+    GBytes *bytes;
+
+    g_return_val_if_fail(path != NULL, NULL);
+
+    file = g_mapped_file_new(path, FALSE, error);
+    if (!file)
+        return NULL;
+
+    bytes = g_mapped_file_get_bytes(file);
+    self = gvs_archive_new(bytes, error);
+
+    g_bytes_unref(bytes);
+    g_mapped_file_unref(file);
+
+    return self;
+}
+
+/**
+ * gvs_archive_get_deserializer:
+ * @archive: A #GvsArchive
+ *
+ * Returns the deserializer used for lookups, so that its statistics can be
+ * read.
+ *
+ * Returns: (transfer none): The archive's #GvsDeserializer
+ */
+GvsDeserializer *
+gvs_archive_get_deserializer(GvsArchive *archive)
+{
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+
+    return archive->priv->deserializer;
+}
+
+/**
+ * gvs_archive_get_document:
+ * @archive: A #GvsArchive
+ *
+ * Returns: (transfer full): The whole document, which shares the archive's
+ *  memory unless it had to be byteswapped
+ */
+GVariant *
+gvs_archive_get_document(GvsArchive *archive)
+{
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+
+    return to_native_order(get_stored_document(archive->priv),
+                           archive->priv->byteswap);
+}
+
+/**
+ * gvs_archive_get_n_entities:
+ * @archive: A #GvsArchive
+ *
+ * Returns: The number of entities in the archive's document
+ */
+gsize
+gvs_archive_get_n_entities(GvsArchive *archive)
+{
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), 0);
+
+    return archive->priv->n_entities;
+}
+
+/**
+ * gvs_archive_get_key_property:
+ * @archive: A #GvsArchive
+ *
+ * Returns: (allow-none): The name of the property objects are indexed by,
+ *  or %NULL if there is none
+ */
+const char *
+gvs_archive_get_key_property(GvsArchive *archive)
+{
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+
+    return archive->priv->key_property[0] ? archive->priv->key_property : NULL;
+}
+
+/**
+ * gvs_archive_lookup_id:
+ * @archive: A #GvsArchive
+ * @id: An entity id, less than gvs_archive_get_n_entities()
+ *
+ * Deserializes entity @id and every entity it refers to, directly or
+ * indirectly, and nothing else. The root object of the document is entity
+ * 0. Each call creates new instances, even of entities returned before.
+ * If the archive's deserializer is in lazy mode, see
+ * gvs_deserializer_set_lazy(), lazy properties of the result are read from
+ * @archive when they are resolved, and keep it alive until then.
+ *
+ * Returns: (transfer full): The entity: a #GObject, or a boxed value for
+ *  boxed entities
+ */
+gpointer
+gvs_archive_lookup_id(GvsArchive *archive, gsize id)
+{
+    GVariant *strings;
+    gpointer entity;
+
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+    g_return_val_if_fail(id < archive->priv->n_entities, NULL);
+
+    strings = _gvs_archive_get_string_table(archive);
+    entity = _gvs_deserializer_deserialize_entity(archive->priv->deserializer,
+                                                  id, archive->priv->n_entities,
+                                                  strings,
+                                                  _gvs_archive_fetch_entity,
+                                                  g_object_ref(archive),
+                                                  g_object_unref);
+    if (strings)
+        g_variant_unref(strings);
+
+    return entity;
+}
+
+/**
+ * gvs_archive_lookup:
+ * @archive: A #GvsArchive
+ * @key: A value of the archive's key property
+ *
+ * Finds the object whose key property is @key, with a binary search of the
+ * index, and deserializes it as gvs_archive_lookup_id(). If several objects
+ * share the key, the one with the lowest id is returned.
+ *
+ * Returns: (type GObject) (transfer full): The object, or %NULL if there is
+ *  none with that key
+ */
+gpointer
+gvs_archive_lookup(GvsArchive *archive, const char *key)
+{
+    GvsArchivePrivate *priv;
+    gsize lo, hi;
+    const char *found;
+    guint64 id;
+
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+    g_return_val_if_fail(key != NULL, NULL);
+
+    priv = archive->priv;
+    lo = 0;
+    hi = g_variant_n_children(priv->keys);
+
+    /* Find the first entry not less than @key */
+    while (lo < hi)
+    {
+        gsize mid = lo + (hi - lo) / 2;
+
+        g_variant_get_child(priv->keys, mid, "(&st)", &found, NULL);
+        if (strcmp(found, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == g_variant_n_children(priv->keys))
+        return NULL;
+
+    g_variant_get_child(priv->keys, lo, "(&st)", &found, &id);
+    if (strcmp(found, key) != 0)
+        return NULL;
+
+    if (id >= priv->n_entities)
+    {
+        g_critical("Archive index refers to entity %" G_GUINT64_FORMAT " of %"
+                   G_GSIZE_FORMAT, id, priv->n_entities);
+        return NULL;
+    }
+
+    return gvs_archive_lookup_id(archive, id);
+}
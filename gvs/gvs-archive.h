@@ -0,0 +1,101 @@
+/* gvs-archive.h: Indexed archives of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_ARCHIVE_H__
+#define __GVS_ARCHIVE_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <gio/gio.h>
+
+#include "gvs-deserializer.h"
+
+G_BEGIN_DECLS
+
+#define GVS_ARCHIVE_ERROR (gvs_archive_error_quark ())
+
+/**
+ * GvsArchiveError:
+ * @GVS_ARCHIVE_ERROR_INVALID: The data is not a GVS archive, or is damaged
+ * @GVS_ARCHIVE_ERROR_UNSUPPORTED: The archive or document uses a version or
+ *  feature which can't be used in an archive, or which this version of
+ *  libgvs doesn't understand
+ */
+typedef enum
+{
+    GVS_ARCHIVE_ERROR_INVALID,
+    GVS_ARCHIVE_ERROR_UNSUPPORTED
+} GvsArchiveError;
+
+#define GVS_TYPE_ARCHIVE             (gvs_archive_get_type ())
+#define GVS_ARCHIVE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), GVS_TYPE_ARCHIVE, GvsArchive))
+#define GVS_IS_ARCHIVE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GVS_TYPE_ARCHIVE))
+
+typedef struct _GvsArchive             GvsArchive;
+typedef struct _GvsArchiveClass        GvsArchiveClass;
+typedef struct _GvsArchivePrivate      GvsArchivePrivate;
+
+struct _GvsArchive
+{
+    /*<private>*/
+    GObject    parent;
+
+    GvsArchivePrivate *priv;
+};
+
+struct _GvsArchiveClass
+{
+    /*<private>*/
+    GObjectClass    parent_class;
+};
+
+GQuark            gvs_archive_error_quark             (void);
+
+gboolean          gvs_archive_write                   (GOutputStream   *stream,
+                                                       GVariant        *document,
+                                                       const char      *key_property,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+GType             gvs_archive_get_type                (void) G_GNUC_CONST;
+
+GvsArchive       *gvs_archive_new                     (GBytes          *bytes,
+                                                       GError         **error);
+
+GvsArchive       *gvs_archive_new_for_path            (const char      *path,
+                                                       GError         **error);
+
+GvsDeserializer  *gvs_archive_get_deserializer        (GvsArchive      *archive);
+
+GVariant         *gvs_archive_get_document            (GvsArchive      *archive);
+
+gsize             gvs_archive_get_n_entities          (GvsArchive      *archive);
+
+const char       *gvs_archive_get_key_property        (GvsArchive      *archive);
+
+gpointer          gvs_archive_lookup                  (GvsArchive      *archive,
+                                                       const char      *key);
+
+gpointer          gvs_archive_lookup_id               (GvsArchive      *archive,
+                                                       gsize            id);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,209 @@
+/* gvs-boxed.c: Registry of transformations for boxed types
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-boxed.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+/*
+ * The registry is a GType -> GvsBoxedTransform hash table which is never
+ * modified once it has been published. Registering a transform copies the
+ * current table, adds the new entry and atomically swaps the copy in, so
+ * lookups (which happen for every boxed value) need no lock at all.
+ *
+ * Tables which have been replaced are kept on a list rather than freed,
+ * since another thread may still be reading from them. Registration is
+ * expected to happen a handful of times at startup, so this costs little.
+ */
+static GHashTable *registry = NULL;
+static GSList *retired_registries = NULL;
+G_LOCK_DEFINE_STATIC(registry);
+
+/******************************************************************************
+ *
+ * Built-in boxed transformations
+ *
+ ******************************************************************************/
+
+static GVariant *
+strv_serialize(GvsSerializer *self, const GValue *value, gpointer unused)
+{
+    const char * const * strv = g_value_get_boxed(value);
+    return g_variant_new_strv(strv, -1);
+}
+
+static void
+strv_deserialize(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+{
+    g_value_take_boxed(value, g_variant_dup_strv(variant, NULL));
+}
+
+/* Byte strings can share the GBytes' buffer rather than being copied a byte
+ * at a time */
+static GVariant *
+bytes_serialize(GvsSerializer *self, const GValue *value, gpointer unused)
+{
+    return g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING,
+                                    g_value_get_boxed(value), TRUE);
+}
+
+static void
+bytes_deserialize(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+{
+    /* g_variant_get_bytestring() doesn't handle embedded NULs, so instead we
+     * just grab the raw data */
+    g_value_take_boxed(value, g_variant_get_data_as_bytes(variant));
+}
+
+static GVariant *
+byte_array_serialize(GvsSerializer *self, const GValue *value, gpointer unused)
+{
+    GByteArray *array = g_value_get_boxed(value);
+
+    /* Copied, since unlike GBytes the array may change after we return */
+    return g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
+                                     array->data, array->len, sizeof(guint8));
+}
+
+static void
+byte_array_deserialize(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+{
+    gsize size;
+    const guint8 *data = g_variant_get_fixed_array(variant, &size, sizeof(guint8));
+    GByteArray *array = g_byte_array_sized_new(size);
+
+    g_byte_array_append(array, data, size);
+    g_value_take_boxed(value, array);
+}
+
+/******************************************************************************
+ *
+ * Registry
+ *
+ ******************************************************************************/
+
+/* Must be called with the registry lock held */
+static void
+register_transform_unlocked(GType                       boxed_type,
+                            GvsPropertySerializeFunc    serialize,
+                            GvsPropertyDeserializeFunc  deserialize,
+                            const GVariantType         *variant_type)
+{
+    GvsBoxedTransform *transform;
+    GHashTable *table;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* Copy the existing entries; the transforms themselves are immutable, so
+     * they can be shared between the old and new tables */
+    table = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    if (registry)
+    {
+        g_hash_table_iter_init(&iter, registry);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+            g_hash_table_insert(table, key, value);
+
+        retired_registries = g_slist_prepend(retired_registries, registry);
+    }
+
+    transform = g_slice_new(GvsBoxedTransform);
+    transform->type = boxed_type;
+    transform->serialize = serialize;
+    transform->deserialize = deserialize;
+    transform->variant_type = g_variant_type_copy(variant_type);
+
+    /* A replaced transform may still be in use by a reader, so it is leaked
+     * along with the table which held it */
+    g_hash_table_insert(table, GSIZE_TO_POINTER(boxed_type), transform);
+
+    g_atomic_pointer_set(&registry, table);
+}
+
+static void
+register_builtin_transforms(void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter(&initialized))
+    {
+        G_LOCK(registry);
+        register_transform_unlocked(G_TYPE_STRV,
+                                    strv_serialize, strv_deserialize,
+                                    G_VARIANT_TYPE_STRING_ARRAY);
+        register_transform_unlocked(G_TYPE_BYTES,
+                                    bytes_serialize, bytes_deserialize,
+                                    G_VARIANT_TYPE_BYTESTRING);
+        register_transform_unlocked(G_TYPE_BYTE_ARRAY,
+                                    byte_array_serialize, byte_array_deserialize,
+                                    G_VARIANT_TYPE_BYTESTRING);
+        G_UNLOCK(registry);
+
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+/* Returns the transform registered for exactly @boxed_type, or %NULL */
+const GvsBoxedTransform *
+_gvs_boxed_transform_lookup(GType boxed_type)
+{
+    GHashTable *table;
+
+    register_builtin_transforms();
+
+    table = g_atomic_pointer_get(&registry);
+
+    return g_hash_table_lookup(table, GSIZE_TO_POINTER(boxed_type));
+}
+
+/**
+ * gvs_register_boxed_transform:
+ * @boxed_type: A boxed #GType
+ * @serialize: (scope forever): Function to turn a #GValue holding a
+ *  non-%NULL @boxed_type into a #GVariant of type @variant_type
+ * @deserialize: (scope forever): Function reversing @serialize
+ * @variant_type: The type of the variants produced by @serialize
+ *
+ * Teaches GVS how to serialize values of @boxed_type wherever they occur,
+ * rather than registering functions for each property individually. Boxed
+ * values are stored once per document however many properties point at them,
+ * in the same way as objects.
+ *
+ * This may be called from any thread. Registering a transform for a type
+ * which already has one (including the built-in #GStrv, #GBytes and
+ * #GByteArray transforms) replaces it. The user data passed to @serialize and
+ * @deserialize is always %NULL.
+ */
+void
+gvs_register_boxed_transform(GType                       boxed_type,
+                             GvsPropertySerializeFunc    serialize,
+                             GvsPropertyDeserializeFunc  deserialize,
+                             const GVariantType         *variant_type)
+{
+    g_return_if_fail(G_TYPE_IS_BOXED(boxed_type));
+    g_return_if_fail(serialize != NULL);
+    g_return_if_fail(deserialize != NULL);
+    g_return_if_fail(variant_type != NULL);
+
+    register_builtin_transforms();
+
+    G_LOCK(registry);
+    register_transform_unlocked(boxed_type, serialize, deserialize, variant_type);
+    G_UNLOCK(registry);
+}
@@ -0,0 +1,38 @@
+/* gvs-boxed.h: Registry of transformations for boxed types
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_BOXED_H__
+#define __GVS_BOXED_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include "gvs-deserializer.h"
+#include "gvs-serializer.h"
+
+G_BEGIN_DECLS
+
+void         gvs_register_boxed_transform(GType                       boxed_type,
+                                          GvsPropertySerializeFunc    serialize,
+                                          GvsPropertyDeserializeFunc  deserialize,
+                                          const GVariantType         *variant_type);
+
+G_END_DECLS
+
+#endif
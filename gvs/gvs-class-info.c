@@ -0,0 +1,219 @@
+/* gvs-class-info.c: Per-class information cache
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <string.h>
+
+/* Whether the built-in transformation of @pspec always produces the same
+ * variant type, which is what a column needs */
+static gboolean
+pspec_is_columnar(GParamSpec *pspec)
+{
+    GType type = pspec->value_type;
+
+    if (g_param_spec_get_qdata(pspec, gvs_property_serialize_func_quark()) ||
+        g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark()) ||
+        gvs_container_info_peek(pspec))
+    {
+        return FALSE;
+    }
+
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+        case G_TYPE_CHAR:
+        case G_TYPE_UCHAR:
+        case G_TYPE_INT:
+        case G_TYPE_UINT:
+        case G_TYPE_LONG:
+        case G_TYPE_ULONG:
+        case G_TYPE_INT64:
+        case G_TYPE_UINT64:
+        case G_TYPE_FLOAT:
+        case G_TYPE_DOUBLE:
+        case G_TYPE_STRING:
+        case G_TYPE_ENUM:
+        case G_TYPE_FLAGS:
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+        case G_TYPE_BOXED:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+GvsClassInfo *
+_gvs_class_info_new(GType type)
+{
+    GvsClassInfo *info;
+    GParamSpec **pspecs;
+    guint n_pspecs, i;
+    GType parent;
+
+    g_return_val_if_fail(g_type_is_a(type, G_TYPE_OBJECT), NULL);
+
+    info = g_slice_new0(GvsClassInfo);
+    info->type = type;
+    info->klass = g_type_class_ref(type);
+    info->iface = g_type_interface_peek(info->klass, GVS_TYPE_SERIALIZABLE);
+
+    pspecs = g_object_class_list_properties(info->klass, &n_pspecs);
+
+    info->columnar = info->iface == NULL;
+
+    for (parent = type; parent && !info->value_like; parent = g_type_parent(parent))
+        info->value_like = g_type_get_qdata(parent, gvs_class_value_like_quark()) != NULL;
+
+    info->pspecs = g_new(GParamSpec *, n_pspecs);
+    info->construct_pspecs = g_new(GParamSpec *, n_pspecs);
+
+    for (i = 0; i < n_pspecs; i++)
+    {
+        GParamSpec *pspec = pspecs[i];
+
+        /* Skip read-only properties which we can't deserialize, write-only
+         * properties which are just stupid, and those we were asked to */
+        if ((pspec->flags & G_PARAM_READABLE) == 0 ||
+            (pspec->flags & G_PARAM_WRITABLE) == 0 ||
+            g_param_spec_get_qdata(pspec, gvs_property_transient_quark()))
+        {
+            continue;
+        }
+
+        info->pspecs[info->n_pspecs++] = pspec;
+
+        if (!pspec_is_columnar(pspec))
+            info->columnar = FALSE;
+
+        if (pspec->flags & G_PARAM_CONSTRUCT_ONLY)
+            info->construct_pspecs[info->n_construct_pspecs++] = pspec;
+    }
+
+    g_free(pspecs);
+
+    return info;
+}
+
+void
+_gvs_class_info_free(gpointer ptr)
+{
+    GvsClassInfo *info = ptr;
+    guint i;
+
+    if (info->defaults)
+    {
+        for (i = 0; i < info->n_pspecs; i++)
+            g_value_unset(&info->defaults[i]);
+
+        g_free(info->defaults);
+    }
+
+    g_free(info->sorted);
+    g_free(info->pspecs);
+    g_free(info->construct_pspecs);
+    g_type_class_unref(info->klass);
+
+    g_slice_free(GvsClassInfo, info);
+}
+
+/* Looks up @type in @cache (a GType -> GvsClassInfo table created with
+ * _gvs_class_info_free() as its value destructor), creating the entry the
+ * first time the class is seen */
+GvsClassInfo *
+_gvs_class_info_lookup(GHashTable *cache, GType type)
+{
+    GvsClassInfo *info = g_hash_table_lookup(cache, GSIZE_TO_POINTER(type));
+
+    if (G_UNLIKELY(info == NULL))
+    {
+        info = _gvs_class_info_new(type);
+        g_hash_table_insert(cache, GSIZE_TO_POINTER(type), info);
+    }
+
+    return info;
+}
+
+/* Returns an array of n_pspecs GValues holding the value of each pspec in a
+ * freshly constructed instance, which is what a property the deserializer
+ * leaves alone ends up with. Classes often set up their instances with
+ * values other than their paramspec defaults, so these are read from an
+ * instance made for the purpose, once per class; abstract classes can't
+ * have one, and fall back to the paramspec defaults. */
+const GValue *
+_gvs_class_info_get_defaults(GvsClassInfo *info)
+{
+    GObject *instance = NULL;
+    guint i;
+
+    if (G_UNLIKELY(info->defaults == NULL))
+    {
+        info->defaults = g_new0(GValue, info->n_pspecs);
+
+        if (!G_TYPE_IS_ABSTRACT(info->type))
+            instance = g_object_ref_sink(g_object_new(info->type, NULL));
+
+        for (i = 0; i < info->n_pspecs; i++)
+        {
+            g_value_init(&info->defaults[i], info->pspecs[i]->value_type);
+
+            if (instance)
+                g_object_get_property(instance, info->pspecs[i]->name,
+                                      &info->defaults[i]);
+            else
+                g_param_value_set_default(info->pspecs[i], &info->defaults[i]);
+        }
+
+        if (instance)
+            g_object_unref(instance);
+    }
+
+    return info->defaults;
+}
+
+static gint
+compare_pspec_names(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    GParamSpec **pspecs = user_data;
+
+    return strcmp(pspecs[*(const guint *) a]->name, pspecs[*(const guint *) b]->name);
+}
+
+/* Returns the indices of the n_pspecs pspecs in order of name, for
+ * GVS_SERIALIZER_CANONICAL */
+const guint *
+_gvs_class_info_get_sorted(GvsClassInfo *info)
+{
+    guint i;
+
+    if (G_UNLIKELY(info->sorted == NULL))
+    {
+        info->sorted = g_new(guint, info->n_pspecs);
+
+        for (i = 0; i < info->n_pspecs; i++)
+            info->sorted[i] = i;
+
+        g_qsort_with_data(info->sorted, info->n_pspecs, sizeof(guint),
+                          compare_pspec_names, info->pspecs);
+    }
+
+    return info->sorted;
+}
@@ -0,0 +1,950 @@
+/* gvs-containers.c: Encodings for GLib container properties
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * GArray, GPtrArray and GHashTable don't know what they contain, so unlike
+ * other boxed types they can't be handled by a transform keyed on the
+ * container type. Instead, properties holding them are registered with the
+ * element (and key) types, and serialized inline as a maybe-array:
+ *
+ *   GArray     -> m a<element>   e.g. "mai" for a GArray of gint
+ *   GPtrArray  -> m a<element>   "mams" for strings, "mamt" for object refs
+ *   GHashTable -> m a{<key><value>}
+ *
+ * GArrays of numeric types are bulk-copied into and out of a fixed-width
+ * variant array, with no per-element GVariant.
+ *
+ * With GVS_SERIALIZER_COMPACT, object refs are "mu" rather than "mt" and
+ * GArrays of gfloat are stored as their bit patterns ("au") rather than
+ * widened to "ad".
+ */
+
+/******************************************************************************
+ *
+ * Element types
+ *
+ ******************************************************************************/
+
+/* The GVariant type string for an element of @type, or NULL if @type can't
+ * be stored in @container_type */
+static const char *
+element_type_string(GType container_type, GType type, gboolean compact)
+{
+    GType fundamental = G_TYPE_FUNDAMENTAL(type);
+    const char *ref = compact ? "mu" : "mt";
+
+    if (container_type == G_TYPE_ARRAY)
+    {
+        switch (fundamental)
+        {
+            case G_TYPE_BOOLEAN:
+                return "b";
+            case G_TYPE_CHAR:
+            case G_TYPE_UCHAR:
+                return "y";
+            case G_TYPE_INT:
+            case G_TYPE_ENUM:
+                return "i";
+            case G_TYPE_UINT:
+            case G_TYPE_FLAGS:
+                return "u";
+            case G_TYPE_INT64:
+            case G_TYPE_LONG:
+                return "x";
+            case G_TYPE_UINT64:
+            case G_TYPE_ULONG:
+                return "t";
+            case G_TYPE_FLOAT:
+                return compact ? "u" : "d";
+            case G_TYPE_DOUBLE:
+                return "d";
+            default:
+                return NULL;
+        }
+    }
+    else if (container_type == G_TYPE_PTR_ARRAY)
+    {
+        switch (fundamental)
+        {
+            case G_TYPE_STRING:
+                return "ms";
+            case G_TYPE_OBJECT:
+            case G_TYPE_INTERFACE:
+                return ref;
+            default:
+                return NULL;
+        }
+    }
+    else if (container_type == G_TYPE_HASH_TABLE)
+    {
+        /* Hash table values are stored in a pointer */
+        switch (fundamental)
+        {
+            case G_TYPE_BOOLEAN:
+                return "b";
+            case G_TYPE_INT:
+                return "i";
+            case G_TYPE_UINT:
+                return "u";
+            case G_TYPE_STRING:
+                return "ms";
+            case G_TYPE_OBJECT:
+            case G_TYPE_INTERFACE:
+                return ref;
+            default:
+                return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static const char *
+key_type_string(GType type)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_INT:
+            return "i";
+        case G_TYPE_UINT:
+            return "u";
+        case G_TYPE_STRING:
+            return "s";
+        default:
+            return NULL;
+    }
+}
+
+/* The size of a GArray element of @type */
+static gsize
+element_size(GType type)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+            return sizeof(gboolean);
+        case G_TYPE_CHAR:
+        case G_TYPE_UCHAR:
+            return sizeof(guchar);
+        case G_TYPE_INT:
+        case G_TYPE_ENUM:
+            return sizeof(gint);
+        case G_TYPE_UINT:
+        case G_TYPE_FLAGS:
+            return sizeof(guint);
+        case G_TYPE_INT64:
+        case G_TYPE_UINT64:
+            return sizeof(gint64);
+        case G_TYPE_LONG:
+        case G_TYPE_ULONG:
+            return sizeof(glong);
+        case G_TYPE_FLOAT:
+            return sizeof(gfloat);
+        case G_TYPE_DOUBLE:
+            return sizeof(gdouble);
+        default:
+            g_assert_not_reached();
+            return 0;
+    }
+}
+
+/* Creates the description of a container, or returns NULL if the element
+ * or key types are not supported. @key_type is ignored except for
+ * GHashTable */
+static GVariantType *
+container_variant_type_new(GType container_type, GType key_type,
+                           GType element_type, gboolean compact)
+{
+    const char *element_str, *key_str = NULL;
+    GVariantType *type;
+    char *type_str;
+
+    element_str = element_type_string(container_type, element_type, compact);
+    if (!element_str)
+        return NULL;
+
+    if (container_type == G_TYPE_HASH_TABLE)
+    {
+        key_str = key_type_string(key_type);
+        if (!key_str)
+            return NULL;
+
+        type_str = g_strdup_printf("a{%s%s}", key_str, element_str);
+    }
+    else
+    {
+        type_str = g_strdup_printf("a%s", element_str);
+    }
+
+    type = g_variant_type_new(type_str);
+    g_free(type_str);
+
+    return type;
+}
+
+GvsContainerInfo *
+_gvs_container_info_new(GType container_type, GType key_type, GType element_type)
+{
+    GvsContainerInfo *info;
+    GVariantType *variant_type;
+
+    variant_type = container_variant_type_new(container_type, key_type,
+                                              element_type, FALSE);
+    if (!variant_type)
+        return NULL;
+
+    info = g_slice_new(GvsContainerInfo);
+    info->container_type = container_type;
+    info->key_type = key_type;
+    info->element_type = element_type;
+    info->variant_type = variant_type;
+    info->compact_variant_type = container_variant_type_new(container_type, key_type,
+                                                            element_type, TRUE);
+
+    return info;
+}
+
+void
+_gvs_container_info_free(gpointer ptr)
+{
+    GvsContainerInfo *info = ptr;
+
+    g_variant_type_free(info->variant_type);
+    g_variant_type_free(info->compact_variant_type);
+    g_slice_free(GvsContainerInfo, info);
+}
+
+/* The type @serializer will write for @info */
+static const GVariantType *
+container_variant_type(GvsSerializer *self, const GvsContainerInfo *info)
+{
+    if (gvs_serializer_get_flags(self) & GVS_SERIALIZER_COMPACT)
+        return info->compact_variant_type;
+
+    return info->variant_type;
+}
+
+/******************************************************************************
+ *
+ * Pointer-sized values (GPtrArray elements and GHashTable keys and values)
+ *
+ ******************************************************************************/
+
+static GVariant *
+pointer_serialize(GvsSerializer *self, GType type, gpointer ptr, gboolean is_key)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+            return g_variant_new_boolean(GPOINTER_TO_INT(ptr) != 0);
+        case G_TYPE_INT:
+            return g_variant_new_int32(GPOINTER_TO_INT(ptr));
+        case G_TYPE_UINT:
+            return g_variant_new_uint32(GPOINTER_TO_UINT(ptr));
+        case G_TYPE_STRING:
+            if (is_key)
+                return g_variant_new_string(ptr);
+            return g_variant_new("ms", ptr);
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+            return gvs_serializer_write_object_ref(self, ptr);
+        default:
+            g_assert_not_reached();
+            return NULL;
+    }
+}
+
+/* Returns an owned pointer, to be freed with pointer_destroy_func() */
+static gpointer
+pointer_deserialize(GvsDeserializer *self, GType type, GVariant *variant)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+            return GINT_TO_POINTER(g_variant_get_boolean(variant));
+        case G_TYPE_INT:
+            return GINT_TO_POINTER(g_variant_get_int32(variant));
+        case G_TYPE_UINT:
+            return GUINT_TO_POINTER(g_variant_get_uint32(variant));
+        case G_TYPE_STRING:
+        {
+            char *str = NULL;
+
+            if (g_variant_is_of_type(variant, G_VARIANT_TYPE_STRING))
+                str = g_variant_dup_string(variant, NULL);
+            else
+                g_variant_get(variant, "ms", &str);
+
+            return str;
+        }
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+        {
+            gpointer object = gvs_deserializer_read_object_ref(self, variant);
+            return object ? g_object_ref(object) : NULL;
+        }
+        default:
+            g_assert_not_reached();
+            return NULL;
+    }
+}
+
+/* Containers may hold NULL elements, which g_object_unref() won't accept */
+static void
+object_unref0(gpointer object)
+{
+    if (object)
+        g_object_unref(object);
+}
+
+static GDestroyNotify
+pointer_destroy_func(GType type)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_STRING:
+            return g_free;
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+            return object_unref0;
+        default:
+            return NULL;
+    }
+}
+
+/* Returns an owned copy of @ptr, to be freed with pointer_destroy_func() */
+static gpointer
+pointer_copy(GType type, gpointer ptr, GvsObjectMapFunc map, gpointer user_data)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_STRING:
+            return g_strdup(ptr);
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+        {
+            GObject *object = ptr ? map(ptr, user_data) : NULL;
+            return object ? g_object_ref(object) : NULL;
+        }
+        default:
+            return ptr;
+    }
+}
+
+static gboolean
+pointer_equal(GType type, gpointer a, gpointer b, GvsObjectPairFunc pair, gpointer user_data)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+            return !a == !b;
+        case G_TYPE_STRING:
+            return g_strcmp0(a, b) == 0;
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+            return pair(a, b, user_data);
+        default:
+            return a == b;
+    }
+}
+
+static guint
+pointer_hash(GType type, gpointer ptr, GvsObjectHashFunc hash, gpointer user_data)
+{
+    switch (G_TYPE_FUNDAMENTAL(type))
+    {
+        case G_TYPE_BOOLEAN:
+            return ptr != NULL;
+        case G_TYPE_STRING:
+            return ptr ? g_str_hash(ptr) : 0;
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+            return hash(ptr, user_data);
+        default:
+            return GPOINTER_TO_UINT(ptr);
+    }
+}
+
+/******************************************************************************
+ *
+ * GArray
+ *
+ ******************************************************************************/
+
+static GVariant *
+array_serialize(const GVariantType *variant_type, const GvsContainerInfo *info,
+                GArray *array)
+{
+    const GVariantType *element = g_variant_type_element(variant_type);
+    GType type = G_TYPE_FUNDAMENTAL(info->element_type);
+    gsize size = element_size(type);
+    guint i;
+
+    if (g_array_get_element_size(array) != size)
+    {
+        g_critical("GArray element size %u does not match registered type %s",
+                   g_array_get_element_size(array),
+                   g_type_name(info->element_type));
+        return g_variant_new_array(element, NULL, 0);
+    }
+
+    if (array->len == 0)
+    {
+        return g_variant_new_array(element, NULL, 0);
+    }
+
+    /* Types whose C representation matches GVariant's are copied in one go.
+     * The rest are converted into a temporary buffer which the variant
+     * then takes ownership of */
+    if (type == G_TYPE_BOOLEAN)
+    {
+        guint8 *buf = g_new(guint8, array->len);
+
+        for (i = 0; i < array->len; i++)
+            buf[i] = g_array_index(array, gboolean, i) ? 1 : 0;
+
+        return g_variant_new_from_data(variant_type, buf, array->len,
+                                       TRUE, g_free, buf);
+    }
+    else if (type == G_TYPE_FLOAT &&
+             g_variant_type_equal(element, G_VARIANT_TYPE_DOUBLE))
+    {
+        gdouble *buf = g_new(gdouble, array->len);
+
+        for (i = 0; i < array->len; i++)
+            buf[i] = g_array_index(array, gfloat, i);
+
+        return g_variant_new_from_data(variant_type, buf,
+                                       array->len * sizeof(gdouble),
+                                       TRUE, g_free, buf);
+    }
+    else if ((type == G_TYPE_LONG || type == G_TYPE_ULONG) &&
+             sizeof(glong) != sizeof(gint64))
+    {
+        gint64 *buf = g_new(gint64, array->len);
+
+        for (i = 0; i < array->len; i++)
+        {
+            if (type == G_TYPE_LONG)
+                buf[i] = g_array_index(array, glong, i);
+            else
+                buf[i] = g_array_index(array, gulong, i);
+        }
+
+        return g_variant_new_from_data(variant_type, buf,
+                                       array->len * sizeof(gint64),
+                                       TRUE, g_free, buf);
+    }
+
+    return g_variant_new_fixed_array(element, array->data, array->len, size);
+}
+
+static GArray *
+array_deserialize(const GvsContainerInfo *info, GVariant *variant)
+{
+    GType type = G_TYPE_FUNDAMENTAL(info->element_type);
+    gsize size = element_size(type);
+    gsize n_elements = 0, i;
+    gconstpointer data;
+    GArray *array;
+
+    /* Compact float arrays are already in the GArray's representation */
+    gboolean float_bits = g_variant_is_of_type(variant, G_VARIANT_TYPE("au"));
+
+    switch (type)
+    {
+        case G_TYPE_BOOLEAN:
+        case G_TYPE_CHAR:
+        case G_TYPE_UCHAR:
+            data = g_variant_get_fixed_array(variant, &n_elements, sizeof(guint8));
+            break;
+        case G_TYPE_FLOAT:
+            data = g_variant_get_fixed_array(variant, &n_elements,
+                                             float_bits ? sizeof(guint32) : 8);
+            break;
+        case G_TYPE_LONG:
+        case G_TYPE_ULONG:
+            data = g_variant_get_fixed_array(variant, &n_elements, 8);
+            break;
+        default:
+            data = g_variant_get_fixed_array(variant, &n_elements, size);
+            break;
+    }
+
+    array = g_array_sized_new(FALSE, FALSE, size, n_elements);
+    g_array_set_size(array, n_elements);
+
+    if (type == G_TYPE_BOOLEAN)
+    {
+        for (i = 0; i < n_elements; i++)
+            g_array_index(array, gboolean, i) = ((const guint8 *) data)[i];
+    }
+    else if (type == G_TYPE_FLOAT && !float_bits)
+    {
+        for (i = 0; i < n_elements; i++)
+            g_array_index(array, gfloat, i) = ((const gdouble *) data)[i];
+    }
+    else if ((type == G_TYPE_LONG || type == G_TYPE_ULONG) &&
+             sizeof(glong) != sizeof(gint64))
+    {
+        for (i = 0; i < n_elements; i++)
+            g_array_index(array, glong, i) = ((const gint64 *) data)[i];
+    }
+    else if (n_elements > 0)
+    {
+        memcpy(array->data, data, n_elements * size);
+    }
+
+    return array;
+}
+
+/******************************************************************************
+ *
+ * GPtrArray
+ *
+ ******************************************************************************/
+
+static GVariant *
+ptr_array_serialize(GvsSerializer *self, const GvsContainerInfo *info, GPtrArray *array)
+{
+    GVariantBuilder builder;
+    guint i;
+
+    g_variant_builder_init(&builder, container_variant_type(self, info));
+
+    for (i = 0; i < array->len; i++)
+    {
+        g_variant_builder_add_value(&builder,
+                pointer_serialize(self, info->element_type,
+                                  g_ptr_array_index(array, i), FALSE));
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+static GPtrArray *
+ptr_array_deserialize(GvsDeserializer *self, const GvsContainerInfo *info, GVariant *variant)
+{
+    GPtrArray *array;
+    GVariantIter iter;
+    GVariant *child;
+
+    array = g_ptr_array_new_full(g_variant_n_children(variant),
+                                 pointer_destroy_func(info->element_type));
+
+    g_variant_iter_init(&iter, variant);
+    while ((child = g_variant_iter_next_value(&iter)))
+    {
+        g_ptr_array_add(array,
+                        pointer_deserialize(self, info->element_type, child));
+        g_variant_unref(child);
+    }
+
+    return array;
+}
+
+/******************************************************************************
+ *
+ * GHashTable
+ *
+ ******************************************************************************/
+
+static gint
+compare_string_keys(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+static gint
+compare_int_keys(gconstpointer a, gconstpointer b)
+{
+    gint int_a = GPOINTER_TO_INT(*(const gpointer *) a);
+    gint int_b = GPOINTER_TO_INT(*(const gpointer *) b);
+
+    return (int_a > int_b) - (int_a < int_b);
+}
+
+static gint
+compare_uint_keys(gconstpointer a, gconstpointer b)
+{
+    guint uint_a = GPOINTER_TO_UINT(*(const gpointer *) a);
+    guint uint_b = GPOINTER_TO_UINT(*(const gpointer *) b);
+
+    return (uint_a > uint_b) - (uint_a < uint_b);
+}
+
+static GVariant *
+hash_table_serialize(GvsSerializer *self, const GvsContainerInfo *info, GHashTable *table)
+{
+    const GVariantType *variant_type = container_variant_type(self, info);
+    const GVariantType *entry_type = g_variant_type_element(variant_type);
+    GVariantBuilder builder;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_variant_builder_init(&builder, variant_type);
+
+    /* Canonical documents list entries in order of key, which also fixes
+     * the order in which objects they refer to are numbered */
+    if (gvs_serializer_get_flags(self) & GVS_SERIALIZER_CANONICAL)
+    {
+        guint n_keys, i;
+        gpointer *keys = g_hash_table_get_keys_as_array(table, &n_keys);
+
+        if (G_TYPE_FUNDAMENTAL(info->key_type) == G_TYPE_STRING)
+            qsort(keys, n_keys, sizeof(gpointer), compare_string_keys);
+        else if (G_TYPE_FUNDAMENTAL(info->key_type) == G_TYPE_INT)
+            qsort(keys, n_keys, sizeof(gpointer), compare_int_keys);
+        else
+            qsort(keys, n_keys, sizeof(gpointer), compare_uint_keys);
+
+        for (i = 0; i < n_keys; i++)
+        {
+            g_variant_builder_open(&builder, entry_type);
+            g_variant_builder_add_value(&builder,
+                    pointer_serialize(self, info->key_type, keys[i], TRUE));
+            g_variant_builder_add_value(&builder,
+                    pointer_serialize(self, info->element_type,
+                                      g_hash_table_lookup(table, keys[i]), FALSE));
+            g_variant_builder_close(&builder);
+        }
+
+        g_free(keys);
+
+        return g_variant_builder_end(&builder);
+    }
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        g_variant_builder_open(&builder, entry_type);
+        g_variant_builder_add_value(&builder,
+                pointer_serialize(self, info->key_type, key, TRUE));
+        g_variant_builder_add_value(&builder,
+                pointer_serialize(self, info->element_type, value, FALSE));
+        g_variant_builder_close(&builder);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+static GHashTable *
+hash_table_deserialize(GvsDeserializer *self, const GvsContainerInfo *info, GVariant *variant)
+{
+    GHashTable *table;
+    GVariantIter iter;
+    GVariant *key, *value;
+
+    if (G_TYPE_FUNDAMENTAL(info->key_type) == G_TYPE_STRING)
+    {
+        table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                      pointer_destroy_func(info->element_type));
+    }
+    else
+    {
+        table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                      pointer_destroy_func(info->element_type));
+    }
+
+    g_variant_iter_init(&iter, variant);
+    while (g_variant_iter_next(&iter, "{@?@*}", &key, &value))
+    {
+        g_hash_table_insert(table,
+                            pointer_deserialize(self, info->key_type, key),
+                            pointer_deserialize(self, info->element_type, value));
+        g_variant_unref(key);
+        g_variant_unref(value);
+    }
+
+    return table;
+}
+
+/******************************************************************************
+ *
+ * Entry points
+ *
+ ******************************************************************************/
+
+/* Returns a floating variant of type "m" + the container's variant type */
+GVariant *
+_gvs_container_serialize(GvsSerializer          *self,
+                         const GvsContainerInfo *info,
+                         const GValue           *value)
+{
+    const GVariantType *variant_type = container_variant_type(self, info);
+    gpointer container = g_value_get_boxed(value);
+    GVariant *variant = NULL;
+
+    if (container)
+    {
+        if (info->container_type == G_TYPE_ARRAY)
+            variant = array_serialize(variant_type, info, container);
+        else if (info->container_type == G_TYPE_PTR_ARRAY)
+            variant = ptr_array_serialize(self, info, container);
+        else
+            variant = hash_table_serialize(self, info, container);
+    }
+
+    return g_variant_new_maybe(variant_type, variant);
+}
+
+/* @value must already be initialized to info->container_type */
+void
+_gvs_container_deserialize(GvsDeserializer        *self,
+                           const GvsContainerInfo *info,
+                           GVariant               *variant,
+                           GValue                 *value)
+{
+    GVariant *child = g_variant_get_maybe(variant);
+    gpointer container = NULL;
+
+    /* Anything but the layout the container was registered with would be
+     * read as garbage, or with an element count out of all proportion */
+    if (child && !g_variant_is_of_type(child, info->variant_type) &&
+        !g_variant_is_of_type(child, info->compact_variant_type))
+    {
+        g_critical("Expected a serialized %s, got type %s",
+                   g_type_name(info->container_type),
+                   g_variant_get_type_string(child));
+        g_clear_pointer(&child, g_variant_unref);
+    }
+
+    if (child)
+    {
+        if (info->container_type == G_TYPE_ARRAY)
+            container = array_deserialize(info, child);
+        else if (info->container_type == G_TYPE_PTR_ARRAY)
+            container = ptr_array_deserialize(self, info, child);
+        else
+            container = hash_table_deserialize(self, info, child);
+
+        g_variant_unref(child);
+    }
+
+    g_value_take_boxed(value, container);
+}
+
+/* Copies the container held by @src into @dest, which must already be
+ * initialized to info->container_type, as a round trip through
+ * _gvs_container_serialize() and _gvs_container_deserialize() would: object
+ * elements are replaced by what @map returns for them */
+void
+_gvs_container_copy(const GvsContainerInfo *info,
+                    const GValue           *src,
+                    GValue                 *dest,
+                    GvsObjectMapFunc        map,
+                    gpointer                user_data)
+{
+    gpointer container = g_value_get_boxed(src);
+    gpointer copy = NULL;
+    guint i;
+
+    if (!container)
+    {
+        /* Nothing to copy */
+    }
+    else if (info->container_type == G_TYPE_ARRAY)
+    {
+        GArray *array = container;
+        gsize size = element_size(G_TYPE_FUNDAMENTAL(info->element_type));
+
+        copy = g_array_sized_new(FALSE, FALSE, size, array->len);
+        g_array_append_vals(copy, array->data, array->len);
+    }
+    else if (info->container_type == G_TYPE_PTR_ARRAY)
+    {
+        GPtrArray *array = container;
+
+        copy = g_ptr_array_new_full(array->len, pointer_destroy_func(info->element_type));
+
+        for (i = 0; i < array->len; i++)
+        {
+            g_ptr_array_add(copy, pointer_copy(info->element_type,
+                                               g_ptr_array_index(array, i),
+                                               map, user_data));
+        }
+    }
+    else
+    {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        if (G_TYPE_FUNDAMENTAL(info->key_type) == G_TYPE_STRING)
+        {
+            copy = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                         pointer_destroy_func(info->element_type));
+        }
+        else
+        {
+            copy = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         pointer_destroy_func(info->element_type));
+        }
+
+        g_hash_table_iter_init(&iter, container);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+        {
+            g_hash_table_insert(copy,
+                                pointer_copy(info->key_type, key, map, user_data),
+                                pointer_copy(info->element_type, value, map, user_data));
+        }
+    }
+
+    g_value_take_boxed(dest, copy);
+}
+
+/* Whether the containers held by @a and @b would serialize the same, taking
+ * hash tables as unordered. Object elements are compared with @pair. */
+gboolean
+_gvs_container_equal(const GvsContainerInfo *info,
+                     const GValue           *a,
+                     const GValue           *b,
+                     GvsObjectPairFunc       pair,
+                     gpointer                user_data)
+{
+    gpointer container_a = g_value_get_boxed(a);
+    gpointer container_b = g_value_get_boxed(b);
+    guint i;
+
+    if (!container_a || !container_b)
+        return container_a == container_b;
+
+    if (info->container_type == G_TYPE_ARRAY)
+    {
+        GArray *array_a = container_a, *array_b = container_b;
+        GType type = G_TYPE_FUNDAMENTAL(info->element_type);
+
+        if (array_a->len != array_b->len)
+            return FALSE;
+
+        if (type != G_TYPE_BOOLEAN)
+            return memcmp(array_a->data, array_b->data, array_a->len * element_size(type)) == 0;
+
+        for (i = 0; i < array_a->len; i++)
+        {
+            if (!g_array_index(array_a, gboolean, i) != !g_array_index(array_b, gboolean, i))
+                return FALSE;
+        }
+    }
+    else if (info->container_type == G_TYPE_PTR_ARRAY)
+    {
+        GPtrArray *array_a = container_a, *array_b = container_b;
+
+        if (array_a->len != array_b->len)
+            return FALSE;
+
+        for (i = 0; i < array_a->len; i++)
+        {
+            if (!pointer_equal(info->element_type, g_ptr_array_index(array_a, i),
+                               g_ptr_array_index(array_b, i), pair, user_data))
+            {
+                return FALSE;
+            }
+        }
+    }
+    else
+    {
+        GHashTableIter iter;
+        gpointer key, value, value_b;
+
+        if (g_hash_table_size(container_a) != g_hash_table_size(container_b))
+            return FALSE;
+
+        g_hash_table_iter_init(&iter, container_a);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+        {
+            if (!g_hash_table_lookup_extended(container_b, key, NULL, &value_b) ||
+                !pointer_equal(info->element_type, value, value_b, pair, user_data))
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/* A hash of the container held by @value agreeing with
+ * _gvs_container_equal(). Object elements are hashed with @hash. */
+guint
+_gvs_container_hash(const GvsContainerInfo *info,
+                    const GValue           *value,
+                    GvsObjectHashFunc       hash,
+                    gpointer                user_data)
+{
+    gpointer container = g_value_get_boxed(value);
+    guint result = 0;
+    guint i;
+
+    if (!container)
+        return 0;
+
+    if (info->container_type == G_TYPE_ARRAY)
+    {
+        GArray *array = container;
+        GType type = G_TYPE_FUNDAMENTAL(info->element_type);
+        gsize size = element_size(type);
+
+        for (i = 0; i < array->len; i++)
+        {
+            const guchar *element = (const guchar *) array->data + i * size;
+            gsize j;
+
+            if (type == G_TYPE_BOOLEAN)
+            {
+                result = result * 31 + (*(const gboolean *) element != 0);
+                continue;
+            }
+
+            for (j = 0; j < size; j++)
+                result = result * 31 + element[j];
+        }
+    }
+    else if (info->container_type == G_TYPE_PTR_ARRAY)
+    {
+        GPtrArray *array = container;
+
+        for (i = 0; i < array->len; i++)
+        {
+            result = result * 31 + pointer_hash(info->element_type,
+                                                g_ptr_array_index(array, i),
+                                                hash, user_data);
+        }
+    }
+    else
+    {
+        GHashTableIter iter;
+        gpointer key, element;
+
+        /* Entries are summed, so their order doesn't matter */
+        g_hash_table_iter_init(&iter, container);
+        while (g_hash_table_iter_next(&iter, &key, &element))
+        {
+            result += pointer_hash(info->key_type, key, hash, user_data) * 31 +
+                      pointer_hash(info->element_type, element, hash, user_data);
+        }
+    }
+
+    return result;
+}
@@ -21,20 +21,121 @@
 #include "gvs-deserializer.h"
 
 #include "gvs-gobject.h"
+#include "gvs-private.h"
+#include "gvs-trace.h"
 #undef __GVS_INSIDE__
 
+#include <gio/gio.h>
+#include <string.h>
+
+/* Entities of one class stored as columns, see gvs-serializer.c */
+typedef struct
+{
+    GvsClassInfo *info;
+    GParamSpec  **pspecs;
+    GVariant    **columns;
+    guint         n_columns;
+} ColumnGroup;
+
+/* Where an entity's state lives: row @index of the entity array, or element
+ * @index of each column of @group */
+typedef struct
+{
+    ColumnGroup *group;
+    gsize        index;
+} EntityLocation;
+
+/* The document being read */
+typedef struct
+{
+    GVariant       *toplevel;
+    gsize           n_entities;
+    gpointer       *entities;
+    GType          *entity_types;
+
+    /* Only used for documents with columns */
+    ColumnGroup    *groups;
+    guint           n_groups;
+    EntityLocation *locations;
+
+    /* Only used when entities are created as they are reached rather than
+     * all up front. Entities come from @fetch if it is set, and each one
+     * created is appended to @created. */
+    GvsEntityFetchFunc fetch;
+    gpointer        fetch_data;
+    GArray         *created;
+
+    /* Only set for documents read in lazy mode */
+    GvsLazyDocument   *lazy;
+
+    /* The entity being materialized, which is created whatever the type
+     * filter says, and which entities the filter has left out so far */
+    gsize           root;
+    gboolean       *filtered;
+
+    /* The string table of a document written with GVS_SERIALIZER_VALUE_TABLE,
+     * split into @strings when first needed. The strings point into
+     * @string_table. */
+    GVariant       *string_table;
+    const char    **strings;
+    gsize           n_strings;
+} DocumentState;
+
+/* A document which outlives the call that read it: one read in lazy mode,
+ * or one opened with _gvs_deserializer_open_document(). Its entity table
+ * holds weak pointers to the objects materialized so far, whose ids are
+ * in the set @materialized. Objects with lazy properties still to resolve keep it
+ * alive through their LazyRefs; once the last of those goes, so does the
+ * document. */
+struct _GvsLazyDocument
+{
+    gint             ref_count;
+    GvsDeserializer *deserializer;
+    DocumentState    state;
+    GHashTable      *materialized;
+    GDestroyNotify   fetch_destroy;
+};
+
+/* A lazy property of an object, and the entity it refers to */
+typedef struct
+{
+    GParamSpec *pspec;
+    gsize       id;
+} LazyRef;
+
+typedef struct
+{
+    GvsLazyDocument *document;
+    GArray       *refs;
+} LazyRefs;
+
+/* Property names given to gvs_deserializer_include_properties() or
+ * gvs_deserializer_exclude_properties() for a class */
+typedef struct
+{
+    gboolean    include;
+    GHashTable *names;
+} PropertyFilter;
+
 struct _GvsDeserializerPrivate
 {
-    GVariant  *toplevel;
-    gpointer  *entities;
+    DocumentState   doc;
+    GHashTable     *class_info;
+    gboolean        lazy;
+    GvsStats        stats;
+
+    /* Filters: the types to create, or NULL for all, GType -> PropertyFilter,
+     * and the filter which applies to each class, worked out when needed */
+    GHashTable     *type_filter;
+    GHashTable     *property_filters;
+    GHashTable     *class_filters;
+    gboolean        skip_filtered_refs;
 };
 
-#define GVS_ENTITY_TYPE            ((const GVariantType*) "(sv)")
-#define GVS_ENTITY_REF_TYPE        ((const GVariantType*) "u")
-#define GVS_ENTITY_ARRAY_TYPE      ((const GVariantType*) "a(sv)")
-#define GVS_SERIALIZED_OBJECT_TYPE ((const GVariantType*) "(uqa(sv))")
-#define GVS_MAGIC_NUMBER           ((guint32) 0x6776736F) /*'gvso'*/
-#define GVS_PROTOCOL_VERSION       ((guint16) 1)
+G_DEFINE_QUARK(gvs-lazy-refs, lazy_refs)
+
+/* Held in the entity type table while an entity is created */
+#define ENTITY_BEING_CREATED       G_TYPE_NONE
 
 static gpointer get_entity(GvsDeserializer *self, gsize id);
 
@@ -47,60 +148,116 @@ static gpointer get_entity(GvsDeserializer *self, gsize id);
 
 /******************************************************************************
  *
- * Internal GvsPropertySerializeFuncs for known types
- *
- ******************************************************************************/
-
-/*
+ * Numbers and references
  *
- * Built-in boxed transformations
+ * Compact documents narrow integers, store floats as their bit pattern and
+ * use 32-bit entity ids, so these are read according to the type actually
+ * present rather than the type of the destination.
  *
- */
+ ******************************************************************************/
 
-static void
-strv_deserialize(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+static gsize
+read_entity_id(GVariant *ref)
 {
-    char **strings = g_variant_dup_strv (variant, NULL);
-    g_value_take_boxed(value, strings);
-    //g_free (strings);
+    if (g_variant_is_of_type(ref, GVS_COMPACT_ENTITY_REF_TYPE))
+        return g_variant_get_uint32(ref);
+
+    return g_variant_get_uint64(ref);
 }
 
-static void
-gbytes_deserialize(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+/* Unsigned 64-bit values come back unchanged in two's complement */
+static gint64
+read_integer(GVariant *variant)
 {
-    /* g_variant_get_bytestring() doesn't handle embedded NULs, so instead we
-     * just grab the raw data.
-     * FIXME: Need to test whether the refcounting is right here */
-    GBytes *bytes = g_variant_get_data_as_bytes (variant);
-    g_value_take_boxed (value, bytes);
+    switch (g_variant_classify(variant))
+    {
+        case G_VARIANT_CLASS_BYTE:
+            return g_variant_get_byte(variant);
+        case G_VARIANT_CLASS_INT16:
+            return g_variant_get_int16(variant);
+        case G_VARIANT_CLASS_UINT16:
+            return g_variant_get_uint16(variant);
+        case G_VARIANT_CLASS_INT32:
+            return g_variant_get_int32(variant);
+        case G_VARIANT_CLASS_UINT32:
+            return g_variant_get_uint32(variant);
+        case G_VARIANT_CLASS_INT64:
+            return g_variant_get_int64(variant);
+        case G_VARIANT_CLASS_UINT64:
+            return g_variant_get_uint64(variant);
+        default:
+            g_critical("Expected a serialized integer, got type %s",
+                       g_variant_get_type_string(variant));
+            return 0;
+    }
 }
 
-typedef struct
+static gdouble
+read_float(GVariant *variant)
 {
-    const char *gtype_name;
-    GvsPropertyDeserializeFunc deserialize;
-} BuiltinTransform;
+    if (g_variant_is_of_type(variant, G_VARIANT_TYPE_UINT32))
+    {
+        guint32 bits = g_variant_get_uint32(variant);
+        gfloat value;
 
-static const BuiltinTransform builtin_transforms[] = {
-    { "GStrv",  strv_deserialize },
-    { "GBytes", gbytes_deserialize },
-    { NULL, }
-};
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    return g_variant_get_double(variant);
+}
 
-static const BuiltinTransform *
-lookup_builtin_transform(GType type)
+/******************************************************************************
+ *
+ * Strings
+ *
+ * Documents written with GVS_SERIALIZER_VALUE_TABLE store strings as an "mh"
+ * index into the string table which ends the document. The table is only
+ * split into strings once one needs it, since readers creating a few
+ * entities of a large document may never read a string at all. Strings are
+ * not interned: each property or field read from the table gets a copy of
+ * its own, as it would from an inline string.
+ *
+ ******************************************************************************/
+
+/* Returns the string @variant refers to, which lives as long as the
+ * document, or %NULL */
+static const char *
+read_table_string(GvsDeserializer *self, GVariant *variant)
 {
-    const char *name = g_type_name(type);
-    const BuiltinTransform *t = NULL;
+    DocumentState *doc = &self->priv->doc;
+    GVariant *child = g_variant_get_maybe(variant);
+    gint32 index;
+
+    if (!child)
+        return NULL;
+
+    index = g_variant_get_handle(child);
+    g_variant_unref(child);
+
+    if (!doc->strings && doc->string_table)
+        doc->strings = g_variant_get_strv(doc->string_table, &doc->n_strings);
 
-    for (t = builtin_transforms; t->gtype_name != NULL; t++) {
-        if (g_str_equal(t->gtype_name, name))
-            return t;
+    if (index < 0 || (gsize) index >= doc->n_strings)
+    {
+        g_critical("Invalid GVS string index %d", index);
+        return NULL;
     }
 
-    return NULL;
+    return doc->strings[index];
 }
 
+/******************************************************************************
+ *
+ * Internal GvsPropertySerializeFuncs for known types
+ *
+ ******************************************************************************/
+
+/*
+ *
+ * Boxed types
+ *
+ */
 static void
 deserialize_boxed(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
 {
@@ -108,15 +265,17 @@ deserialize_boxed(GvsDeserializer *self, GVariant *variant, GValue *value, gpoin
 
     if (child)
     {
-        gsize child_id = g_variant_get_uint64(child);
-        g_value_take_boxed(value, get_entity(self, child_id));
+        gsize child_id = read_entity_id(child);
+
+        /* The entity table keeps its own copy, since the same boxed value
+         * may be referenced from more than one place */
+        g_value_set_boxed(value, get_entity(self, child_id));
+        g_variant_unref (child);
     }
     else
     {
         g_value_set_boxed(value, NULL);
     }
-  
-    g_variant_unref (child);
 }
 
 
@@ -140,20 +299,27 @@ deserialize_fundamental(GvsDeserializer *self, GVariant *variant, GValue *value,
             g_value_set_double(value, g_variant_get_double(variant));
             break;
         case G_TYPE_FLOAT:
-            g_value_set_float(value, (float) g_variant_get_double(variant));
+            g_value_set_float(value, (float) read_float(variant));
             break;
         case G_TYPE_INT:
-            g_value_set_int(value, g_variant_get_int32(variant));
+            g_value_set_int(value, read_integer(variant));
             break;
         case G_TYPE_INT64:
-            g_value_set_int64(value, g_variant_get_int64(variant));
+            g_value_set_int64(value, read_integer(variant));
             break;
         case G_TYPE_LONG:
-            g_value_set_long(value, g_variant_get_int64(variant));
+            g_value_set_long(value, read_integer(variant));
             break;
         case G_TYPE_STRING:
         {
             char *str = NULL;
+
+            if (g_variant_is_of_type(variant, GVS_STRING_REF_TYPE))
+            {
+                g_value_set_string(value, read_table_string(self, variant));
+                break;
+            }
+
             g_variant_get(variant, "ms", &str);
             g_value_take_string(value, str);
             break;
@@ -162,13 +328,13 @@ deserialize_fundamental(GvsDeserializer *self, GVariant *variant, GValue *value,
             g_value_set_uchar(value, g_variant_get_byte(variant));
             break;
         case G_TYPE_UINT:
-            g_value_set_uint(value, g_variant_get_uint32(variant));
+            g_value_set_uint(value, read_integer(variant));
             break;
         case G_TYPE_UINT64:
-            g_value_set_uint64(value, g_variant_get_uint64(variant));
+            g_value_set_uint64(value, read_integer(variant));
             break;
         case G_TYPE_ULONG:
-            g_value_set_ulong(value, g_variant_get_uint64(variant));
+            g_value_set_ulong(value, read_integer(variant));
             break;
         case G_TYPE_VARIANT:
             g_value_take_variant(value, g_variant_get_variant(variant));
@@ -188,13 +354,13 @@ deserialize_fundamental(GvsDeserializer *self, GVariant *variant, GValue *value,
 static void
 deserialize_enum(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
 {
-    g_value_set_enum(value, g_variant_get_int32(variant));
+    g_value_set_enum(value, read_integer(variant));
 }
 
 static void
 deserialize_flags(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
 {
-    g_value_set_flags(value, g_variant_get_uint32(variant));
+    g_value_set_flags(value, read_integer(variant));
 }
 
 /*
@@ -202,23 +368,220 @@ deserialize_flags(GvsDeserializer *self, GVariant *variant, GValue *value, gpoin
  * Objects
  *
  */
-static void
-deserialize_object(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+static gpointer
+deserialize_object_ref(GvsDeserializer *self, GVariant *variant)
 {
     GVariant *child = g_variant_get_maybe(variant);
+    gpointer object = NULL;
 
     if (child)
     {
-        gsize child_id = g_variant_get_uint64(child);
-        g_value_set_object(value, get_entity(self, child_id));
+        object = get_entity(self, read_entity_id(child));
+        g_variant_unref(child);
+    }
+
+    return object;
+}
+
+static void
+deserialize_object(GvsDeserializer *self, GVariant *variant, GValue *value, gpointer unused)
+{
+    gpointer object = deserialize_object_ref(self, variant);
+
+    /* Such as a GListStore written in place of some other GListModel */
+    if (object && !G_TYPE_CHECK_INSTANCE_TYPE(object, G_VALUE_TYPE(value)))
+    {
+        g_critical("Can't read a %s into a property of type %s",
+                   G_OBJECT_TYPE_NAME(object), G_VALUE_TYPE_NAME(value));
+        return;
+    }
+
+    g_value_set_object(value, object);
+}
+
+/*
+ *
+ * Filters
+ *
+ */
+static inline gboolean
+has_filters(GvsDeserializer *self)
+{
+    return self->priv->type_filter || g_hash_table_size(self->priv->property_filters);
+}
+
+static void
+property_filter_free(gpointer ptr)
+{
+    PropertyFilter *filter = ptr;
+
+    g_hash_table_destroy(filter->names);
+    g_slice_free(PropertyFilter, filter);
+}
+
+/* Whether objects of @type are left out by gvs_deserializer_include_types() */
+static gboolean
+type_filtered(GvsDeserializer *self, GType type)
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    if (!self->priv->type_filter || !g_type_is_a(type, G_TYPE_OBJECT))
+        return FALSE;
+
+    g_hash_table_iter_init(&iter, self->priv->type_filter);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        if (g_type_is_a(type, GPOINTER_TO_SIZE(key)))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Whether property @name of @info is left out by the property filters */
+static gboolean
+property_filtered(GvsDeserializer *self, GvsClassInfo *info, const char *name)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    PropertyFilter *filter = NULL;
+    gpointer cached;
+    GType type;
+
+    if (g_hash_table_size(priv->property_filters) == 0)
+        return FALSE;
+
+    if (g_hash_table_lookup_extended(priv->class_filters,
+                                     GSIZE_TO_POINTER(info->type), NULL, &cached))
+    {
+        filter = cached;
     }
     else
     {
-        g_value_set_object(value, NULL);
+        for (type = info->type; type && !filter; type = g_type_parent(type))
+            filter = g_hash_table_lookup(priv->property_filters, GSIZE_TO_POINTER(type));
+
+        g_hash_table_insert(priv->class_filters, GSIZE_TO_POINTER(info->type), filter);
+    }
+
+    return filter && g_hash_table_contains(filter->names, name) != filter->include;
+}
+
+/* Whether @variant, the value of object property @pspec, refers to an entity
+ * left out by the type filter, and the property should be left alone */
+static gboolean
+skip_filtered_ref(GvsDeserializer *self, GParamSpec *pspec, GVariant *variant)
+{
+    DocumentState *doc = &self->priv->doc;
+    GVariant *child;
+    gsize id;
+
+    if (!self->priv->skip_filtered_refs || !self->priv->type_filter ||
+        !(G_TYPE_IS_OBJECT(pspec->value_type) || G_TYPE_IS_INTERFACE(pspec->value_type)) ||
+        g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark()) ||
+        !g_variant_is_of_type(variant, G_VARIANT_TYPE_MAYBE))
+    {
+        return FALSE;
     }
+
+    child = g_variant_get_maybe(variant);
+    if (!child)
+        return FALSE;
+
+    id = read_entity_id(child);
+    g_variant_unref(child);
+
+    return id < doc->n_entities && !get_entity(self, id) &&
+           doc->filtered && doc->filtered[id];
 }
 
+/*
+ *
+ * Properties registered with gvs_register_property_offset()
+ *
+ */
+static void
+deserialize_field(GvsDeserializer *self, GObject *object,
+                  const GvsFieldAccessor *field, GVariant *variant)
+{
+    gpointer mem = G_STRUCT_MEMBER_P(object, field->offset);
+
+    switch (field->kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            *(gboolean *) mem = g_variant_get_boolean(variant);
+            break;
+        case GVS_FIELD_CHAR:
+            *(gint8 *) mem = g_variant_get_byte(variant);
+            break;
+        case GVS_FIELD_UCHAR:
+            *(guint8 *) mem = g_variant_get_byte(variant);
+            break;
+        case GVS_FIELD_INT:
+        case GVS_FIELD_ENUM:
+            *(gint *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_UINT:
+        case GVS_FIELD_FLAGS:
+            *(guint *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_LONG:
+            *(glong *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_ULONG:
+            *(gulong *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_INT64:
+            *(gint64 *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_UINT64:
+            *(guint64 *) mem = read_integer(variant);
+            break;
+        case GVS_FIELD_FLOAT:
+            *(gfloat *) mem = (gfloat) read_float(variant);
+            break;
+        case GVS_FIELD_DOUBLE:
+            *(gdouble *) mem = g_variant_get_double(variant);
+            break;
+        case GVS_FIELD_STRING:
+        {
+            char *str = NULL;
+
+            if (g_variant_is_of_type(variant, GVS_STRING_REF_TYPE))
+                str = g_strdup(read_table_string(self, variant));
+            else
+                g_variant_get(variant, "ms", &str);
+
+            g_free(*(char **) mem);
+            *(char **) mem = str;
+            break;
+        }
+        case GVS_FIELD_OBJECT:
+        {
+            GObject *old = *(GObject **) mem;
+            GObject *target = deserialize_object_ref(self, variant);
+
+            *(GObject **) mem = target ? g_object_ref(target) : NULL;
+            if (old)
+                g_object_unref(old);
+            break;
+        }
+        case GVS_FIELD_OBJECT_UNOWNED:
+        {
+            GObject *target = deserialize_object_ref(self, variant);
+            DocumentState *doc = &self->priv->doc;
 
+            /* The entity table lets go of everything but the root, which
+             * keeps the target alive in its place */
+            _gvs_keep_alive(doc->entities[doc->root], target);
+            *(GObject **) mem = target;
+            break;
+        }
+        default:
+            g_assert_not_reached();
+            break;
+    }
+}
 
 /******************************************************************************
  *
@@ -229,13 +592,30 @@ deserialize_object(GvsDeserializer *self, GVariant *variant, GValue *value, gpoi
 static void
 deserialize_pspec(GvsDeserializer *self, GParamSpec *pspec, GVariant *variant, GValue *value)
 {
+    const GvsDeserializeClosure *closure;
+    const GvsContainerInfo *container;
     GvsPropertyDeserializeFunc func = NULL;
+    gpointer user_data = NULL;
     GType type = pspec->value_type;
 
+    GVS_TRACE2(deserialize_property_entry, pspec->name, g_variant_get_size(variant));
+
     /* Try to find the right deserialization function */
-    func = g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark());
+    closure = g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark());
 
-    if (func == NULL)
+    if (closure)
+    {
+        func = closure->func;
+        user_data = closure->user_data;
+    }
+    else if ((container = gvs_container_info_peek(pspec)))
+    {
+        g_value_init(value, type);
+        _gvs_container_deserialize(self, container, variant, value);
+        GVS_TRACE2(deserialize_property_return, pspec->name, g_type_name(type));
+        return;
+    }
+    else
     {
         if (G_TYPE_IS_FUNDAMENTAL(type))
         {
@@ -266,7 +646,7 @@ deserialize_pspec(GvsDeserializer *self, GParamSpec *pspec, GVariant *variant, G
     if (func)
     {
         g_value_init (value, type);
-        func(self, variant, value, NULL);
+        func(self, variant, value, user_data);
     }
     else
     {
@@ -274,20 +654,91 @@ deserialize_pspec(GvsDeserializer *self, GParamSpec *pspec, GVariant *variant, G
                   "Use gvs_register_property_deserialize_func() in your class_init function\n",
                   pspec->name, g_type_name(pspec->value_type));
     }
+
+    GVS_TRACE2(deserialize_property_return, pspec->name, g_type_name(type));
+}
+
+
+static void
+lazy_refs_free(gpointer data)
+{
+    LazyRefs *refs = data;
+
+    _gvs_lazy_document_unref(refs->document);
+    g_array_unref(refs->refs);
+    g_slice_free(LazyRefs, refs);
+}
+
+/* When reading lazily, records the reference held by a lazy property of
+ * @object instead of following it, unless its target already exists. Returns
+ * whether it did. Properties with a deserialize function are read as usual,
+ * since their serialization may not be a plain reference. */
+static gboolean
+defer_property(GvsDeserializer *self, GObject *object,
+               GParamSpec *pspec, GVariant *variant)
+{
+    DocumentState *doc = &self->priv->doc;
+    LazyRefs *refs;
+    LazyRef ref;
+    GVariant *child;
+
+    if (!self->priv->lazy || !doc->lazy ||
+        !g_param_spec_get_qdata(pspec, gvs_property_lazy_quark()) ||
+        g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark()))
+    {
+        return FALSE;
+    }
+
+    child = g_variant_get_maybe(variant);
+    if (!child)
+        return FALSE;
+
+    ref.pspec = pspec;
+    ref.id = read_entity_id(child);
+    g_variant_unref(child);
+
+    /* Bad ids are left for get_entity() to report */
+    if (ref.id >= doc->n_entities || doc->entities[ref.id])
+        return FALSE;
+
+    refs = g_object_get_qdata(object, lazy_refs_quark());
+    if (!refs)
+    {
+        refs = g_slice_new(LazyRefs);
+        refs->document = _gvs_lazy_document_ref(doc->lazy);
+        refs->refs = g_array_new(FALSE, FALSE, sizeof(LazyRef));
+        g_object_set_qdata_full(object, lazy_refs_quark(), refs, lazy_refs_free);
+    }
+
+    g_array_append_val(refs->refs, ref);
+
+    return TRUE;
 }
 
 
 static void
 gvs_deserialize_object_default(GvsDeserializer *self,
+                               GvsClassInfo    *info,
                                GObject         *object,
                                GVariant        *variant)
 {
+    GvsSerializableInterface *iface = info->iface;
+    GvsSerializable *serializable = iface ? GVS_SERIALIZABLE(object) : NULL;
     guint n_params, i;
-    GObjectClass *gobject_class = NULL;
 
-    gobject_class = G_OBJECT_GET_CLASS(object);
-    g_assert(G_IS_OBJECT_CLASS(gobject_class));
-    
+    if (iface && iface->pre_deserialize)
+    {
+        GVariantDict dict;
+
+        g_variant_dict_init(&dict, variant);
+        iface->pre_deserialize(serializable, self, &dict);
+        variant = g_variant_ref_sink(g_variant_dict_end(&dict));
+    }
+    else
+    {
+        g_variant_ref(variant);
+    }
+
     n_params = g_variant_n_children(variant);
     
     /* Pretty simple: for every entry in the properties dict, if the
@@ -303,46 +754,84 @@ gvs_deserialize_object_default(GvsDeserializer *self,
         g_assert(prop_name);
         g_assert(prop_var);
 
-        pspec = g_object_class_find_property(gobject_class, prop_name);
+        pspec = g_object_class_find_property(info->klass, prop_name);
         g_assert(pspec);
 
-        if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) == 0)
+        if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) == 0 &&
+            !property_filtered(self, info, prop_name))
         {
-            deserialize_pspec(self, pspec, prop_var, &value);
-
-            g_object_set_property(object, prop_name, &value);
-          
-            g_value_unset (&value);
+            const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+            gboolean handled = FALSE;
+
+            self->priv->stats.n_properties++;
+
+            if (iface && iface->deserialize_property)
+            {
+                g_value_init(&value, pspec->value_type);
+                handled = iface->deserialize_property(serializable, self,
+                                                      pspec, prop_var, &value);
+                if (!handled)
+                    g_value_unset(&value);
+            }
+
+            if (handled)
+            {
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+                g_object_set_property(object, prop_name, &value);
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+
+                g_value_unset (&value);
+            }
+            else if (!field && defer_property(self, object, pspec, prop_var))
+            {
+                /* Resolved by gvs_resolve_lazy_property() */
+            }
+            else if (skip_filtered_ref(self, pspec, prop_var))
+            {
+                /* Left as it was after construction */
+            }
+            else if (field &&
+                     !g_param_spec_get_qdata(pspec, gvs_property_deserialize_func_quark()))
+            {
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+                deserialize_field(self, object, field, prop_var);
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+            }
+            else
+            {
+                deserialize_pspec(self, pspec, prop_var, &value);
+
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+                g_object_set_property(object, prop_name, &value);
+                _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+
+                g_value_unset (&value);
+            }
         }
 
         g_variant_unref(prop_var);
         g_free(prop_name);
     }
+
+    g_variant_unref(variant);
 }
 
 
 static gpointer
-gvs_create_object_default(GvsDeserializer *self, GType class_type, GVariant *variant)
+gvs_create_object_default(GvsDeserializer *self, GvsClassInfo *info, GVariant *variant)
 {
-    guint n_params, i;
-    GObjectClass *gobject_class = NULL;
     gpointer object = NULL;
-    GParamSpec **pspecs;
-    
-    GArray *params = g_array_new(FALSE, TRUE, sizeof(GParameter));
+    GParameter *params;
+    guint n_params = 0, i;
 
-    gobject_class = G_OBJECT_CLASS(g_type_class_ref(class_type));
-    g_assert(gobject_class);
-    
-    pspecs = g_object_class_list_properties(gobject_class, &n_params);
-    for (i=0; i < n_params; i++)
+    params = g_newa(GParameter, info->n_construct_pspecs);
+
+    for (i = 0; i < info->n_construct_pspecs; i++)
     {
-        GParamSpec *pspec = pspecs[i];
+        GParamSpec *pspec = info->construct_pspecs[i];
         GVariant *pvariant = NULL;
-        GParameter param = { 0, };
 
-        /* Only handle construct-only properties here*/
-        if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) == 0)
+        if (property_filtered(self, info, pspec->name))
             continue;
 
         pvariant = g_variant_lookup_value(variant,
@@ -352,127 +841,1076 @@ gvs_create_object_default(GvsDeserializer *self, GType class_type, GVariant *var
         if (!pvariant)
             continue;
 
-        param.name = g_param_spec_get_name(pspec);
-        deserialize_pspec(self, pspec, pvariant, &param.value);
+        if (skip_filtered_ref(self, pspec, pvariant))
+        {
+            g_variant_unref(pvariant);
+            continue;
+        }
 
-        g_array_append_val(params, param);
+        params[n_params].name = g_param_spec_get_name(pspec);
+        memset(&params[n_params].value, 0, sizeof(GValue));
+        deserialize_pspec(self, pspec, pvariant, &params[n_params].value);
+        n_params++;
 
         g_variant_unref(pvariant);
     }
 
-    object = g_object_newv(class_type,
-                           params->len,
-                           (GParameter *) params->data);
+    self->priv->stats.n_properties += n_params;
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_CONSTRUCT);
+    object = g_object_newv(info->type, n_params, params);
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
 
-    g_free(pspecs);
-    g_array_free(params, TRUE);
-    g_type_class_unref(gobject_class);
+    for (i = 0; i < n_params; i++)
+        g_value_unset(&params[i].value);
 
     return object;
 }
 
-static void
-deserialize_entity(GvsDeserializer *self, gsize index)
+static gpointer
+create_object(GvsDeserializer *self, GvsClassInfo *info, GVariant *variant)
 {
-    GvsDeserializerPrivate *priv = self->priv;
-    char *gtype_str = NULL;
-    GType gtype;
-    GVariant *child;
-    gpointer entity = priv->entities[index];
-
-    g_assert (entity);
+    GvsSerializableInterface *iface = info->iface;
 
-    /* Grab the nth entry from the toplevel */
-    g_variant_get_child(priv->toplevel, index, "(sv)", &gtype_str, &child);
-  
-    if (gtype_str == NULL)
+    /* Custom serializations don't use the property dictionary, so there are
+     * no construct properties for us to find */
+    if (iface && (iface->read || iface->deserialize))
     {
-        g_critical("Could not read GType string from serialized object");
-        goto out;
-    }
+        gpointer object;
 
-    gtype = g_type_from_name(gtype_str);
+        _gvs_stats_enter(&self->priv->stats, GVS_STATS_CONSTRUCT);
+        object = g_object_newv(info->type, 0, NULL);
+        _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
 
-    if (gtype == 0)
-    {
-        g_critical("Type name \"%s\" is not registered with GType", gtype_str);
-        goto out;
+        return object;
     }
 
-    /* Only GObjects need two-stage deserialization */
-    if (g_type_is_a (gtype, G_TYPE_OBJECT))
-    	gvs_deserialize_object_default(self, entity, child);
-
-out:
-    g_free (gtype_str);
-    g_variant_unref(child);
+    return gvs_create_object_default(self, info, variant);
 }
 
-static gpointer
-create_entity(GvsDeserializer *self, gsize index)
+static void
+deserialize_object_entity(GvsDeserializer *self, GvsClassInfo *info,
+                          GObject *object, GVariant *variant)
 {
-    GvsDeserializerPrivate *priv = self->priv;
-    char *gtype_str;
-    GType gtype;
-    GVariant *child;
-    gpointer entity = NULL;
-
-    /* Grab the nth entry from the toplevel */
-    g_variant_get_child(priv->toplevel, index, "(sv)", &gtype_str, &child);
+    GvsSerializableInterface *iface = info->iface;
+    GvsStats *stats = &self->priv->stats;
 
-    if (gtype_str == NULL)
+    if (iface && iface->read)
     {
-        g_critical("Could not read GType string from serialized object");
-        goto out;
-    }
-
-    gtype = g_type_from_name(gtype_str);
+        GVariantIter reader;
 
-    if (gtype == 0)
-    {
-        g_critical("Type name \"%s\" is not registered with GType", gtype_str);
-        goto out;
+        g_variant_iter_init(&reader, variant);
+        _gvs_stats_enter(stats, GVS_STATS_PROPERTY_SET);
+        iface->read(GVS_SERIALIZABLE(object), self, &reader);
+        _gvs_stats_enter(stats, GVS_STATS_DECODE);
     }
-
-    /* TODO: Handle other entity types here, and GvsSerializable etc */
-    if (g_type_is_a(gtype, G_TYPE_OBJECT))
+    else if (iface && iface->deserialize)
     {
-        entity = gvs_create_object_default(self, gtype, child);
+        _gvs_stats_enter(stats, GVS_STATS_PROPERTY_SET);
+        iface->deserialize(GVS_SERIALIZABLE(object), self, variant);
+        _gvs_stats_enter(stats, GVS_STATS_DECODE);
     }
-    else if (g_type_is_a(gtype, G_TYPE_BOXED))
+    else
     {
-        const BuiltinTransform *transform = lookup_builtin_transform(gtype);
+        gvs_deserialize_object_default(self, info, object, variant);
+    }
+}
+
+/*
+ * Column groups
+ */
+static gpointer
+create_column_object(GvsDeserializer *self, ColumnGroup *group, gsize index)
+{
+    GvsClassInfo *info = group->info;
+    GParameter *params;
+    gpointer object;
+    guint n_params = 0, i;
+
+    params = g_newa(GParameter, info->n_construct_pspecs);
+
+    for (i = 0; i < group->n_columns; i++)
+    {
+        GParamSpec *pspec = group->pspecs[i];
+        GVariant *element;
+
+        /* The bound only matters for malformed documents repeating a column */
+        if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) == 0 ||
+            n_params == info->n_construct_pspecs ||
+            property_filtered(self, info, pspec->name))
+        {
+            continue;
+        }
+
+        element = g_variant_get_child_value(group->columns[i], index);
+
+        if (skip_filtered_ref(self, pspec, element))
+        {
+            g_variant_unref(element);
+            continue;
+        }
+
+        params[n_params].name = pspec->name;
+        memset(&params[n_params].value, 0, sizeof(GValue));
+        deserialize_pspec(self, pspec, element, &params[n_params].value);
+        n_params++;
+
+        g_variant_unref(element);
+    }
+
+    self->priv->stats.n_properties += n_params;
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_CONSTRUCT);
+    object = g_object_newv(info->type, n_params, params);
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+
+    for (i = 0; i < n_params; i++)
+        g_value_unset(&params[i].value);
+
+    return object;
+}
+
+static void
+deserialize_column_object(GvsDeserializer *self, ColumnGroup *group,
+                          gsize index, GObject *object)
+{
+    guint i;
+
+    for (i = 0; i < group->n_columns; i++)
+    {
+        GParamSpec *pspec = group->pspecs[i];
+        const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+        GVariant *element;
+
+        if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) ||
+            property_filtered(self, group->info, pspec->name))
+        {
+            continue;
+        }
+
+        element = g_variant_get_child_value(group->columns[i], index);
+        self->priv->stats.n_properties++;
+
+        if (skip_filtered_ref(self, pspec, element))
+        {
+            /* Left as it was after construction */
+        }
+        else if (field)
+        {
+            _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+            deserialize_field(self, object, field, element);
+            _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+        }
+        else
+        {
+            GValue value = G_VALUE_INIT;
+
+            deserialize_pspec(self, pspec, element, &value);
+            _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+            g_object_set_property(object, pspec->name, &value);
+            _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+            g_value_unset(&value);
+        }
+
+        g_variant_unref(element);
+    }
+}
+
+/*
+ * List stores
+ */
+static gpointer
+create_list_store(GvsDeserializer *self, GVariant *variant)
+{
+    const char *item_type_name;
+    GType item_type;
+    GListStore *store;
+
+    if (!g_variant_is_of_type(variant, GVS_LIST_STORE_TYPE) &&
+        !g_variant_is_of_type(variant, GVS_COMPACT_LIST_STORE_TYPE))
+    {
+        g_critical("Serialized GListStore has unexpected type %s",
+                   g_variant_get_type_string(variant));
+        return NULL;
+    }
+
+    g_variant_get_child(variant, 0, "&s", &item_type_name);
+    item_type = g_type_from_name(item_type_name);
+
+    if (item_type == 0 || !g_type_is_a(item_type, G_TYPE_OBJECT))
+    {
+        g_critical("List item type \"%s\" is not a registered object type",
+                   item_type_name);
+        return NULL;
+    }
+
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_CONSTRUCT);
+    store = g_list_store_new(item_type);
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+
+    return store;
+}
+
+static void
+deserialize_list_store(GvsDeserializer *self, GListStore *store, GVariant *variant)
+{
+    GVariant *ids_variant = g_variant_get_child_value(variant, 1);
+    gboolean compact = g_variant_is_of_type(variant, GVS_COMPACT_LIST_STORE_TYPE);
+    gconstpointer ids;
+    gpointer *items;
+    gsize n_ids, n_items = 0, i;
+
+    ids = g_variant_get_fixed_array(ids_variant, &n_ids,
+                                    compact ? sizeof(guint32) : sizeof(guint64));
+    items = g_new(gpointer, n_ids);
+
+    for (i = 0; i < n_ids; i++)
+    {
+        if (compact)
+            items[n_items] = get_entity(self, ((const guint32 *) ids)[i]);
+        else
+            items[n_items] = get_entity(self, ((const guint64 *) ids)[i]);
+
+        /* Items left out by the type filter are left out of the list */
+        if (items[n_items])
+            n_items++;
+    }
+
+    /* A single splice means a single items-changed emission, however large
+     * the list is */
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_SET);
+    g_list_store_splice(store, 0, g_list_model_get_n_items(G_LIST_MODEL(store)),
+                        items, n_items);
+    _gvs_stats_enter(&self->priv->stats, GVS_STATS_DECODE);
+
+    g_free(items);
+    g_variant_unref(ids_variant);
+}
+
+/* Returns the type name and payload of the entity in @row, from the
+ * toplevel array or the fetch function */
+static void
+read_row(GvsDeserializer *self, gsize row, char **gtype_str, GVariant **child)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    GVariant *entry;
+
+    if (priv->doc.fetch)
+    {
+        entry = priv->doc.fetch(priv->doc.fetch_data, row);
+        priv->stats.n_bytes += g_variant_get_size(entry);
+    }
+    else
+    {
+        entry = g_variant_get_child_value(priv->doc.toplevel, row);
+    }
+
+    g_variant_get(entry, "(sv)", gtype_str, child);
+    g_variant_unref(entry);
+}
+
+static void
+deserialize_entity(GvsDeserializer *self, gsize index)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    char *gtype_str = NULL;
+    GType gtype;
+    GVariant *child;
+    gpointer entity = priv->doc.entities[index];
+    gsize row = index;
+    GvsStatsFrame frame;
+
+    g_assert (entity);
+
+    GVS_TRACE1(deserialize_entity_entry, index);
+    _gvs_stats_push_entity(&priv->stats, &frame, GVS_STATS_DECODE);
+
+    if (priv->doc.locations)
+    {
+        EntityLocation *location = &priv->doc.locations[index];
+
+        if (location->group)
+        {
+            deserialize_column_object(self, location->group, location->index,
+                                      entity);
+            _gvs_stats_pop_entity(&priv->stats, &frame,
+                                  priv->doc.entity_types[index], FALSE);
+            GVS_TRACE3(deserialize_entity_return,
+                       g_type_name(priv->doc.entity_types[index]), index, 0);
+            GVS_TRACE_MARK(frame.start, "deserialize-entity", "%s %" G_GSIZE_FORMAT,
+                           g_type_name(priv->doc.entity_types[index]), index);
+            return;
+        }
+
+        row = location->index;
+    }
+
+    /* Grab the nth entry from the toplevel */
+    read_row(self, row, &gtype_str, &child);
+  
+    if (gtype_str == NULL)
+    {
+        g_critical("Could not read GType string from serialized object");
+        goto out;
+    }
+
+    gtype = g_type_from_name(gtype_str);
+
+    if (gtype == 0)
+    {
+        g_critical("Type name \"%s\" is not registered with GType", gtype_str);
+        goto out;
+    }
+
+    /* Only GObjects need two-stage deserialization */
+    if (g_type_is_a(gtype, G_TYPE_LIST_STORE))
+    {
+        deserialize_list_store(self, entity, child);
+    }
+    else if (g_type_is_a (gtype, G_TYPE_OBJECT))
+    {
+        GvsClassInfo *info = _gvs_class_info_lookup(priv->class_info, gtype);
+        deserialize_object_entity(self, info, entity, child);
+    }
+
+out:
+    _gvs_stats_pop_entity(&priv->stats, &frame, priv->doc.entity_types[index], FALSE);
+    GVS_TRACE3(deserialize_entity_return, g_type_name(priv->doc.entity_types[index]),
+               index, g_variant_get_size(child));
+    GVS_TRACE_MARK(frame.start, "deserialize-entity", "%s %" G_GSIZE_FORMAT,
+                   g_type_name(priv->doc.entity_types[index]), index);
+
+    g_free (gtype_str);
+    g_variant_unref(child);
+}
+
+static void
+mark_filtered(GvsDeserializer *self, gsize index)
+{
+    DocumentState *doc = &self->priv->doc;
+
+    if (!doc->filtered)
+        doc->filtered = g_new0(gboolean, doc->n_entities);
+
+    doc->filtered[index] = TRUE;
+}
+
+static gpointer
+create_entity(GvsDeserializer *self, gsize index)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    char *gtype_str;
+    GType gtype;
+    GVariant *child;
+    gpointer entity = NULL;
+    gsize row = index;
+    GvsStatsFrame frame;
+
+    GVS_TRACE1(create_entity_entry, index);
+    _gvs_stats_push_entity(&priv->stats, &frame, GVS_STATS_DECODE);
+
+    if (priv->doc.locations)
+    {
+        EntityLocation *location = &priv->doc.locations[index];
+
+        if (location->group &&
+            index != priv->doc.root && type_filtered(self, location->group->info->type))
+        {
+            mark_filtered(self, index);
+            priv->doc.entity_types[index] = G_TYPE_INVALID;
+            _gvs_stats_pop_entity(&priv->stats, &frame, G_TYPE_INVALID, TRUE);
+            GVS_TRACE3(create_entity_return, NULL, index, 0);
+            return NULL;
+        }
+
+        if (location->group)
+        {
+            entity = create_column_object(self, location->group, location->index);
+            priv->doc.entities[index] = entity;
+            priv->doc.entity_types[index] = location->group->info->type;
+
+            if (priv->doc.created)
+                g_array_append_val(priv->doc.created, index);
+
+            _gvs_stats_pop_entity(&priv->stats, &frame,
+                                  priv->doc.entity_types[index], TRUE);
+            GVS_TRACE3(create_entity_return,
+                       g_type_name(priv->doc.entity_types[index]), index, 0);
+            GVS_TRACE_MARK(frame.start, "create-entity", "%s %" G_GSIZE_FORMAT,
+                           g_type_name(priv->doc.entity_types[index]), index);
+            return entity;
+        }
+
+        row = location->index;
+    }
+
+    /* Grab the nth entry from the toplevel */
+    read_row(self, row, &gtype_str, &child);
+
+    if (gtype_str == NULL)
+    {
+        g_critical("Could not read GType string from serialized object");
+        goto out;
+    }
+
+    gtype = g_type_from_name(gtype_str);
+
+    if (gtype == 0)
+    {
+        g_critical("Type name \"%s\" is not registered with GType", gtype_str);
+        goto out;
+    }
+
+    /* Left out without looking at its state */
+    if (index != priv->doc.root && type_filtered(self, gtype))
+    {
+        mark_filtered(self, index);
+        goto out;
+    }
+
+    /* TODO: Handle other entity types here */
+    if (g_type_is_a(gtype, G_TYPE_LIST_STORE))
+    {
+        entity = create_list_store(self, child);
+        if (!entity)
+            goto out;
+    }
+    else if (g_type_is_a(gtype, G_TYPE_OBJECT))
+    {
+        GvsClassInfo *info = _gvs_class_info_lookup(priv->class_info, gtype);
+        entity = create_object(self, info, child);
+    }
+    else if (g_type_is_a(gtype, G_TYPE_BOXED))
+    {
+        const GvsBoxedTransform *transform = _gvs_boxed_transform_lookup(gtype);
         GValue value = G_VALUE_INIT;
+
+        if (!transform)
+        {
+            g_critical("Could not deserialize boxed type %s\n"
+                       "Use gvs_register_boxed_transform() to register a transformation\n",
+                       gtype_str);
+            goto out;
+        }
+
+        /* The GValue's reference becomes the entity table's */
         g_value_init(&value, gtype);
         transform->deserialize(self, child, &value, NULL);
         entity = g_value_get_boxed(&value);
     }
 
-    g_assert(entity);
+    g_assert(entity);
+
+    priv->doc.entities[index] = entity;
+    priv->doc.entity_types[index] = gtype;
+
+    if (priv->doc.created)
+        g_array_append_val(priv->doc.created, index);
+
+out:
+    /* The type is only recorded if the entity was created successfully */
+    if (!entity)
+        priv->doc.entity_types[index] = G_TYPE_INVALID;
+
+    _gvs_stats_pop_entity(&priv->stats, &frame, priv->doc.entity_types[index], TRUE);
+    GVS_TRACE3(create_entity_return, g_type_name(priv->doc.entity_types[index]),
+               index, g_variant_get_size(child));
+    GVS_TRACE_MARK(frame.start, "create-entity", "%s %" G_GSIZE_FORMAT,
+                   g_type_name(priv->doc.entity_types[index]), index);
+
+    g_free(gtype_str);
+    g_variant_unref(child);
+
+    return entity;
+}
+
+
+static gpointer
+get_entity(GvsDeserializer *self, gsize index)
+{
+    gpointer entity;
+
+    if (index >= self->priv->doc.n_entities)
+    {
+        g_critical("Reference to entity %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT,
+                   index, self->priv->doc.n_entities);
+        return NULL;
+    }
+
+    entity = self->priv->doc.entities[index];
+
+    if (!entity &&
+        !(self->priv->doc.filtered && self->priv->doc.filtered[index] &&
+          index != self->priv->doc.root))
+    {
+        /* An entity reached again while it is being created must be
+         * part of a cycle through construct-only properties, which no
+         * order of creation satisfies */
+        if (self->priv->doc.entity_types[index] == ENTITY_BEING_CREATED)
+        {
+            g_critical("Entity %" G_GSIZE_FORMAT " refers to itself through "
+                       "construct-only properties", index);
+            return NULL;
+        }
+
+        self->priv->doc.entity_types[index] = ENTITY_BEING_CREATED;
+        entity = create_entity(self, index);
+    }
+
+    return entity;
+}
+
+
+static void
+free_column_groups(DocumentState *doc)
+{
+    guint i, j;
+
+    for (i = 0; i < doc->n_groups; i++)
+    {
+        for (j = 0; j < doc->groups[i].n_columns; j++)
+            g_variant_unref(doc->groups[i].columns[j]);
+
+        g_free(doc->groups[i].columns);
+        g_free(doc->groups[i].pspecs);
+    }
+
+    g_free(doc->groups);
+    g_free(doc->locations);
+    doc->groups = NULL;
+    doc->n_groups = 0;
+    doc->locations = NULL;
+}
+
+/* Frees what @doc holds. Entities still in its table are left alone. */
+static void
+free_document_state(DocumentState *doc)
+{
+    g_clear_pointer(&doc->toplevel, g_variant_unref);
+    g_clear_pointer(&doc->entities, g_free);
+    g_clear_pointer(&doc->entity_types, g_free);
+    g_clear_pointer(&doc->filtered, g_free);
+    g_clear_pointer(&doc->strings, g_free);
+    g_clear_pointer(&doc->string_table, g_variant_unref);
+    doc->n_strings = 0;
+    free_column_groups(doc);
+
+    doc->n_entities = 0;
+    doc->root = 0;
+    doc->fetch = NULL;
+    doc->fetch_data = NULL;
+    doc->lazy = NULL;
+}
+
+/* Reads the column section of a version 2 document and works out where each
+ * entity lives. Group members take the ids listed in the group; the rows of
+ * the entity array fill the remaining ids in ascending order. Returns the
+ * total number of entities, or 0 if the document is inconsistent. */
+static gsize
+load_column_groups(GvsDeserializer *self, GVariant *groups)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    gsize n_rows = g_variant_n_children(priv->doc.toplevel);
+    gsize n_groups = g_variant_n_children(groups);
+    gsize n_entities = n_rows;
+    GVariant **group_ids;
+    gsize i, j, row;
+
+    priv->doc.n_groups = n_groups;
+    priv->doc.groups = g_new0(ColumnGroup, n_groups);
+    group_ids = g_new(GVariant *, n_groups);
+
+    /* Count the group members first, so the location table can be sized */
+    for (i = 0; i < n_groups; i++)
+    {
+        GVariant *group = g_variant_get_child_value(groups, i);
+
+        group_ids[i] = g_variant_get_child_value(group, 1);
+        n_entities += g_variant_n_children(group_ids[i]);
+        g_variant_unref(group);
+    }
+
+    priv->doc.locations = g_new(EntityLocation, n_entities);
+    for (i = 0; i < n_entities; i++)
+    {
+        priv->doc.locations[i].group = NULL;
+        priv->doc.locations[i].index = G_MAXSIZE;
+    }
+
+    for (i = 0; i < n_groups; i++)
+    {
+        ColumnGroup *group = &priv->doc.groups[i];
+        const char *type_name;
+        GVariant *columns;
+        const guint64 *ids;
+        gsize n_ids;
+        GType type;
+
+        g_variant_get_child(groups, i, "(&s@at@a{sv})", &type_name, NULL, &columns);
+
+        type = g_type_from_name(type_name);
+        if (type == 0 || !g_type_is_a(type, G_TYPE_OBJECT))
+        {
+            g_critical("Type name \"%s\" is not a registered object type", type_name);
+            g_variant_unref(columns);
+            goto fail;
+        }
+
+        group->info = _gvs_class_info_lookup(priv->class_info, type);
+
+        ids = g_variant_get_fixed_array(group_ids[i], &n_ids, sizeof(guint64));
+        for (j = 0; j < n_ids; j++)
+        {
+            if (ids[j] >= n_entities || priv->doc.locations[ids[j]].index != G_MAXSIZE)
+            {
+                g_critical("Invalid entity id %" G_GUINT64_FORMAT " in column group",
+                           ids[j]);
+                g_variant_unref(columns);
+                goto fail;
+            }
+
+            priv->doc.locations[ids[j]].group = group;
+            priv->doc.locations[ids[j]].index = j;
+        }
+
+        j = g_variant_n_children(columns);
+        group->pspecs = g_new(GParamSpec *, j);
+        group->columns = g_new(GVariant *, j);
+
+        for (j = 0; j < g_variant_n_children(columns); j++)
+        {
+            GVariant **column = &group->columns[group->n_columns++];
+            const char *name;
+
+            g_variant_get_child(columns, j, "{&sv}", &name, column);
+            group->pspecs[j] = g_object_class_find_property(group->info->klass, name);
+
+            if (!group->pspecs[j] || g_variant_n_children(*column) != n_ids)
+            {
+                g_critical("Invalid column \"%s\" for type %s", name, type_name);
+                g_variant_unref(columns);
+                goto fail;
+            }
+        }
+
+        g_variant_unref(columns);
+    }
+
+    /* Everything left over is a row, in order */
+    for (i = 0, row = 0; i < n_entities; i++)
+    {
+        if (priv->doc.locations[i].index == G_MAXSIZE)
+            priv->doc.locations[i].index = row++;
+    }
+
+    for (i = 0; i < n_groups; i++)
+        g_variant_unref(group_ids[i]);
+    g_free(group_ids);
+
+    return n_entities;
+
+fail:
+    for (i = 0; i < n_groups; i++)
+        g_variant_unref(group_ids[i]);
+    g_free(group_ids);
+    free_column_groups(&priv->doc);
+
+    return 0;
+}
+
+/******************************************************************************
+ *
+ * Lazy documents
+ *
+ ******************************************************************************/
+
+/* Moves the document @self is reading into a new GvsLazyDocument */
+static GvsLazyDocument *
+lazy_document_new(GvsDeserializer *self, GDestroyNotify fetch_destroy)
+{
+    GvsLazyDocument *lazy = g_slice_new(GvsLazyDocument);
+
+    lazy->ref_count = 1;
+    lazy->deserializer = g_object_ref(self);
+    lazy->state = self->priv->doc;
+    lazy->state.lazy = lazy;
+    lazy->materialized = g_hash_table_new(g_direct_hash, g_direct_equal);
+    lazy->fetch_destroy = fetch_destroy;
+
+    memset(&self->priv->doc, 0, sizeof(DocumentState));
+
+    return lazy;
+}
+
+GvsLazyDocument *
+_gvs_lazy_document_ref(GvsLazyDocument *lazy)
+{
+    g_atomic_int_inc(&lazy->ref_count);
+
+    return lazy;
+}
+
+void
+_gvs_lazy_document_unref(GvsLazyDocument *lazy)
+{
+    gpointer *entities = lazy->state.entities;
+    GHashTableIter iter;
+    gpointer key;
+
+    if (!g_atomic_int_dec_and_test(&lazy->ref_count))
+        return;
+
+    g_hash_table_iter_init(&iter, lazy->materialized);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        gsize id = GPOINTER_TO_SIZE(key);
+
+        if (entities[id])
+        {
+            g_object_remove_weak_pointer(entities[id], &entities[id]);
+            entities[id] = NULL;
+        }
+    }
+
+    if (lazy->fetch_destroy)
+        lazy->fetch_destroy(lazy->state.fetch_data);
+
+    free_document_state(&lazy->state);
+    g_hash_table_destroy(lazy->materialized);
+    g_object_unref(lazy->deserializer);
+    g_slice_free(GvsLazyDocument, lazy);
+}
+
+/* Makes @lazy the document its deserializer is reading, saving the current
+ * one in @saved. A getter may resolve a lazy property while another document
+ * is being read, or while @lazy itself is, in which case nothing is swapped.
+ * Returns whether lazy_document_leave() needs to swap back. */
+static gboolean
+lazy_document_enter(GvsLazyDocument *lazy, DocumentState *saved)
+{
+    GvsDeserializerPrivate *priv = lazy->deserializer->priv;
+
+    if (priv->doc.lazy == lazy)
+        return FALSE;
+
+    *saved = priv->doc;
+    priv->doc = lazy->state;
+
+    return TRUE;
+}
+
+static void
+lazy_document_leave(GvsLazyDocument *lazy, DocumentState *saved, gboolean entered)
+{
+    GvsDeserializerPrivate *priv = lazy->deserializer->priv;
+
+    if (!entered)
+        return;
+
+    lazy->state = priv->doc;
+    priv->doc = *saved;
+}
+
+/* Creates entity @id of the current document unless it exists already,
+ * along with everything it reaches, and deserializes whatever was created.
+ * Returns a new reference to it.
+ *
+ * The entity table doesn't own anything afterwards. In lazy documents it
+ * keeps weak pointers to objects, so they can be shared by later calls;
+ * otherwise the table is about to be freed anyway. */
+static gpointer
+materialize_entity(GvsDeserializer *self, gsize id)
+{
+    DocumentState *doc = &self->priv->doc;
+    GArray *outer = doc->created;
+    gsize outer_root = doc->root;
+    gboolean existed;
+    gpointer entity;
+    guint i;
+
+    existed = id < doc->n_entities && doc->entities[id];
+    doc->created = g_array_new(FALSE, FALSE, sizeof(gsize));
+    doc->root = id;
+
+    /* The same two stages as gvs_deserializer_deserialize(), but entities
+     * referred to by those being deserialized join the end of the list */
+    entity = get_entity(self, id);
+
+    for (i = 0; i < doc->created->len; i++)
+        deserialize_entity(self, g_array_index(doc->created, gsize, i));
+
+    for (i = 0; i < doc->created->len; i++)
+    {
+        gsize index = g_array_index(doc->created, gsize, i);
+
+        if (g_type_is_a(doc->entity_types[index], G_TYPE_OBJECT))
+        {
+            if (doc->lazy)
+            {
+                g_object_add_weak_pointer(doc->entities[index],
+                                          &doc->entities[index]);
+                /* Ids of objects which died and were materialized again
+                 * are only held once */
+                g_hash_table_add(doc->lazy->materialized,
+                                 GSIZE_TO_POINTER(index));
+            }
+
+            /* The caller gets our reference to the entity itself */
+            if (index != id)
+                g_object_unref(doc->entities[index]);
+        }
+        else
+        {
+            if (index != id)
+                g_boxed_free(doc->entity_types[index], doc->entities[index]);
+
+            doc->entities[index] = NULL;
+        }
+    }
+
+    /* Only objects outlive the call which created them */
+    if (existed)
+        g_object_ref(entity);
+
+    g_array_unref(doc->created);
+    doc->created = outer;
+    doc->root = outer_root;
+
+    return entity;
+}
+
+/* Reads entity @id of @lazy and stores it in @pspec of @object, unless
+ * @object was given a value of its own since it was deserialized */
+static void
+resolve_lazy_ref(GvsLazyDocument *lazy, GObject *object, const LazyRef *ref)
+{
+    GValue value = G_VALUE_INIT;
+    gpointer target;
+
+    /* The getter finds nothing left to resolve, so this can't recurse */
+    g_value_init(&value, ref->pspec->value_type);
+    g_object_get_property(object, ref->pspec->name, &value);
+
+    if (g_value_get_object(&value))
+    {
+        g_value_unset(&value);
+        return;
+    }
+
+    target = _gvs_lazy_document_get_entity(lazy, ref->id);
 
-    priv->entities[index] = entity;
+    if (target)
+    {
+        g_value_set_object(&value, target);
+        g_object_set_property(object, ref->pspec->name, &value);
+        g_object_unref(target);
+    }
 
-out:
-    g_free(gtype_str);
-    g_variant_unref(child);
+    g_value_unset(&value);
+}
 
-    return entity;
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+/* Returns the entity array of @document, for reading entities one at a time
+ * with _gvs_entity_array_fetch(), or %NULL if @document isn't a GVS document
+ * or has column groups, whose entities aren't rows of the array. */
+GVariant *
+_gvs_document_get_entity_array(GVariant *document)
+{
+    guint32 magic_number;
+    GVariant *groups;
+    gsize n_groups;
+
+    g_return_val_if_fail(document != NULL, NULL);
+    g_return_val_if_fail(g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_TYPE) ||
+                         g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V2_TYPE) ||
+                         g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V3_TYPE),
+                         NULL);
+
+    g_variant_get_child(document, 0, "u", &magic_number);
+    g_return_val_if_fail(magic_number == GVS_MAGIC_NUMBER, NULL);
+
+    if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_TYPE))
+        return g_variant_get_child_value(document, 2);
+
+    groups = g_variant_get_child_value(document, 4);
+    n_groups = g_variant_n_children(groups);
+    g_variant_unref(groups);
+
+    if (n_groups > 0)
+    {
+        g_critical("Documents with column groups can't be read one entity at a time");
+        return NULL;
+    }
+
+    return g_variant_get_child_value(document, 3);
 }
 
+/* Returns the string table of @document, an "as", or %NULL if it has none */
+GVariant *
+_gvs_document_get_string_table(GVariant *document)
+{
+    if (!g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V3_TYPE))
+        return NULL;
 
-static gpointer
-get_entity(GvsDeserializer *self, gsize index)
+    return g_variant_get_child_value(document, 5);
+}
+
+/* A GvsEntityFetchFunc for the result of _gvs_document_get_entity_array() */
+GVariant *
+_gvs_entity_array_fetch(gpointer entities, gsize id)
+{
+    return g_variant_get_child_value(entities, id);
+}
+
+/* Returns the "ms" which @ref, a GVS_STRING_REF_TYPE, stands for in
+ * @strings, the string table of its document. References to strings which
+ * aren't there read as nothing. */
+GVariant *
+_gvs_string_table_resolve(GVariant *strings, GVariant *ref)
 {
-    gpointer entity = self->priv->entities[index];
+    GVariant *child = g_variant_get_maybe(ref);
+    GVariant *string = NULL;
+    gint32 index;
 
-    if (!entity)
+    if (child)
     {
-        entity = create_entity(self, index);
+        index = g_variant_get_handle(child);
+        g_variant_unref(child);
+
+        if (strings && index >= 0 && (gsize) index < g_variant_n_children(strings))
+            string = g_variant_get_child_value(strings, index);
     }
 
+    return g_variant_ref_sink(g_variant_new_maybe(G_VARIANT_TYPE_STRING, string));
+}
+
+/* Opens a document of @n_entities entities, each got from @fetch, and
+ * string table @strings, or %NULL, whose entities are created as they are
+ * asked for with _gvs_lazy_document_get_entity(). @destroy is called on
+ * @user_data when the document is freed. Documents with column groups can't
+ * be read this way. */
+GvsLazyDocument *
+_gvs_deserializer_open_document(GvsDeserializer *self,
+                                gsize n_entities,
+                                GVariant *strings,
+                                GvsEntityFetchFunc fetch,
+                                gpointer user_data,
+                                GDestroyNotify destroy)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    DocumentState saved;
+    GvsLazyDocument *lazy;
+
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), NULL);
+    g_return_val_if_fail(fetch != NULL, NULL);
+
+    /* Another document may be being read, if a getter got us here */
+    saved = priv->doc;
+    memset(&priv->doc, 0, sizeof(DocumentState));
+
+    priv->doc.fetch = fetch;
+    priv->doc.fetch_data = user_data;
+    priv->doc.n_entities = n_entities;
+    priv->doc.entities = g_new0(gpointer, n_entities);
+    priv->doc.entity_types = g_new0(GType, n_entities);
+    priv->doc.string_table = strings ? g_variant_ref(strings) : NULL;
+
+    lazy = lazy_document_new(self, destroy);
+    priv->doc = saved;
+
+    return lazy;
+}
+
+/* Returns a new reference to entity @id of @lazy, creating it and whatever
+ * it reaches unless it is alive already. Objects created are shared with
+ * later calls for as long as they live. */
+gpointer
+_gvs_lazy_document_get_entity(GvsLazyDocument *lazy, gsize id)
+{
+    GvsDeserializer *self = lazy->deserializer;
+    GvsStats *stats = &self->priv->stats;
+    GvsStatsPhase phase = stats->phase;
+    DocumentState saved;
+    gboolean entered;
+    gpointer entity;
+    gint64 begin;
+
+    entered = lazy_document_enter(lazy, &saved);
+    begin = _gvs_stats_enter(stats, GVS_STATS_DECODE);
+    entity = materialize_entity(self, id);
+    _gvs_stats_enter(stats, phase);
+    lazy_document_leave(lazy, &saved, entered);
+
+    GVS_TRACE_MARK(begin, "materialize", "entity %" G_GSIZE_FORMAT " of %"
+                   G_GSIZE_FORMAT, id, lazy->state.n_entities);
+
     return entity;
 }
 
+/* Deserializes entity @id of a document holding @n_entities entities and
+ * string table @strings, or %NULL, and whatever it refers to, getting each
+ * entity from @fetch. Only the entities
+ * reached from @id are created, and the entity table is allocated with
+ * g_new0(), which leaves the pages for entities never touched unwritten.
+ * Documents with column groups can't be read this way.
+ *
+ * @destroy is called on @user_data once @fetch is no longer needed, which
+ * in lazy mode is when the last lazy property of the result is resolved. */
+gpointer
+_gvs_deserializer_deserialize_entity(GvsDeserializer *self,
+                                     gsize id,
+                                     gsize n_entities,
+                                     GVariant *strings,
+                                     GvsEntityFetchFunc fetch,
+                                     gpointer user_data,
+                                     GDestroyNotify destroy)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+    gpointer entity;
+    gint64 begin;
+
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), NULL);
+    g_return_val_if_fail(id < n_entities, NULL);
+    g_return_val_if_fail(fetch != NULL, NULL);
+
+    begin = _gvs_stats_enter(&priv->stats, GVS_STATS_DECODE);
+
+    priv->doc.fetch = fetch;
+    priv->doc.fetch_data = user_data;
+    priv->doc.n_entities = n_entities;
+    priv->doc.entities = g_new0(gpointer, n_entities);
+    priv->doc.entity_types = g_new0(GType, n_entities);
+    priv->doc.string_table = strings ? g_variant_ref(strings) : NULL;
+
+    if (priv->lazy)
+    {
+        GvsLazyDocument *lazy = lazy_document_new(self, destroy);
+        DocumentState saved;
+
+        lazy_document_enter(lazy, &saved);
+        entity = materialize_entity(self, id);
+        lazy_document_leave(lazy, &saved, TRUE);
+        _gvs_lazy_document_unref(lazy);
+    }
+    else
+    {
+        entity = materialize_entity(self, id);
+        free_document_state(&priv->doc);
+
+        if (destroy)
+            destroy(user_data);
+    }
+
+    _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
+
+    GVS_TRACE_MARK(begin, "deserialize", "entity %" G_GSIZE_FORMAT " of %"
+                   G_GSIZE_FORMAT, id, n_entities);
+
+    return entity;
+}
 
 /******************************************************************************
  *
@@ -496,50 +1934,460 @@ gvs_deserializer_deserialize(GvsDeserializer *self, GVariant *variant)
     gpointer object;
     guint32 magic_number;
     guint16 protocol_version;
+    gint64 begin;
     
     g_return_val_if_fail(GVS_IS_DESERIALIZER(self), NULL);
-    g_return_val_if_fail(g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_TYPE), NULL);
+    g_return_val_if_fail(g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_TYPE) ||
+                         g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_V2_TYPE) ||
+                         g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_V3_TYPE),
+                         NULL);
 
     /* Check magic number is correct */
     g_variant_get_child(variant, 0, "u", &magic_number);
     g_return_val_if_fail(magic_number == GVS_MAGIC_NUMBER, NULL);
 
-    /* Check the protocol version (currently must be 1) */
+    GVS_TRACE1(deserialize_entry, g_variant_get_size(variant));
+    begin = _gvs_stats_enter(&priv->stats, GVS_STATS_DECODE);
+
+    /* Check the protocol version matches the layout */
     g_variant_get_child(variant, 1, "q", &protocol_version);
-    if (protocol_version != 1)
+    if (protocol_version == GVS_PROTOCOL_VERSION &&
+        g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_TYPE))
+    {
+        priv->doc.toplevel = g_variant_get_child_value(variant, 2);
+        n_entities = g_variant_n_children(priv->doc.toplevel);
+    }
+    else if ((protocol_version == GVS_PROTOCOL_VERSION_2 &&
+              g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_V2_TYPE)) ||
+             (protocol_version == GVS_PROTOCOL_VERSION_3 &&
+              g_variant_is_of_type(variant, GVS_SERIALIZED_OBJECT_V3_TYPE)))
+    {
+        GVariant *groups;
+        guint32 features;
+
+        g_variant_get_child(variant, 2, "u", &features);
+        if (features & ~GVS_KNOWN_FEATURES)
+        {
+            g_critical("This version of libgvs does not support GVS features 0x%x\n",
+                       features & ~GVS_KNOWN_FEATURES);
+            _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
+            return NULL;
+        }
+
+        priv->doc.toplevel = g_variant_get_child_value(variant, 3);
+        groups = g_variant_get_child_value(variant, 4);
+        n_entities = load_column_groups(self, groups);
+        g_variant_unref(groups);
+
+        if (n_entities == 0)
+        {
+            g_clear_pointer(&priv->doc.toplevel, g_variant_unref);
+            _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
+            return NULL;
+        }
+
+        priv->doc.string_table = _gvs_document_get_string_table(variant);
+    }
+    else
     {
         g_critical("This version of libgvs cannot deserialize GVS protocol version %i\n",
                    protocol_version);
+        _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
         return NULL;
     }
 
-    /* Go ahead and start unpacking the array */
-    priv->toplevel = g_variant_get_child_value(variant, 2);
-    n_entities = g_variant_n_children(priv->toplevel);
-    priv->entities = g_new0(gpointer, n_entities);
+    priv->doc.n_entities = n_entities;
+    priv->doc.entities = g_new0(gpointer, n_entities);
+    priv->doc.entity_types = g_new0(GType, n_entities);
 
-    /* We do deserialization in two stages.*/
-    
-    /* First, create all the entities */
-    for (i = 0; i < n_entities; i++)
+    if (priv->lazy)
     {
-        create_entity(self, i);
+        /* Only the root and what it reaches without going through a lazy
+         * property are created now */
+        GvsLazyDocument *lazy = lazy_document_new(self, NULL);
+        DocumentState saved;
+
+        lazy_document_enter(lazy, &saved);
+        object = materialize_entity(self, 0);
+        lazy_document_leave(lazy, &saved, TRUE);
+        _gvs_lazy_document_unref(lazy);
     }
-
-    /* Now, do proper deserialization */
-    for (i = 0; i < n_entities; i++)
+    else if (has_filters(self))
     {
-        deserialize_entity(self, i);
+        /* Only what the root reaches through what passes the filters */
+        object = materialize_entity(self, 0);
+        free_document_state(&priv->doc);
+    }
+    else
+    {
+        /* We do deserialization in two stages.*/
+
+        /* First, create all the entities. Some may have been created
+         * already to satisfy construct properties of earlier ones */
+        for (i = 0; i < n_entities; i++)
+        {
+            get_entity(self, i);
+        }
+
+        /* Now, do proper deserialization */
+        for (i = 0; i < n_entities; i++)
+        {
+            deserialize_entity(self, i);
+        }
+
+        object = priv->doc.entities[0];
+
+        /* Everything else is now owned by whatever refers to it */
+        for (i = 1; i < n_entities; i++)
+        {
+            if (!priv->doc.entities[i])
+                continue;
+
+            if (g_type_is_a(priv->doc.entity_types[i], G_TYPE_OBJECT))
+                g_object_unref(priv->doc.entities[i]);
+            else
+                g_boxed_free(priv->doc.entity_types[i], priv->doc.entities[i]);
+        }
+
+        free_document_state(&priv->doc);
     }
 
-    object = priv->entities[0];
+    priv->stats.n_bytes += g_variant_get_size(variant);
+    _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
 
-    g_variant_unref(priv->toplevel);
-    g_free(priv->entities);
+    GVS_TRACE3(deserialize_return, object ? G_OBJECT_TYPE_NAME(object) : NULL,
+               n_entities, g_variant_get_size(variant));
+    GVS_TRACE_MARK(begin, "deserialize", "%s, %" G_GSIZE_FORMAT " entities",
+                   object ? G_OBJECT_TYPE_NAME(object) : "(none)", n_entities);
 
     return object;
 }
 
+/**
+ * gvs_deserializer_deserialize_property:
+ * @deserializer: A #GvsDeserializer
+ * @pspec: The #GParamSpec of the property
+ * @variant: A serialized property value
+ * @value: (out caller-allocates): An uninitialized #GValue to hold the result
+ *
+ * Reverses gvs_serializer_serialize_property(), using the transformation GVS
+ * would use for @pspec during default deserialization. @value is
+ * initialized to the value type of @pspec.
+ */
+void
+gvs_deserializer_deserialize_property(GvsDeserializer *self,
+                                      GParamSpec      *pspec,
+                                      GVariant        *variant,
+                                      GValue          *value)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+    g_return_if_fail(G_IS_PARAM_SPEC(pspec));
+    g_return_if_fail(variant != NULL);
+    g_return_if_fail(value != NULL && G_VALUE_TYPE(value) == 0);
+
+    deserialize_pspec(self, pspec, variant, value);
+}
+
+/**
+ * gvs_deserializer_read_object_ref:
+ * @deserializer: A #GvsDeserializer
+ * @variant: A reference created with gvs_serializer_write_object_ref()
+ *
+ * Resolves an object reference written by gvs_serializer_write_object_ref().
+ * The returned object has been constructed, but its own state may not have
+ * been restored yet if it is part of a reference cycle.
+ *
+ * Returns: (transfer none) (type GObject) (nullable): The referenced object
+ */
+gpointer
+gvs_deserializer_read_object_ref(GvsDeserializer *self, GVariant *variant)
+{
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), NULL);
+    g_return_val_if_fail(variant != NULL, NULL);
+
+    return deserialize_object_ref(self, variant);
+}
+
+/**
+ * gvs_deserializer_get_stats:
+ * @deserializer: A #GvsDeserializer
+ *
+ * Returns a snapshot of what @deserializer has done since it was created, or
+ * since the last call to gvs_deserializer_reset_stats(). Only the
+ * %GVS_STATS_DECODE, %GVS_STATS_CONSTRUCT and %GVS_STATS_PROPERTY_SET phases
+ * apply to deserialization.
+ *
+ * Returns: (transfer full): A new #GvsStats, free with gvs_stats_free()
+ */
+GvsStats *
+gvs_deserializer_get_stats(GvsDeserializer *self)
+{
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), NULL);
+
+    return gvs_stats_copy(&self->priv->stats);
+}
+
+/**
+ * gvs_deserializer_reset_stats:
+ * @deserializer: A #GvsDeserializer
+ *
+ * Sets all of the statistics kept by @deserializer back to zero.
+ */
+void
+gvs_deserializer_reset_stats(GvsDeserializer *self)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+
+    _gvs_stats_clear(&self->priv->stats);
+    _gvs_stats_init(&self->priv->stats);
+}
+
+/**
+ * gvs_deserializer_set_lazy:
+ * @deserializer: A #GvsDeserializer
+ * @lazy: Whether to read documents lazily
+ *
+ * In lazy mode, properties registered with gvs_register_property_lazy() are
+ * not followed during deserialization. The document stays in memory, and the
+ * object each one refers to is created, with everything it reaches in turn,
+ * when gvs_resolve_lazy_property() is called for it, usually from the class's
+ * get_property() implementation. A reference to an object which exists
+ * already, such as one back to the root, is set straight away.
+ *
+ * Reading only part of a large document then costs time and memory in
+ * proportion to that part. The document is released once every lazy property
+ * of the objects deserialized from it has been resolved, or those objects
+ * have been finalized. Objects which are finalized are created afresh if they
+ * are reached again.
+ *
+ * Objects stored in column groups, see %GVS_SERIALIZER_COLUMNAR, always have
+ * their references followed. The same goes for lazy properties registered
+ * with gvs_register_property_offset(), which are read without calling
+ * get_property().
+ *
+ * This also applies to gvs_archive_lookup().
+ */
+void
+gvs_deserializer_set_lazy(GvsDeserializer *self, gboolean lazy)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+
+    self->priv->lazy = lazy;
+}
+
+/**
+ * gvs_deserializer_get_lazy:
+ * @deserializer: A #GvsDeserializer
+ *
+ * Returns: Whether @deserializer reads documents lazily, see
+ *  gvs_deserializer_set_lazy()
+ */
+gboolean
+gvs_deserializer_get_lazy(GvsDeserializer *self)
+{
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), FALSE);
+
+    return self->priv->lazy;
+}
+
+static void
+set_property_filter(GvsDeserializer *self, GType type, gboolean include,
+                    const char * const *names)
+{
+    GvsDeserializerPrivate *priv = self->priv;
+
+    g_hash_table_remove_all(priv->class_filters);
+
+    if (names)
+    {
+        PropertyFilter *filter = g_slice_new(PropertyFilter);
+
+        filter->include = include;
+        filter->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        for (; *names; names++)
+            g_hash_table_add(filter->names, g_strdup(*names));
+
+        g_hash_table_insert(priv->property_filters, GSIZE_TO_POINTER(type), filter);
+    }
+    else
+    {
+        g_hash_table_remove(priv->property_filters, GSIZE_TO_POINTER(type));
+    }
+}
+
+/**
+ * gvs_deserializer_include_types:
+ * @deserializer: A #GvsDeserializer
+ * @types: (array length=n_types) (nullable): The object types to create
+ * @n_types: The length of @types, or 0 to create every type again
+ *
+ * Creates only objects of @types and their subtypes. Other objects are
+ * skipped without reading their state, so neither is anything only they
+ * refer to. References to them are set to %NULL, or left alone if
+ * gvs_deserializer_set_skip_filtered_refs() says so, and list store items
+ * of other types are left out of their list.
+ *
+ * The object asked for is always created: the root of the document, or the
+ * entity looked up in a #GvsArchive. So are the items of a #GvsListModel,
+ * and the targets of lazy properties when they are resolved. Boxed values
+ * are not filtered.
+ */
+void
+gvs_deserializer_include_types(GvsDeserializer *self, const GType *types, guint n_types)
+{
+    GvsDeserializerPrivate *priv;
+    guint i;
+
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+    g_return_if_fail(types != NULL || n_types == 0);
+
+    priv = self->priv;
+    g_clear_pointer(&priv->type_filter, g_hash_table_destroy);
+
+    if (n_types == 0)
+        return;
+
+    priv->type_filter = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (i = 0; i < n_types; i++)
+        g_hash_table_add(priv->type_filter, GSIZE_TO_POINTER(types[i]));
+}
+
+/**
+ * gvs_deserializer_include_properties:
+ * @deserializer: A #GvsDeserializer
+ * @type: A #GObject type
+ * @names: (array zero-terminated=1) (nullable): The properties to set, or
+ *  %NULL to set them all again
+ *
+ * Sets only the properties in @names of objects of @type and its
+ * subclasses, unless a subclass has a filter of its own. Other properties
+ * are skipped without reading their values, and keep the value they had
+ * after construction. This applies to default deserialization; classes
+ * implementing #GvsSerializableInterface deserialize() or read() decide for
+ * themselves what to read.
+ */
+void
+gvs_deserializer_include_properties(GvsDeserializer    *self,
+                                    GType               type,
+                                    const char * const *names)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+    g_return_if_fail(g_type_is_a(type, G_TYPE_OBJECT));
+
+    set_property_filter(self, type, TRUE, names);
+}
+
+/**
+ * gvs_deserializer_exclude_properties:
+ * @deserializer: A #GvsDeserializer
+ * @type: A #GObject type
+ * @names: (array zero-terminated=1) (nullable): The properties not to set,
+ *  or %NULL to set them all again
+ *
+ * Like gvs_deserializer_include_properties(), but sets every property of
+ * @type except those in @names.
+ */
+void
+gvs_deserializer_exclude_properties(GvsDeserializer    *self,
+                                    GType               type,
+                                    const char * const *names)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+    g_return_if_fail(g_type_is_a(type, G_TYPE_OBJECT));
+
+    set_property_filter(self, type, FALSE, names);
+}
+
+/**
+ * gvs_deserializer_set_skip_filtered_refs:
+ * @deserializer: A #GvsDeserializer
+ * @skip: Whether to leave references to filtered objects alone
+ *
+ * By default, object properties referring to an object left out by
+ * gvs_deserializer_include_types() are set to %NULL. If @skip is %TRUE they
+ * are not set at all, and keep the value they had after construction.
+ */
+void
+gvs_deserializer_set_skip_filtered_refs(GvsDeserializer *self, gboolean skip)
+{
+    g_return_if_fail(GVS_IS_DESERIALIZER(self));
+
+    self->priv->skip_filtered_refs = skip;
+}
+
+/**
+ * gvs_deserializer_get_skip_filtered_refs:
+ * @deserializer: A #GvsDeserializer
+ *
+ * Returns: The value set with gvs_deserializer_set_skip_filtered_refs()
+ */
+gboolean
+gvs_deserializer_get_skip_filtered_refs(GvsDeserializer *self)
+{
+    g_return_val_if_fail(GVS_IS_DESERIALIZER(self), FALSE);
+
+    return self->priv->skip_filtered_refs;
+}
+
+/**
+ * gvs_resolve_lazy_property:
+ * @object: A #GObject
+ * @pspec: (nullable): A property of @object registered with
+ *  gvs_register_property_lazy(), or %NULL for all of them
+ *
+ * If @object was deserialized in lazy mode and @pspec hasn't been resolved
+ * yet, creates the object it refers to and sets the property. Does nothing
+ * if the property has been given a value since.
+ *
+ * This is cheap when there is nothing to do, so classes with lazy properties
+ * should call it at the top of get_property():
+ * |[
+ * case PROP_CHILD:
+ *     gvs_resolve_lazy_property(obj, pspec);
+ *     g_value_set_object(value, self->child);
+ *     break;
+ * ]|
+ */
+void
+gvs_resolve_lazy_property(GObject *object, GParamSpec *pspec)
+{
+    LazyRefs *refs;
+
+    g_return_if_fail(G_IS_OBJECT(object));
+    g_return_if_fail(pspec == NULL || G_IS_PARAM_SPEC(pspec));
+
+    while ((refs = g_object_get_qdata(object, lazy_refs_quark())))
+    {
+        GvsLazyDocument *lazy;
+        LazyRef ref;
+        guint i;
+
+        for (i = 0; i < refs->refs->len; i++)
+        {
+            if (!pspec || g_array_index(refs->refs, LazyRef, i).pspec == pspec)
+                break;
+        }
+
+        if (i == refs->refs->len)
+            return;
+
+        /* Forget it first, so the getter called while resolving it doesn't
+         * try again */
+        ref = g_array_index(refs->refs, LazyRef, i);
+        g_array_remove_index_fast(refs->refs, i);
+        lazy = _gvs_lazy_document_ref(refs->document);
+
+        if (refs->refs->len == 0)
+            g_object_set_qdata(object, lazy_refs_quark(), NULL);
+
+        resolve_lazy_ref(lazy, object, &ref);
+        _gvs_lazy_document_unref(lazy);
+
+        if (pspec)
+            return;
+    }
+}
+
 /**
  * gvs_deserializer_new:
  * 
@@ -559,13 +2407,37 @@ gvs_deserializer_new(void)
 
 G_DEFINE_TYPE_WITH_PRIVATE(GvsDeserializer, gvs_deserializer, G_TYPE_OBJECT)
 
+static void
+gvs_deserializer_finalize(GObject *object)
+{
+    GvsDeserializerPrivate *priv = GVS_DESERIALIZER(object)->priv;
+
+    g_hash_table_destroy(priv->class_info);
+    g_hash_table_destroy(priv->property_filters);
+    g_hash_table_destroy(priv->class_filters);
+    g_clear_pointer(&priv->type_filter, g_hash_table_destroy);
+    _gvs_stats_clear(&priv->stats);
+
+    G_OBJECT_CLASS(gvs_deserializer_parent_class)->finalize(object);
+}
+
 static void
 gvs_deserializer_class_init(GvsDeserializerClass *klass)
 {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_deserializer_finalize;
 }
 
 static void
 gvs_deserializer_init (GvsDeserializer *self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_DESERIALIZER, GvsDeserializerPrivate);
+
+    self->priv->class_info = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                   NULL, _gvs_class_info_free);
+    self->priv->property_filters = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                         NULL, property_filter_free);
+    self->priv->class_filters = g_hash_table_new(g_direct_hash, g_direct_equal);
+    _gvs_stats_init(&self->priv->stats);
 }
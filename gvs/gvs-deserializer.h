@@ -25,6 +25,8 @@
 
 #include <glib-object.h>
 
+#include "gvs-stats.h"
+
 G_BEGIN_DECLS
 
 #define GVS_TYPE_DESERIALIZER             (gvs_deserializer_get_type ())
@@ -74,6 +76,43 @@ GvsDeserializer  *gvs_deserializer_new            (void);
 gpointer          gvs_deserializer_deserialize    (GvsDeserializer *deserializer,
                                                    GVariant        *variant);
 
+void              gvs_deserializer_deserialize_property (GvsDeserializer *deserializer,
+                                                         GParamSpec      *pspec,
+                                                         GVariant        *variant,
+                                                         GValue          *value);
+
+gpointer          gvs_deserializer_read_object_ref (GvsDeserializer *deserializer,
+                                                    GVariant        *variant);
+
+GvsStats         *gvs_deserializer_get_stats       (GvsDeserializer *deserializer);
+
+void              gvs_deserializer_reset_stats     (GvsDeserializer *deserializer);
+
+void              gvs_deserializer_set_lazy        (GvsDeserializer *deserializer,
+                                                    gboolean         lazy);
+
+gboolean          gvs_deserializer_get_lazy        (GvsDeserializer *deserializer);
+
+void              gvs_deserializer_include_types   (GvsDeserializer *deserializer,
+                                                    const GType     *types,
+                                                    guint            n_types);
+
+void              gvs_deserializer_include_properties (GvsDeserializer    *deserializer,
+                                                       GType               type,
+                                                       const char * const *names);
+
+void              gvs_deserializer_exclude_properties (GvsDeserializer    *deserializer,
+                                                       GType               type,
+                                                       const char * const *names);
+
+void              gvs_deserializer_set_skip_filtered_refs (GvsDeserializer *deserializer,
+                                                           gboolean         skip);
+
+gboolean          gvs_deserializer_get_skip_filtered_refs (GvsDeserializer *deserializer);
+
+void              gvs_resolve_lazy_property        (GObject         *object,
+                                                    GParamSpec      *pspec);
+
 G_END_DECLS
 
 #endif
@@ -0,0 +1,498 @@
+/* gvs-diff.c: Structural comparison of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define __GVS_INSIDE__
+#include "gvs-diff.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <string.h>
+
+/*
+ * Two documents are compared from their roots down, in step: properties are
+ * matched by name, GListStore items by position, and an object property
+ * pairs up the entities the two documents refer to. Entity hashes tell us
+ * where to stop, since a pair with equal hashes has nothing different
+ * anywhere below it. What is left unpaired afterwards, and whose content
+ * appears nowhere in the other document, was added or removed.
+ */
+
+typedef struct
+{
+    GvsView    *old_view;
+    GvsView    *new_view;
+    GPtrArray  *result;
+
+    /* Entities paired so far, old id -> new id and back */
+    GHashTable *old_to_new;
+    GHashTable *new_to_old;
+
+    /* The entity hashes of each document */
+    GHashTable *old_hashes;
+    GHashTable *new_hashes;
+
+    /* Pairs with different hashes still to compare */
+    GArray     *queue;
+} DiffState;
+
+typedef struct
+{
+    gsize old_id;
+    gsize new_id;
+} DiffPair;
+
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+static void
+diff_entry_free(gpointer ptr)
+{
+    GvsDiffEntry *entry = ptr;
+
+    g_strfreev(entry->properties);
+    g_slice_free(GvsDiffEntry, entry);
+}
+
+static void
+add_entry(DiffState *state, GvsDiffKind kind, gsize old_id, gsize new_id,
+          char **properties)
+{
+    GvsDiffEntry *entry = g_slice_new(GvsDiffEntry);
+
+    entry->kind = kind;
+    entry->old_id = old_id;
+    entry->new_id = new_id;
+    entry->properties = properties;
+
+    g_ptr_array_add(state->result, entry);
+}
+
+static gboolean
+lookup_pair(GHashTable *table, gsize id, gsize *other)
+{
+    gpointer value;
+
+    if (!g_hash_table_lookup_extended(table, GSIZE_TO_POINTER(id), NULL, &value))
+        return FALSE;
+
+    *other = GPOINTER_TO_SIZE(value);
+
+    return TRUE;
+}
+
+static gboolean
+same_type(DiffState *state, gsize old_id, gsize new_id)
+{
+    GVariant *old_entity = gvs_view_get_entity(state->old_view, old_id);
+    GVariant *new_entity = gvs_view_get_entity(state->new_view, new_id);
+    const char *old_name, *new_name;
+    gboolean same;
+
+    g_variant_get_child(old_entity, 0, "&s", &old_name);
+    g_variant_get_child(new_entity, 0, "&s", &new_name);
+    same = strcmp(old_name, new_name) == 0;
+
+    g_variant_unref(old_entity);
+    g_variant_unref(new_entity);
+
+    return same;
+}
+
+/* Pairs two entities, and queues them for comparison if they differ */
+static void
+pair_entities(DiffState *state, gsize old_id, gsize new_id)
+{
+    g_hash_table_insert(state->old_to_new, GSIZE_TO_POINTER(old_id), GSIZE_TO_POINTER(new_id));
+    g_hash_table_insert(state->new_to_old, GSIZE_TO_POINTER(new_id), GSIZE_TO_POINTER(old_id));
+
+    if (strcmp(gvs_view_get_entity_hash(state->old_view, old_id),
+               gvs_view_get_entity_hash(state->new_view, new_id)) != 0)
+    {
+        DiffPair pair = { old_id, new_id };
+
+        g_array_append_val(state->queue, pair);
+    }
+}
+
+/* Compares two references found in the same place, pairing their targets if
+ * they can be. Returns %TRUE if the reference itself changed, that is if it
+ * now refers to something which can't be the entity it did. */
+static gboolean
+diff_refs(DiffState *state, gboolean old_present, gsize old_id,
+          gboolean new_present, gsize new_id)
+{
+    const char *old_hash, *new_hash;
+    gsize paired;
+
+    if (!old_present || !new_present)
+        return old_present != new_present;
+
+    if (old_id >= gvs_view_get_n_entities(state->old_view) ||
+        new_id >= gvs_view_get_n_entities(state->new_view))
+    {
+        return TRUE;
+    }
+
+    if (lookup_pair(state->old_to_new, old_id, &paired))
+        return paired != new_id;
+
+    if (lookup_pair(state->new_to_old, new_id, &paired))
+        return TRUE;
+
+    old_hash = gvs_view_get_entity_hash(state->old_view, old_id);
+    new_hash = gvs_view_get_entity_hash(state->new_view, new_id);
+
+    if (strcmp(old_hash, new_hash) != 0)
+    {
+        if (!same_type(state, old_id, new_id))
+            return TRUE;
+
+        /* Pointing at something which was already there, or away from
+         * something which still is, is a move rather than an edit */
+        if (g_hash_table_contains(state->new_hashes, old_hash) ||
+            g_hash_table_contains(state->old_hashes, new_hash))
+        {
+            return TRUE;
+        }
+    }
+
+    pair_entities(state, old_id, new_id);
+
+    return FALSE;
+}
+
+static gboolean
+is_ref(GVariant *value)
+{
+    return g_variant_is_of_type(value, G_VARIANT_TYPE("mt")) ||
+           g_variant_is_of_type(value, G_VARIANT_TYPE("mu"));
+}
+
+static gboolean
+is_list_store(GVariant *payload)
+{
+    return g_variant_is_of_type(payload, GVS_LIST_STORE_TYPE) ||
+           g_variant_is_of_type(payload, GVS_COMPACT_LIST_STORE_TYPE);
+}
+
+static gboolean
+diff_values(DiffState *state, GVariant *old_value, GVariant *new_value)
+{
+    char *old_digest, *new_digest;
+    gboolean changed;
+
+    if (!old_value || !new_value)
+        return old_value != new_value;
+
+    if (is_ref(old_value) && is_ref(new_value))
+    {
+        gsize old_id = 0, new_id = 0;
+        gboolean old_present = gvs_view_read_ref(old_value, &old_id);
+        gboolean new_present = gvs_view_read_ref(new_value, &new_id);
+
+        return diff_refs(state, old_present, old_id, new_present, new_id);
+    }
+
+    /* Anything else, including containers of references, compares by
+     * content */
+    old_digest = _gvs_view_hash_value(state->old_view, old_value);
+    new_digest = _gvs_view_hash_value(state->new_view, new_value);
+    changed = strcmp(old_digest, new_digest) != 0;
+
+    g_free(old_digest);
+    g_free(new_digest);
+
+    return changed;
+}
+
+static void
+diff_properties(DiffState *state, GVariant *old_payload, GVariant *new_payload,
+                GPtrArray *names)
+{
+    GVariantIter iter;
+    const char *name;
+    GVariant *value;
+
+    g_variant_iter_init(&iter, old_payload);
+    while (g_variant_iter_next(&iter, "{&sv}", &name, &value))
+    {
+        GVariant *new_value = g_variant_lookup_value(new_payload, name, NULL);
+
+        if (diff_values(state, value, new_value))
+            g_ptr_array_add(names, g_strdup(name));
+
+        if (new_value)
+            g_variant_unref(new_value);
+        g_variant_unref(value);
+    }
+
+    g_variant_iter_init(&iter, new_payload);
+    while (g_variant_iter_next(&iter, "{&sv}", &name, &value))
+    {
+        GVariant *old_value = g_variant_lookup_value(old_payload, name, NULL);
+
+        if (old_value)
+            g_variant_unref(old_value);
+        else
+            g_ptr_array_add(names, g_strdup(name));
+
+        g_variant_unref(value);
+    }
+}
+
+static gsize
+read_item(GVariant *ids, gsize i)
+{
+    GVariant *item = g_variant_get_child_value(ids, i);
+    gsize id;
+
+    if (g_variant_is_of_type(item, G_VARIANT_TYPE_UINT32))
+        id = g_variant_get_uint32(item);
+    else
+        id = g_variant_get_uint64(item);
+
+    g_variant_unref(item);
+
+    return id;
+}
+
+static void
+diff_items(DiffState *state, GVariant *old_payload, GVariant *new_payload,
+           GPtrArray *names)
+{
+    GVariant *old_ids = g_variant_get_child_value(old_payload, 1);
+    GVariant *new_ids = g_variant_get_child_value(new_payload, 1);
+    gsize n_old = g_variant_n_children(old_ids);
+    gsize n_new = g_variant_n_children(new_ids);
+    gsize i;
+
+    for (i = 0; i < MAX(n_old, n_new); i++)
+    {
+        gboolean old_present = i < n_old;
+        gboolean new_present = i < n_new;
+
+        if (diff_refs(state, old_present, old_present ? read_item(old_ids, i) : 0,
+                      new_present, new_present ? read_item(new_ids, i) : 0))
+        {
+            g_ptr_array_add(names, g_strdup_printf("%" G_GSIZE_FORMAT, i));
+        }
+    }
+
+    g_variant_unref(old_ids);
+    g_variant_unref(new_ids);
+}
+
+/* Reports what changed between two paired entities of the same type */
+static void
+diff_entities(DiffState *state, gsize old_id, gsize new_id)
+{
+    GVariant *old_entity = gvs_view_get_entity(state->old_view, old_id);
+    GVariant *new_entity = gvs_view_get_entity(state->new_view, new_id);
+    GVariant *old_payload, *new_payload;
+    GPtrArray *names = NULL;
+
+    g_variant_get_child(old_entity, 1, "v", &old_payload);
+    g_variant_get_child(new_entity, 1, "v", &new_payload);
+
+    if (g_variant_is_of_type(old_payload, G_VARIANT_TYPE_VARDICT) &&
+        g_variant_is_of_type(new_payload, G_VARIANT_TYPE_VARDICT))
+    {
+        names = g_ptr_array_new();
+        diff_properties(state, old_payload, new_payload, names);
+    }
+    else if (is_list_store(old_payload) && is_list_store(new_payload))
+    {
+        names = g_ptr_array_new();
+        diff_items(state, old_payload, new_payload, names);
+    }
+
+    /* Custom serializations can't be compared piece by piece, and entities
+     * whose differences are all further down aren't changed themselves */
+    if (!names)
+    {
+        add_entry(state, GVS_DIFF_CHANGED, old_id, new_id, NULL);
+    }
+    else if (names->len > 0)
+    {
+        g_ptr_array_add(names, NULL);
+        add_entry(state, GVS_DIFF_CHANGED, old_id, new_id,
+                  (char **) g_ptr_array_free(names, FALSE));
+    }
+    else
+    {
+        g_ptr_array_free(names, TRUE);
+    }
+
+    g_variant_unref(old_payload);
+    g_variant_unref(new_payload);
+    g_variant_unref(old_entity);
+    g_variant_unref(new_entity);
+}
+
+static GHashTable *
+hash_set_new(GvsView *view)
+{
+    GHashTable *hashes = g_hash_table_new(g_str_hash, g_str_equal);
+    gsize i, n_entities = gvs_view_get_n_entities(view);
+
+    for (i = 0; i < n_entities; i++)
+        g_hash_table_add(hashes, (gpointer) gvs_view_get_entity_hash(view, i));
+
+    return hashes;
+}
+
+/* Reports the entities of @view which weren't paired, and whose hashes
+ * aren't in @other_hashes */
+static void
+add_unpaired(DiffState *state, GvsView *view, GHashTable *paired,
+             GHashTable *other_hashes, GvsDiffKind kind)
+{
+    gsize i, n_entities = gvs_view_get_n_entities(view);
+
+    for (i = 0; i < n_entities; i++)
+    {
+        if (g_hash_table_contains(paired, GSIZE_TO_POINTER(i)) ||
+            g_hash_table_contains(other_hashes, gvs_view_get_entity_hash(view, i)))
+        {
+            continue;
+        }
+
+        if (kind == GVS_DIFF_REMOVED)
+            add_entry(state, kind, i, GVS_DIFF_NO_ENTITY, NULL);
+        else
+            add_entry(state, kind, GVS_DIFF_NO_ENTITY, i, NULL);
+    }
+}
+
+/******************************************************************************
+ *
+ * Public API
+ *
+ ******************************************************************************/
+
+/**
+ * gvs_view_diff:
+ * @old_view: A #GvsView of the old document
+ * @new_view: A #GvsView of the new document
+ *
+ * Finds what changed between two documents, without deserializing either.
+ * The roots are compared first, and from there entities are paired up by
+ * where they are referred from: by the same property of paired entities, or
+ * the same position in paired #GListStore<!-- -->s. Comparison stops
+ * wherever two paired entities have equal hashes (see
+ * gvs_view_get_entity_hash()), so once the hashes are known the work done
+ * depends on how much changed rather than on the size of the documents.
+ *
+ * A paired entity is reported as changed if any of its own properties
+ * differ; an object property only differs if it refers to an entity which
+ * can't be paired with the one it used to, not if something changed inside
+ * that entity. Entities with different hashes are only paired if neither
+ * hash is in the other document, so a property which now refers to
+ * something that was already there has changed, rather than what it refers
+ * to. Entities which weren't paired are reported as removed or added,
+ * unless an entity with the same hash is in the other document, which means
+ * it only moved.
+ *
+ * The documents should be written with %GVS_SERIALIZER_CANONICAL, or equal
+ * entities may have different hashes.
+ *
+ * Returns: (transfer full) (element-type GvsDiffEntry): The changed entities
+ *  in the order they were found, then the removed and the added entities in
+ *  order of id. Free with g_ptr_array_unref()
+ */
+GPtrArray *
+gvs_view_diff(GvsView *old_view, GvsView *new_view)
+{
+    DiffState state;
+    guint i;
+
+    g_return_val_if_fail(GVS_IS_VIEW(old_view), NULL);
+    g_return_val_if_fail(GVS_IS_VIEW(new_view), NULL);
+
+    state.old_view = old_view;
+    state.new_view = new_view;
+    state.result = g_ptr_array_new_with_free_func(diff_entry_free);
+    state.old_to_new = g_hash_table_new(NULL, NULL);
+    state.new_to_old = g_hash_table_new(NULL, NULL);
+    state.old_hashes = hash_set_new(old_view);
+    state.new_hashes = hash_set_new(new_view);
+    state.queue = g_array_new(FALSE, FALSE, sizeof(DiffPair));
+
+    if (gvs_view_get_n_entities(old_view) > 0 &&
+        gvs_view_get_n_entities(new_view) > 0 &&
+        same_type(&state, 0, 0))
+    {
+        pair_entities(&state, 0, 0);
+    }
+
+    /* The queue grows as we go */
+    for (i = 0; i < state.queue->len; i++)
+    {
+        DiffPair pair = g_array_index(state.queue, DiffPair, i);
+
+        diff_entities(&state, pair.old_id, pair.new_id);
+    }
+
+    add_unpaired(&state, old_view, state.old_to_new, state.new_hashes, GVS_DIFF_REMOVED);
+    add_unpaired(&state, new_view, state.new_to_old, state.old_hashes, GVS_DIFF_ADDED);
+
+    g_array_unref(state.queue);
+    g_hash_table_destroy(state.old_hashes);
+    g_hash_table_destroy(state.new_hashes);
+    g_hash_table_destroy(state.old_to_new);
+    g_hash_table_destroy(state.new_to_old);
+
+    return state.result;
+}
+
+/**
+ * gvs_document_diff:
+ * @old_document: A document returned by gvs_serializer_serialize_object()
+ * @new_document: Another such document
+ *
+ * Creates a #GvsView of each document and calls gvs_view_diff(). Documents
+ * written with %GVS_SERIALIZER_COLUMNAR can't be compared.
+ *
+ * Returns: (transfer full) (element-type GvsDiffEntry) (nullable): The
+ *  differences, or %NULL if either document can't be viewed. Free with
+ *  g_ptr_array_unref()
+ */
+GPtrArray *
+gvs_document_diff(GVariant *old_document, GVariant *new_document)
+{
+    GvsView *old_view, *new_view;
+    GPtrArray *result = NULL;
+
+    g_return_val_if_fail(old_document != NULL, NULL);
+    g_return_val_if_fail(new_document != NULL, NULL);
+
+    old_view = gvs_view_new(old_document);
+    new_view = gvs_view_new(new_document);
+
+    if (old_view && new_view)
+        result = gvs_view_diff(old_view, new_view);
+
+    g_clear_object(&old_view);
+    g_clear_object(&new_view);
+
+    return result;
+}
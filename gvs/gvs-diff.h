@@ -0,0 +1,84 @@
+/* gvs-diff.h: Structural comparison of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_DIFF_H__
+#define __GVS_DIFF_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+
+#include "gvs-view.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GVS_DIFF_NO_ENTITY:
+ *
+ * The id a #GvsDiffEntry gives for the side an entity is missing from
+ */
+#define GVS_DIFF_NO_ENTITY G_MAXSIZE
+
+/**
+ * GvsDiffKind:
+ * @GVS_DIFF_ADDED: The entity is only in the new document
+ * @GVS_DIFF_REMOVED: The entity is only in the old document
+ * @GVS_DIFF_CHANGED: The entity is in both, with different properties
+ *
+ * What a #GvsDiffEntry reports
+ */
+typedef enum
+{
+    GVS_DIFF_ADDED,
+    GVS_DIFF_REMOVED,
+    GVS_DIFF_CHANGED
+} GvsDiffKind;
+
+/**
+ * GvsDiffEntry:
+ * @kind: What happened to the entity
+ * @old_id: Its id in the old document, or %GVS_DIFF_NO_ENTITY if it was
+ *  added
+ * @new_id: Its id in the new document, or %GVS_DIFF_NO_ENTITY if it was
+ *  removed
+ * @properties: (array zero-terminated=1) (nullable): For a changed entity,
+ *  the names of the properties which changed, or %NULL if its state
+ *  couldn't be compared property by property. Items of a #GListStore are
+ *  named by their position.
+ *
+ * One difference found by gvs_document_diff()
+ */
+typedef struct
+{
+    GvsDiffKind   kind;
+    gsize         old_id;
+    gsize         new_id;
+    char        **properties;
+} GvsDiffEntry;
+
+GPtrArray *gvs_document_diff (GVariant *old_document,
+                              GVariant *new_document);
+
+GPtrArray *gvs_view_diff     (GvsView  *old_view,
+                              GvsView  *new_view);
+
+G_END_DECLS
+
+#endif
@@ -18,18 +18,123 @@
 
 #define __GVS_INSIDE__
 #include "gvs-gobject.h"
+#include "gvs-private.h"
 #undef __GVS_INSIDE__
 
 G_DEFINE_QUARK("gvs-property-serialize-func-quark", gvs_property_serialize_func);
 
 G_DEFINE_QUARK("gvs-property-deserialize-func-quark", gvs_property_deserialize_func);
 
+G_DEFINE_QUARK("gvs-property-offset-quark", gvs_property_offset);
+
+G_DEFINE_QUARK("gvs-property-container-quark", gvs_property_container);
+
+G_DEFINE_QUARK(gvs-property-lazy-quark, gvs_property_lazy);
+
+G_DEFINE_QUARK(gvs-property-transient-quark, gvs_property_transient);
+
+G_DEFINE_QUARK(gvs-class-value-like-quark, gvs_class_value_like);
+
+G_DEFINE_QUARK(gvs-unowned-targets-quark, gvs_unowned_targets);
+
+static void
+serialize_closure_free(gpointer ptr)
+{
+    GvsSerializeClosure *closure = ptr;
+
+    if (closure->destroy_notify)
+        closure->destroy_notify(closure->user_data);
+
+    g_slice_free(GvsSerializeClosure, closure);
+}
+
+static void
+deserialize_closure_free(gpointer ptr)
+{
+    GvsDeserializeClosure *closure = ptr;
+
+    if (closure->destroy_notify)
+        closure->destroy_notify(closure->user_data);
+
+    g_slice_free(GvsDeserializeClosure, closure);
+}
+
+static void
+field_accessor_free(gpointer ptr)
+{
+    g_slice_free(GvsFieldAccessor, ptr);
+}
+
+static gboolean
+field_kind_matches(GParamSpec *pspec, GvsFieldKind kind)
+{
+    GType type = pspec->value_type;
+
+    switch (kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            return type == G_TYPE_BOOLEAN;
+        case GVS_FIELD_CHAR:
+            return type == G_TYPE_CHAR;
+        case GVS_FIELD_UCHAR:
+            return type == G_TYPE_UCHAR;
+        case GVS_FIELD_INT:
+            return type == G_TYPE_INT;
+        case GVS_FIELD_UINT:
+            return type == G_TYPE_UINT;
+        case GVS_FIELD_LONG:
+            return type == G_TYPE_LONG;
+        case GVS_FIELD_ULONG:
+            return type == G_TYPE_ULONG;
+        case GVS_FIELD_INT64:
+            return type == G_TYPE_INT64;
+        case GVS_FIELD_UINT64:
+            return type == G_TYPE_UINT64;
+        case GVS_FIELD_FLOAT:
+            return type == G_TYPE_FLOAT;
+        case GVS_FIELD_DOUBLE:
+            return type == G_TYPE_DOUBLE;
+        case GVS_FIELD_ENUM:
+            return G_TYPE_IS_ENUM(type);
+        case GVS_FIELD_FLAGS:
+            return G_TYPE_IS_FLAGS(type);
+        case GVS_FIELD_STRING:
+            return type == G_TYPE_STRING;
+        case GVS_FIELD_OBJECT:
+        case GVS_FIELD_OBJECT_UNOWNED:
+            return G_TYPE_IS_OBJECT(type) || G_TYPE_IS_INTERFACE(type);
+        default:
+            return FALSE;
+    }
+}
+
+void
+_gvs_keep_alive(GObject *root, GObject *object)
+{
+    GHashTable *targets;
+
+    if (!object || object == root)
+        return;
+
+    targets = g_object_get_qdata(root, gvs_unowned_targets_quark());
+    if (!targets)
+    {
+        targets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        g_object_unref, NULL);
+        g_object_set_qdata_full(root, gvs_unowned_targets_quark(), targets,
+                                (GDestroyNotify) g_hash_table_destroy);
+    }
+
+    if (!g_hash_table_contains(targets, object))
+        g_hash_table_add(targets, g_object_ref(object));
+}
+
 /**
  * gvs_register_property_serialize_func: (skip)
  */
 void
-gvs_register_propery_serialize_func(GParamSpec *pspec,
-                                    GvsPropertySerializeFunc serialize)
+gvs_register_property_serialize_func(GParamSpec *pspec,
+                                     GvsPropertySerializeFunc serialize)
 {
     gvs_register_property_serialize_func_full(pspec, serialize, NULL, NULL);
 }
@@ -43,8 +148,14 @@ gvs_register_property_serialize_func_full(GParamSpec *pspec,
                                           gpointer user_data,
                                           GDestroyNotify destroy_notify)
 {
+    GvsSerializeClosure *closure = g_slice_new(GvsSerializeClosure);
+
+    closure->func = serialize;
+    closure->user_data = user_data;
+    closure->destroy_notify = destroy_notify;
+
     g_param_spec_set_qdata_full(pspec, gvs_property_serialize_func_quark(),
-                                user_data, destroy_notify);
+                                closure, serialize_closure_free);
 }
 
 /**
@@ -69,10 +180,174 @@ gvs_register_property_deserialize_func_full(GParamSpec *pspec,
                                             gpointer user_data,
                                             GDestroyNotify destroy_notify)
 {
+    GvsDeserializeClosure *closure = g_slice_new(GvsDeserializeClosure);
+
+    closure->func = deserialize;
+    closure->user_data = user_data;
+    closure->destroy_notify = destroy_notify;
+
     g_param_spec_set_qdata_full(pspec, gvs_property_deserialize_func_quark(),
-                                user_data, destroy_notify);
+                                closure, deserialize_closure_free);
 }
 
+/**
+ * gvs_register_property_offset:
+ * @pspec: A #GParamSpec installed on an object class
+ * @offset: Offset of the field backing @pspec, relative to the start of the
+ *  instance (use G_PRIVATE_OFFSET() for fields in the instance private data)
+ * @kind: How the field is stored
+ *
+ * Tells GVS that @pspec is a plain wrapper around a struct field. The
+ * serializer will then read the field directly rather than calling
+ * g_object_get_property(), and the deserializer will store into it directly,
+ * bypassing g_object_set_property() and hence the class's set_property()
+ * implementation and any "notify" emission.
+ *
+ * Construct-only properties are still passed to g_object_newv(), and any
+ * function registered with gvs_register_property_serialize_func() or
+ * gvs_register_property_deserialize_func() takes precedence.
+ *
+ * As with the serialization functions, the best place to call this is in your
+ * `class_init()` function, right after installing the property.
+ */
+void
+gvs_register_property_offset(GParamSpec  *pspec,
+                             gssize       offset,
+                             GvsFieldKind kind)
+{
+    GvsFieldAccessor *field;
+
+    g_return_if_fail(G_IS_PARAM_SPEC(pspec));
+    g_return_if_fail(field_kind_matches(pspec, kind));
+
+    field = g_slice_new(GvsFieldAccessor);
+    field->offset = offset;
+    field->kind = kind;
+
+    g_param_spec_set_qdata_full(pspec, gvs_property_offset_quark(),
+                                field, field_accessor_free);
+}
+
+/**
+ * gvs_register_property_element_type:
+ * @pspec: A #GParamSpec of type %G_TYPE_ARRAY or %G_TYPE_PTR_ARRAY
+ * @element_type: The type of the elements of the array
+ *
+ * Tells GVS what an array property contains, so that it can be serialized
+ * inline as a GVariant array. A #GArray may hold booleans, any integer type,
+ * enums, flags, floats or doubles; numeric elements are copied in bulk. A
+ * #GPtrArray may hold strings or objects, and is recreated with g_free() or
+ * g_object_unref() as its element free function.
+ */
+void
+gvs_register_property_element_type(GParamSpec *pspec,
+                                   GType       element_type)
+{
+    GvsContainerInfo *info;
+
+    g_return_if_fail(G_IS_PARAM_SPEC(pspec));
+    g_return_if_fail(pspec->value_type == G_TYPE_ARRAY ||
+                     pspec->value_type == G_TYPE_PTR_ARRAY);
+
+    info = _gvs_container_info_new(pspec->value_type, G_TYPE_INVALID, element_type);
+    if (!info)
+    {
+        g_critical("GVS cannot store elements of type %s in a %s",
+                   g_type_name(element_type), g_type_name(pspec->value_type));
+        return;
+    }
+
+    g_param_spec_set_qdata_full(pspec, gvs_property_container_quark(),
+                                info, _gvs_container_info_free);
+}
+
+/**
+ * gvs_register_property_key_value_types:
+ * @pspec: A #GParamSpec of type %G_TYPE_HASH_TABLE
+ * @key_type: The type of the keys: %G_TYPE_STRING, %G_TYPE_INT or
+ *  %G_TYPE_UINT (the latter two stored with GINT_TO_POINTER() and friends)
+ * @value_type: The type of the values: %G_TYPE_STRING, an object type, or
+ *  %G_TYPE_BOOLEAN, %G_TYPE_INT or %G_TYPE_UINT stored in the pointer
+ *
+ * Tells GVS what a hash table property contains, so that it can be
+ * serialized inline as a GVariant dictionary. Deserialized tables use
+ * g_str_hash() or g_direct_hash() as appropriate, and free string and object
+ * keys and values with g_free() and g_object_unref().
+ */
+void
+gvs_register_property_key_value_types(GParamSpec *pspec,
+                                      GType       key_type,
+                                      GType       value_type)
+{
+    GvsContainerInfo *info;
+
+    g_return_if_fail(G_IS_PARAM_SPEC(pspec));
+    g_return_if_fail(pspec->value_type == G_TYPE_HASH_TABLE);
+
+    info = _gvs_container_info_new(G_TYPE_HASH_TABLE, key_type, value_type);
+    if (!info)
+    {
+        g_critical("GVS cannot store a hash table from %s to %s",
+                   g_type_name(key_type), g_type_name(value_type));
+        return;
+    }
+
+    g_param_spec_set_qdata_full(pspec, gvs_property_container_quark(),
+                                info, _gvs_container_info_free);
+}
+
+/**
+ * gvs_register_property_lazy:
+ * @pspec: An object-typed #GParamSpec installed on an object class
+ *
+ * Tells GVS that the object @pspec refers to need not be created until it is
+ * asked for. This only has an effect on a #GvsDeserializer in lazy mode, see
+ * gvs_deserializer_set_lazy(), and relies on the class calling
+ * gvs_resolve_lazy_property() from its get_property() implementation.
+ */
+void
+gvs_register_property_lazy(GParamSpec *pspec)
+{
+    g_return_if_fail(G_TYPE_IS_OBJECT(pspec->value_type) || G_TYPE_IS_INTERFACE(pspec->value_type));
+
+    g_param_spec_set_qdata(pspec, gvs_property_lazy_quark(), GINT_TO_POINTER(TRUE));
+}
+
+/**
+ * gvs_register_property_transient:
+ * @pspec: A #GParamSpec installed on an object class
+ *
+ * Tells GVS never to serialize @pspec, as for caches and other state which
+ * can be worked out again. Deserialization leaves such properties as they
+ * were after construction. Call this from class_init, before any instance
+ * is serialized.
+ */
+void
+gvs_register_property_transient(GParamSpec *pspec)
+{
+    g_return_if_fail(G_IS_PARAM_SPEC(pspec));
+
+    g_param_spec_set_qdata(pspec, gvs_property_transient_quark(), GINT_TO_POINTER(TRUE));
+}
+
+/**
+ * gvs_register_class_value_like:
+ * @type: An object type
+ *
+ * Tells GVS that instances of @type and its subclasses are values: two of
+ * them which serialize identically may stand in for each other, so nothing
+ * depends on which instance a reference points to. A serializer with
+ * %GVS_SERIALIZER_MERGE_VALUES writes such instances as one entity, which
+ * is then deserialized as one shared instance. Call this from class_init,
+ * before any instance is serialized.
+ */
+void
+gvs_register_class_value_like(GType type)
+{
+    g_return_if_fail(g_type_is_a(type, G_TYPE_OBJECT));
+
+    g_type_set_qdata(type, gvs_class_value_like_quark(), GINT_TO_POINTER(TRUE));
+}
 
 /**
  * gvs_gobject_serialize:
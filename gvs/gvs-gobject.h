@@ -28,8 +28,55 @@
 
 G_BEGIN_DECLS
 
+/**
+ * GvsFieldKind:
+ * @GVS_FIELD_BOOLEAN: a #gboolean
+ * @GVS_FIELD_CHAR: a #gint8
+ * @GVS_FIELD_UCHAR: a #guint8
+ * @GVS_FIELD_INT: a #gint
+ * @GVS_FIELD_UINT: a #guint
+ * @GVS_FIELD_LONG: a #glong
+ * @GVS_FIELD_ULONG: a #gulong
+ * @GVS_FIELD_INT64: a #gint64
+ * @GVS_FIELD_UINT64: a #guint64
+ * @GVS_FIELD_FLOAT: a #gfloat
+ * @GVS_FIELD_DOUBLE: a #gdouble
+ * @GVS_FIELD_ENUM: a #gint holding an enum value
+ * @GVS_FIELD_FLAGS: a #guint holding a flags value
+ * @GVS_FIELD_STRING: a `char *` owned by the instance (freed with g_free())
+ * @GVS_FIELD_OBJECT: a #GObject pointer holding a strong reference
+ * @GVS_FIELD_OBJECT_UNOWNED: a #GObject pointer holding no reference
+ *
+ * Describes the C storage of a property registered with
+ * gvs_register_property_offset().
+ */
+typedef enum
+{
+    GVS_FIELD_BOOLEAN,
+    GVS_FIELD_CHAR,
+    GVS_FIELD_UCHAR,
+    GVS_FIELD_INT,
+    GVS_FIELD_UINT,
+    GVS_FIELD_LONG,
+    GVS_FIELD_ULONG,
+    GVS_FIELD_INT64,
+    GVS_FIELD_UINT64,
+    GVS_FIELD_FLOAT,
+    GVS_FIELD_DOUBLE,
+    GVS_FIELD_ENUM,
+    GVS_FIELD_FLAGS,
+    GVS_FIELD_STRING,
+    GVS_FIELD_OBJECT,
+    GVS_FIELD_OBJECT_UNOWNED
+} GvsFieldKind;
+
 GQuark       gvs_property_serialize_func_quark   (void) G_GNUC_CONST;
 GQuark       gvs_property_deserialize_func_quark (void) G_GNUC_CONST;
+GQuark       gvs_property_offset_quark           (void) G_GNUC_CONST;
+GQuark       gvs_property_container_quark        (void) G_GNUC_CONST;
+GQuark       gvs_property_lazy_quark             (void) G_GNUC_CONST;
+GQuark       gvs_property_transient_quark        (void) G_GNUC_CONST;
+GQuark       gvs_class_value_like_quark          (void) G_GNUC_CONST;
 
 void         gvs_register_property_serialize_func(GParamSpec *pspec,
                                                   GvsPropertySerializeFunc serialize);
@@ -47,10 +94,34 @@ void         gvs_register_property_deserialize_func_full(GParamSpec *pspec,
                                                          gpointer user_data,
                                                          GDestroyNotify destroy_notify);
 
+void         gvs_register_property_offset(GParamSpec  *pspec,
+                                          gssize       offset,
+                                          GvsFieldKind kind);
+
+void         gvs_register_property_element_type(GParamSpec *pspec,
+                                                GType       element_type);
+
+void         gvs_register_property_key_value_types(GParamSpec *pspec,
+                                                   GType       key_type,
+                                                   GType       value_type);
+
+void         gvs_register_property_lazy(GParamSpec *pspec);
+
+void         gvs_register_property_transient(GParamSpec *pspec);
+
+void         gvs_register_class_value_like(GType type);
+
 GVariant    *gvs_gobject_serialize(GObject *object);
 
 gpointer     gvs_gobject_new_deserialize(GVariant *variant);
 
+gpointer     gvs_gobject_clone(GObject *object);
+
+gboolean     gvs_gobject_equal(GObject *a,
+                               GObject *b);
+
+guint        gvs_gobject_hash(GObject *object);
+
 G_END_DECLS
 
 #endif
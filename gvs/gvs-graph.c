@@ -0,0 +1,979 @@
+/* gvs-graph.c: Operations on live object graphs
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define __GVS_INSIDE__
+#include "gvs-gobject.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <gio/gio.h>
+#include <string.h>
+
+/*
+ * These walk object graphs the way a GvsSerializer would, but work on the
+ * objects themselves rather than building a document. Anything whose
+ * serialized form is up to custom code (a GvsSerializable class, or a
+ * property with its own serialize function) can only be handled by
+ * actually serializing it.
+ */
+
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+/* Whether objects of @info's class are serialized by GVS alone */
+static gboolean
+class_is_plain(GvsClassInfo *info)
+{
+    guint i;
+
+    if (info->iface)
+        return FALSE;
+
+    for (i = 0; i < info->n_pspecs; i++)
+    {
+        if (g_param_spec_get_qdata(info->pspecs[i], gvs_property_serialize_func_quark()) ||
+            g_param_spec_get_qdata(info->pspecs[i], gvs_property_deserialize_func_quark()))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* The size of a field of @kind which can be copied bit for bit, or 0 */
+static gsize
+field_size(GvsFieldKind kind)
+{
+    switch (kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            return sizeof(gboolean);
+        case GVS_FIELD_CHAR:
+        case GVS_FIELD_UCHAR:
+            return sizeof(guint8);
+        case GVS_FIELD_INT:
+        case GVS_FIELD_ENUM:
+            return sizeof(gint);
+        case GVS_FIELD_UINT:
+        case GVS_FIELD_FLAGS:
+            return sizeof(guint);
+        case GVS_FIELD_LONG:
+        case GVS_FIELD_ULONG:
+            return sizeof(glong);
+        case GVS_FIELD_INT64:
+        case GVS_FIELD_UINT64:
+            return sizeof(gint64);
+        case GVS_FIELD_FLOAT:
+            return sizeof(gfloat);
+        case GVS_FIELD_DOUBLE:
+            return sizeof(gdouble);
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Cloning
+ *
+ * Like deserialization, this happens in two stages: each object is created,
+ * with its construct-only properties, when it is first reached, and its
+ * other properties are set once it comes off the queue. References to an
+ * object already reached, including those making a cycle, use the copy
+ * already made. The copies are only held by what refers to them, except
+ * that the targets of GVS_FIELD_OBJECT_UNOWNED fields are held by the copy
+ * of the root, as deserialized graphs are.
+ *
+ * A cycle through construct-only properties can't be copied this way, since
+ * neither object can be created before the other; such graphs are copied by
+ * serializing them, as the deserializer has its own way out.
+ */
+
+typedef struct
+{
+    GHashTable *class_info;
+
+    /* Source object -> its copy, holding a reference to each */
+    GHashTable *copies;
+
+    /* The copy of the object being cloned */
+    GObject    *root;
+
+    /* Source objects whose copies are being created */
+    GHashTable *creating;
+
+    /* Source objects whose copies have yet to be filled in */
+    GQueue      pending;
+
+    /* Set when something which can't be copied directly is found */
+    gboolean    failed;
+} CloneState;
+
+static GObject *get_copy(GObject *source, gpointer user_data);
+
+static void
+copy_value(CloneState *state, GParamSpec *pspec, const GValue *src, GValue *dest)
+{
+    const GvsContainerInfo *container = gvs_container_info_peek(pspec);
+
+    g_value_init(dest, pspec->value_type);
+
+    if (container)
+        _gvs_container_copy(container, src, dest, get_copy, state);
+    else if (G_VALUE_HOLDS_OBJECT(src))
+        g_value_set_object(dest, get_copy(g_value_get_object(src), state));
+    else
+        g_value_copy(src, dest);
+}
+
+static GObject *
+create_copy(CloneState *state, GObject *source)
+{
+    GvsClassInfo *info;
+    GParameter *params;
+    GObject *copy;
+    guint n_params = 0, i;
+
+    if (G_IS_LIST_STORE(source))
+        return g_object_new(G_TYPE_LIST_STORE, "item-type",
+                            g_list_model_get_item_type(G_LIST_MODEL(source)), NULL);
+
+    info = _gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(source));
+
+    if (!class_is_plain(info))
+    {
+        state->failed = TRUE;
+        return NULL;
+    }
+
+    params = g_newa(GParameter, info->n_construct_pspecs);
+
+    for (i = 0; i < info->n_construct_pspecs; i++)
+    {
+        GParamSpec *pspec = info->construct_pspecs[i];
+        GValue value = G_VALUE_INIT;
+
+        g_value_init(&value, pspec->value_type);
+        g_object_get_property(source, pspec->name, &value);
+
+        params[n_params].name = pspec->name;
+        memset(&params[n_params].value, 0, sizeof(GValue));
+        copy_value(state, pspec, &value, &params[n_params].value);
+        n_params++;
+
+        g_value_unset(&value);
+    }
+
+    copy = g_object_newv(info->type, n_params, params);
+
+    for (i = 0; i < n_params; i++)
+        g_value_unset(&params[i].value);
+
+    return copy;
+}
+
+/* A GvsObjectMapFunc: returns the copy of @source, creating it first if it
+ * hasn't been reached before */
+static GObject *
+get_copy(GObject *source, gpointer user_data)
+{
+    CloneState *state = user_data;
+    GObject *copy;
+
+    if (!source || state->failed)
+        return NULL;
+
+    copy = g_hash_table_lookup(state->copies, source);
+    if (copy)
+        return copy;
+
+    /* Reached again through its own construct-only properties */
+    if (g_hash_table_contains(state->creating, source))
+    {
+        state->failed = TRUE;
+        return NULL;
+    }
+
+    g_hash_table_add(state->creating, source);
+    copy = create_copy(state, source);
+    g_hash_table_remove(state->creating, source);
+
+    if (!copy)
+        return NULL;
+
+    g_hash_table_insert(state->copies, g_object_ref(source), copy);
+    g_queue_push_tail(&state->pending, source);
+
+    return copy;
+}
+
+static void
+copy_field(CloneState *state, GObject *source, GObject *copy,
+           const GvsFieldAccessor *field)
+{
+    gconstpointer src = G_STRUCT_MEMBER_P(source, field->offset);
+    gpointer dest = G_STRUCT_MEMBER_P(copy, field->offset);
+    gsize size = field_size(field->kind);
+
+    if (size)
+    {
+        memcpy(dest, src, size);
+        return;
+    }
+
+    switch (field->kind)
+    {
+        case GVS_FIELD_STRING:
+            g_free(*(char **) dest);
+            *(char **) dest = g_strdup(*(char * const *) src);
+            break;
+        case GVS_FIELD_OBJECT:
+        {
+            GObject *old = *(GObject **) dest;
+            GObject *target = get_copy(*(GObject * const *) src, state);
+
+            *(GObject **) dest = target ? g_object_ref(target) : NULL;
+            if (old)
+                g_object_unref(old);
+            break;
+        }
+        case GVS_FIELD_OBJECT_UNOWNED:
+        {
+            GObject *target = get_copy(*(GObject * const *) src, state);
+
+            if (target)
+                _gvs_keep_alive(state->root, target);
+            *(GObject **) dest = target;
+            break;
+        }
+        default:
+            g_assert_not_reached();
+            break;
+    }
+}
+
+/* Sets the state of @copy, other than its construct-only properties */
+static void
+fill_copy(CloneState *state, GObject *source, GObject *copy)
+{
+    GvsClassInfo *info;
+    guint i;
+
+    if (G_IS_LIST_STORE(source))
+    {
+        guint n_items = g_list_model_get_n_items(G_LIST_MODEL(source));
+
+        for (i = 0; i < n_items; i++)
+        {
+            GObject *item = g_list_model_get_object(G_LIST_MODEL(source), i);
+            GObject *item_copy = get_copy(item, state);
+
+            if (item_copy)
+                g_list_store_append(G_LIST_STORE(copy), item_copy);
+            g_object_unref(item);
+        }
+
+        return;
+    }
+
+    info = _gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(source));
+
+    for (i = 0; i < info->n_pspecs && !state->failed; i++)
+    {
+        GParamSpec *pspec = info->pspecs[i];
+        const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+        GValue value = G_VALUE_INIT, value_copy = G_VALUE_INIT;
+
+        if (pspec->flags & G_PARAM_CONSTRUCT_ONLY)
+            continue;
+
+        if (field)
+        {
+            copy_field(state, source, copy, field);
+            continue;
+        }
+
+        g_value_init(&value, pspec->value_type);
+        g_object_get_property(source, pspec->name, &value);
+        copy_value(state, pspec, &value, &value_copy);
+        g_object_set_property(copy, pspec->name, &value_copy);
+
+        g_value_unset(&value_copy);
+        g_value_unset(&value);
+    }
+}
+
+/*
+ * Equality and hashing
+ *
+ * Two graphs are equal if they would serialize the same, except that hash
+ * tables are compared as unordered. They are walked in step from their
+ * roots, pairing each object of one with the object in the same place in
+ * the other; an object which turns up again must be paired with the same
+ * counterpart, which is how shared objects and cycles are checked.
+ */
+
+typedef struct
+{
+    GHashTable    *class_info;
+
+    /* Objects paired so far, each way round */
+    GHashTable    *a_to_b;
+    GHashTable    *b_to_a;
+
+    /* Objects of the first graph whose properties are still to compare */
+    GQueue         pending;
+
+    /* What compares boxed values, created when first needed */
+    GvsSerializer *boxed_serializer;
+
+    /* Set when something which can't be compared directly is found */
+    gboolean       failed;
+} EqualState;
+
+/* Returns the serialized form of boxed @value, as it would be written as
+ * an entity, or %NULL if it has none */
+static GVariant *
+serialize_boxed(GvsSerializer **serializer, const GValue *value)
+{
+    const GvsBoxedTransform *transform = _gvs_boxed_transform_lookup(G_VALUE_TYPE(value));
+
+    if (!transform || !g_value_peek_pointer(value))
+        return NULL;
+
+    if (!*serializer)
+        *serializer = gvs_serializer_new();
+
+    return g_variant_ref_sink(transform->serialize(*serializer, value, NULL));
+}
+
+static gboolean
+basic_values_equal(const GValue *a, const GValue *b)
+{
+    switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(a)))
+    {
+        case G_TYPE_BOOLEAN:
+            return !g_value_get_boolean(a) == !g_value_get_boolean(b);
+        case G_TYPE_CHAR:
+            return g_value_get_schar(a) == g_value_get_schar(b);
+        case G_TYPE_UCHAR:
+            return g_value_get_uchar(a) == g_value_get_uchar(b);
+        case G_TYPE_INT:
+            return g_value_get_int(a) == g_value_get_int(b);
+        case G_TYPE_UINT:
+            return g_value_get_uint(a) == g_value_get_uint(b);
+        case G_TYPE_LONG:
+            return g_value_get_long(a) == g_value_get_long(b);
+        case G_TYPE_ULONG:
+            return g_value_get_ulong(a) == g_value_get_ulong(b);
+        case G_TYPE_INT64:
+            return g_value_get_int64(a) == g_value_get_int64(b);
+        case G_TYPE_UINT64:
+            return g_value_get_uint64(a) == g_value_get_uint64(b);
+        case G_TYPE_ENUM:
+            return g_value_get_enum(a) == g_value_get_enum(b);
+        case G_TYPE_FLAGS:
+            return g_value_get_flags(a) == g_value_get_flags(b);
+        case G_TYPE_FLOAT:
+        {
+            /* Bit for bit, as serialized documents compare */
+            gfloat float_a = g_value_get_float(a), float_b = g_value_get_float(b);
+            return memcmp(&float_a, &float_b, sizeof(gfloat)) == 0;
+        }
+        case G_TYPE_DOUBLE:
+        {
+            gdouble double_a = g_value_get_double(a), double_b = g_value_get_double(b);
+            return memcmp(&double_a, &double_b, sizeof(gdouble)) == 0;
+        }
+        case G_TYPE_STRING:
+            return g_strcmp0(g_value_get_string(a), g_value_get_string(b)) == 0;
+        case G_TYPE_VARIANT:
+        {
+            GVariant *variant_a = g_value_get_variant(a);
+            GVariant *variant_b = g_value_get_variant(b);
+
+            if (!variant_a || !variant_b)
+                return variant_a == variant_b;
+
+            return g_variant_equal(variant_a, variant_b);
+        }
+        default:
+            return g_value_peek_pointer(a) == g_value_peek_pointer(b);
+    }
+}
+
+/* A GvsObjectPairFunc: pairs @a with @b, or returns %FALSE if either is
+ * already paired with something else */
+static gboolean
+pair_objects(GObject *a, GObject *b, gpointer user_data)
+{
+    EqualState *state = user_data;
+    GvsClassInfo *info;
+    gpointer paired;
+
+    if (!a || !b)
+        return a == b;
+
+    if (state->failed)
+        return FALSE;
+
+    if (g_hash_table_lookup_extended(state->a_to_b, a, NULL, &paired))
+        return paired == b;
+
+    if (g_hash_table_contains(state->b_to_a, b) || G_OBJECT_TYPE(a) != G_OBJECT_TYPE(b))
+        return FALSE;
+
+    if (!G_IS_LIST_STORE(a))
+    {
+        info = _gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(a));
+
+        if (!class_is_plain(info))
+        {
+            state->failed = TRUE;
+            return FALSE;
+        }
+    }
+
+    g_hash_table_insert(state->a_to_b, a, b);
+    g_hash_table_insert(state->b_to_a, b, a);
+    g_queue_push_tail(&state->pending, a);
+
+    return TRUE;
+}
+
+static gboolean
+values_equal(EqualState *state, GParamSpec *pspec, const GValue *a, const GValue *b)
+{
+    const GvsContainerInfo *container = gvs_container_info_peek(pspec);
+    GVariant *variant_a, *variant_b;
+    gboolean equal;
+
+    if (container)
+        return _gvs_container_equal(container, a, b, pair_objects, state);
+
+    if (G_VALUE_HOLDS_OBJECT(a))
+        return pair_objects(g_value_get_object(a), g_value_get_object(b), state);
+
+    if (!G_VALUE_HOLDS_BOXED(a))
+        return basic_values_equal(a, b);
+
+    if (g_value_peek_pointer(a) == g_value_peek_pointer(b))
+        return TRUE;
+
+    variant_a = serialize_boxed(&state->boxed_serializer, a);
+    variant_b = serialize_boxed(&state->boxed_serializer, b);
+    equal = variant_a && variant_b && g_variant_equal(variant_a, variant_b);
+
+    if (variant_a)
+        g_variant_unref(variant_a);
+    if (variant_b)
+        g_variant_unref(variant_b);
+
+    return equal;
+}
+
+static gboolean
+fields_equal(EqualState *state, GObject *a, GObject *b, const GvsFieldAccessor *field)
+{
+    gconstpointer mem_a = G_STRUCT_MEMBER_P(a, field->offset);
+    gconstpointer mem_b = G_STRUCT_MEMBER_P(b, field->offset);
+    gsize size = field_size(field->kind);
+
+    if (field->kind == GVS_FIELD_BOOLEAN)
+        return !*(const gboolean *) mem_a == !*(const gboolean *) mem_b;
+
+    if (size)
+        return memcmp(mem_a, mem_b, size) == 0;
+
+    if (field->kind == GVS_FIELD_STRING)
+        return g_strcmp0(*(char * const *) mem_a, *(char * const *) mem_b) == 0;
+
+    return pair_objects(*(GObject * const *) mem_a, *(GObject * const *) mem_b, state);
+}
+
+/* Compares the state of two paired objects of the same type */
+static gboolean
+objects_equal(EqualState *state, GObject *a, GObject *b)
+{
+    GvsClassInfo *info;
+    guint i;
+
+    if (G_IS_LIST_STORE(a))
+    {
+        GListModel *model_a = G_LIST_MODEL(a), *model_b = G_LIST_MODEL(b);
+        guint n_items = g_list_model_get_n_items(model_a);
+        gboolean equal = g_list_model_get_item_type(model_a) == g_list_model_get_item_type(model_b) &&
+                         g_list_model_get_n_items(model_b) == n_items;
+
+        for (i = 0; equal && i < n_items; i++)
+        {
+            GObject *item_a = g_list_model_get_object(model_a, i);
+            GObject *item_b = g_list_model_get_object(model_b, i);
+
+            equal = pair_objects(item_a, item_b, state);
+
+            g_object_unref(item_a);
+            g_object_unref(item_b);
+        }
+
+        return equal;
+    }
+
+    info = _gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(a));
+
+    for (i = 0; i < info->n_pspecs; i++)
+    {
+        GParamSpec *pspec = info->pspecs[i];
+        const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+        GValue value_a = G_VALUE_INIT, value_b = G_VALUE_INIT;
+        gboolean equal;
+
+        if (field)
+        {
+            if (!fields_equal(state, a, b, field))
+                return FALSE;
+            continue;
+        }
+
+        g_value_init(&value_a, pspec->value_type);
+        g_value_init(&value_b, pspec->value_type);
+        g_object_get_property(a, pspec->name, &value_a);
+        g_object_get_property(b, pspec->name, &value_b);
+
+        equal = values_equal(state, pspec, &value_a, &value_b);
+
+        g_value_unset(&value_a);
+        g_value_unset(&value_b);
+
+        if (!equal)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+typedef struct
+{
+    GHashTable    *class_info;
+
+    /* Objects already reached */
+    GHashTable    *visited;
+    GQueue         pending;
+
+    GvsSerializer *boxed_serializer;
+    gboolean       failed;
+} HashState;
+
+/* A GvsObjectHashFunc. References only add whether they are set, since
+ * the objects they refer to are hashed in their own right, and queues
+ * @object to be hashed if it hasn't been reached before */
+static guint
+hash_object_ref(GObject *object, gpointer user_data)
+{
+    HashState *state = user_data;
+
+    if (!object)
+        return 0;
+
+    if (!g_hash_table_contains(state->visited, object))
+    {
+        if (!G_IS_LIST_STORE(object) &&
+            !class_is_plain(_gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(object))))
+        {
+            state->failed = TRUE;
+        }
+
+        g_hash_table_add(state->visited, object);
+        g_queue_push_tail(&state->pending, object);
+    }
+
+    return 1;
+}
+
+static guint
+hash_bytes(gconstpointer data, gsize size)
+{
+    const guchar *bytes = data;
+    guint hash = 5381;
+    gsize i;
+
+    for (i = 0; i < size; i++)
+        hash = hash * 33 + bytes[i];
+
+    return hash;
+}
+
+/* Hashes the serialized form of @variant, which unlike g_variant_hash()
+ * works for any type */
+static guint
+hash_variant(GVariant *variant)
+{
+    GVariant *normal;
+    guint hash;
+
+    if (!variant)
+        return 0;
+
+    normal = g_variant_get_normal_form(variant);
+    hash = g_str_hash(g_variant_get_type_string(normal)) * 31 +
+           hash_bytes(g_variant_get_data(normal), g_variant_get_size(normal));
+    g_variant_unref(normal);
+
+    return hash;
+}
+
+static guint
+hash_value(HashState *state, GParamSpec *pspec, const GValue *value)
+{
+    const GvsContainerInfo *container = gvs_container_info_peek(pspec);
+
+    if (container)
+        return _gvs_container_hash(container, value, hash_object_ref, state);
+
+    switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(value)))
+    {
+        case G_TYPE_BOOLEAN:
+            return g_value_get_boolean(value) != 0;
+        case G_TYPE_CHAR:
+            return g_value_get_schar(value);
+        case G_TYPE_UCHAR:
+            return g_value_get_uchar(value);
+        case G_TYPE_INT:
+            return g_value_get_int(value);
+        case G_TYPE_UINT:
+            return g_value_get_uint(value);
+        case G_TYPE_ENUM:
+            return g_value_get_enum(value);
+        case G_TYPE_FLAGS:
+            return g_value_get_flags(value);
+        case G_TYPE_LONG:
+        case G_TYPE_ULONG:
+        case G_TYPE_INT64:
+        case G_TYPE_UINT64:
+        case G_TYPE_FLOAT:
+        case G_TYPE_DOUBLE:
+        {
+            guint64 bits = 0;
+            GValue wide = G_VALUE_INIT;
+
+            if (G_VALUE_HOLDS_FLOAT(value))
+            {
+                gfloat f = g_value_get_float(value);
+                memcpy(&bits, &f, sizeof(gfloat));
+            }
+            else if (G_VALUE_HOLDS_DOUBLE(value))
+            {
+                gdouble d = g_value_get_double(value);
+                memcpy(&bits, &d, sizeof(gdouble));
+            }
+            else
+            {
+                g_value_init(&wide, G_TYPE_UINT64);
+                g_value_transform(value, &wide);
+                bits = g_value_get_uint64(&wide);
+            }
+
+            return (guint) (bits ^ (bits >> 32));
+        }
+        case G_TYPE_STRING:
+            return g_value_get_string(value) ? g_str_hash(g_value_get_string(value)) : 0;
+        case G_TYPE_VARIANT:
+            return hash_variant(g_value_get_variant(value));
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+            return hash_object_ref(g_value_get_object(value), state);
+        case G_TYPE_BOXED:
+        {
+            GVariant *variant = serialize_boxed(&state->boxed_serializer, value);
+            guint hash = hash_variant(variant);
+
+            if (variant)
+                g_variant_unref(variant);
+
+            return hash;
+        }
+        default:
+            return 0;
+    }
+}
+
+static guint
+hash_field(HashState *state, GObject *object, const GvsFieldAccessor *field)
+{
+    gconstpointer mem = G_STRUCT_MEMBER_P(object, field->offset);
+
+    switch (field->kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            return *(const gboolean *) mem != 0;
+        case GVS_FIELD_STRING:
+            return *(char * const *) mem ? g_str_hash(*(char * const *) mem) : 0;
+        case GVS_FIELD_OBJECT:
+        case GVS_FIELD_OBJECT_UNOWNED:
+            return hash_object_ref(*(GObject * const *) mem, state);
+        default:
+            return hash_bytes(mem, field_size(field->kind));
+    }
+}
+
+static guint
+hash_object(HashState *state, GObject *object)
+{
+    guint hash = g_str_hash(G_OBJECT_TYPE_NAME(object));
+    GvsClassInfo *info;
+    guint i;
+
+    if (G_IS_LIST_STORE(object))
+    {
+        GListModel *model = G_LIST_MODEL(object);
+        guint n_items = g_list_model_get_n_items(model);
+
+        hash = hash * 31 + g_str_hash(g_type_name(g_list_model_get_item_type(model)));
+
+        for (i = 0; i < n_items; i++)
+        {
+            GObject *item = g_list_model_get_object(model, i);
+
+            hash = hash * 31 + hash_object_ref(item, state);
+            g_object_unref(item);
+        }
+
+        return hash;
+    }
+
+    info = _gvs_class_info_lookup(state->class_info, G_OBJECT_TYPE(object));
+
+    for (i = 0; i < info->n_pspecs; i++)
+    {
+        GParamSpec *pspec = info->pspecs[i];
+        const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+        GValue value = G_VALUE_INIT;
+
+        if (field)
+        {
+            hash = hash * 31 + hash_field(state, object, field);
+            continue;
+        }
+
+        g_value_init(&value, pspec->value_type);
+        g_object_get_property(object, pspec->name, &value);
+        hash = hash * 31 + hash_value(state, pspec, &value);
+        g_value_unset(&value);
+    }
+
+    return hash;
+}
+
+/* Serializes a graph which can't be walked directly, in a form which
+ * doesn't depend on hash table order */
+static GVariant *
+serialize_canonical(GObject *object)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_CANONICAL);
+    document = gvs_serializer_serialize_object(serializer, object);
+    g_object_unref(serializer);
+
+    return document;
+}
+
+/******************************************************************************
+ *
+ * Public API
+ *
+ ******************************************************************************/
+
+/**
+ * gvs_gobject_clone:
+ * @object: A #GObject
+ *
+ * Makes a deep copy of @object and everything it refers to, as
+ * gvs_gobject_serialize() followed by gvs_gobject_new_deserialize() would,
+ * but copying property values straight from each object to its copy. The
+ * same properties are copied, objects referred to more than once are
+ * copied once, cycles are copied as cycles, and construct-only properties
+ * are given to g_object_newv().
+ *
+ * Classes implementing #GvsSerializable, and properties with their own
+ * serialize or deserialize functions, define their state by what they
+ * write, so a graph holding any of them is copied by serializing it.
+ *
+ * Returns: (transfer full) (type GObject): A copy of @object
+ */
+gpointer
+gvs_gobject_clone(GObject *object)
+{
+    CloneState state;
+    GObject *copy, *source;
+
+    g_return_val_if_fail(G_IS_OBJECT(object), NULL);
+
+    state.class_info = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, _gvs_class_info_free);
+    state.copies = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         g_object_unref, g_object_unref);
+    state.root = NULL;
+    state.creating = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_queue_init(&state.pending);
+    state.failed = FALSE;
+
+    copy = state.root = get_copy(object, &state);
+
+    while (!state.failed && (source = g_queue_pop_head(&state.pending)))
+        fill_copy(&state, source, g_hash_table_lookup(state.copies, source));
+
+    if (state.failed)
+    {
+        GVariant *document = gvs_gobject_serialize(object);
+
+        copy = gvs_gobject_new_deserialize(document);
+        g_variant_unref(document);
+    }
+    else
+    {
+        g_object_ref(copy);
+    }
+
+    g_queue_clear(&state.pending);
+    g_hash_table_destroy(state.creating);
+    g_hash_table_destroy(state.copies);
+    g_hash_table_destroy(state.class_info);
+
+    return copy;
+}
+
+/**
+ * gvs_gobject_equal:
+ * @a: A #GObject
+ * @b: Another #GObject
+ *
+ * Compares two object graphs without serializing them. They are equal if
+ * gvs_gobject_serialize() would give equal documents for both, except that
+ * the entries of #GHashTable properties are compared whatever their order:
+ * the same properties are compared, and objects must be shared, and form
+ * cycles, in the same way in both. Comparison stops at the first
+ * difference. Hash table properties are looked up in each other, so should
+ * use the hash functions GVS gives them on deserialization.
+ *
+ * Graphs holding classes or properties with custom serialization are
+ * compared by serializing them.
+ *
+ * Returns: %TRUE if the graphs from @a and @b are equal
+ */
+gboolean
+gvs_gobject_equal(GObject *a, GObject *b)
+{
+    EqualState state;
+    GObject *object;
+    gboolean equal;
+
+    g_return_val_if_fail(G_IS_OBJECT(a), FALSE);
+    g_return_val_if_fail(G_IS_OBJECT(b), FALSE);
+
+    if (a == b)
+        return TRUE;
+
+    state.class_info = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, _gvs_class_info_free);
+    state.a_to_b = g_hash_table_new(NULL, NULL);
+    state.b_to_a = g_hash_table_new(NULL, NULL);
+    g_queue_init(&state.pending);
+    state.boxed_serializer = NULL;
+    state.failed = FALSE;
+
+    equal = pair_objects(a, b, &state);
+
+    while (equal && (object = g_queue_pop_head(&state.pending)))
+        equal = objects_equal(&state, object, g_hash_table_lookup(state.a_to_b, object));
+
+    if (state.failed)
+    {
+        GVariant *document_a = serialize_canonical(a);
+        GVariant *document_b = serialize_canonical(b);
+
+        equal = g_variant_equal(document_a, document_b);
+
+        g_variant_unref(document_a);
+        g_variant_unref(document_b);
+    }
+
+    g_queue_clear(&state.pending);
+    g_hash_table_destroy(state.a_to_b);
+    g_hash_table_destroy(state.b_to_a);
+    g_hash_table_destroy(state.class_info);
+    g_clear_object(&state.boxed_serializer);
+
+    return equal;
+}
+
+/**
+ * gvs_gobject_hash:
+ * @object: A #GObject
+ *
+ * Returns a hash of the graph from @object, for which graphs equal by
+ * gvs_gobject_equal() have equal hashes. Each object reached adds a hash of
+ * its type and property values; references only add whether they are set,
+ * so graphs differing only in how their objects refer to each other may
+ * collide.
+ *
+ * Returns: A hash of @object and everything it refers to
+ */
+guint
+gvs_gobject_hash(GObject *object)
+{
+    HashState state;
+    GObject *current;
+    guint hash = 0;
+
+    g_return_val_if_fail(G_IS_OBJECT(object), 0);
+
+    state.class_info = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, _gvs_class_info_free);
+    state.visited = g_hash_table_new(NULL, NULL);
+    g_queue_init(&state.pending);
+    state.boxed_serializer = NULL;
+    state.failed = FALSE;
+
+    hash_object_ref(object, &state);
+
+    /* Summed, since equal graphs may reach their objects in different
+     * orders through hash tables */
+    while (!state.failed && (current = g_queue_pop_head(&state.pending)))
+        hash += hash_object(&state, current);
+
+    if (state.failed)
+    {
+        GVariant *document = serialize_canonical(object);
+
+        hash = hash_variant(document);
+        g_variant_unref(document);
+    }
+
+    g_queue_clear(&state.pending);
+    g_hash_table_destroy(state.visited);
+    g_hash_table_destroy(state.class_info);
+    g_clear_object(&state.boxed_serializer);
+
+    return hash;
+}
@@ -0,0 +1,441 @@
+/* gvs-list-model.c: GListModel over a serialized list
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-list-model.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+/*
+ * The model reads the item ids of the serialized GListStore at the root of a
+ * document, and creates each item from the document the first time it is
+ * asked for. Items, and whatever they refer to, are shared for as long as
+ * they live, whether through the cache or because the caller kept them.
+ */
+
+#define GVS_LIST_MODEL_DEFAULT_CACHE_SIZE 256
+
+typedef struct
+{
+    guint    position;
+    gpointer item;
+} CacheEntry;
+
+struct _GvsListModelPrivate
+{
+    GvsDeserializer *deserializer;
+    GvsLazyDocument *document;
+    GType            item_type;
+
+    /* The ids of the items of the whole list, 64-bit or, in compact
+     * documents, 32-bit. Slices share them. */
+    GVariant        *ids;
+    gconstpointer    id_data;
+    gboolean         compact;
+    guint            offset;
+    guint            n_items;
+
+    /* CacheEntrys, most recently used first, and their links by position */
+    GQueue           cache;
+    GHashTable      *cache_links;
+    guint            cache_size;
+};
+
+static void gvs_list_model_iface_init(GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(GvsListModel, gvs_list_model, G_TYPE_OBJECT,
+                        G_ADD_PRIVATE(GvsListModel)
+                        G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL,
+                                              gvs_list_model_iface_init))
+
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+/* Makes a model of the list at the root of a document read with @fetch,
+ * whose string table is @strings, or %NULL */
+static GvsListModel *
+open_list(GvsDeserializer *deserializer,
+          gsize n_entities,
+          GVariant *strings,
+          GvsEntityFetchFunc fetch,
+          gpointer user_data,
+          GDestroyNotify destroy)
+{
+    GvsListModelPrivate *priv;
+    GvsListModel *self = NULL;
+    const char *type_name, *item_type_name;
+    GVariant *root, *list;
+    GType type, item_type;
+    gsize n_items;
+
+    if (n_entities == 0)
+    {
+        g_critical("Serialized document has no entities");
+        destroy(user_data);
+        return NULL;
+    }
+
+    root = fetch(user_data, 0);
+    g_variant_get(root, "(&sv)", &type_name, &list);
+    type = g_type_from_name(type_name);
+
+    if (type == 0 || !g_type_is_a(type, G_TYPE_LIST_STORE) ||
+        (!g_variant_is_of_type(list, GVS_LIST_STORE_TYPE) &&
+         !g_variant_is_of_type(list, GVS_COMPACT_LIST_STORE_TYPE)))
+    {
+        g_critical("The root of the document is a %s, not a GListStore", type_name);
+        destroy(user_data);
+        goto out;
+    }
+
+    g_variant_get_child(list, 0, "&s", &item_type_name);
+    item_type = g_type_from_name(item_type_name);
+
+    if (item_type == 0 || !g_type_is_a(item_type, G_TYPE_OBJECT))
+    {
+        g_critical("List item type \"%s\" is not a registered object type",
+                   item_type_name);
+        destroy(user_data);
+        goto out;
+    }
+
+    self = g_object_new(GVS_TYPE_LIST_MODEL, NULL);
+    priv = self->priv;
+
+    priv->deserializer = g_object_ref(deserializer);
+    priv->document = _gvs_deserializer_open_document(deserializer, n_entities,
+                                                     strings, fetch, user_data,
+                                                     destroy);
+    priv->item_type = item_type;
+    priv->compact = g_variant_is_of_type(list, GVS_COMPACT_LIST_STORE_TYPE);
+    priv->ids = g_variant_get_child_value(list, 1);
+    priv->id_data = g_variant_get_fixed_array(priv->ids, &n_items,
+                                              priv->compact ? sizeof(guint32)
+                                                            : sizeof(guint64));
+    priv->n_items = n_items;
+
+out:
+    g_variant_unref(list);
+    g_variant_unref(root);
+
+    return self;
+}
+
+static void
+cache_entry_free(CacheEntry *entry)
+{
+    g_object_unref(entry->item);
+    g_slice_free(CacheEntry, entry);
+}
+
+/* Drops the least recently used items until at most @size are left */
+static void
+trim_cache(GvsListModel *self, guint size)
+{
+    GvsListModelPrivate *priv = self->priv;
+
+    while (priv->cache.length > size)
+    {
+        CacheEntry *entry = g_queue_pop_tail(&priv->cache);
+
+        g_hash_table_remove(priv->cache_links, GUINT_TO_POINTER(entry->position));
+        cache_entry_free(entry);
+    }
+}
+
+/******************************************************************************
+ *
+ * GListModel implementation
+ *
+ ******************************************************************************/
+
+static GType
+gvs_list_model_get_item_type(GListModel *list)
+{
+    return GVS_LIST_MODEL(list)->priv->item_type;
+}
+
+static guint
+gvs_list_model_get_n_items(GListModel *list)
+{
+    return GVS_LIST_MODEL(list)->priv->n_items;
+}
+
+static gpointer
+gvs_list_model_get_item(GListModel *list, guint position)
+{
+    GvsListModel *self = GVS_LIST_MODEL(list);
+    GvsListModelPrivate *priv = self->priv;
+    CacheEntry *entry;
+    GList *link;
+    gpointer item;
+    gsize id;
+
+    if (position >= priv->n_items)
+        return NULL;
+
+    link = g_hash_table_lookup(priv->cache_links, GUINT_TO_POINTER(position));
+    if (link)
+    {
+        g_queue_unlink(&priv->cache, link);
+        g_queue_push_head_link(&priv->cache, link);
+
+        return g_object_ref(((CacheEntry *) link->data)->item);
+    }
+
+    if (priv->compact)
+        id = ((const guint32 *) priv->id_data)[priv->offset + position];
+    else
+        id = ((const guint64 *) priv->id_data)[priv->offset + position];
+
+    item = _gvs_lazy_document_get_entity(priv->document, id);
+    if (!item || priv->cache_size == 0)
+        return item;
+
+    entry = g_slice_new(CacheEntry);
+    entry->position = position;
+    entry->item = g_object_ref(item);
+
+    g_queue_push_head(&priv->cache, entry);
+    g_hash_table_insert(priv->cache_links, GUINT_TO_POINTER(position),
+                        priv->cache.head);
+    trim_cache(self, priv->cache_size);
+
+    return item;
+}
+
+static void
+gvs_list_model_iface_init(GListModelInterface *iface)
+{
+    iface->get_item_type = gvs_list_model_get_item_type;
+    iface->get_n_items = gvs_list_model_get_n_items;
+    iface->get_item = gvs_list_model_get_item;
+}
+
+/******************************************************************************
+ *
+ * Public API
+ *
+ ******************************************************************************/
+
+/**
+ * gvs_list_model_new:
+ * @document: A serialized #GListStore, as returned by
+ *  gvs_serializer_serialize_object()
+ *
+ * Creates a #GListModel holding the same items as the #GListStore serialized
+ * in @document, without deserializing any of them. The number of items comes
+ * straight from the serialized list, and each item is deserialized, along
+ * with whatever it refers to, when g_list_model_get_item() first asks for it.
+ *
+ * The most recently used items are kept alive, see
+ * gvs_list_model_set_cache_size(). Items which are still alive, whether in
+ * the cache or held elsewhere, are returned again rather than recreated, and
+ * share whatever they refer to with the other items.
+ *
+ * Documents written with %GVS_SERIALIZER_COLUMNAR can't be read this way.
+ *
+ * Returns: (transfer full): A new #GvsListModel
+ */
+GvsListModel *
+gvs_list_model_new(GVariant *document)
+{
+    GvsDeserializer *deserializer;
+    GvsListModel *self;
+    GVariant *entities, *strings;
+
+    entities = _gvs_document_get_entity_array(document);
+    if (!entities)
+        return NULL;
+
+    strings = _gvs_document_get_string_table(document);
+    deserializer = gvs_deserializer_new();
+    self = open_list(deserializer, g_variant_n_children(entities), strings,
+                     _gvs_entity_array_fetch, entities,
+                     (GDestroyNotify) g_variant_unref);
+    g_object_unref(deserializer);
+
+    if (strings)
+        g_variant_unref(strings);
+
+    return self;
+}
+
+/**
+ * gvs_list_model_new_for_archive:
+ * @archive: A #GvsArchive whose document is a serialized #GListStore
+ *
+ * Like gvs_list_model_new(), but reading items straight out of @archive, so
+ * that only the parts of the archive holding the items asked for, and what
+ * they refer to, are read. The model uses the archive's deserializer, and
+ * keeps @archive alive.
+ *
+ * Returns: (transfer full): A new #GvsListModel
+ */
+GvsListModel *
+gvs_list_model_new_for_archive(GvsArchive *archive)
+{
+    GvsListModel *self;
+    GVariant *strings;
+
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+
+    strings = _gvs_archive_get_string_table(archive);
+    self = open_list(gvs_archive_get_deserializer(archive),
+                     gvs_archive_get_n_entities(archive), strings,
+                     _gvs_archive_fetch_entity, g_object_ref(archive),
+                     g_object_unref);
+
+    if (strings)
+        g_variant_unref(strings);
+
+    return self;
+}
+
+/**
+ * gvs_list_model_new_slice:
+ * @model: A #GvsListModel
+ * @position: The position in @model of the first item of the slice
+ * @n_items: The number of items in the slice
+ *
+ * Creates a model holding @n_items items of @model, starting at @position.
+ * The two share the serialized document, and items alive in one are returned
+ * by the other, but each has a cache of its own.
+ *
+ * Returns: (transfer full): A new #GvsListModel
+ */
+GvsListModel *
+gvs_list_model_new_slice(GvsListModel *model, guint position, guint n_items)
+{
+    GvsListModelPrivate *priv;
+    GvsListModel *self;
+
+    g_return_val_if_fail(GVS_IS_LIST_MODEL(model), NULL);
+    g_return_val_if_fail(position <= model->priv->n_items, NULL);
+    g_return_val_if_fail(n_items <= model->priv->n_items - position, NULL);
+
+    self = g_object_new(GVS_TYPE_LIST_MODEL, NULL);
+    priv = self->priv;
+
+    priv->deserializer = g_object_ref(model->priv->deserializer);
+    priv->document = _gvs_lazy_document_ref(model->priv->document);
+    priv->item_type = model->priv->item_type;
+    priv->ids = g_variant_ref(model->priv->ids);
+    priv->id_data = model->priv->id_data;
+    priv->compact = model->priv->compact;
+    priv->offset = model->priv->offset + position;
+    priv->n_items = n_items;
+
+    return self;
+}
+
+/**
+ * gvs_list_model_get_deserializer:
+ * @model: A #GvsListModel
+ *
+ * Returns the deserializer @model creates its items with, which can be used
+ * to put it in lazy mode, see gvs_deserializer_set_lazy(), or to find out
+ * how much has been deserialized.
+ *
+ * Returns: (transfer none): The #GvsDeserializer used by @model
+ */
+GvsDeserializer *
+gvs_list_model_get_deserializer(GvsListModel *model)
+{
+    g_return_val_if_fail(GVS_IS_LIST_MODEL(model), NULL);
+
+    return model->priv->deserializer;
+}
+
+/**
+ * gvs_list_model_set_cache_size:
+ * @model: A #GvsListModel
+ * @cache_size: The number of items to keep alive
+ *
+ * Sets how many of the most recently used items @model keeps a reference
+ * to, 256 by default. Items dropped from the cache are recreated if they are
+ * asked for again after being finalized. A size of 0 turns the cache off.
+ */
+void
+gvs_list_model_set_cache_size(GvsListModel *model, guint cache_size)
+{
+    g_return_if_fail(GVS_IS_LIST_MODEL(model));
+
+    model->priv->cache_size = cache_size;
+    trim_cache(model, cache_size);
+}
+
+/**
+ * gvs_list_model_get_cache_size:
+ * @model: A #GvsListModel
+ *
+ * Returns: The number of items @model keeps alive, see
+ *  gvs_list_model_set_cache_size()
+ */
+guint
+gvs_list_model_get_cache_size(GvsListModel *model)
+{
+    g_return_val_if_fail(GVS_IS_LIST_MODEL(model), 0);
+
+    return model->priv->cache_size;
+}
+
+/******************************************************************************
+ *
+ * GObject boilerplate
+ *
+ ******************************************************************************/
+
+static void
+gvs_list_model_finalize(GObject *object)
+{
+    GvsListModelPrivate *priv = GVS_LIST_MODEL(object)->priv;
+
+    /* Items go first, so the document doesn't watch them any longer than
+     * it has to */
+    trim_cache(GVS_LIST_MODEL(object), 0);
+    g_hash_table_destroy(priv->cache_links);
+
+    if (priv->document)
+        _gvs_lazy_document_unref(priv->document);
+    g_clear_pointer(&priv->ids, g_variant_unref);
+    g_clear_object(&priv->deserializer);
+
+    G_OBJECT_CLASS(gvs_list_model_parent_class)->finalize(object);
+}
+
+static void
+gvs_list_model_class_init(GvsListModelClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_list_model_finalize;
+}
+
+static void
+gvs_list_model_init(GvsListModel *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_LIST_MODEL, GvsListModelPrivate);
+
+    g_queue_init(&self->priv->cache);
+    self->priv->cache_links = g_hash_table_new(g_direct_hash, g_direct_equal);
+    self->priv->cache_size = GVS_LIST_MODEL_DEFAULT_CACHE_SIZE;
+}
@@ -0,0 +1,74 @@
+/* gvs-list-model.h: GListModel over a serialized list
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_LIST_MODEL_H__
+#define __GVS_LIST_MODEL_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <gio/gio.h>
+
+#include "gvs-archive.h"
+#include "gvs-deserializer.h"
+
+G_BEGIN_DECLS
+
+#define GVS_TYPE_LIST_MODEL             (gvs_list_model_get_type ())
+#define GVS_LIST_MODEL(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), GVS_TYPE_LIST_MODEL, GvsListModel))
+#define GVS_IS_LIST_MODEL(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GVS_TYPE_LIST_MODEL))
+
+typedef struct _GvsListModel             GvsListModel;
+typedef struct _GvsListModelClass        GvsListModelClass;
+typedef struct _GvsListModelPrivate      GvsListModelPrivate;
+
+struct _GvsListModel
+{
+    /*<private>*/
+    GObject    parent;
+
+    GvsListModelPrivate *priv;
+};
+
+struct _GvsListModelClass
+{
+    /*<private>*/
+    GObjectClass    parent_class;
+};
+
+GType             gvs_list_model_get_type             (void) G_GNUC_CONST;
+
+GvsListModel     *gvs_list_model_new                  (GVariant        *document);
+
+GvsListModel     *gvs_list_model_new_for_archive      (GvsArchive      *archive);
+
+GvsListModel     *gvs_list_model_new_slice            (GvsListModel    *model,
+                                                       guint            position,
+                                                       guint            n_items);
+
+GvsDeserializer  *gvs_list_model_get_deserializer     (GvsListModel    *model);
+
+void              gvs_list_model_set_cache_size       (GvsListModel    *model,
+                                                       guint            cache_size);
+
+guint             gvs_list_model_get_cache_size       (GvsListModel    *model);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,283 @@
+/* gvs-private.h: Internal declarations shared between GVS source files
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_PRIVATE_H__
+#define __GVS_PRIVATE_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "gvs-private.h may only be used inside libgvs"
+#endif
+
+#include "gvs-boxed.h"
+#include "gvs-gobject.h"
+#include "gvs-serializable.h"
+#include "gvs-view.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The serialized document format, shared by everything which writes or reads
+ * documents. Version 1 is "(uqa(sv))": the magic number, the version and the
+ * entity array. Version 2 adds a mask of GVS_FEATURE_* bits after the version
+ * and a section of column groups after the entity array. Version 3, written
+ * for GVS_FEATURE_VALUE_TABLE, adds the string table after the column groups;
+ * strings are then maybe handles indexing it, which nothing else is stored as.
+ */
+#define GVS_MAGIC_NUMBER              ((guint32) 0x6776736F) /*'gvso'*/
+#define GVS_PROTOCOL_VERSION          ((guint16) 1)
+#define GVS_PROTOCOL_VERSION_2        ((guint16) 2)
+#define GVS_PROTOCOL_VERSION_3        ((guint16) 3)
+#define GVS_SERIALIZED_OBJECT_TYPE    ((const GVariantType*) "(uqa(sv))")
+#define GVS_SERIALIZED_OBJECT_V2_TYPE ((const GVariantType*) "(uqua(sv)a(sata{sv}))")
+#define GVS_SERIALIZED_OBJECT_V3_TYPE ((const GVariantType*) "(uqua(sv)a(sata{sv})as)")
+#define GVS_ENTITY_TYPE               ((const GVariantType*) "(sv)")
+#define GVS_ENTITY_ARRAY_TYPE         ((const GVariantType*) "a(sv)")
+#define GVS_ENTITY_REF_TYPE           G_VARIANT_TYPE_UINT64
+#define GVS_COMPACT_ENTITY_REF_TYPE   G_VARIANT_TYPE_UINT32
+#define GVS_STRING_REF_TYPE           ((const GVariantType*) "mh")
+#define GVS_COLUMN_GROUP_TYPE         ((const GVariantType*) "(sata{sv})")
+#define GVS_LIST_STORE_TYPE           ((const GVariantType*) "(sat)")
+#define GVS_COMPACT_LIST_STORE_TYPE   ((const GVariantType*) "(sau)")
+
+#define GVS_FEATURE_COLUMNS           ((guint32) 1 << 0)
+#define GVS_FEATURE_COMPACT           ((guint32) 1 << 1)
+#define GVS_FEATURE_VALUE_TABLE       ((guint32) 1 << 2)
+#define GVS_KNOWN_FEATURES            (GVS_FEATURE_COLUMNS | GVS_FEATURE_COMPACT | \
+                                       GVS_FEATURE_VALUE_TABLE)
+
+/* What we attach to a GParamSpec with gvs_register_property_serialize_func() */
+typedef struct
+{
+    GvsPropertySerializeFunc func;
+    gpointer                 user_data;
+    GDestroyNotify           destroy_notify;
+} GvsSerializeClosure;
+
+/* ...and with gvs_register_property_deserialize_func() */
+typedef struct
+{
+    GvsPropertyDeserializeFunc func;
+    gpointer                   user_data;
+    GDestroyNotify             destroy_notify;
+} GvsDeserializeClosure;
+
+/* ...and with gvs_register_property_offset() */
+typedef struct
+{
+    gssize       offset;
+    GvsFieldKind kind;
+} GvsFieldAccessor;
+
+#define gvs_field_accessor_peek(pspec) \
+    ((const GvsFieldAccessor *) g_param_spec_get_qdata((pspec), gvs_property_offset_quark()))
+
+/* Makes @root hold a reference to @object, the target of a
+ * GVS_FIELD_OBJECT_UNOWNED field in a graph GVS created, which would
+ * otherwise have nothing keeping it alive */
+void _gvs_keep_alive (GObject *root, GObject *object);
+
+/* ...and with gvs_register_property_element_type() or
+ * gvs_register_property_key_value_types() */
+typedef struct
+{
+    GType         container_type;
+    GType         key_type;
+    GType         element_type;
+    GVariantType *variant_type;
+
+    /* The same, as written with GVS_SERIALIZER_COMPACT */
+    GVariantType *compact_variant_type;
+} GvsContainerInfo;
+
+#define gvs_container_info_peek(pspec) \
+    ((const GvsContainerInfo *) g_param_spec_get_qdata((pspec), gvs_property_container_quark()))
+
+/* Returns the counterpart of @object in a copy of its graph, without adding
+ * a reference */
+typedef GObject *(*GvsObjectMapFunc) (GObject *object, gpointer user_data);
+
+/* Returns whether @a and @b are counterparts in two graphs being compared */
+typedef gboolean (*GvsObjectPairFunc) (GObject *a, GObject *b, gpointer user_data);
+
+/* Returns what @object, which may be %NULL, adds to the hash of its graph */
+typedef guint (*GvsObjectHashFunc) (GObject *object, gpointer user_data);
+
+GvsContainerInfo *_gvs_container_info_new    (GType container_type,
+                                              GType key_type,
+                                              GType element_type);
+void              _gvs_container_info_free   (gpointer info);
+GVariant         *_gvs_container_serialize   (GvsSerializer          *serializer,
+                                              const GvsContainerInfo *info,
+                                              const GValue           *value);
+void              _gvs_container_deserialize (GvsDeserializer        *deserializer,
+                                              const GvsContainerInfo *info,
+                                              GVariant               *variant,
+                                              GValue                 *value);
+void              _gvs_container_copy        (const GvsContainerInfo *info,
+                                              const GValue           *src,
+                                              GValue                 *dest,
+                                              GvsObjectMapFunc        map,
+                                              gpointer                user_data);
+gboolean          _gvs_container_equal       (const GvsContainerInfo *info,
+                                              const GValue           *a,
+                                              const GValue           *b,
+                                              GvsObjectPairFunc       pair,
+                                              gpointer                user_data);
+guint             _gvs_container_hash        (const GvsContainerInfo *info,
+                                              const GValue           *value,
+                                              GvsObjectHashFunc       hash,
+                                              gpointer                user_data);
+
+/* What we store with gvs_register_boxed_transform() */
+typedef struct
+{
+    GType                      type;
+    GVariantType              *variant_type;
+    GvsPropertySerializeFunc   serialize;
+    GvsPropertyDeserializeFunc deserialize;
+} GvsBoxedTransform;
+
+const GvsBoxedTransform *_gvs_boxed_transform_lookup (GType boxed_type);
+
+/* Everything the (de)serializer wants to know about an object class, worked
+ * out once per class rather than once per instance */
+typedef struct
+{
+    GType                     type;
+    GObjectClass             *klass;
+
+    /* NULL if the class does not implement GvsSerializable */
+    GvsSerializableInterface *iface;
+
+    /* Properties which are both readable and writable, in the order returned
+     * by g_object_class_list_properties() */
+    GParamSpec              **pspecs;
+    guint                     n_pspecs;
+
+    /* The value of each of the above in a new instance, filled in on first
+     * use by _gvs_class_info_get_defaults() */
+    GValue                   *defaults;
+
+    /* Indices into the above in order of property name, filled in on first
+     * use by _gvs_class_info_get_sorted() */
+    guint                    *sorted;
+
+    /* The subset of the above which are construct-only */
+    GParamSpec              **construct_pspecs;
+    guint                     n_construct_pspecs;
+
+    /* TRUE if instances may be stored as columns: the class uses default
+     * serialization and every property serializes to one fixed variant type */
+    gboolean                  columnar;
+
+    /* TRUE if the class or one of its ancestors was registered with
+     * gvs_register_class_value_like() */
+    gboolean                  value_like;
+} GvsClassInfo;
+
+GvsClassInfo *_gvs_class_info_new    (GType type);
+void          _gvs_class_info_free   (gpointer info);
+GvsClassInfo *_gvs_class_info_lookup (GHashTable *cache, GType type);
+const GValue *_gvs_class_info_get_defaults (GvsClassInfo *info);
+const guint  *_gvs_class_info_get_sorted   (GvsClassInfo *info);
+
+/* Returns entity @id of a document, as an "(sv)", to deserializers which
+ * read entities one at a time rather than from the document's entity array */
+typedef GVariant *(*GvsEntityFetchFunc) (gpointer user_data, gsize id);
+
+gpointer _gvs_deserializer_deserialize_entity (GvsDeserializer    *deserializer,
+                                               gsize               id,
+                                               gsize               n_entities,
+                                               GVariant           *strings,
+                                               GvsEntityFetchFunc  fetch,
+                                               gpointer            user_data,
+                                               GDestroyNotify      destroy);
+
+GVariant *_gvs_document_get_entity_array (GVariant *document);
+GVariant *_gvs_document_get_string_table (GVariant *document);
+GVariant *_gvs_entity_array_fetch        (gpointer  entities, gsize id);
+GVariant *_gvs_string_table_resolve      (GVariant *strings, GVariant *ref);
+
+/* A document read in lazy mode, see gvs-deserializer.c */
+typedef struct _GvsLazyDocument GvsLazyDocument;
+
+GvsLazyDocument *_gvs_deserializer_open_document (GvsDeserializer    *deserializer,
+                                                  gsize               n_entities,
+                                                  GVariant           *strings,
+                                                  GvsEntityFetchFunc  fetch,
+                                                  gpointer            user_data,
+                                                  GDestroyNotify      destroy);
+GvsLazyDocument *_gvs_lazy_document_ref          (GvsLazyDocument    *document);
+void             _gvs_lazy_document_unref        (GvsLazyDocument    *document);
+gpointer         _gvs_lazy_document_get_entity   (GvsLazyDocument    *document,
+                                                  gsize               id);
+
+/* Reads entity @id of the document in archive @user_data */
+GVariant *_gvs_archive_fetch_entity      (gpointer    user_data, gsize id);
+GVariant *_gvs_archive_get_string_table  (GvsArchive *archive);
+
+/* Hashes a value of an entity of @view the way its entity hash does */
+char *_gvs_view_hash_value (GvsView *view, GVariant *value);
+
+/* What gvs_serializer_get_stats() and gvs_deserializer_get_stats() take a
+ * copy of. Times are in nanoseconds. */
+struct _GvsStats
+{
+    guint64       n_entities;
+    guint64       n_properties;
+    guint64       n_bytes;
+    gint64        phase_time[GVS_STATS_N_PHASES];
+
+    /* GType -> GvsTypeStats */
+    GHashTable   *types;
+
+    /* Only meaningful while a [de]serialization is in progress: the phase
+     * being timed (GVS_STATS_IDLE if none), when it was entered, and the time
+     * taken by entities finished inside the one currently being timed */
+    GvsStatsPhase phase;
+    gint64        phase_start;
+    gint64        nested;
+};
+
+#define GVS_STATS_IDLE GVS_STATS_N_PHASES
+
+typedef struct
+{
+    guint64 count;
+    gint64  time;
+} GvsTypeStats;
+
+/* Saved by _gvs_stats_push_entity() for the matching _gvs_stats_pop_entity() */
+typedef struct
+{
+    GvsStatsPhase phase;
+    gint64        start;
+    gint64        nested;
+} GvsStatsFrame;
+
+void   _gvs_stats_init        (GvsStats *stats);
+void   _gvs_stats_clear       (GvsStats *stats);
+gint64 _gvs_stats_enter       (GvsStats *stats, GvsStatsPhase phase);
+void   _gvs_stats_push_entity (GvsStats *stats, GvsStatsFrame *frame,
+                               GvsStatsPhase phase);
+void   _gvs_stats_pop_entity  (GvsStats *stats, GvsStatsFrame *frame,
+                               GType type, gboolean count);
+
+G_END_DECLS
+
+#endif
@@ -25,6 +25,9 @@
 
 #include <glib-object.h>
 
+#include "gvs-deserializer.h"
+#include "gvs-serializer.h"
+
 G_BEGIN_DECLS
 
 #define GVS_TYPE_SERIALIZABLE           (gvs_serializable_get_type ())
@@ -35,13 +38,68 @@ G_BEGIN_DECLS
 typedef struct _GvsSerializable             GvsSerializable;
 typedef struct _GvsSerializableInterface    GvsSerializableInterface;
 
+/**
+ * GvsSerializableInterface:
+ * @serialize: Returns the complete serialized state of the object, replacing
+ *  the default property dictionary. Must be paired with @deserialize.
+ * @serialize_property: Serializes a single property during default
+ *  serialization. Return %NULL to use the default transformation.
+ * @post_serialize: Called with the default property dictionary once all
+ *  properties have been added; may insert extra members.
+ * @deserialize: Applies state previously produced by @serialize.
+ * @deserialize_property: Deserializes a single property during default
+ *  deserialization, storing the result in the (already initialised) value
+ *  and returning %TRUE; return %FALSE to use the default transformation.
+ * @pre_deserialize: Called with the property dictionary before any
+ *  properties are set; should undo whatever @post_serialize did.
+ * @write: Fast path: emits the whole state of the object into a tuple
+ *  builder in one call, with no per-property reflection. Must be paired with
+ *  @read.
+ * @read: Fast path: reads back the values emitted by @write, in order.
+ *
+ * All members are optional. Each class is checked for them once per
+ * #GvsSerializer or #GvsDeserializer, not once per instance. If @write is set
+ * it is used in preference to @serialize, and likewise @read to @deserialize.
+ */
 struct _GvsSerializableInterface
 {
     /*<private>*/
     GTypeInterface    parent_iface;
     
     /*<public>*/
-    
+    GVariant *(*serialize)            (GvsSerializable *serializable,
+                                       GvsSerializer   *serializer);
+
+    GVariant *(*serialize_property)   (GvsSerializable *serializable,
+                                       GvsSerializer   *serializer,
+                                       GParamSpec      *pspec,
+                                       const GValue    *value);
+
+    void      (*post_serialize)       (GvsSerializable *serializable,
+                                       GvsSerializer   *serializer,
+                                       GVariantDict    *dict);
+
+    void      (*deserialize)          (GvsSerializable *serializable,
+                                       GvsDeserializer *deserializer,
+                                       GVariant        *variant);
+
+    gboolean  (*deserialize_property) (GvsSerializable *serializable,
+                                       GvsDeserializer *deserializer,
+                                       GParamSpec      *pspec,
+                                       GVariant        *variant,
+                                       GValue          *value);
+
+    void      (*pre_deserialize)      (GvsSerializable *serializable,
+                                       GvsDeserializer *deserializer,
+                                       GVariantDict    *dict);
+
+    void      (*write)                (GvsSerializable *serializable,
+                                       GvsSerializer   *serializer,
+                                       GVariantBuilder *writer);
+
+    void      (*read)                 (GvsSerializable *serializable,
+                                       GvsDeserializer *deserializer,
+                                       GVariantIter    *reader);
 };
 
 GType       gvs_serializable_get_type         (void) G_GNUC_CONST;
@@ -21,23 +21,46 @@
 #include "gvs-serializer.h"
 
 #include "gvs-gobject.h"
+#include "gvs-private.h"
+#include "gvs-trace.h"
 #undef __GVS_INSIDE__
 
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
 struct _GvsSerializerPrivate
 {
+    GvsSerializerFlags flags;
     GVariantBuilder *builder;
     GHashTable      *entity_map;
     GQueue           queue;
     gsize            num_entities;
+    GHashTable      *class_info;
+    GHashTable      *column_groups;
+    GPtrArray       *column_group_list;
+    GvsStats         stats;
+
+    /* With GVS_SERIALIZER_MERGE_VALUES: serialized entity -> id of each
+     * value-like object written, and the objects being serialized early */
+    GHashTable      *value_ids;
+    GHashTable      *merging;
+
+    /* With GVS_SERIALIZER_VALUE_TABLE: string -> index in the table, and
+     * the strings in order of index */
+    GHashTable      *string_ids;
+    GPtrArray       *strings;
+
+    /* Projection: GType -> Projection, and GType -> property mask */
+    GHashTable      *projections;
+    GHashTable      *property_masks;
+
+    /* Limits, 0 for none, and the depth of the entity being written */
+    guint            max_depth;
+    gsize            max_entities;
+    guint            depth;
 };
 
-#define GVS_ENTITY_TYPE            ((const GVariantType*) "(sv)")
-#define GVS_ENTITY_REF_TYPE        G_VARIANT_TYPE_UINT64
-#define GVS_ENTITY_ARRAY_TYPE      ((const GVariantType*) "a(sv)")
-#define GVS_SERIALIZED_OBJECT_TYPE ("(uq@a(sv))")
-#define GVS_MAGIC_NUMBER           ((guint32) 0x6776736F) /*'gvso'*/
-#define GVS_PROTOCOL_VERSION       ((guint16) 1)
-
 /******************************************************************************
  *
  * Entity handling functions
@@ -47,14 +70,23 @@ struct _GvsSerializerPrivate
 typedef struct
 {
     gsize id;
+    guint depth;
     GValue value;
+
+    /* The "(sv)" written for the entity, if it was serialized early */
+    GVariant *entity;
 } EntityRef;
 
+/* Returned for objects left out by gvs_serializer_set_max_depth() or
+ * gvs_serializer_set_max_entities() */
+#define NO_ENTITY G_MAXSIZE
+
 static EntityRef *
-make_entity_ref(gsize id, const GValue *value)
+make_entity_ref(gsize id, guint depth, const GValue *value)
 {
-    EntityRef *ref = g_slice_new(EntityRef);
+    EntityRef *ref = g_slice_new0(EntityRef);
     ref->id = id;
+    ref->depth = depth;
     g_value_init(&ref->value, G_VALUE_TYPE (value));
     g_value_copy(value, &ref->value);
 
@@ -66,11 +98,83 @@ entity_ref_free(gpointer ptr)
 {
     EntityRef *ref = ptr;
     g_value_reset(&ref->value);
+    if (ref->entity)
+        g_variant_unref(ref->entity);
     g_slice_free(EntityRef, ref);
 }
 
+static gsize get_entity_id(GvsSerializer *self, const GValue *value);
 static GVariant *get_entity_ref(GvsSerializer *self, const GValue *value);
 
+static inline gboolean
+is_compact(GvsSerializer *self)
+{
+    return (self->priv->flags & GVS_SERIALIZER_COMPACT) != 0;
+}
+
+static const GVariantType *
+entity_ref_type(GvsSerializer *self)
+{
+    return is_compact(self) ? GVS_COMPACT_ENTITY_REF_TYPE : GVS_ENTITY_REF_TYPE;
+}
+
+static GVariant *
+new_entity_ref(GvsSerializer *self, gsize id)
+{
+    if (is_compact(self))
+    {
+        if (G_UNLIKELY(id > G_MAXUINT32))
+            g_critical("Too many entities for GVS_SERIALIZER_COMPACT");
+
+        return g_variant_new_uint32(id);
+    }
+
+    return g_variant_new_uint64(id);
+}
+
+/*
+ * With GVS_SERIALIZER_COLUMNAR, instances of suitable classes are gathered
+ * into one group per class instead of being written to the entity array.
+ * Each group holds the ids of its members and one array per property.
+ */
+typedef struct
+{
+    GvsClassInfo    *info;
+    GArray          *ids;
+    GVariantBuilder *columns;
+} ColumnGroup;
+
+static ColumnGroup *
+column_group_new(GvsClassInfo *info)
+{
+    ColumnGroup *group = g_slice_new(ColumnGroup);
+    guint i;
+
+    group->info = info;
+    group->ids = g_array_new(FALSE, FALSE, sizeof(guint64));
+    group->columns = g_new(GVariantBuilder, info->n_pspecs);
+
+    /* The element type is taken from the first value added */
+    for (i = 0; i < info->n_pspecs; i++)
+        g_variant_builder_init(&group->columns[i], G_VARIANT_TYPE_ARRAY);
+
+    return group;
+}
+
+static void
+column_group_free(gpointer ptr)
+{
+    ColumnGroup *group = ptr;
+    guint i;
+
+    for (i = 0; i < group->info->n_pspecs; i++)
+        g_variant_builder_clear(&group->columns[i]);
+
+    g_free(group->columns);
+    g_array_unref(group->ids);
+    g_slice_free(ColumnGroup, group);
+}
+
 /******************************************************************************
  *
  * Internal GvsPropertySerializeFuncs for known types
@@ -79,86 +183,216 @@ static GVariant *get_entity_ref(GvsSerializer *self, const GValue *value);
 
 /*
  *
- * Built-in boxed transformations
+ * Boxed types
  *
  */
-
 static GVariant *
-strv_serialize(GvsSerializer *self, const GValue *value, gpointer unused)
+serialize_boxed_property(GvsSerializer *self, const GValue *value, gpointer unused)
 {
-    const char * const * strv = g_value_get_boxed(value);
-    return g_variant_new_strv(strv, g_strv_length((GStrv) strv));
+    gpointer object = g_value_get_boxed(value);
+    GVariant *ref = NULL;
+
+    if (object)
+        ref = get_entity_ref(self, value);
+
+    return g_variant_new_maybe(entity_ref_type(self), ref);
 }
 
-static GVariant *
-bytes_serialize(GvsSerializer *self, const GValue *value, gpointer unused)
+/*
+ *
+ * Integer narrowing and float packing, for GVS_SERIALIZER_COMPACT
+ *
+ */
+
+/* The narrowest type holding every integer between @min and @max */
+static const GVariantType *
+range_variant_type(gint64 min, guint64 max)
 {
-    gsize size, i;
-    const guint8 *data;
-    GVariantBuilder builder;
+    if (min >= 0)
+    {
+        if (max <= G_MAXUINT8)
+            return G_VARIANT_TYPE_BYTE;
+        if (max <= G_MAXUINT16)
+            return G_VARIANT_TYPE_UINT16;
+        if (max <= G_MAXUINT32)
+            return G_VARIANT_TYPE_UINT32;
+        return G_VARIANT_TYPE_UINT64;
+    }
 
-    data = g_bytes_get_data(g_value_get_boxed(value), &size);
+    if (min >= G_MININT16 && max <= G_MAXINT16)
+        return G_VARIANT_TYPE_INT16;
+    if (min >= G_MININT32 && max <= G_MAXINT32)
+        return G_VARIANT_TYPE_INT32;
+    return G_VARIANT_TYPE_INT64;
+}
 
-    /* Hmmm, g_variant_new_bytestring for some reason wants the incoming
-     * data to be nul-terminated, which of course a generic chunk of data
-     * in the form of bytes might not be. So we have to manually go through
-     * and create the byte array ourselves. */
-    g_variant_builder_init(&builder, G_VARIANT_TYPE_BYTESTRING);
-    for (i = 0; i < size; i++)
+/* The full width of the C type behind @pspec */
+static const GVariantType *
+full_integer_type(GParamSpec *pspec)
+{
+    switch (G_TYPE_FUNDAMENTAL(pspec->value_type))
     {
-        g_variant_builder_add_value(&builder, g_variant_new_byte(data[i]));
+        case G_TYPE_INT:
+        case G_TYPE_ENUM:
+            return G_VARIANT_TYPE_INT32;
+        case G_TYPE_UINT:
+        case G_TYPE_FLAGS:
+            return G_VARIANT_TYPE_UINT32;
+        case G_TYPE_LONG:
+        case G_TYPE_INT64:
+            return G_VARIANT_TYPE_INT64;
+        default:
+            return G_VARIANT_TYPE_UINT64;
     }
+}
 
-    return g_variant_builder_end(&builder);
+/* The type to write integer, enum and flags values of @pspec as. Without
+ * GVS_SERIALIZER_COMPACT this is the full width of the C type */
+static const GVariantType *
+integer_variant_type(GvsSerializer *self, GParamSpec *pspec)
+{
+    GParamSpec *target;
+
+    if (is_compact(self))
+    {
+        target = g_param_spec_get_redirect_target(pspec);
+        if (target)
+            pspec = target;
+
+        if (G_IS_PARAM_SPEC_INT(pspec))
+            return range_variant_type(G_PARAM_SPEC_INT(pspec)->minimum,
+                                      G_PARAM_SPEC_INT(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_UINT(pspec))
+            return range_variant_type(0, G_PARAM_SPEC_UINT(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_LONG(pspec))
+            return range_variant_type(G_PARAM_SPEC_LONG(pspec)->minimum,
+                                      G_PARAM_SPEC_LONG(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_ULONG(pspec))
+            return range_variant_type(0, G_PARAM_SPEC_ULONG(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_INT64(pspec))
+            return range_variant_type(G_PARAM_SPEC_INT64(pspec)->minimum,
+                                      G_PARAM_SPEC_INT64(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_UINT64(pspec))
+            return range_variant_type(0, G_PARAM_SPEC_UINT64(pspec)->maximum);
+        if (G_IS_PARAM_SPEC_ENUM(pspec))
+            return range_variant_type(G_PARAM_SPEC_ENUM(pspec)->enum_class->minimum,
+                                      G_PARAM_SPEC_ENUM(pspec)->enum_class->maximum);
+        if (G_IS_PARAM_SPEC_FLAGS(pspec))
+            return range_variant_type(0, G_PARAM_SPEC_FLAGS(pspec)->flags_class->mask);
+    }
+
+    return full_integer_type(pspec);
 }
 
-typedef struct
+/* Whether @value, read from a signed or unsigned C type, survives being
+ * written as @type */
+static gboolean
+integer_fits(const GVariantType *type, gint64 value, gboolean is_unsigned)
 {
-    const char *gtype_name;
-    const GVariantType *variant_type;
-    GvsPropertySerializeFunc serialize;
-} BuiltinTransform;
+    /* Unsigned values above G_MAXINT64 arrive negative */
+    if (is_unsigned && value < 0)
+        return g_variant_type_equal(type, G_VARIANT_TYPE_UINT64);
 
-static const BuiltinTransform builtin_transforms[] = {
-    { "GStrv",  G_VARIANT_TYPE_STRING_ARRAY, strv_serialize },
-    { "GBytes", G_VARIANT_TYPE_BYTESTRING, bytes_serialize },
-    { NULL, }
-};
+    switch (*g_variant_type_peek_string(type))
+    {
+        case 'y':
+            return value >= 0 && value <= G_MAXUINT8;
+        case 'n':
+            return value >= G_MININT16 && value <= G_MAXINT16;
+        case 'q':
+            return value >= 0 && value <= G_MAXUINT16;
+        case 'i':
+            return value >= G_MININT32 && value <= G_MAXINT32;
+        case 'u':
+            return value >= 0 && value <= G_MAXUINT32;
+        default:
+            return TRUE;
+    }
+}
 
-static const BuiltinTransform *
-lookup_builtin_transform(GType type)
+/* Unsigned 64-bit values pass through @value unchanged in two's complement */
+static GVariant *
+new_integer(const GVariantType *type, gint64 value)
+{
+    switch (*g_variant_type_peek_string(type))
+    {
+        case 'y':
+            return g_variant_new_byte(value);
+        case 'n':
+            return g_variant_new_int16(value);
+        case 'q':
+            return g_variant_new_uint16(value);
+        case 'i':
+            return g_variant_new_int32(value);
+        case 'u':
+            return g_variant_new_uint32(value);
+        case 'x':
+            return g_variant_new_int64(value);
+        default:
+            return g_variant_new_uint64(value);
+    }
+}
+
+/*
+ * With GVS_SERIALIZER_VALUE_TABLE, strings are written once each to the
+ * string table at the end of the document, and properties hold their index
+ * as an "mh" instead of an "ms". Handles aren't used for anything else, so
+ * readers can't mistake them for compact entity refs. Only strings written
+ * while a document is being built go in the table.
+ */
+static GVariant *
+new_string(GvsSerializer *self, const char *str)
 {
-    const char *name = g_type_name(type);
-    const BuiltinTransform *t = NULL;
+    GvsSerializerPrivate *priv = self->priv;
+    gpointer index;
+
+    if (!priv->string_ids)
+        return g_variant_new("ms", str);
+
+    if (!str)
+        return g_variant_new_maybe(G_VARIANT_TYPE_HANDLE, NULL);
+
+    if (!g_hash_table_lookup_extended(priv->string_ids, str, NULL, &index))
+    {
+        char *copy = g_strdup(str);
+
+        if (G_UNLIKELY(priv->strings->len == G_MAXINT32))
+            g_critical("Too many strings for GVS_SERIALIZER_VALUE_TABLE");
 
-    for (t = builtin_transforms; t->gtype_name != NULL; t++) {
-        if (g_str_equal(t->gtype_name, name))
-            return t;
+        index = GUINT_TO_POINTER(priv->strings->len);
+        g_hash_table_insert(priv->string_ids, copy, index);
+        g_ptr_array_add(priv->strings, copy);
     }
 
-    return NULL;
+    return g_variant_new_maybe(G_VARIANT_TYPE_HANDLE,
+                               g_variant_new_handle(GPOINTER_TO_INT(index)));
 }
 
 static GVariant *
-serialize_boxed_property(GvsSerializer *self, const GValue *value, gpointer unused)
+new_float(GvsSerializer *self, gfloat value)
 {
-    gpointer object = g_value_get_boxed(value);
-    GVariant *ref = NULL;
+    if (is_compact(self))
+    {
+        guint32 bits;
 
-    if (object)
-        ref = get_entity_ref(self, value);
+        memcpy(&bits, &value, sizeof(bits));
+        return g_variant_new_uint32(bits);
+    }
 
-    return g_variant_new_maybe(GVS_ENTITY_REF_TYPE, ref);
+    return g_variant_new_double(value);
 }
 
 /*
  *
  * Fundemental type transformations
  *
+ * The built-in functions are passed their GParamSpec as user data
+ *
  */
 static GVariant *
-serialize_fundamental(GvsSerializer *self, const GValue *value, gpointer unused)
+serialize_fundamental(GvsSerializer *self, const GValue *value, gpointer user_data)
 {
+    GParamSpec *pspec = user_data;
     GVariant *variant;
 
     switch (G_VALUE_TYPE(value))
@@ -173,27 +407,37 @@ serialize_fundamental(GvsSerializer *self, const GValue *value, gpointer unused)
             variant = g_variant_new_double(g_value_get_double(value));
             break;
         case G_TYPE_FLOAT:
-            variant = g_variant_new_double(g_value_get_float(value));
+            variant = new_float(self, g_value_get_float(value));
             break;
         case G_TYPE_INT:
-            variant = g_variant_new_int32(g_value_get_int(value));
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_int(value));
             break;
         case G_TYPE_INT64:
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_int64(value));
+            break;
         case G_TYPE_LONG:
-            variant = g_variant_new_int64(g_value_get_int64(value));
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_long(value));
             break;
         case G_TYPE_STRING:
-            variant = g_variant_new("ms", g_value_get_string(value));
+            variant = new_string(self, g_value_get_string(value));
             break;
         case G_TYPE_UCHAR:
             variant = g_variant_new_byte(g_value_get_uchar(value));
             break;
         case G_TYPE_UINT:
-            variant = g_variant_new_uint32(g_value_get_uint(value));
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_uint(value));
             break;
         case G_TYPE_UINT64:
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_uint64(value));
+            break;
         case G_TYPE_ULONG:
-            variant = g_variant_new_uint64(g_value_get_uint64(value));
+            variant = new_integer(integer_variant_type(self, pspec),
+                                  g_value_get_ulong(value));
             break;
         case G_TYPE_VARIANT:
             variant = g_value_dup_variant(value);
@@ -212,15 +456,17 @@ serialize_fundamental(GvsSerializer *self, const GValue *value, gpointer unused)
  * 
  */
 static GVariant *
-serialize_enum(GvsSerializer *self, const GValue *value, gpointer unused)
+serialize_enum(GvsSerializer *self, const GValue *value, gpointer user_data)
 {
-    return g_variant_ref_sink(g_variant_new_int32(g_value_get_enum(value)));
+    return new_integer(integer_variant_type(self, user_data),
+                       g_value_get_enum(value));
 }
 
 static GVariant *
-serialize_flags(GvsSerializer *self, const GValue *value, gpointer unused)
+serialize_flags(GvsSerializer *self, const GValue *value, gpointer user_data)
 {
-    return g_variant_ref_sink(g_variant_new_uint32(g_value_get_flags(value)));
+    return new_integer(integer_variant_type(self, user_data),
+                       g_value_get_flags(value));
 }
 
 /*
@@ -228,24 +474,330 @@ serialize_flags(GvsSerializer *self, const GValue *value, gpointer unused)
  * Objects
  *
  */
+/* Whether references to objects not yet in the document are cut off here */
+static inline gboolean
+past_limits(GvsSerializer *self)
+{
+    GvsSerializerPrivate *priv = self->priv;
+
+    return (priv->max_depth && priv->depth >= priv->max_depth) ||
+           (priv->max_entities && priv->num_entities >= priv->max_entities);
+}
+
+/* Returns NO_ENTITY if @object is past the limits */
+static gsize
+get_object_entity_id(GvsSerializer *self, GObject *object)
+{
+    /* The declared type of the property may be a base class or interface;
+     * we want to record the type of the actual instance */
+    GValue derived_value = G_VALUE_INIT;
+    gsize id;
+
+    if (G_UNLIKELY(past_limits(self)) &&
+        !g_hash_table_contains(self->priv->entity_map, object))
+    {
+        return NO_ENTITY;
+    }
+
+    g_value_init (&derived_value, G_TYPE_FROM_INSTANCE (object));
+    g_value_set_object (&derived_value, object);
+    id = get_entity_id(self, &derived_value);
+    g_value_reset (&derived_value);
+
+    return id;
+}
+
 static GVariant *
-serialize_object_property(GvsSerializer *self, const GValue *value, gpointer unused)
+serialize_object_ref(GvsSerializer *self, GObject *object)
 {
-    gpointer object = g_value_get_object(value);
     GVariant *ref = NULL;
+    gsize id;
 
-    if (object)
+    if (object && (id = get_object_entity_id(self, object)) != NO_ENTITY)
+        ref = new_entity_ref(self, id);
+
+    return g_variant_new_maybe(entity_ref_type(self), ref);
+}
+
+/* Every GListModel is written as a list, and read back as a GListStore,
+ * which a property declared with a narrower type can't hold */
+static void
+check_list_model_ref(GParamSpec *pspec, GObject *object)
+{
+    if (object && G_IS_LIST_MODEL(object) && !G_IS_LIST_STORE(object) &&
+        !g_type_is_a(G_TYPE_LIST_STORE, pspec->value_type))
+    {
+        g_critical("Property %s holds a %s, which is serialized as a GListStore "
+                   "that a %s property can't be set to",
+                   pspec->name, G_OBJECT_TYPE_NAME(object),
+                   g_type_name(pspec->value_type));
+    }
+}
+
+static GVariant *
+serialize_object_property(GvsSerializer *self, const GValue *value, gpointer user_data)
+{
+    check_list_model_ref(user_data, g_value_get_object(value));
+
+    return serialize_object_ref(self, g_value_get_object(value));
+}
+
+/*
+ *
+ * Properties registered with gvs_register_property_offset()
+ *
+ */
+
+/* Fields are read straight from memory, without the validation that
+ * g_object_set_property() gives, so they may hold values outside the range
+ * of their GParamSpec. Such values are written at full width rather than
+ * cut down to the narrowed type, as is every value of a column, since a
+ * column has a single element type. */
+static GVariant *
+new_field_integer(GvsSerializer *self, GParamSpec *pspec, gint64 value,
+                  gboolean is_unsigned, gboolean full_width)
+{
+    const GVariantType *type = integer_variant_type(self, pspec);
+
+    if (full_width || !integer_fits(type, value, is_unsigned))
+        type = full_integer_type(pspec);
+
+    return new_integer(type, value);
+}
+
+static GVariant *
+serialize_field(GvsSerializer *self, GObject *object, GParamSpec *pspec,
+                const GvsFieldAccessor *field, gboolean full_width)
+{
+    gconstpointer mem = G_STRUCT_MEMBER_P(object, field->offset);
+    GVariant *variant = NULL;
+
+    switch (field->kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            variant = g_variant_new_boolean(*(const gboolean *) mem);
+            break;
+        case GVS_FIELD_CHAR:
+            variant = g_variant_new_byte(*(const gint8 *) mem);
+            break;
+        case GVS_FIELD_UCHAR:
+            variant = g_variant_new_byte(*(const guint8 *) mem);
+            break;
+        case GVS_FIELD_INT:
+        case GVS_FIELD_ENUM:
+            variant = new_field_integer(self, pspec, *(const gint *) mem,
+                                        FALSE, full_width);
+            break;
+        case GVS_FIELD_UINT:
+        case GVS_FIELD_FLAGS:
+            variant = new_field_integer(self, pspec, *(const guint *) mem,
+                                        TRUE, full_width);
+            break;
+        case GVS_FIELD_LONG:
+            variant = new_field_integer(self, pspec, *(const glong *) mem,
+                                        FALSE, full_width);
+            break;
+        case GVS_FIELD_ULONG:
+            variant = new_field_integer(self, pspec, *(const gulong *) mem,
+                                        TRUE, full_width);
+            break;
+        case GVS_FIELD_INT64:
+            variant = new_field_integer(self, pspec, *(const gint64 *) mem,
+                                        FALSE, full_width);
+            break;
+        case GVS_FIELD_UINT64:
+            variant = new_field_integer(self, pspec, *(const guint64 *) mem,
+                                        TRUE, full_width);
+            break;
+        case GVS_FIELD_FLOAT:
+            variant = new_float(self, *(const gfloat *) mem);
+            break;
+        case GVS_FIELD_DOUBLE:
+            variant = g_variant_new_double(*(const gdouble *) mem);
+            break;
+        case GVS_FIELD_STRING:
+            variant = new_string(self, *(const char * const *) mem);
+            break;
+        case GVS_FIELD_OBJECT:
+        case GVS_FIELD_OBJECT_UNOWNED:
+            check_list_model_ref(pspec, *(GObject * const *) mem);
+            variant = serialize_object_ref(self, *(GObject * const *) mem);
+            break;
+        default:
+            g_assert_not_reached();
+            break;
+    }
+
+    return variant;
+}
+
+/*
+ *
+ * Default value checks, for GVS_SERIALIZER_SKIP_DEFAULTS
+ *
+ */
+
+/* Floating point values are compared bitwise, since the paramspec comparison
+ * allows an epsilon (and treats -0.0 as 0.0), which would not round-trip */
+static gboolean
+value_holds_default(GParamSpec *pspec, const GValue *value, const GValue *def)
+{
+    if (G_VALUE_HOLDS_DOUBLE(value))
+    {
+        gdouble a = g_value_get_double(value), b = g_value_get_double(def);
+        return memcmp(&a, &b, sizeof(gdouble)) == 0;
+    }
+    else if (G_VALUE_HOLDS_FLOAT(value))
+    {
+        gfloat a = g_value_get_float(value), b = g_value_get_float(def);
+        return memcmp(&a, &b, sizeof(gfloat)) == 0;
+    }
+
+    return g_param_values_cmp(pspec, value, def) == 0;
+}
+
+static gboolean
+field_holds_default(GObject *object, const GvsFieldAccessor *field, const GValue *def)
+{
+    gconstpointer mem = G_STRUCT_MEMBER_P(object, field->offset);
+
+    switch (field->kind)
+    {
+        case GVS_FIELD_BOOLEAN:
+            return !*(const gboolean *) mem == !g_value_get_boolean(def);
+        case GVS_FIELD_CHAR:
+            return *(const gint8 *) mem == g_value_get_schar(def);
+        case GVS_FIELD_UCHAR:
+            return *(const guint8 *) mem == g_value_get_uchar(def);
+        case GVS_FIELD_INT:
+            return *(const gint *) mem == g_value_get_int(def);
+        case GVS_FIELD_UINT:
+            return *(const guint *) mem == g_value_get_uint(def);
+        case GVS_FIELD_LONG:
+            return *(const glong *) mem == g_value_get_long(def);
+        case GVS_FIELD_ULONG:
+            return *(const gulong *) mem == g_value_get_ulong(def);
+        case GVS_FIELD_INT64:
+            return *(const gint64 *) mem == g_value_get_int64(def);
+        case GVS_FIELD_UINT64:
+            return *(const guint64 *) mem == g_value_get_uint64(def);
+        case GVS_FIELD_FLOAT:
+        {
+            gfloat b = g_value_get_float(def);
+            return memcmp(mem, &b, sizeof(gfloat)) == 0;
+        }
+        case GVS_FIELD_DOUBLE:
+        {
+            gdouble b = g_value_get_double(def);
+            return memcmp(mem, &b, sizeof(gdouble)) == 0;
+        }
+        case GVS_FIELD_ENUM:
+            return *(const gint *) mem == g_value_get_enum(def);
+        case GVS_FIELD_FLAGS:
+            return *(const guint *) mem == g_value_get_flags(def);
+        case GVS_FIELD_STRING:
+            return g_strcmp0(*(const char * const *) mem, g_value_get_string(def)) == 0;
+        case GVS_FIELD_OBJECT:
+        case GVS_FIELD_OBJECT_UNOWNED:
+            return *(GObject * const *) mem == g_value_get_object(def);
+        default:
+            g_assert_not_reached();
+            return FALSE;
+    }
+}
+
+/******************************************************************************
+ *
+ * Projection
+ *
+ ******************************************************************************/
+
+/*
+ * Property names given to gvs_serializer_include_properties() or
+ * gvs_serializer_exclude_properties() for a class. Each class then gets a
+ * mask saying which of its GvsClassInfo pspecs to write, worked out the first
+ * time one of its instances is written, from the projection of the class or
+ * its nearest ancestor which has one.
+ */
+typedef struct
+{
+    gboolean    include;
+    GHashTable *names;
+} Projection;
+
+static void
+projection_free(gpointer ptr)
+{
+    Projection *projection = ptr;
+
+    g_hash_table_destroy(projection->names);
+    g_slice_free(Projection, projection);
+}
+
+static void
+set_projection(GvsSerializer *self, GType type, gboolean include,
+               const char * const *names)
+{
+    GvsSerializerPrivate *priv = self->priv;
+
+    g_hash_table_remove_all(priv->property_masks);
+
+    if (names)
+    {
+        Projection *projection = g_slice_new(Projection);
+
+        projection->include = include;
+        projection->names = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                  g_free, NULL);
+        for (; *names; names++)
+            g_hash_table_add(projection->names, g_strdup(*names));
+
+        g_hash_table_insert(priv->projections, GSIZE_TO_POINTER(type), projection);
+    }
+    else
+    {
+        g_hash_table_remove(priv->projections, GSIZE_TO_POINTER(type));
+    }
+}
+
+/* Returns which properties of @info to write, or %NULL for all of them */
+static const gboolean *
+get_property_mask(GvsSerializer *self, GvsClassInfo *info)
+{
+    GvsSerializerPrivate *priv = self->priv;
+    Projection *projection = NULL;
+    gboolean *mask = NULL;
+    gpointer cached;
+    GType type;
+    guint i;
+
+    if (g_hash_table_size(priv->projections) == 0)
+        return NULL;
+
+    if (g_hash_table_lookup_extended(priv->property_masks,
+                                     GSIZE_TO_POINTER(info->type), NULL, &cached))
     {
-    	/* The passed GValue has the declared type of the property; we want to
-     	 * record the type of the actual instance */
-        GValue derived_value = G_VALUE_INIT;
-        g_value_init (&derived_value, G_TYPE_FROM_INSTANCE (object));
-        g_value_set_object (&derived_value, object);
-        ref = get_entity_ref(self, &derived_value);
-        g_value_reset (&derived_value);
+        return cached;
     }
 
-    return g_variant_new_maybe(GVS_ENTITY_REF_TYPE, ref);
+    for (type = info->type; type && !projection; type = g_type_parent(type))
+        projection = g_hash_table_lookup(priv->projections, GSIZE_TO_POINTER(type));
+
+    if (projection)
+    {
+        mask = g_new(gboolean, info->n_pspecs);
+
+        for (i = 0; i < info->n_pspecs; i++)
+        {
+            gboolean named = g_hash_table_contains(projection->names,
+                                                   info->pspecs[i]->name);
+            mask[i] = named == projection->include;
+        }
+    }
+
+    g_hash_table_insert(priv->property_masks, GSIZE_TO_POINTER(info->type), mask);
+
+    return mask;
 }
 
 /******************************************************************************
@@ -257,15 +809,31 @@ serialize_object_property(GvsSerializer *self, const GValue *value, gpointer unu
 static GVariant *
 serialize_pspec(GvsSerializer *self, GParamSpec *pspec, const GValue *value)
 {
+    const GvsSerializeClosure *closure;
+    const GvsContainerInfo *container = NULL;
     GvsPropertySerializeFunc func = NULL;
+    gpointer user_data = NULL;
     GVariant *variant = NULL;
     GType type = pspec->value_type;
 
+    GVS_TRACE2(serialize_property_entry, pspec->name, g_type_name(type));
+
     /* Try to find the right serialization function */
-    func = g_param_spec_get_qdata(pspec, gvs_property_serialize_func_quark());
+    closure = g_param_spec_get_qdata(pspec, gvs_property_serialize_func_quark());
 
-    if (func == NULL)
+    if (closure)
+    {
+        func = closure->func;
+        user_data = closure->user_data;
+    }
+    else if ((container = gvs_container_info_peek(pspec)))
+    {
+        variant = _gvs_container_serialize(self, container, value);
+    }
+    else
     {
+        user_data = pspec;
+
         if (G_TYPE_IS_FUNDAMENTAL(type))
         {
             func = serialize_fundamental;
@@ -290,150 +858,555 @@ serialize_pspec(GvsSerializer *self, GParamSpec *pspec, const GValue *value)
 
     if (func)
     {
-        variant = func(self, value, NULL);
+        variant = func(self, value, user_data);
     }
-    else
+    else if (!container)
     {
         g_warning("Could not serialize property %s of type %s\n"
                   "Use gvs_register_property_serialize_func() in your class_init function\n",
                   pspec->name, g_type_name(pspec->value_type));
     }
 
+    GVS_TRACE2(serialize_property_return, pspec->name,
+               variant ? g_variant_get_size(variant) : 0);
+
     return variant;
 }
 
-static GVariant *
-serialize_object_default(GvsSerializer *self, EntityRef *ref)
+static gint
+compare_entry_names(gconstpointer a, gconstpointer b)
 {
-    GObjectClass *klass;
-    guint n_props, i;
-    GParamSpec **pspecs;
-    GVariantBuilder builder;
-    GObject *object;
+    const char *name_a, *name_b;
 
-    object = g_value_get_object(&ref->value);
+    g_variant_get_child(*(GVariant * const *) a, 0, "&s", &name_a);
+    g_variant_get_child(*(GVariant * const *) b, 0, "&s", &name_b);
 
-    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    return strcmp(name_a, name_b);
+}
 
-    klass = G_OBJECT_GET_CLASS(object);
-    
-    pspecs = g_object_class_list_properties(klass, &n_props);
-    
-    for (i = 0; i < n_props; i++)
-    {
-        GValue value = G_VALUE_INIT;
-        GParamSpec *pspec = pspecs[i];
+/* Returns @dict with its entries in order of name */
+static GVariant *
+sort_vardict(GVariant *dict)
+{
+    gsize n_entries = g_variant_n_children(dict);
+    GVariant **entries = g_new(GVariant *, n_entries);
+    GVariant *sorted;
+    gsize i;
 
-        /* Skip read-only properties which we can't deserialize, and write-only
-         * properties which are just stupid */
-        if ((pspec->flags & G_PARAM_READABLE) == 0 ||
-            (pspec->flags & G_PARAM_WRITABLE) == 0)
-        {
-            continue;
-        }
+    for (i = 0; i < n_entries; i++)
+        entries[i] = g_variant_get_child_value(dict, i);
 
-        g_value_init(&value, pspec->value_type);
+    qsort(entries, n_entries, sizeof(GVariant *), compare_entry_names);
+    sorted = g_variant_new_array(G_VARIANT_TYPE("{sv}"), entries, n_entries);
 
-        g_object_get_property(object, pspec->name, &value);
+    for (i = 0; i < n_entries; i++)
+        g_variant_unref(entries[i]);
+    g_free(entries);
 
-        g_variant_builder_add(&builder, "{sv}", pspec->name,
-                              serialize_pspec(self, pspec, &value));
+    return sorted;
+}
+
+/* Returns a new, non-floating reference */
+static GVariant *
+serialize_object_default(GvsSerializer *self, GvsClassInfo *info, GObject *object)
+{
+    GvsSerializableInterface *iface = info->iface;
+    const gboolean *mask = get_property_mask(self, info);
+    const GValue *defaults = NULL;
+    const guint *order = NULL;
+    GVariantBuilder builder;
+    GVariant *variant;
+    guint j;
+
+    if (self->priv->flags & GVS_SERIALIZER_SKIP_DEFAULTS)
+        defaults = _gvs_class_info_get_defaults(info);
+
+    if (self->priv->flags & GVS_SERIALIZER_CANONICAL)
+        order = _gvs_class_info_get_sorted(info);
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+
+    for (j = 0; j < info->n_pspecs; j++)
+    {
+        guint i = order ? order[j] : j;
+        GValue value = G_VALUE_INIT;
+        GParamSpec *pspec = info->pspecs[i];
+        const GvsFieldAccessor *field;
+
+        if (mask && !mask[i])
+            continue;
+
+        variant = NULL;
+        self->priv->stats.n_properties++;
+
+        /* Plain field storage: read it straight out of the instance, unless
+         * someone has asked for a custom transformation */
+        field = gvs_field_accessor_peek(pspec);
+        if (field &&
+            !(iface && iface->serialize_property) &&
+            !g_param_spec_get_qdata(pspec, gvs_property_serialize_func_quark()))
+        {
+            if (!defaults || !field_holds_default(object, field, &defaults[i]))
+            {
+                g_variant_builder_add(&builder, "{sv}", pspec->name,
+                                      serialize_field(self, object, pspec,
+                                                      field, FALSE));
+            }
+            continue;
+        }
+
+        g_value_init(&value, pspec->value_type);
+
+        _gvs_stats_enter(&self->priv->stats, GVS_STATS_PROPERTY_READ);
+        g_object_get_property(object, pspec->name, &value);
+        _gvs_stats_enter(&self->priv->stats, GVS_STATS_ENCODE);
+
+        if (defaults && value_holds_default(pspec, &value, &defaults[i]))
+        {
+            g_value_unset(&value);
+            continue;
+        }
+
+        if (iface && iface->serialize_property)
+        {
+            variant = iface->serialize_property(GVS_SERIALIZABLE(object),
+                                                self, pspec, &value);
+        }
+
+        if (variant == NULL)
+        {
+            variant = serialize_pspec(self, pspec, &value);
+        }
+
+        if (variant)
+        {
+            g_variant_builder_add(&builder, "{sv}", pspec->name, variant);
+        }
 
         g_value_unset (&value);
     }
 
-    g_free(pspecs);
+    variant = g_variant_ref_sink(g_variant_builder_end(&builder));
+
+    if (iface && iface->post_serialize)
+    {
+        GVariantDict dict;
+
+        g_variant_dict_init(&dict, variant);
+        iface->post_serialize(GVS_SERIALIZABLE(object), self, &dict);
 
-    return g_variant_builder_end (&builder);
+        g_variant_unref(variant);
+        variant = g_variant_ref_sink(g_variant_dict_end(&dict));
+
+        /* GVariantDict writes its entries in hash table order */
+        if (order)
+        {
+            GVariant *sorted = g_variant_ref_sink(sort_vardict(variant));
+
+            g_variant_unref(variant);
+            variant = sorted;
+        }
+    }
+
+    return variant;
 }
 
+/* Returns a new, non-floating reference */
 static GVariant *
-serialize_boxed_default(GvsSerializer *self, EntityRef *ref)
+serialize_object(GvsSerializer *self, GObject *object)
+{
+    GvsClassInfo *info;
+    GvsSerializableInterface *iface;
+
+    info = _gvs_class_info_lookup(self->priv->class_info,
+                                  G_OBJECT_TYPE(object));
+    iface = info->iface;
+
+    if (iface && iface->write)
+    {
+        GVariantBuilder writer;
+
+        g_variant_builder_init(&writer, G_VARIANT_TYPE_TUPLE);
+        iface->write(GVS_SERIALIZABLE(object), self, &writer);
+
+        return g_variant_ref_sink(g_variant_builder_end(&writer));
+    }
+    else if (iface && iface->serialize)
+    {
+        return g_variant_ref_sink(iface->serialize(GVS_SERIALIZABLE(object), self));
+    }
+
+    return serialize_object_default(self, info, object);
+}
+
+/*
+ * List stores are written as "(sat)": the item type name, followed by the
+ * entity ids of the items as a packed array. The item GType is recorded once
+ * for the whole list rather than being implied by each item. Compact
+ * documents use "(sau)". Any other GListModel is written the same way, as
+ * a GListStore holding its items.
+ */
+static GVariant *
+serialize_list_store(GvsSerializer *self, GListModel *model)
+{
+    guint n_items = g_list_model_get_n_items(model);
+    gboolean compact = is_compact(self);
+    gsize id_size = compact ? sizeof(guint32) : sizeof(guint64);
+    guint8 *ids = g_malloc(n_items * id_size);
+    guint n_ids = 0;
+    GVariant *items;
+    guint i;
+
+    for (i = 0; i < n_items; i++)
+    {
+        GObject *item = g_list_model_get_object(model, i);
+        gsize id = get_object_entity_id(self, item);
+
+        g_object_unref(item);
+
+        /* Items past the limits are left out of the list */
+        if (id == NO_ENTITY)
+            continue;
+
+        if (compact)
+            ((guint32 *) ids)[n_ids++] = id;
+        else
+            ((guint64 *) ids)[n_ids++] = id;
+    }
+
+    items = g_variant_new_fixed_array(entity_ref_type(self), ids, n_ids, id_size);
+    g_free(ids);
+
+    return g_variant_new(compact ? "(s@au)" : "(s@at)",
+                         g_type_name(g_list_model_get_item_type(model)),
+                         items);
+}
+
+static GVariant *
+serialize_boxed_default(GvsSerializer *self, const GValue *value)
 {
     GVariant *variant = NULL;
-    const BuiltinTransform *transform;
+    const GvsBoxedTransform *transform;
 
-    transform = lookup_builtin_transform(G_VALUE_TYPE(&ref->value));
+    transform = _gvs_boxed_transform_lookup(G_VALUE_TYPE(value));
 
-    if (g_value_peek_pointer(&ref->value) && transform)
+    if (g_value_peek_pointer(value) && transform)
     {
-        variant = transform->serialize(self, &ref->value, NULL);
+        variant = transform->serialize(self, value, NULL);
+    }
+    else
+    {
+        g_critical("Could not serialize boxed type %s\n"
+                   "Use gvs_register_boxed_transform() to register a transformation\n",
+                   G_VALUE_TYPE_NAME(value));
+
+        variant = g_variant_new_tuple(NULL, 0);
     }
 
     return variant;
 }
 
+/* Appends every property of @object to the columns of its class's group */
+static void
+serialize_object_columns(GvsSerializer *self, GvsClassInfo *info,
+                         GObject *object, gsize id)
+{
+    GvsSerializerPrivate *priv = self->priv;
+    ColumnGroup *group;
+    guint64 id64 = id;
+    guint i;
+
+    group = g_hash_table_lookup(priv->column_groups, GSIZE_TO_POINTER(info->type));
+    if (!group)
+    {
+        group = column_group_new(info);
+        g_hash_table_insert(priv->column_groups, GSIZE_TO_POINTER(info->type), group);
+        g_ptr_array_add(priv->column_group_list, group);
+    }
+
+    g_array_append_val(group->ids, id64);
+    priv->stats.n_properties += info->n_pspecs;
+
+    for (i = 0; i < info->n_pspecs; i++)
+    {
+        GParamSpec *pspec = info->pspecs[i];
+        const GvsFieldAccessor *field = gvs_field_accessor_peek(pspec);
+        GValue value = G_VALUE_INIT;
+
+        if (field)
+        {
+            g_variant_builder_add_value(&group->columns[i],
+                                        serialize_field(self, object, pspec,
+                                                        field, TRUE));
+            continue;
+        }
+
+        g_value_init(&value, pspec->value_type);
+        _gvs_stats_enter(&priv->stats, GVS_STATS_PROPERTY_READ);
+        g_object_get_property(object, pspec->name, &value);
+        _gvs_stats_enter(&priv->stats, GVS_STATS_ENCODE);
+        g_variant_builder_add_value(&group->columns[i],
+                                    serialize_pspec(self, pspec, &value));
+        g_value_unset(&value);
+    }
+}
+
+static GVariant *
+serialize_column_groups(GvsSerializer *self)
+{
+    GvsSerializerPrivate *priv = self->priv;
+    GVariantBuilder builder;
+    guint i, j;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sata{sv})"));
+
+    for (i = 0; i < priv->column_group_list->len; i++)
+    {
+        ColumnGroup *group = g_ptr_array_index(priv->column_group_list, i);
+        GvsClassInfo *info = group->info;
+
+        g_variant_builder_open(&builder, GVS_COLUMN_GROUP_TYPE);
+        g_variant_builder_add(&builder, "s", g_type_name(info->type));
+        g_variant_builder_add_value(&builder,
+                g_variant_new_fixed_array(G_VARIANT_TYPE_UINT64,
+                                          group->ids->data, group->ids->len,
+                                          sizeof(guint64)));
+
+        g_variant_builder_open(&builder, G_VARIANT_TYPE_VARDICT);
+        for (j = 0; j < info->n_pspecs; j++)
+        {
+            g_variant_builder_add(&builder, "{sv}", info->pspecs[j]->name,
+                                  g_variant_builder_end(&group->columns[j]));
+        }
+        g_variant_builder_close(&builder);
+
+        g_variant_builder_close(&builder);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
 static void
 serialize_entity(GvsSerializer *self, EntityRef *ref)
 {
     GvsSerializerPrivate *priv = self->priv;
     GType type = G_VALUE_TYPE(&ref->value);
+    GVariant *payload = NULL;
+    GvsStatsFrame frame;
+
+    GVS_TRACE2(serialize_entity_entry, g_type_name(type), ref->id);
+    _gvs_stats_push_entity(&priv->stats, &frame, GVS_STATS_ENCODE);
+
+    priv->depth = ref->depth;
+
+    if (ref->entity)
+    {
+        g_variant_builder_add_value(priv->builder, ref->entity);
+        _gvs_stats_pop_entity(&priv->stats, &frame, type, TRUE);
+        GVS_TRACE3(serialize_entity_return, g_type_name(type), ref->id,
+                   g_variant_get_size(ref->entity));
+        GVS_TRACE_MARK(frame.start, "serialize-entity", "%s %" G_GSIZE_FORMAT,
+                       g_type_name(type), ref->id);
+        return;
+    }
+
+    if ((priv->flags & GVS_SERIALIZER_COLUMNAR) &&
+        g_type_is_a(type, G_TYPE_OBJECT) &&
+        !g_type_is_a(type, G_TYPE_LIST_MODEL))
+    {
+        GvsClassInfo *info = _gvs_class_info_lookup(priv->class_info, type);
+
+        /* Columns hold every property, so projected classes can't use them */
+        if (info->columnar && !get_property_mask(self, info))
+        {
+            serialize_object_columns(self, info, g_value_get_object(&ref->value),
+                                     ref->id);
+            _gvs_stats_pop_entity(&priv->stats, &frame, type, TRUE);
+            GVS_TRACE3(serialize_entity_return, g_type_name(type), ref->id, 0);
+            GVS_TRACE_MARK(frame.start, "serialize-entity", "%s %" G_GSIZE_FORMAT,
+                           g_type_name(type), ref->id);
+            return;
+        }
+    }
     
     /* Now, create our new object. This is type "(sv)" */
     g_variant_builder_open(priv->builder, GVS_ENTITY_TYPE);
     
     /* First, add GType name */
-    g_variant_builder_add(priv->builder, "s", g_type_name(type));
+    if (g_type_is_a(type, G_TYPE_LIST_MODEL))
+        g_variant_builder_add(priv->builder, "s", g_type_name(G_TYPE_LIST_STORE));
+    else
+        g_variant_builder_add(priv->builder, "s", g_type_name(type));
 
     /* Then add the serialized item itself */
-    if (g_type_is_a(type, G_TYPE_OBJECT))
+    if (g_type_is_a(type, G_TYPE_LIST_MODEL))
+    {
+        payload = g_variant_ref_sink(serialize_list_store(self,
+                                                          g_value_get_object(&ref->value)));
+    }
+    else if (g_type_is_a(type, G_TYPE_OBJECT))
     {
-        g_variant_builder_add(priv->builder, "v",
-                              serialize_object_default(self, ref));
+        payload = serialize_object(self, g_value_get_object(&ref->value));
     }
     else if (g_type_is_a(type, G_TYPE_BOXED))
     {
-        g_variant_builder_add(priv->builder, "v",
-                              serialize_boxed_default(self, ref));
+        payload = g_variant_ref_sink(serialize_boxed_default(self, &ref->value));
     }
     else
     {
         g_assert_not_reached();
     }
 
+    g_variant_builder_add(priv->builder, "v", payload);
+
     /* Close the tuple we just opened */
     g_variant_builder_close(priv->builder);
+
+    _gvs_stats_pop_entity(&priv->stats, &frame, type, TRUE);
+    GVS_TRACE3(serialize_entity_return, g_type_name(type), ref->id,
+               g_variant_get_size(payload));
+    GVS_TRACE_MARK(frame.start, "serialize-entity", "%s %" G_GSIZE_FORMAT,
+                   g_type_name(type), ref->id);
+
+    g_variant_unref(payload);
 }
 
 static gsize
-push_entity(GvsSerializer *self, const GValue *value)
+push_entity(GvsSerializer *self, const GValue *value, guint depth)
 {
     GvsSerializerPrivate *priv = self->priv;
 
-    EntityRef *ref = make_entity_ref(priv->num_entities++, value);
-    
-    g_hash_table_insert(priv->entity_map, g_value_peek_pointer(value), ref);
+    EntityRef *ref = make_entity_ref(priv->num_entities++, depth, value);
+
+    /* Keyed by our own copy of the value, which lives as long as the map.
+     * Boxed values read from properties are often deep copies freed straight
+     * after, whose address may come round again holding something else. */
+    g_hash_table_insert(priv->entity_map, g_value_peek_pointer(&ref->value), ref);
 
     g_queue_push_head(&priv->queue, ref);
 
     return ref->id;
 }
 
+/*
+ * With GVS_SERIALIZER_MERGE_VALUES, a value-like object is serialized as
+ * soon as it is referred to, so that it can be looked up by what it
+ * serializes to. Objects it refers to are given ids first, and merged in
+ * turn if they are value-like too, so two trees of equal values end up
+ * as one. Ids still follow the order entities are pushed in, which is the
+ * order they are written in. GVS_SERIALIZER_VALUE_TABLE does the same for
+ * boxed values, which are copied on deserialization anyway.
+ */
+static gsize
+push_value_entity(GvsSerializer *self, const GValue *value, guint depth)
+{
+    GvsSerializerPrivate *priv = self->priv;
+    gpointer instance = g_value_peek_pointer(value);
+    guint outer_depth = priv->depth;
+    GvsStatsPhase phase = priv->stats.phase;
+    GVariant *payload, *entity;
+    gpointer merged_id;
+    EntityRef *ref;
+    GBytes *key;
+
+    /* An object which refers back to itself can't be looked up until it has
+     * been written, so it is queued like any other */
+    if (g_hash_table_contains(priv->merging, instance))
+        return push_entity(self, value, depth);
+
+    g_hash_table_add(priv->merging, instance);
+    priv->depth = depth;
+    _gvs_stats_enter(&priv->stats, GVS_STATS_ENCODE);
+    if (G_VALUE_HOLDS_OBJECT(value))
+        payload = serialize_object(self, instance);
+    else
+        payload = g_variant_ref_sink(serialize_boxed_default(self, value));
+    _gvs_stats_enter(&priv->stats, phase);
+    priv->depth = outer_depth;
+    g_hash_table_remove(priv->merging, instance);
+
+    /* ...which may have happened while we were serializing it */
+    ref = g_hash_table_lookup(priv->entity_map, instance);
+    if (ref)
+    {
+        g_variant_unref(payload);
+        return ref->id;
+    }
+
+    entity = g_variant_ref_sink(g_variant_new("(sv)", G_VALUE_TYPE_NAME(value),
+                                              payload));
+    g_variant_unref(payload);
+    key = g_variant_get_data_as_bytes(entity);
+
+    if (g_hash_table_lookup_extended(priv->value_ids, key, NULL, &merged_id))
+    {
+        ref = make_entity_ref(GPOINTER_TO_SIZE(merged_id), depth, value);
+        g_bytes_unref(key);
+        g_variant_unref(entity);
+    }
+    else
+    {
+        ref = make_entity_ref(priv->num_entities++, depth, value);
+        ref->entity = entity;
+        g_hash_table_insert(priv->value_ids, key, GSIZE_TO_POINTER(ref->id));
+        g_queue_push_head(&priv->queue, ref);
+    }
+
+    /* Later references to the same instance needn't serialize it again */
+    g_hash_table_insert(priv->entity_map, g_value_peek_pointer(&ref->value), ref);
+
+    return ref->id;
+}
+
+static inline gboolean
+merges_by_value(GvsSerializer *self, const GValue *value)
+{
+    GvsSerializerPrivate *priv = self->priv;
+    GType type = G_VALUE_TYPE(value);
+
+    if (g_type_is_a(type, G_TYPE_BOXED))
+        return (priv->flags & GVS_SERIALIZER_VALUE_TABLE) != 0;
+
+    return (priv->flags & GVS_SERIALIZER_MERGE_VALUES) &&
+           g_type_is_a(type, G_TYPE_OBJECT) &&
+           !g_type_is_a(type, G_TYPE_LIST_MODEL) &&
+           _gvs_class_info_lookup(priv->class_info, type)->value_like;
+}
+
 static EntityRef *
 pop_entity(GvsSerializer *self)
 {
     return g_queue_pop_tail(&self->priv->queue);
 }
 
-static GVariant *
-get_entity_ref(GvsSerializer *self, const GValue *value)
+static gsize
+get_entity_id(GvsSerializer *self, const GValue *value)
 {
     GvsSerializerPrivate *priv = self->priv;
-    gsize entity_id = 0;
-    gpointer ptr = g_value_peek_pointer(value);
+    GvsStatsPhase phase = priv->stats.phase;
+    EntityRef *ref;
+    gsize id;
 
-    /* If we have this entity already, returns its reference */
-    if (g_hash_table_contains(priv->entity_map, ptr))
-    {
-        EntityRef *ref = g_hash_table_lookup(priv->entity_map, ptr);
-        entity_id = ref->id;
-    }
+    _gvs_stats_enter(&priv->stats, GVS_STATS_GRAPH_WALK);
+
+    /* If we have this entity already, returns its id */
+    ref = g_hash_table_lookup(priv->entity_map, g_value_peek_pointer(value));
+    if (ref)
+        id = ref->id;
+    else if (merges_by_value(self, value))
+        id = push_value_entity(self, value, priv->depth + 1);
     else
-    {
-        entity_id = push_entity(self, value);
-    }
+        id = push_entity(self, value, priv->depth + 1);
+
+    _gvs_stats_enter(&priv->stats, phase);
 
-    return g_variant_new_uint64(entity_id);
+    return id;
+}
+
+static GVariant *
+get_entity_ref(GvsSerializer *self, const GValue *value)
+{
+    return new_entity_ref(self, get_entity_id(self, value));
 }
 
 
@@ -458,21 +1431,46 @@ gvs_serializer_serialize_object(GvsSerializer *self, GObject *object)
     GVariant *variant = NULL;
     GVariant *array = NULL;
     GValue val = G_VALUE_INIT;
+    gint64 begin;
 
     g_return_val_if_fail(GVS_IS_SERIALIZER(self), NULL);
     g_return_val_if_fail(G_IS_OBJECT(object), NULL);
 
     priv = self->priv;
 
+    GVS_TRACE1(serialize_object_entry, G_OBJECT_TYPE_NAME(object));
+    begin = _gvs_stats_enter(&priv->stats, GVS_STATS_GRAPH_WALK);
+
     priv->builder = g_variant_builder_new(GVS_ENTITY_ARRAY_TYPE);
     priv->entity_map = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                              NULL, entity_ref_free);
     g_queue_init(&priv->queue);
+    priv->num_entities = 0;
+    priv->depth = 0;
+
+    if (priv->flags & (GVS_SERIALIZER_MERGE_VALUES | GVS_SERIALIZER_VALUE_TABLE))
+    {
+        priv->value_ids = g_hash_table_new_full(g_bytes_hash, g_bytes_equal,
+                                                (GDestroyNotify) g_bytes_unref, NULL);
+        priv->merging = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+
+    if (priv->flags & GVS_SERIALIZER_VALUE_TABLE)
+    {
+        priv->string_ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        priv->strings = g_ptr_array_new();
+    }
+
+    if (priv->flags & GVS_SERIALIZER_COLUMNAR)
+    {
+        priv->column_groups = g_hash_table_new(g_direct_hash, g_direct_equal);
+        priv->column_group_list = g_ptr_array_new_with_free_func(column_group_free);
+    }
 
     g_value_init(&val, G_TYPE_FROM_INSTANCE(object));
     g_value_set_object(&val, object);
 
-    push_entity(self, &val);
+    push_entity(self, &val, 0);
 
     {
         EntityRef *e = NULL;
@@ -483,20 +1481,305 @@ gvs_serializer_serialize_object(GvsSerializer *self, GObject *object)
         }
     }
 
+    _gvs_stats_enter(&priv->stats, GVS_STATS_ENCODE);
+
     array = g_variant_builder_end(priv->builder);
 
-    variant = g_variant_new(GVS_SERIALIZED_OBJECT_TYPE,
-                            GVS_MAGIC_NUMBER,
-                            GVS_PROTOCOL_VERSION,
-                            array);
+    if (priv->flags & (GVS_SERIALIZER_COLUMNAR | GVS_SERIALIZER_COMPACT |
+                       GVS_SERIALIZER_VALUE_TABLE))
+    {
+        guint32 features = 0;
+        GVariant *groups;
+
+        if (priv->flags & GVS_SERIALIZER_COLUMNAR)
+        {
+            features |= GVS_FEATURE_COLUMNS;
+            groups = serialize_column_groups(self);
+
+            g_hash_table_destroy(priv->column_groups);
+            g_ptr_array_unref(priv->column_group_list);
+            priv->column_groups = NULL;
+            priv->column_group_list = NULL;
+        }
+        else
+        {
+            groups = g_variant_new_array(GVS_COLUMN_GROUP_TYPE, NULL, 0);
+        }
+
+        if (priv->flags & GVS_SERIALIZER_COMPACT)
+            features |= GVS_FEATURE_COMPACT;
+
+        if (priv->flags & GVS_SERIALIZER_VALUE_TABLE)
+        {
+            features |= GVS_FEATURE_VALUE_TABLE;
+            variant = g_variant_new("(uqu@a(sv)@a(sata{sv})@as)",
+                                    GVS_MAGIC_NUMBER,
+                                    GVS_PROTOCOL_VERSION_3,
+                                    features,
+                                    array,
+                                    groups,
+                                    g_variant_new_strv((const char * const *) priv->strings->pdata,
+                                                       priv->strings->len));
+        }
+        else
+        {
+            variant = g_variant_new("(uqu@a(sv)@a(sata{sv}))",
+                                    GVS_MAGIC_NUMBER,
+                                    GVS_PROTOCOL_VERSION_2,
+                                    features,
+                                    array,
+                                    groups);
+        }
+    }
+    else
+    {
+        variant = g_variant_new("(uq@a(sv))",
+                                GVS_MAGIC_NUMBER,
+                                GVS_PROTOCOL_VERSION,
+                                array);
+    }
+
+    /* Documented as non-floating, which callers handing it on rely on */
+    g_variant_ref_sink(variant);
 
     g_value_reset(&val);
     g_hash_table_destroy(priv->entity_map);
     g_variant_builder_unref(priv->builder);
+    g_clear_pointer(&priv->value_ids, g_hash_table_destroy);
+    g_clear_pointer(&priv->merging, g_hash_table_destroy);
+    g_clear_pointer(&priv->string_ids, g_hash_table_destroy);
+    g_clear_pointer(&priv->strings, g_ptr_array_unref);
+
+    priv->stats.n_bytes += g_variant_get_size(variant);
+    _gvs_stats_enter(&priv->stats, GVS_STATS_IDLE);
+
+    GVS_TRACE3(serialize_object_return, G_OBJECT_TYPE_NAME(object),
+               priv->num_entities, g_variant_get_size(variant));
+    GVS_TRACE_MARK(begin, "serialize", "%s, %" G_GSIZE_FORMAT " entities",
+                   G_OBJECT_TYPE_NAME(object), priv->num_entities);
 
     return variant;
 }
 
+/**
+ * gvs_serializer_serialize_property:
+ * @serializer: A #GvsSerializer
+ * @pspec: The #GParamSpec of the property
+ * @value: The value of the property
+ *
+ * Serializes @value using the transformation GVS would use for @pspec during
+ * default serialization. This is intended for #GvsSerializable
+ * implementations which want the default behaviour for some properties.
+ *
+ * Returns: (transfer full): A #GVariant holding the serialized value
+ */
+GVariant *
+gvs_serializer_serialize_property(GvsSerializer *self,
+                                  GParamSpec    *pspec,
+                                  const GValue  *value)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), NULL);
+    g_return_val_if_fail(G_IS_PARAM_SPEC(pspec), NULL);
+    g_return_val_if_fail(G_VALUE_HOLDS(value, pspec->value_type), NULL);
+
+    return serialize_pspec(self, pspec, value);
+}
+
+/**
+ * gvs_serializer_write_object_ref:
+ * @serializer: A #GvsSerializer
+ * @object: (allow-none): A #GObject, or %NULL
+ *
+ * Returns a reference to @object, arranging for @object itself to be
+ * serialized as part of the current graph if it has not been already. Use
+ * this from #GvsSerializableInterface.write() (or serialize()) to store
+ * object pointers; gvs_deserializer_read_object_ref() reverses it.
+ *
+ * Returns: (transfer full): A floating #GVariant holding the reference
+ */
+GVariant *
+gvs_serializer_write_object_ref(GvsSerializer *self, GObject *object)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), NULL);
+    g_return_val_if_fail(object == NULL || G_IS_OBJECT(object), NULL);
+
+    return serialize_object_ref(self, object);
+}
+
+/**
+ * gvs_serializer_set_flags:
+ * @serializer: A #GvsSerializer
+ * @flags: The #GvsSerializerFlags to use for subsequent serializations
+ */
+void
+gvs_serializer_set_flags(GvsSerializer *self, GvsSerializerFlags flags)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+
+    self->priv->flags = flags;
+}
+
+/**
+ * gvs_serializer_get_flags:
+ * @serializer: A #GvsSerializer
+ *
+ * Returns: The flags set with gvs_serializer_set_flags()
+ */
+GvsSerializerFlags
+gvs_serializer_get_flags(GvsSerializer *self)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), GVS_SERIALIZER_FLAGS_NONE);
+
+    return self->priv->flags;
+}
+
+/**
+ * gvs_serializer_include_properties:
+ * @serializer: A #GvsSerializer
+ * @type: A #GObject type
+ * @names: (array zero-terminated=1) (nullable): The properties to write, or
+ *  %NULL to write them all again
+ *
+ * Writes only the properties in @names for instances of @type and its
+ * subclasses, unless a subclass has a projection of its own. This applies
+ * to default serialization; classes implementing #GvsSerializableInterface
+ * serialize() or write() decide for themselves what to write. Leaving out
+ * an object property also leaves out whatever only it refers to.
+ *
+ * Projected classes are never stored as columns.
+ */
+void
+gvs_serializer_include_properties(GvsSerializer      *self,
+                                  GType               type,
+                                  const char * const *names)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+    g_return_if_fail(g_type_is_a(type, G_TYPE_OBJECT));
+
+    set_projection(self, type, TRUE, names);
+}
+
+/**
+ * gvs_serializer_exclude_properties:
+ * @serializer: A #GvsSerializer
+ * @type: A #GObject type
+ * @names: (array zero-terminated=1) (nullable): The properties not to
+ *  write, or %NULL to write them all again
+ *
+ * Like gvs_serializer_include_properties(), but writes every property of
+ * @type except those in @names. To leave a property out of every document,
+ * use gvs_register_property_transient() instead.
+ */
+void
+gvs_serializer_exclude_properties(GvsSerializer      *self,
+                                  GType               type,
+                                  const char * const *names)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+    g_return_if_fail(g_type_is_a(type, G_TYPE_OBJECT));
+
+    set_projection(self, type, FALSE, names);
+}
+
+/**
+ * gvs_serializer_set_max_depth:
+ * @serializer: A #GvsSerializer
+ * @max_depth: The most references to follow from the root, or 0 for no limit
+ *
+ * Writes only the objects which can be reached from the root by following
+ * at most @max_depth references. References to other objects are written
+ * as %NULL, and #GListStore items are left out of their list. Boxed values
+ * are always written, as they are part of the entity holding them.
+ */
+void
+gvs_serializer_set_max_depth(GvsSerializer *self, guint max_depth)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+
+    self->priv->max_depth = max_depth;
+}
+
+/**
+ * gvs_serializer_get_max_depth:
+ * @serializer: A #GvsSerializer
+ *
+ * Returns: The limit set with gvs_serializer_set_max_depth()
+ */
+guint
+gvs_serializer_get_max_depth(GvsSerializer *self)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), 0);
+
+    return self->priv->max_depth;
+}
+
+/**
+ * gvs_serializer_set_max_entities:
+ * @serializer: A #GvsSerializer
+ * @max_entities: The most entities to write, or 0 for no limit
+ *
+ * Stops adding objects to a document once it holds @max_entities entities.
+ * Objects are added nearest the root first, so this keeps the part of the
+ * graph closest to it; references past the limit are treated as for
+ * gvs_serializer_set_max_depth(). Boxed values don't count against the
+ * limit until it is reached, and are still written after it.
+ */
+void
+gvs_serializer_set_max_entities(GvsSerializer *self, gsize max_entities)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+
+    self->priv->max_entities = max_entities;
+}
+
+/**
+ * gvs_serializer_get_max_entities:
+ * @serializer: A #GvsSerializer
+ *
+ * Returns: The limit set with gvs_serializer_set_max_entities()
+ */
+gsize
+gvs_serializer_get_max_entities(GvsSerializer *self)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), 0);
+
+    return self->priv->max_entities;
+}
+
+/**
+ * gvs_serializer_get_stats:
+ * @serializer: A #GvsSerializer
+ *
+ * Returns a snapshot of what @serializer has done since it was created, or
+ * since the last call to gvs_serializer_reset_stats(). Only the
+ * %GVS_STATS_GRAPH_WALK, %GVS_STATS_PROPERTY_READ and %GVS_STATS_ENCODE
+ * phases apply to serialization.
+ *
+ * Returns: (transfer full): A new #GvsStats, free with gvs_stats_free()
+ */
+GvsStats *
+gvs_serializer_get_stats(GvsSerializer *self)
+{
+    g_return_val_if_fail(GVS_IS_SERIALIZER(self), NULL);
+
+    return gvs_stats_copy(&self->priv->stats);
+}
+
+/**
+ * gvs_serializer_reset_stats:
+ * @serializer: A #GvsSerializer
+ *
+ * Sets all of the statistics kept by @serializer back to zero.
+ */
+void
+gvs_serializer_reset_stats(GvsSerializer *self)
+{
+    g_return_if_fail(GVS_IS_SERIALIZER(self));
+
+    _gvs_stats_clear(&self->priv->stats);
+    _gvs_stats_init(&self->priv->stats);
+}
+
 /**
  * gvs_serializer_new:
  * 
@@ -516,13 +1799,37 @@ gvs_serializer_new(void)
 
 G_DEFINE_TYPE_WITH_PRIVATE(GvsSerializer, gvs_serializer, G_TYPE_OBJECT)
 
+static void
+gvs_serializer_finalize(GObject *object)
+{
+    GvsSerializerPrivate *priv = GVS_SERIALIZER(object)->priv;
+
+    g_hash_table_destroy(priv->class_info);
+    g_hash_table_destroy(priv->projections);
+    g_hash_table_destroy(priv->property_masks);
+    _gvs_stats_clear(&priv->stats);
+
+    G_OBJECT_CLASS(gvs_serializer_parent_class)->finalize(object);
+}
+
 static void
 gvs_serializer_class_init(GvsSerializerClass *klass)
 {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_serializer_finalize;
 }
 
 static void
 gvs_serializer_init (GvsSerializer *self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_SERIALIZER, GvsSerializerPrivate);
+
+    self->priv->class_info = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                   NULL, _gvs_class_info_free);
+    self->priv->projections = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                    NULL, projection_free);
+    self->priv->property_masks = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                       NULL, g_free);
+    _gvs_stats_init(&self->priv->stats);
 }
@@ -25,6 +25,8 @@
 
 #include <glib-object.h>
 
+#include "gvs-stats.h"
+
 G_BEGIN_DECLS
 
 #define GVS_TYPE_SERIALIZER             (gvs_serializer_get_type ())
@@ -55,6 +57,52 @@ struct _GvsSerializerClass
     
 };
 
+/**
+ * GvsSerializerFlags:
+ * @GVS_SERIALIZER_FLAGS_NONE: No flags
+ * @GVS_SERIALIZER_SKIP_DEFAULTS: Omit properties which still hold the value
+ *  they have in a newly constructed instance of their class. The
+ *  deserializer leaves such properties as they were after construction.
+ * @GVS_SERIALIZER_COLUMNAR: Group instances of classes which use default
+ *  serialization and have only plain properties by class, storing each
+ *  property as one array across all instances. Such documents use version 2
+ *  of the format. Properties are never omitted from columns, so this takes
+ *  precedence over %GVS_SERIALIZER_SKIP_DEFAULTS for those classes.
+ * @GVS_SERIALIZER_COMPACT: Write object references as 32-bit rather than
+ *  64-bit ids, #gfloat values as their 32-bit pattern rather than widened to
+ *  doubles, and integers as the narrowest type which holds every value their
+ *  #GParamSpec allows. Such documents use version 2 of the format, and may
+ *  hold at most %G_MAXUINT32 entities.
+ * @GVS_SERIALIZER_CANONICAL: Write properties in order of name, and hash
+ *  table entries in order of key, so that equal graphs give identical
+ *  documents whatever order their properties were installed or their hash
+ *  tables filled in. Entities are numbered in the order they are reached
+ *  from the root, which then only depends on the graph. Classes with a
+ *  custom serialize() or write() are written as they choose.
+ * @GVS_SERIALIZER_MERGE_VALUES: Write instances of classes registered with
+ *  gvs_register_class_value_like() which serialize identically as a single
+ *  entity. References count as identical if they are to the same entity,
+ *  which for value-like objects means merged ones. Such instances are
+ *  serialized when first referred to rather than in turn, and any which
+ *  refer back to themselves are written separately. The format is
+ *  unchanged, so such documents need no special handling to read.
+ * @GVS_SERIALIZER_VALUE_TABLE: Write each distinct string once, to a table
+ *  at the end of the document, and store string properties as an index
+ *  into it. Boxed values such as #GStrv and #GBytes which serialize
+ *  identically are written as a single entity. Such documents use version
+ *  3 of the format. #GvsView reads string properties through the table.
+ */
+typedef enum
+{
+    GVS_SERIALIZER_FLAGS_NONE    = 0,
+    GVS_SERIALIZER_SKIP_DEFAULTS = 1 << 0,
+    GVS_SERIALIZER_COLUMNAR      = 1 << 1,
+    GVS_SERIALIZER_COMPACT       = 1 << 2,
+    GVS_SERIALIZER_CANONICAL     = 1 << 3,
+    GVS_SERIALIZER_MERGE_VALUES  = 1 << 4,
+    GVS_SERIALIZER_VALUE_TABLE   = 1 << 5
+} GvsSerializerFlags;
+
 /**
  * GvsPropertySerializeFunc:
  * @serializer: The #GvsSerializer being used to serialize this property
@@ -69,9 +117,43 @@ GType             gvs_serializer_get_type         (void) G_GNUC_CONST;
 
 GvsSerializer    *gvs_serializer_new              (void);
 
+void              gvs_serializer_set_flags        (GvsSerializer      *serializer,
+                                                   GvsSerializerFlags  flags);
+
+GvsSerializerFlags gvs_serializer_get_flags       (GvsSerializer *serializer);
+
+void              gvs_serializer_include_properties (GvsSerializer      *serializer,
+                                                     GType               type,
+                                                     const char * const *names);
+
+void              gvs_serializer_exclude_properties (GvsSerializer      *serializer,
+                                                     GType               type,
+                                                     const char * const *names);
+
+void              gvs_serializer_set_max_depth    (GvsSerializer *serializer,
+                                                   guint          max_depth);
+
+guint             gvs_serializer_get_max_depth    (GvsSerializer *serializer);
+
+void              gvs_serializer_set_max_entities (GvsSerializer *serializer,
+                                                   gsize          max_entities);
+
+gsize             gvs_serializer_get_max_entities (GvsSerializer *serializer);
+
 GVariant         *gvs_serializer_serialize_object (GvsSerializer *serializer,
                                                    GObject       *object);
 
+GVariant         *gvs_serializer_serialize_property (GvsSerializer *serializer,
+                                                     GParamSpec    *pspec,
+                                                     const GValue  *value);
+
+GVariant         *gvs_serializer_write_object_ref (GvsSerializer *serializer,
+                                                   GObject       *object);
+
+GvsStats         *gvs_serializer_get_stats        (GvsSerializer *serializer);
+
+void              gvs_serializer_reset_stats      (GvsSerializer *serializer);
+
 
 
 G_END_DECLS
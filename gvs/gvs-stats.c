@@ -0,0 +1,366 @@
+/* gvs-stats.c: Runtime statistics for the serializer and deserializer
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-stats.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Collection is always on, so it has to be cheap: the [de]serializer calls
+ * _gvs_stats_enter() when it moves from one phase to another, which costs
+ * one read of the monotonic clock, and _gvs_stats_push_entity() and
+ * _gvs_stats_pop_entity() around each entity, which add one hash table
+ * lookup. Nothing is allocated after the first entity of each type.
+ *
+ * Entities may nest: the deserializer creates an object referred to by a
+ * construct property while creating the object which refers to it. The time
+ * charged to a type excludes any entities finished while it was being
+ * timed, so the per-type times add up to the total.
+ */
+
+static gint64
+stats_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (gint64) ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+#endif
+
+    return g_get_monotonic_time() * 1000;
+}
+
+static GHashTable *
+type_table_new(void)
+{
+    return g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+static GvsTypeStats *
+lookup_type(GvsStats *stats, GType type)
+{
+    GvsTypeStats *type_stats;
+
+    type_stats = g_hash_table_lookup(stats->types, GSIZE_TO_POINTER(type));
+    if (!type_stats)
+    {
+        type_stats = g_new0(GvsTypeStats, 1);
+        g_hash_table_insert(stats->types, GSIZE_TO_POINTER(type), type_stats);
+    }
+
+    return type_stats;
+}
+
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+void
+_gvs_stats_init(GvsStats *stats)
+{
+    memset(stats, 0, sizeof(GvsStats));
+    stats->types = type_table_new();
+    stats->phase = GVS_STATS_IDLE;
+}
+
+void
+_gvs_stats_clear(GvsStats *stats)
+{
+    g_clear_pointer(&stats->types, g_hash_table_destroy);
+}
+
+/* Charges the time since the last call to the phase we were in, and moves
+ * on to @phase. Returns the current time. */
+gint64
+_gvs_stats_enter(GvsStats *stats, GvsStatsPhase phase)
+{
+    gint64 now = stats_now();
+
+    if (stats->phase != GVS_STATS_IDLE)
+        stats->phase_time[stats->phase] += now - stats->phase_start;
+
+    stats->phase = phase;
+    stats->phase_start = now;
+
+    return now;
+}
+
+/* Starts timing an entity, in @phase */
+void
+_gvs_stats_push_entity(GvsStats *stats, GvsStatsFrame *frame, GvsStatsPhase phase)
+{
+    frame->phase = stats->phase;
+    frame->nested = stats->nested;
+    stats->nested = 0;
+    frame->start = _gvs_stats_enter(stats, phase);
+}
+
+/* Stops timing an entity and returns to the phase we were in before it. The
+ * time is charged to @type, unless that is G_TYPE_INVALID because the entity
+ * turned out to be unreadable. If @count is TRUE this is also the first time
+ * we have seen the entity. */
+void
+_gvs_stats_pop_entity(GvsStats *stats, GvsStatsFrame *frame,
+                      GType type, gboolean count)
+{
+    gint64 elapsed = _gvs_stats_enter(stats, frame->phase) - frame->start;
+
+    if (type != G_TYPE_INVALID)
+    {
+        GvsTypeStats *type_stats = lookup_type(stats, type);
+
+        type_stats->time += elapsed - stats->nested;
+
+        if (count)
+        {
+            type_stats->count++;
+            stats->n_entities++;
+        }
+    }
+
+    stats->nested = frame->nested + elapsed;
+}
+
+/******************************************************************************
+ *
+ * Public API
+ *
+ ******************************************************************************/
+
+/**
+ * gvs_stats_copy:
+ * @stats: A #GvsStats
+ *
+ * Returns: (transfer full): A copy of @stats, free with gvs_stats_free()
+ */
+GvsStats *
+gvs_stats_copy(const GvsStats *stats)
+{
+    GvsStats *copy;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_return_val_if_fail(stats != NULL, NULL);
+
+    copy = g_new(GvsStats, 1);
+    *copy = *stats;
+    copy->types = type_table_new();
+    copy->phase = GVS_STATS_IDLE;
+    copy->nested = 0;
+
+    g_hash_table_iter_init(&iter, stats->types);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        GvsTypeStats *type_stats = g_new(GvsTypeStats, 1);
+
+        *type_stats = *(const GvsTypeStats *) value;
+        g_hash_table_insert(copy->types, key, type_stats);
+    }
+
+    return copy;
+}
+
+/**
+ * gvs_stats_free:
+ * @stats: A #GvsStats
+ */
+void
+gvs_stats_free(GvsStats *stats)
+{
+    g_return_if_fail(stats != NULL);
+
+    _gvs_stats_clear(stats);
+    g_free(stats);
+}
+
+G_DEFINE_BOXED_TYPE(GvsStats, gvs_stats, gvs_stats_copy, gvs_stats_free)
+
+/**
+ * gvs_stats_get_n_entities:
+ * @stats: A #GvsStats
+ *
+ * Returns: The number of entities (objects and boxed values) serialized or
+ *  created
+ */
+guint64
+gvs_stats_get_n_entities(const GvsStats *stats)
+{
+    g_return_val_if_fail(stats != NULL, 0);
+
+    return stats->n_entities;
+}
+
+/**
+ * gvs_stats_get_n_properties:
+ * @stats: A #GvsStats
+ *
+ * Returns: The number of properties read from objects being serialized, or
+ *  set on objects being deserialized. Objects which override
+ *  #GvsSerializableInterface.serialize() or write() (or their deserialization
+ *  counterparts) handle their own state, so it is not counted.
+ */
+guint64
+gvs_stats_get_n_properties(const GvsStats *stats)
+{
+    g_return_val_if_fail(stats != NULL, 0);
+
+    return stats->n_properties;
+}
+
+/**
+ * gvs_stats_get_n_bytes:
+ * @stats: A #GvsStats
+ *
+ * Returns: The total size of the documents produced or consumed
+ */
+guint64
+gvs_stats_get_n_bytes(const GvsStats *stats)
+{
+    g_return_val_if_fail(stats != NULL, 0);
+
+    return stats->n_bytes;
+}
+
+/**
+ * gvs_stats_get_phase_time:
+ * @stats: A #GvsStats
+ * @phase: A #GvsStatsPhase
+ *
+ * Returns: The time spent in @phase, in seconds
+ */
+gdouble
+gvs_stats_get_phase_time(const GvsStats *stats, GvsStatsPhase phase)
+{
+    g_return_val_if_fail(stats != NULL, 0.0);
+    g_return_val_if_fail(phase < GVS_STATS_N_PHASES, 0.0);
+
+    return stats->phase_time[phase] / 1e9;
+}
+
+typedef struct
+{
+    GType  type;
+    gint64 time;
+} TypeTime;
+
+static gint
+compare_type_time(gconstpointer a, gconstpointer b)
+{
+    const TypeTime *ta = a, *tb = b;
+
+    if (ta->time != tb->time)
+        return ta->time > tb->time ? -1 : 1;
+
+    return ta->type < tb->type ? -1 : ta->type > tb->type;
+}
+
+/**
+ * gvs_stats_list_types:
+ * @stats: A #GvsStats
+ * @n_types: (out) (allow-none): Return location for the number of types
+ *
+ * Lists the types of the entities which have been seen, the most expensive
+ * first.
+ *
+ * Returns: (array length=n_types zero-terminated=1) (transfer container): A
+ *  0-terminated array of #GType<!-- -->s. Free with g_free()
+ */
+GType *
+gvs_stats_list_types(const GvsStats *stats, guint *n_types)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    TypeTime *sorted;
+    GType *types;
+    guint n, i = 0;
+
+    g_return_val_if_fail(stats != NULL, NULL);
+
+    n = g_hash_table_size(stats->types);
+    sorted = g_new(TypeTime, n);
+
+    g_hash_table_iter_init(&iter, stats->types);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        sorted[i].type = GPOINTER_TO_SIZE(key);
+        sorted[i].time = ((GvsTypeStats *) value)->time;
+        i++;
+    }
+
+    qsort(sorted, n, sizeof(TypeTime), compare_type_time);
+
+    types = g_new(GType, n + 1);
+    for (i = 0; i < n; i++)
+        types[i] = sorted[i].type;
+    types[n] = G_TYPE_INVALID;
+
+    g_free(sorted);
+
+    if (n_types)
+        *n_types = n;
+
+    return types;
+}
+
+/**
+ * gvs_stats_get_type_count:
+ * @stats: A #GvsStats
+ * @type: A #GType
+ *
+ * Returns: The number of entities of exactly @type (not counting subtypes)
+ *  which have been seen
+ */
+guint64
+gvs_stats_get_type_count(const GvsStats *stats, GType type)
+{
+    const GvsTypeStats *type_stats;
+
+    g_return_val_if_fail(stats != NULL, 0);
+
+    type_stats = g_hash_table_lookup(stats->types, GSIZE_TO_POINTER(type));
+
+    return type_stats ? type_stats->count : 0;
+}
+
+/**
+ * gvs_stats_get_type_time:
+ * @stats: A #GvsStats
+ * @type: A #GType
+ *
+ * Returns: The time spent on entities of exactly @type, in seconds. This
+ *  excludes any other entities which had to be created in the meantime.
+ */
+gdouble
+gvs_stats_get_type_time(const GvsStats *stats, GType type)
+{
+    const GvsTypeStats *type_stats;
+
+    g_return_val_if_fail(stats != NULL, 0.0);
+
+    type_stats = g_hash_table_lookup(stats->types, GSIZE_TO_POINTER(type));
+
+    return type_stats ? type_stats->time / 1e9 : 0.0;
+}
@@ -0,0 +1,92 @@
+/* gvs-stats.h: Runtime statistics for the serializer and deserializer
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_STATS_H__
+#define __GVS_STATS_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GVS_TYPE_STATS (gvs_stats_get_type ())
+
+typedef struct _GvsStats GvsStats;
+
+/**
+ * GvsStatsPhase:
+ * @GVS_STATS_GRAPH_WALK: Finding the entities reachable from the root
+ *  object, and assigning them ids
+ * @GVS_STATS_PROPERTY_READ: Reading property values with
+ *  g_object_get_property()
+ * @GVS_STATS_ENCODE: Turning values into #GVariant<!-- -->s, including any
+ *  custom #GvsSerializable code
+ * @GVS_STATS_DECODE: Reading values back out of the document
+ * @GVS_STATS_CONSTRUCT: Creating objects, including setting their
+ *  construct properties
+ * @GVS_STATS_PROPERTY_SET: Setting property values, whether with
+ *  g_object_set_property(), directly into a field or by custom
+ *  #GvsSerializable code
+ * @GVS_STATS_N_PHASES: The number of phases
+ *
+ * The phases which gvs_stats_get_phase_time() reports on. The first three
+ * apply to a #GvsSerializer, the rest to a #GvsDeserializer; time spent in
+ * nested calls (resolving an object reference while encoding, say) is
+ * counted against the inner phase only.
+ */
+typedef enum
+{
+    GVS_STATS_GRAPH_WALK,
+    GVS_STATS_PROPERTY_READ,
+    GVS_STATS_ENCODE,
+    GVS_STATS_DECODE,
+    GVS_STATS_CONSTRUCT,
+    GVS_STATS_PROPERTY_SET,
+    GVS_STATS_N_PHASES
+} GvsStatsPhase;
+
+GType     gvs_stats_get_type         (void) G_GNUC_CONST;
+
+GvsStats *gvs_stats_copy             (const GvsStats *stats);
+
+void      gvs_stats_free             (GvsStats *stats);
+
+guint64   gvs_stats_get_n_entities   (const GvsStats *stats);
+
+guint64   gvs_stats_get_n_properties (const GvsStats *stats);
+
+guint64   gvs_stats_get_n_bytes      (const GvsStats *stats);
+
+gdouble   gvs_stats_get_phase_time   (const GvsStats *stats,
+                                      GvsStatsPhase   phase);
+
+GType    *gvs_stats_list_types       (const GvsStats *stats,
+                                      guint          *n_types);
+
+guint64   gvs_stats_get_type_count   (const GvsStats *stats,
+                                      GType           type);
+
+gdouble   gvs_stats_get_type_time    (const GvsStats *stats,
+                                      GType           type);
+
+G_END_DECLS
+
+#endif
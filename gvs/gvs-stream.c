@@ -0,0 +1,925 @@
+/* gvs-stream.c: Framed streams of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-stream.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <string.h>
+
+/*
+ * A GVS stream is a header followed by any number of records, each holding
+ * one serialized document in GVariant's serialized form. All integers are
+ * little-endian.
+ *
+ * Stream header (8 bytes):
+ *   "GVSS", byte order of the documents ('l' or 'B'), stream version (1),
+ *   16-bit flags (GvsStreamFlags)
+ *
+ * Record header (8 bytes, or 12 with GVS_STREAM_CHECKSUMS):
+ *   32-bit payload size, 16-bit document version (1, 2 or 3), 16 reserved
+ *   bits, then the CRC-32 of the payload if checksums are on
+ *
+ * The record header says how big the payload is, so a reader can step over
+ * a record without looking at it.
+ */
+
+#define GVS_STREAM_MAGIC              "GVSS"
+#define GVS_STREAM_VERSION            ((guint8) 1)
+#define GVS_STREAM_HEADER_SIZE        8
+#define GVS_STREAM_KNOWN_FLAGS        (GVS_STREAM_CHECKSUMS)
+#define GVS_RECORD_HEADER_SIZE        8
+#define GVS_RECORD_MAX_HEADER_SIZE    12
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+#define GVS_STREAM_NATIVE_ORDER       'B'
+#else
+#define GVS_STREAM_NATIVE_ORDER       'l'
+#endif
+
+/* Records are written out once this much is waiting, or this many records
+ * (which keeps the number of vectors passed to writev() well under
+ * IOV_MAX) */
+#define GVS_STREAM_DEFAULT_BATCH_SIZE (64 * 1024)
+#define GVS_STREAM_MAX_BATCH_RECORDS  64
+
+/* Record payloads are read in pieces of at most this size */
+#define GVS_STREAM_READ_CHUNK_SIZE    (1024 * 1024)
+
+G_DEFINE_QUARK(gvs-stream-error-quark, gvs_stream_error)
+
+/******************************************************************************
+ *
+ * Utility functions
+ *
+ ******************************************************************************/
+
+/* CRC-32 as used by zlib and PNG (IEEE 802.3, reflected) */
+static guint32 crc_table[256];
+
+static guint32
+compute_crc32(const guint8 *data, gsize size)
+{
+    static gsize table_initialized = 0;
+    guint32 crc = 0xFFFFFFFF;
+
+    if (g_once_init_enter(&table_initialized))
+    {
+        guint32 i, j;
+
+        for (i = 0; i < 256; i++)
+        {
+            guint32 c = i;
+
+            for (j = 0; j < 8; j++)
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+            crc_table[i] = c;
+        }
+
+        g_once_init_leave(&table_initialized, 1);
+    }
+
+    while (size--)
+        crc = crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void
+put_uint16(guint8 *data, guint16 value)
+{
+    value = GUINT16_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+put_uint32(guint8 *data, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static guint16
+get_uint16(const guint8 *data)
+{
+    guint16 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT16_FROM_LE(value);
+}
+
+static guint32
+get_uint32(const guint8 *data)
+{
+    guint32 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static const GVariantType *
+document_type(guint16 version)
+{
+    switch (version)
+    {
+        case 1:
+            return GVS_SERIALIZED_OBJECT_TYPE;
+        case 2:
+            return GVS_SERIALIZED_OBJECT_V2_TYPE;
+        case 3:
+            return GVS_SERIALIZED_OBJECT_V3_TYPE;
+        default:
+            return NULL;
+    }
+}
+
+/******************************************************************************
+ *
+ * GvsStreamWriter
+ *
+ ******************************************************************************/
+
+typedef struct
+{
+    guint8  header[GVS_RECORD_MAX_HEADER_SIZE];
+    gsize   header_size;
+    GBytes *payload;
+} PendingRecord;
+
+struct _GvsStreamWriterPrivate
+{
+    GOutputStream  *stream;
+    GvsStreamFlags  flags;
+    GvsSerializer  *serializer;
+    gsize           batch_size;
+
+    guint8          header[GVS_STREAM_HEADER_SIZE];
+    gboolean        header_written;
+
+    /* Records waiting for the next write */
+    GArray         *pending;
+    gsize           pending_size;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvsStreamWriter, gvs_stream_writer, G_TYPE_OBJECT)
+
+static void
+clear_pending_record(gpointer data)
+{
+    g_bytes_unref(((PendingRecord *) data)->payload);
+}
+
+/* Writes the stream header, if it hasn't been written yet, and every pending
+ * record, with as few calls into the stream as we can manage */
+static gboolean
+write_pending(GvsStreamWriter *self, GCancellable *cancellable, GError **error)
+{
+    GvsStreamWriterPrivate *priv = self->priv;
+    GOutputVector *vectors;
+    gsize n_vectors = 0;
+    gboolean ret = TRUE;
+    guint i;
+
+    if (priv->header_written && priv->pending->len == 0)
+        return TRUE;
+
+    vectors = g_new(GOutputVector, 2 * priv->pending->len + 1);
+
+    if (!priv->header_written)
+    {
+        vectors[n_vectors].buffer = priv->header;
+        vectors[n_vectors].size = GVS_STREAM_HEADER_SIZE;
+        n_vectors++;
+    }
+
+    for (i = 0; i < priv->pending->len; i++)
+    {
+        PendingRecord *record = &g_array_index(priv->pending, PendingRecord, i);
+        gsize size;
+
+        vectors[n_vectors].buffer = record->header;
+        vectors[n_vectors].size = record->header_size;
+        n_vectors++;
+
+        vectors[n_vectors].buffer = g_bytes_get_data(record->payload, &size);
+        vectors[n_vectors].size = size;
+        n_vectors++;
+    }
+
+#if GLIB_CHECK_VERSION(2, 60, 0)
+    ret = g_output_stream_writev_all(priv->stream, vectors, n_vectors,
+                                     NULL, cancellable, error);
+#else
+    for (i = 0; ret && i < n_vectors; i++)
+    {
+        ret = g_output_stream_write_all(priv->stream,
+                                        vectors[i].buffer, vectors[i].size,
+                                        NULL, cancellable, error);
+    }
+#endif
+
+    g_free(vectors);
+
+    /* If the write failed we don't know how much of the batch made it out,
+     * so there's no sense in trying again */
+    priv->header_written = TRUE;
+    g_array_set_size(priv->pending, 0);
+    priv->pending_size = 0;
+
+    return ret;
+}
+
+static void
+gvs_stream_writer_finalize(GObject *object)
+{
+    GvsStreamWriter *self = GVS_STREAM_WRITER(object);
+    GvsStreamWriterPrivate *priv = self->priv;
+    GError *error = NULL;
+
+    if (!write_pending(self, NULL, &error))
+    {
+        g_warning("Error writing GVS stream records: %s", error->message);
+        g_error_free(error);
+    }
+
+    g_array_unref(priv->pending);
+    g_object_unref(priv->serializer);
+    g_object_unref(priv->stream);
+
+    G_OBJECT_CLASS(gvs_stream_writer_parent_class)->finalize(object);
+}
+
+static void
+gvs_stream_writer_class_init(GvsStreamWriterClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_stream_writer_finalize;
+}
+
+static void
+gvs_stream_writer_init(GvsStreamWriter *self)
+{
+    GvsStreamWriterPrivate *priv;
+
+    priv = self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_STREAM_WRITER,
+                                                    GvsStreamWriterPrivate);
+
+    priv->serializer = gvs_serializer_new();
+    priv->batch_size = GVS_STREAM_DEFAULT_BATCH_SIZE;
+    priv->pending = g_array_new(FALSE, FALSE, sizeof(PendingRecord));
+    g_array_set_clear_func(priv->pending, clear_pending_record);
+}
+
+/**
+ * gvs_stream_writer_new:
+ * @stream: The #GOutputStream to write to
+ * @flags: Flags which affect the whole stream
+ *
+ * Creates a writer which appends documents to @stream. Nothing is written
+ * until the first batch of records is full, or gvs_stream_writer_flush() is
+ * called. The writer flushes any remaining records when it is finalized, but
+ * can only report errors from that as warnings.
+ *
+ * Returns: (transfer full): A new #GvsStreamWriter
+ */
+GvsStreamWriter *
+gvs_stream_writer_new(GOutputStream *stream, GvsStreamFlags flags)
+{
+    GvsStreamWriter *self;
+    GvsStreamWriterPrivate *priv;
+
+    g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), NULL);
+    g_return_val_if_fail((flags & ~GVS_STREAM_KNOWN_FLAGS) == 0, NULL);
+
+    self = g_object_new(GVS_TYPE_STREAM_WRITER, NULL);
+    priv = self->priv;
+
+    priv->stream = g_object_ref(stream);
+    priv->flags = flags;
+
+    memcpy(priv->header, GVS_STREAM_MAGIC, 4);
+    priv->header[4] = GVS_STREAM_NATIVE_ORDER;
+    priv->header[5] = GVS_STREAM_VERSION;
+    put_uint16(priv->header + 6, flags);
+
+    return self;
+}
+
+/**
+ * gvs_stream_writer_get_serializer:
+ * @writer: A #GvsStreamWriter
+ *
+ * Returns the serializer used by gvs_stream_writer_write_object(), so that
+ * its flags can be set or its statistics read.
+ *
+ * Returns: (transfer none): The writer's #GvsSerializer
+ */
+GvsSerializer *
+gvs_stream_writer_get_serializer(GvsStreamWriter *writer)
+{
+    g_return_val_if_fail(GVS_IS_STREAM_WRITER(writer), NULL);
+
+    return writer->priv->serializer;
+}
+
+/**
+ * gvs_stream_writer_set_batch_size:
+ * @writer: A #GvsStreamWriter
+ * @batch_size: The number of bytes to collect before writing
+ *
+ * Records are collected until at least @batch_size bytes are waiting, and
+ * then written with a single vectored write. A @batch_size of 0 writes each
+ * record as soon as it is added. The default is 64 KiB.
+ */
+void
+gvs_stream_writer_set_batch_size(GvsStreamWriter *writer, gsize batch_size)
+{
+    g_return_if_fail(GVS_IS_STREAM_WRITER(writer));
+
+    writer->priv->batch_size = batch_size;
+}
+
+/**
+ * gvs_stream_writer_write_document:
+ * @writer: A #GvsStreamWriter
+ * @document: A document produced by gvs_serializer_serialize_object()
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Adds @document to the stream as a record. It may not be written until
+ * later, in which case errors are reported by a later call.
+ *
+ * Returns: %TRUE unless writing to the stream failed
+ */
+gboolean
+gvs_stream_writer_write_document(GvsStreamWriter *writer,
+                                 GVariant *document,
+                                 GCancellable *cancellable,
+                                 GError **error)
+{
+    GvsStreamWriterPrivate *priv;
+    PendingRecord record;
+    guint16 version;
+    gsize size;
+
+    g_return_val_if_fail(GVS_IS_STREAM_WRITER(writer), FALSE);
+    g_return_val_if_fail(document != NULL, FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    priv = writer->priv;
+
+    if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_TYPE))
+        version = 1;
+    else if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V2_TYPE))
+        version = 2;
+    else if (g_variant_is_of_type(document, GVS_SERIALIZED_OBJECT_V3_TYPE))
+        version = 3;
+    else
+        g_return_val_if_reached(FALSE);
+
+    g_variant_ref_sink(document);
+    record.payload = g_variant_get_data_as_bytes(document);
+    g_variant_unref(document);
+
+    size = g_bytes_get_size(record.payload);
+    if (size > G_MAXUINT32)
+    {
+        g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_UNSUPPORTED,
+                    "Document of %" G_GSIZE_FORMAT " bytes is too large for a GVS stream",
+                    size);
+        g_bytes_unref(record.payload);
+        return FALSE;
+    }
+
+    put_uint32(record.header, size);
+    put_uint16(record.header + 4, version);
+    put_uint16(record.header + 6, 0);
+    record.header_size = GVS_RECORD_HEADER_SIZE;
+
+    if (priv->flags & GVS_STREAM_CHECKSUMS)
+    {
+        put_uint32(record.header + record.header_size,
+                   compute_crc32(g_bytes_get_data(record.payload, NULL), size));
+        record.header_size += 4;
+    }
+
+    g_array_append_val(priv->pending, record);
+    priv->pending_size += record.header_size + size;
+
+    if (priv->pending_size >= priv->batch_size ||
+        priv->pending->len >= GVS_STREAM_MAX_BATCH_RECORDS)
+        return write_pending(writer, cancellable, error);
+
+    return TRUE;
+}
+
+/**
+ * gvs_stream_writer_write_object:
+ * @writer: A #GvsStreamWriter
+ * @object: The root of the object graph to write
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Serializes @object with the writer's serializer and adds it to the stream,
+ * as gvs_stream_writer_write_document().
+ *
+ * Returns: %TRUE unless writing to the stream failed
+ */
+gboolean
+gvs_stream_writer_write_object(GvsStreamWriter *writer,
+                               GObject *object,
+                               GCancellable *cancellable,
+                               GError **error)
+{
+    GVariant *document;
+    gboolean ret;
+
+    g_return_val_if_fail(GVS_IS_STREAM_WRITER(writer), FALSE);
+    g_return_val_if_fail(G_IS_OBJECT(object), FALSE);
+
+    document = gvs_serializer_serialize_object(writer->priv->serializer, object);
+    ret = gvs_stream_writer_write_document(writer, document, cancellable, error);
+    g_variant_unref(document);
+
+    return ret;
+}
+
+/**
+ * gvs_stream_writer_flush:
+ * @writer: A #GvsStreamWriter
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Writes any pending records, and the stream header if nothing has been
+ * written yet, then flushes the underlying stream.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gvs_stream_writer_flush(GvsStreamWriter *writer,
+                        GCancellable *cancellable,
+                        GError **error)
+{
+    g_return_val_if_fail(GVS_IS_STREAM_WRITER(writer), FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    return write_pending(writer, cancellable, error) &&
+           g_output_stream_flush(writer->priv->stream, cancellable, error);
+}
+
+/******************************************************************************
+ *
+ * GvsStreamReader
+ *
+ ******************************************************************************/
+
+typedef struct
+{
+    guint32 size;
+    guint16 version;
+    guint16 reserved;
+    guint32 checksum;
+} RecordHeader;
+
+struct _GvsStreamReaderPrivate
+{
+    GInputStream    *stream;
+    GvsDeserializer *deserializer;
+
+    gboolean         header_read;
+    gboolean         at_end;
+    GvsStreamFlags   flags;
+    gboolean         byteswap;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvsStreamReader, gvs_stream_reader, G_TYPE_OBJECT)
+
+/* Reads exactly @size bytes. Returns FALSE with @error unset if the stream
+ * ended before the first byte, and a TRUNCATED error if it ended after. */
+static gboolean
+read_exactly(GvsStreamReader *self, void *buffer, gsize size,
+             GCancellable *cancellable, GError **error)
+{
+    gsize n_read = 0;
+
+    if (!g_input_stream_read_all(self->priv->stream, buffer, size, &n_read,
+                                 cancellable, error))
+        return FALSE;
+
+    if (n_read == 0 && size > 0)
+        return FALSE;
+
+    if (n_read < size)
+    {
+        g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_TRUNCATED,
+                    "GVS stream ended %" G_GSIZE_FORMAT " bytes into a %"
+                    G_GSIZE_FORMAT " byte read", n_read, size);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Reads a record payload of @size bytes. The size comes from a record header
+ * which nothing has checked yet, so rather than allocating it all up front
+ * the buffer grows as data actually arrives: a corrupt header claiming
+ * gigabytes then fails as truncated once the stream runs out, having
+ * allocated no more than about twice what was there.
+ */
+static guint8 *
+read_payload(GvsStreamReader *self, gsize size,
+             GCancellable *cancellable, GError **error)
+{
+    guint8 *data = NULL;
+    gsize allocated = 0;
+    gsize n_read = 0;
+
+    while (n_read < size)
+    {
+        gsize wanted = MIN(size - n_read, GVS_STREAM_READ_CHUNK_SIZE);
+        gsize n_chunk = 0;
+
+        if (n_read + wanted > allocated)
+        {
+            allocated = MIN(size, MAX(n_read + wanted, 2 * allocated));
+            data = g_realloc(data, allocated);
+        }
+
+        if (!g_input_stream_read_all(self->priv->stream, data + n_read, wanted,
+                                     &n_chunk, cancellable, error))
+        {
+            g_free(data);
+            return NULL;
+        }
+
+        n_read += n_chunk;
+
+        if (n_chunk < wanted)
+        {
+            g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_TRUNCATED,
+                        "GVS stream ended %" G_GSIZE_FORMAT " bytes into a %"
+                        G_GSIZE_FORMAT " byte record", n_read, size);
+            g_free(data);
+            return NULL;
+        }
+    }
+
+    /* An empty payload is not a valid document, but still needs a buffer */
+    return data ? data : g_malloc(0);
+}
+
+static gboolean
+read_stream_header(GvsStreamReader *self, GCancellable *cancellable, GError **error)
+{
+    GvsStreamReaderPrivate *priv = self->priv;
+    guint8 header[GVS_STREAM_HEADER_SIZE];
+    GError *local_error = NULL;
+
+    if (priv->header_read)
+        return TRUE;
+
+    if (!read_exactly(self, header, sizeof(header), cancellable, &local_error))
+    {
+        /* A writer which never wrote anything leaves an empty stream, which
+         * we treat as holding no records */
+        if (!local_error)
+        {
+            priv->header_read = TRUE;
+            priv->at_end = TRUE;
+            return TRUE;
+        }
+
+        if (g_error_matches(local_error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_TRUNCATED))
+        {
+            g_clear_error(&local_error);
+            g_set_error_literal(&local_error, GVS_STREAM_ERROR,
+                                GVS_STREAM_ERROR_INVALID_HEADER,
+                                "Stream is too short to be a GVS stream");
+        }
+
+        g_propagate_error(error, local_error);
+        return FALSE;
+    }
+
+    if (memcmp(header, GVS_STREAM_MAGIC, 4) != 0 ||
+        (header[4] != 'l' && header[4] != 'B'))
+    {
+        g_set_error_literal(error, GVS_STREAM_ERROR,
+                            GVS_STREAM_ERROR_INVALID_HEADER,
+                            "Stream is not a GVS stream");
+        return FALSE;
+    }
+
+    if (header[5] != GVS_STREAM_VERSION)
+    {
+        g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_UNSUPPORTED,
+                    "Unsupported GVS stream version %u", header[5]);
+        return FALSE;
+    }
+
+    priv->flags = get_uint16(header + 6);
+    if (priv->flags & ~GVS_STREAM_KNOWN_FLAGS)
+    {
+        g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_UNSUPPORTED,
+                    "Unsupported GVS stream flags 0x%x",
+                    priv->flags & ~GVS_STREAM_KNOWN_FLAGS);
+        return FALSE;
+    }
+
+    priv->byteswap = header[4] != GVS_STREAM_NATIVE_ORDER;
+    priv->header_read = TRUE;
+
+    return TRUE;
+}
+
+/* Reads the header of the next record. Returns FALSE with @error unset at
+ * the end of the stream. */
+static gboolean
+read_record_header(GvsStreamReader *self, RecordHeader *record,
+                   GCancellable *cancellable, GError **error)
+{
+    GvsStreamReaderPrivate *priv = self->priv;
+    guint8 header[GVS_RECORD_MAX_HEADER_SIZE];
+    gsize header_size = GVS_RECORD_HEADER_SIZE;
+
+    if (!read_stream_header(self, cancellable, error) || priv->at_end)
+        return FALSE;
+
+    if (priv->flags & GVS_STREAM_CHECKSUMS)
+        header_size += 4;
+
+    if (!read_exactly(self, header, header_size, cancellable, error))
+    {
+        priv->at_end = TRUE;
+        return FALSE;
+    }
+
+    record->size = get_uint32(header);
+    record->version = get_uint16(header + 4);
+    record->reserved = get_uint16(header + 6);
+    record->checksum = header_size > GVS_RECORD_HEADER_SIZE ? get_uint32(header + 8) : 0;
+
+    return TRUE;
+}
+
+static void
+gvs_stream_reader_finalize(GObject *object)
+{
+    GvsStreamReaderPrivate *priv = GVS_STREAM_READER(object)->priv;
+
+    g_object_unref(priv->deserializer);
+    g_object_unref(priv->stream);
+
+    G_OBJECT_CLASS(gvs_stream_reader_parent_class)->finalize(object);
+}
+
+static void
+gvs_stream_reader_class_init(GvsStreamReaderClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_stream_reader_finalize;
+}
+
+static void
+gvs_stream_reader_init(GvsStreamReader *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_STREAM_READER,
+                                             GvsStreamReaderPrivate);
+
+    self->priv->deserializer = gvs_deserializer_new();
+}
+
+/**
+ * gvs_stream_reader_new:
+ * @stream: The #GInputStream to read from
+ *
+ * Creates a reader for the records in @stream. The stream header is read
+ * along with the first record.
+ *
+ * Returns: (transfer full): A new #GvsStreamReader
+ */
+GvsStreamReader *
+gvs_stream_reader_new(GInputStream *stream)
+{
+    GvsStreamReader *self;
+
+    g_return_val_if_fail(G_IS_INPUT_STREAM(stream), NULL);
+
+    self = g_object_new(GVS_TYPE_STREAM_READER, NULL);
+    self->priv->stream = g_object_ref(stream);
+
+    return self;
+}
+
+/**
+ * gvs_stream_reader_get_deserializer:
+ * @reader: A #GvsStreamReader
+ *
+ * Returns the deserializer used by gvs_stream_reader_read_object(), so that
+ * its statistics can be read.
+ *
+ * Returns: (transfer none): The reader's #GvsDeserializer
+ */
+GvsDeserializer *
+gvs_stream_reader_get_deserializer(GvsStreamReader *reader)
+{
+    g_return_val_if_fail(GVS_IS_STREAM_READER(reader), NULL);
+
+    return reader->priv->deserializer;
+}
+
+/**
+ * gvs_stream_reader_read_document:
+ * @reader: A #GvsStreamReader
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Reads the next record, checking its checksum if the stream has them, and
+ * returns the document it holds, in native byte order.
+ *
+ * Returns: (transfer full): The document, or %NULL at the end of the stream
+ *  (with @error unset) or on error
+ */
+GVariant *
+gvs_stream_reader_read_document(GvsStreamReader *reader,
+                                GCancellable *cancellable,
+                                GError **error)
+{
+    GvsStreamReaderPrivate *priv;
+    const GVariantType *type;
+    RecordHeader record;
+    GVariant *document;
+    guint32 magic_number;
+    guint16 version;
+    guint8 *data;
+    GBytes *bytes;
+
+    g_return_val_if_fail(GVS_IS_STREAM_READER(reader), NULL);
+    g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+    priv = reader->priv;
+
+    if (!read_record_header(reader, &record, cancellable, error))
+        return NULL;
+
+    type = document_type(record.version);
+    if (!type || record.reserved != 0)
+    {
+        g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_UNSUPPORTED,
+                    "Unsupported GVS document version %u", record.version);
+        return NULL;
+    }
+
+    data = read_payload(reader, record.size, cancellable, error);
+    if (!data)
+        return NULL;
+
+    if ((priv->flags & GVS_STREAM_CHECKSUMS) &&
+        compute_crc32(data, record.size) != record.checksum)
+    {
+        g_set_error_literal(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_CHECKSUM,
+                            "GVS stream record does not match its checksum");
+        g_free(data);
+        return NULL;
+    }
+
+    bytes = g_bytes_new_take(data, record.size);
+    document = g_variant_ref_sink(g_variant_new_from_bytes(type, bytes, FALSE));
+    g_bytes_unref(bytes);
+
+    if (priv->byteswap)
+    {
+        GVariant *swapped = g_variant_ref_sink(g_variant_byteswap(document));
+
+        g_variant_unref(document);
+        document = swapped;
+    }
+
+    /* The deserializer treats anything else as a programming error */
+    g_variant_get_child(document, 0, "u", &magic_number);
+    g_variant_get_child(document, 1, "q", &version);
+    if (magic_number != GVS_MAGIC_NUMBER || version != record.version)
+    {
+        g_set_error_literal(error, GVS_STREAM_ERROR,
+                            GVS_STREAM_ERROR_INVALID_DOCUMENT,
+                            "GVS stream record does not hold a GVS document");
+        g_variant_unref(document);
+        return NULL;
+    }
+
+    return document;
+}
+
+/**
+ * gvs_stream_reader_read_object:
+ * @reader: A #GvsStreamReader
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Reads the next record, as gvs_stream_reader_read_document(), and
+ * deserializes it with the reader's deserializer.
+ *
+ * Returns: (transfer full) (type GObject): The root object of the record's
+ *  document, or %NULL at the end of the stream (with @error unset) or on
+ *  error
+ */
+gpointer
+gvs_stream_reader_read_object(GvsStreamReader *reader,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+    GVariant *document;
+    gpointer object;
+
+    g_return_val_if_fail(GVS_IS_STREAM_READER(reader), NULL);
+
+    document = gvs_stream_reader_read_document(reader, cancellable, error);
+    if (!document)
+        return NULL;
+
+    object = gvs_deserializer_deserialize(reader->priv->deserializer, document);
+    g_variant_unref(document);
+
+    if (!object)
+    {
+        g_set_error_literal(error, GVS_STREAM_ERROR,
+                            GVS_STREAM_ERROR_INVALID_DOCUMENT,
+                            "Could not deserialize GVS stream record");
+    }
+
+    return object;
+}
+
+/**
+ * gvs_stream_reader_skip:
+ * @reader: A #GvsStreamReader
+ * @cancellable: (allow-none): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Steps over the next record without reading its contents, so neither its
+ * checksum nor its document are checked. Records with document versions
+ * this version of libgvs doesn't support can be skipped too. Seekable
+ * streams skip by seeking.
+ *
+ * Returns: %TRUE if a record was skipped, %FALSE at the end of the stream
+ *  (with @error unset) or on error
+ */
+gboolean
+gvs_stream_reader_skip(GvsStreamReader *reader,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+    GvsStreamReaderPrivate *priv;
+    RecordHeader record;
+    gsize remaining;
+
+    g_return_val_if_fail(GVS_IS_STREAM_READER(reader), FALSE);
+    g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+    priv = reader->priv;
+
+    if (!read_record_header(reader, &record, cancellable, error))
+        return FALSE;
+
+    remaining = record.size;
+    while (remaining > 0)
+    {
+        gssize skipped = g_input_stream_skip(priv->stream, remaining,
+                                             cancellable, error);
+
+        if (skipped < 0)
+            return FALSE;
+
+        if (skipped == 0)
+        {
+            g_set_error(error, GVS_STREAM_ERROR, GVS_STREAM_ERROR_TRUNCATED,
+                        "GVS stream ended %" G_GSIZE_FORMAT " bytes before the "
+                        "end of a record", remaining);
+            return FALSE;
+        }
+
+        remaining -= skipped;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,166 @@
+/* gvs-stream.h: Framed streams of serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_STREAM_H__
+#define __GVS_STREAM_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <gio/gio.h>
+
+#include "gvs-deserializer.h"
+#include "gvs-serializer.h"
+
+G_BEGIN_DECLS
+
+#define GVS_STREAM_ERROR (gvs_stream_error_quark ())
+
+/**
+ * GvsStreamError:
+ * @GVS_STREAM_ERROR_INVALID_HEADER: The stream does not start with a GVS
+ *  stream header
+ * @GVS_STREAM_ERROR_UNSUPPORTED: The stream or a record uses a version or
+ *  feature this version of libgvs doesn't understand
+ * @GVS_STREAM_ERROR_TRUNCATED: The stream ended part of the way through a
+ *  record
+ * @GVS_STREAM_ERROR_CHECKSUM: A record's checksum does not match its contents
+ * @GVS_STREAM_ERROR_INVALID_DOCUMENT: A record does not hold a GVS document
+ *
+ * Errors reported by #GvsStreamReader. Errors from the underlying stream are
+ * passed on unchanged.
+ */
+typedef enum
+{
+    GVS_STREAM_ERROR_INVALID_HEADER,
+    GVS_STREAM_ERROR_UNSUPPORTED,
+    GVS_STREAM_ERROR_TRUNCATED,
+    GVS_STREAM_ERROR_CHECKSUM,
+    GVS_STREAM_ERROR_INVALID_DOCUMENT
+} GvsStreamError;
+
+/**
+ * GvsStreamFlags:
+ * @GVS_STREAM_FLAGS_NONE: No flags
+ * @GVS_STREAM_CHECKSUMS: Store a CRC-32 of each record, which the reader
+ *  checks before handing the record back
+ */
+typedef enum
+{
+    GVS_STREAM_FLAGS_NONE = 0,
+    GVS_STREAM_CHECKSUMS  = 1 << 0
+} GvsStreamFlags;
+
+/*
+ * GvsStreamWriter
+ */
+#define GVS_TYPE_STREAM_WRITER             (gvs_stream_writer_get_type ())
+#define GVS_STREAM_WRITER(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), GVS_TYPE_STREAM_WRITER, GvsStreamWriter))
+#define GVS_IS_STREAM_WRITER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GVS_TYPE_STREAM_WRITER))
+
+typedef struct _GvsStreamWriter             GvsStreamWriter;
+typedef struct _GvsStreamWriterClass        GvsStreamWriterClass;
+typedef struct _GvsStreamWriterPrivate      GvsStreamWriterPrivate;
+
+struct _GvsStreamWriter
+{
+    /*<private>*/
+    GObject    parent;
+
+    GvsStreamWriterPrivate *priv;
+};
+
+struct _GvsStreamWriterClass
+{
+    /*<private>*/
+    GObjectClass    parent_class;
+};
+
+/*
+ * GvsStreamReader
+ */
+#define GVS_TYPE_STREAM_READER             (gvs_stream_reader_get_type ())
+#define GVS_STREAM_READER(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), GVS_TYPE_STREAM_READER, GvsStreamReader))
+#define GVS_IS_STREAM_READER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GVS_TYPE_STREAM_READER))
+
+typedef struct _GvsStreamReader             GvsStreamReader;
+typedef struct _GvsStreamReaderClass        GvsStreamReaderClass;
+typedef struct _GvsStreamReaderPrivate      GvsStreamReaderPrivate;
+
+struct _GvsStreamReader
+{
+    /*<private>*/
+    GObject    parent;
+
+    GvsStreamReaderPrivate *priv;
+};
+
+struct _GvsStreamReaderClass
+{
+    /*<private>*/
+    GObjectClass    parent_class;
+};
+
+GQuark            gvs_stream_error_quark              (void);
+
+GType             gvs_stream_writer_get_type          (void) G_GNUC_CONST;
+
+GvsStreamWriter  *gvs_stream_writer_new               (GOutputStream   *stream,
+                                                       GvsStreamFlags   flags);
+
+GvsSerializer    *gvs_stream_writer_get_serializer    (GvsStreamWriter *writer);
+
+void              gvs_stream_writer_set_batch_size    (GvsStreamWriter *writer,
+                                                       gsize            batch_size);
+
+gboolean          gvs_stream_writer_write_object      (GvsStreamWriter *writer,
+                                                       GObject         *object,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+gboolean          gvs_stream_writer_write_document    (GvsStreamWriter *writer,
+                                                       GVariant        *document,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+gboolean          gvs_stream_writer_flush             (GvsStreamWriter *writer,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+GType             gvs_stream_reader_get_type          (void) G_GNUC_CONST;
+
+GvsStreamReader  *gvs_stream_reader_new               (GInputStream    *stream);
+
+GvsDeserializer  *gvs_stream_reader_get_deserializer  (GvsStreamReader *reader);
+
+GVariant         *gvs_stream_reader_read_document     (GvsStreamReader *reader,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+gpointer          gvs_stream_reader_read_object       (GvsStreamReader *reader,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+gboolean          gvs_stream_reader_skip              (GvsStreamReader *reader,
+                                                       GCancellable    *cancellable,
+                                                       GError         **error);
+
+G_END_DECLS
+
+#endif
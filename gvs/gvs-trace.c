@@ -0,0 +1,52 @@
+/* gvs-trace.c: Static tracepoints in the serializer and deserializer
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-trace.h"
+#undef __GVS_INSIDE__
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#ifdef HAVE_DTRACE
+
+/* The semaphores live in the .probes section, where tracers expect to find
+ * them; this is what "dtrace -G" would generate */
+#define GVS_TRACE_DEFINE_SEMAPHORE(probe) \
+    __extension__ unsigned short gvs_##probe##_semaphore \
+        __attribute__((section(".probes"))) = 0;
+GVS_TRACE_PROBES(GVS_TRACE_DEFINE_SEMAPHORE)
+#undef GVS_TRACE_DEFINE_SEMAPHORE
+
+#endif
+
+#ifdef HAVE_SYSPROF
+
+void
+_gvs_trace_mark(gint64 begin, const char *name, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    sysprof_collector_mark_vprintf(begin, SYSPROF_CAPTURE_CURRENT_TIME - begin,
+                                   "gvs", name, format, args);
+    va_end(args);
+}
+
+#endif
@@ -0,0 +1,118 @@
+/* gvs-trace.h: Static tracepoints in the serializer and deserializer
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_TRACE_H__
+#define __GVS_TRACE_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "gvs-trace.h may only be used inside libgvs"
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * With --enable-dtrace, each of these is a USDT probe in the "gvs" provider,
+ * which perf, bpftrace and SystemTap can attach to. Every probe has a
+ * semaphore which the tracer sets while it is attached, and the arguments
+ * are only worked out when it is set, so a probe nobody is listening to
+ * costs a load and a branch.
+ *
+ * Arguments: type names and property names are strings, ids and sizes are
+ * 64-bit. Byte sizes are those of the entity's or property's serialized
+ * form, or 0 for entities stored as columns.
+ */
+#define GVS_TRACE_PROBES(P)                                                  \
+    P(serialize_object_entry)       /* root type name */                    \
+    P(serialize_object_return)      /* root type name, entities, bytes */   \
+    P(serialize_entity_entry)       /* type name, id */                     \
+    P(serialize_entity_return)      /* type name, id, bytes */              \
+    P(serialize_property_entry)     /* property name, value type name */    \
+    P(serialize_property_return)    /* property name, bytes */              \
+    P(deserialize_entry)            /* bytes */                             \
+    P(deserialize_return)           /* root type name, entities, bytes */   \
+    P(create_entity_entry)          /* id */                                \
+    P(create_entity_return)         /* type name, id, bytes */              \
+    P(deserialize_entity_entry)     /* id */                                \
+    P(deserialize_entity_return)    /* type name, id, bytes */              \
+    P(deserialize_property_entry)   /* property name, bytes */              \
+    P(deserialize_property_return)  /* property name, value type name */
+
+#ifdef HAVE_DTRACE
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define GVS_TRACE_DECLARE_SEMAPHORE(probe) \
+    extern unsigned short gvs_##probe##_semaphore G_GNUC_INTERNAL;
+GVS_TRACE_PROBES(GVS_TRACE_DECLARE_SEMAPHORE)
+#undef GVS_TRACE_DECLARE_SEMAPHORE
+
+#define GVS_TRACE_ENABLED(probe) G_UNLIKELY(gvs_##probe##_semaphore)
+
+#define GVS_TRACE1(probe, a) G_STMT_START {                                  \
+        if (GVS_TRACE_ENABLED(probe))                                        \
+            DTRACE_PROBE1(gvs, probe, a);                                    \
+    } G_STMT_END
+#define GVS_TRACE2(probe, a, b) G_STMT_START {                               \
+        if (GVS_TRACE_ENABLED(probe))                                        \
+            DTRACE_PROBE2(gvs, probe, a, b);                                 \
+    } G_STMT_END
+#define GVS_TRACE3(probe, a, b, c) G_STMT_START {                            \
+        if (GVS_TRACE_ENABLED(probe))                                        \
+            DTRACE_PROBE3(gvs, probe, a, b, c);                              \
+    } G_STMT_END
+
+#else
+
+#define GVS_TRACE1(probe, a)       G_STMT_START { } G_STMT_END
+#define GVS_TRACE2(probe, a, b)    G_STMT_START { } G_STMT_END
+#define GVS_TRACE3(probe, a, b, c) G_STMT_START { } G_STMT_END
+
+#endif
+
+/*
+ * With --enable-sysprof, whole [de]serializations and each entity also show
+ * up as marks in sysprof captures. @begin is a CLOCK_MONOTONIC time in
+ * nanoseconds, as returned by _gvs_stats_enter(); the mark ends now.
+ * Properties are too fine-grained to be worth a mark each.
+ */
+#ifdef HAVE_SYSPROF
+
+void _gvs_trace_mark (gint64      begin,
+                      const char *name,
+                      const char *format,
+                      ...) G_GNUC_PRINTF(3, 4);
+
+#define GVS_TRACE_MARK(begin, name, ...) \
+    _gvs_trace_mark((begin), (name), __VA_ARGS__)
+
+#else
+
+#define GVS_TRACE_MARK(begin, name, ...) ((void) (begin))
+
+#endif
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,872 @@
+/* gvs-view.c: Read-only queries over serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __GVS_INSIDE__
+#include "gvs-view.h"
+#include "gvs-private.h"
+#undef __GVS_INSIDE__
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Everything here works on the serialized form directly. Entities come from
+ * the same fetch functions the deserializer uses for archives, and values
+ * are children of the document, which GVariant hands out as slices of the
+ * same buffer.
+ */
+
+struct _GvsViewPrivate
+{
+    gsize              n_entities;
+    GvsEntityFetchFunc fetch;
+    gpointer           fetch_data;
+    GDestroyNotify     fetch_destroy;
+
+    /* The document's string table, or %NULL */
+    GVariant          *strings;
+
+    /* Hex digests of entities, filled in as gvs_view_get_entity_hash()
+     * needs them */
+    char             **hashes;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvsView, gvs_view, G_TYPE_OBJECT)
+
+/******************************************************************************
+ *
+ * Internal functions
+ *
+ ******************************************************************************/
+
+/* Takes ownership of @strings */
+static GvsView *
+view_new(gsize n_entities, GVariant *strings, GvsEntityFetchFunc fetch,
+         gpointer user_data, GDestroyNotify destroy)
+{
+    GvsView *self = g_object_new(GVS_TYPE_VIEW, NULL);
+
+    self->priv->n_entities = n_entities;
+    self->priv->strings = strings;
+    self->priv->fetch = fetch;
+    self->priv->fetch_data = user_data;
+    self->priv->fetch_destroy = destroy;
+
+    return self;
+}
+
+/* Returns the payload of entity @id, or %NULL if there is no such entity */
+static GVariant *
+get_payload(GvsView *self, gsize id)
+{
+    GVariant *entity, *payload;
+
+    if (id >= self->priv->n_entities)
+        return NULL;
+
+    entity = self->priv->fetch(self->priv->fetch_data, id);
+    g_variant_get_child(entity, 1, "v", &payload);
+    g_variant_unref(entity);
+
+    return payload;
+}
+
+/* Returns property @name of a default serialization, or item @name of a
+ * serialized GListStore if @name is a number */
+static GVariant *
+get_member(GVariant *payload, const char *name)
+{
+    if (g_variant_is_of_type(payload, G_VARIANT_TYPE_VARDICT))
+        return g_variant_lookup_value(payload, name, NULL);
+
+    if (name[0] >= '0' && name[0] <= '9' &&
+        (g_variant_is_of_type(payload, GVS_LIST_STORE_TYPE) ||
+         g_variant_is_of_type(payload, GVS_COMPACT_LIST_STORE_TYPE)))
+    {
+        GVariant *ids = g_variant_get_child_value(payload, 1);
+        GVariant *item = NULL;
+        char *end;
+        guint64 index = g_ascii_strtoull(name, &end, 10);
+
+        if (*end == '\0' && index < g_variant_n_children(ids))
+        {
+            item = g_variant_get_child_value(ids, index);
+            item = g_variant_new_maybe(NULL, item);
+        }
+
+        g_variant_unref(ids);
+
+        return item ? g_variant_ref_sink(item) : NULL;
+    }
+
+    return NULL;
+}
+
+/******************************************************************************
+ *
+ * Content hashes
+ *
+ ******************************************************************************/
+
+/*
+ * An entity's hash covers its type name and payload, with each reference
+ * replaced by the hash of the entity it refers to, so equal hashes mean
+ * equal subgraphs whatever the entities were numbered. Hashes are worked out
+ * depth first: an entity is hashed once everything it refers to has been,
+ * and a reference to an entity still on the stack, which can only happen in
+ * a cycle, is replaced by how far down the stack that entity is.
+ */
+
+typedef struct
+{
+    GvsView    *view;
+
+    /* What to feed values to, or %NULL to collect references instead */
+    GChecksum  *checksum;
+    GArray     *refs;
+
+    /* Entity id -> 1 + its position on the stack */
+    GHashTable *on_stack;
+    guint       depth;
+} HashState;
+
+typedef struct
+{
+    gsize     id;
+    GVariant *entity;
+    GArray   *refs;
+    guint     next;
+} HashFrame;
+
+static void
+feed_uint64(GChecksum *checksum, guint64 n)
+{
+    n = GUINT64_TO_LE(n);
+    g_checksum_update(checksum, (const guchar *) &n, sizeof(n));
+}
+
+static void
+feed_string(GChecksum *checksum, const char *string)
+{
+    g_checksum_update(checksum, (const guchar *) string, strlen(string) + 1);
+}
+
+static gboolean
+is_ref(GVariant *value)
+{
+    return g_variant_is_of_type(value, G_VARIANT_TYPE("mt")) ||
+           g_variant_is_of_type(value, G_VARIANT_TYPE("mu"));
+}
+
+/* Whether values of @type could hold a reference somewhere inside */
+static gboolean
+type_may_hold_refs(const GVariantType *type)
+{
+    const char *string = g_variant_type_peek_string(type);
+    gsize length = g_variant_type_get_string_length(type);
+
+    return memchr(string, 'm', length) || memchr(string, 'v', length);
+}
+
+static void
+hash_ref(HashState *state, gboolean present, gsize id)
+{
+    GvsViewPrivate *priv = state->view->priv;
+    guint position;
+
+    if (!state->checksum)
+    {
+        if (present && id < priv->n_entities)
+            g_array_append_val(state->refs, id);
+        return;
+    }
+
+    if (!present)
+    {
+        feed_string(state->checksum, "null");
+        return;
+    }
+
+    if (id >= priv->n_entities)
+    {
+        feed_string(state->checksum, "dangling");
+        return;
+    }
+
+    if (priv->hashes[id])
+    {
+        feed_string(state->checksum, priv->hashes[id]);
+        return;
+    }
+
+    position = GPOINTER_TO_UINT(g_hash_table_lookup(state->on_stack, GSIZE_TO_POINTER(id)));
+    g_assert(position != 0);
+
+    feed_string(state->checksum, "cycle");
+    feed_uint64(state->checksum, state->depth - (position - 1));
+}
+
+static void
+hash_value(HashState *state, GVariant *value)
+{
+    const GVariantType *type = g_variant_get_type(value);
+    gsize i, n_children;
+
+    /* Strings in the table hash as the strings themselves, whatever their
+     * index, so documents with and without a table can be compared */
+    if (g_variant_is_of_type(value, GVS_STRING_REF_TYPE))
+    {
+        GVariant *string = _gvs_string_table_resolve(state->view->priv->strings, value);
+
+        hash_value(state, string);
+        g_variant_unref(string);
+        return;
+    }
+
+    if (is_ref(value))
+    {
+        gsize id = 0;
+        gboolean present = gvs_view_read_ref(value, &id);
+
+        hash_ref(state, present, id);
+        return;
+    }
+
+    if (!type_may_hold_refs(type))
+    {
+        GVariant *normal;
+
+        if (!state->checksum)
+            return;
+
+        /* Hashes shouldn't depend on the byte order of the host */
+        normal = g_variant_get_normal_form(value);
+        if (G_BYTE_ORDER == G_BIG_ENDIAN)
+        {
+            GVariant *swapped = g_variant_byteswap(normal);
+
+            g_variant_unref(normal);
+            normal = swapped;
+        }
+
+        feed_string(state->checksum, g_variant_get_type_string(value));
+        feed_uint64(state->checksum, g_variant_get_size(normal));
+        g_checksum_update(state->checksum, g_variant_get_data(normal),
+                          g_variant_get_size(normal));
+        g_variant_unref(normal);
+        return;
+    }
+
+    n_children = g_variant_n_children(value);
+
+    if (state->checksum)
+    {
+        feed_string(state->checksum, g_variant_get_type_string(value));
+        feed_uint64(state->checksum, n_children);
+    }
+
+    for (i = 0; i < n_children; i++)
+    {
+        GVariant *child = g_variant_get_child_value(value, i);
+
+        hash_value(state, child);
+        g_variant_unref(child);
+    }
+}
+
+/* As hash_value(), but the items of a serialized GListStore are references */
+static void
+hash_payload(HashState *state, GVariant *payload)
+{
+    GVariant *type_name, *ids;
+    gsize i, n_items;
+
+    if (!g_variant_is_of_type(payload, GVS_LIST_STORE_TYPE) &&
+        !g_variant_is_of_type(payload, GVS_COMPACT_LIST_STORE_TYPE))
+    {
+        hash_value(state, payload);
+        return;
+    }
+
+    type_name = g_variant_get_child_value(payload, 0);
+    ids = g_variant_get_child_value(payload, 1);
+    n_items = g_variant_n_children(ids);
+
+    if (state->checksum)
+    {
+        feed_string(state->checksum, "list");
+        feed_string(state->checksum, g_variant_get_string(type_name, NULL));
+        feed_uint64(state->checksum, n_items);
+    }
+
+    for (i = 0; i < n_items; i++)
+    {
+        GVariant *item = g_variant_get_child_value(ids, i);
+
+        if (g_variant_is_of_type(item, G_VARIANT_TYPE_UINT32))
+            hash_ref(state, TRUE, g_variant_get_uint32(item));
+        else
+            hash_ref(state, TRUE, g_variant_get_uint64(item));
+
+        g_variant_unref(item);
+    }
+
+    g_variant_unref(ids);
+    g_variant_unref(type_name);
+}
+
+/* Fetches entity @id and collects its references onto the stack */
+static void
+push_frame(HashState *state, GArray *stack, gsize id)
+{
+    GvsViewPrivate *priv = state->view->priv;
+    HashFrame frame;
+    GVariant *payload;
+
+    frame.id = id;
+    frame.entity = priv->fetch(priv->fetch_data, id);
+    frame.refs = g_array_new(FALSE, FALSE, sizeof(gsize));
+    frame.next = 0;
+
+    g_variant_get_child(frame.entity, 1, "v", &payload);
+    state->checksum = NULL;
+    state->refs = frame.refs;
+    hash_payload(state, payload);
+    g_variant_unref(payload);
+
+    g_array_append_val(stack, frame);
+    g_hash_table_insert(state->on_stack, GSIZE_TO_POINTER(id),
+                        GUINT_TO_POINTER(stack->len));
+}
+
+static void
+compute_hashes(GvsView *self, gsize root)
+{
+    GvsViewPrivate *priv = self->priv;
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    GArray *stack = g_array_new(FALSE, FALSE, sizeof(HashFrame));
+    HashState state;
+
+    state.view = self;
+    state.on_stack = g_hash_table_new(NULL, NULL);
+
+    push_frame(&state, stack, root);
+
+    while (stack->len > 0)
+    {
+        HashFrame *frame = &g_array_index(stack, HashFrame, stack->len - 1);
+        const char *type_name;
+        GVariant *payload;
+
+        if (frame->next < frame->refs->len)
+        {
+            gsize id = g_array_index(frame->refs, gsize, frame->next++);
+
+            if (!priv->hashes[id] &&
+                !g_hash_table_contains(state.on_stack, GSIZE_TO_POINTER(id)))
+            {
+                push_frame(&state, stack, id);
+            }
+
+            continue;
+        }
+
+        /* Everything @frame refers to is hashed, or further down the stack */
+        g_variant_get(frame->entity, "(&sv)", &type_name, &payload);
+
+        g_checksum_reset(checksum);
+        state.checksum = checksum;
+        state.depth = stack->len - 1;
+        feed_string(checksum, type_name);
+        hash_payload(&state, payload);
+        priv->hashes[frame->id] = g_strdup(g_checksum_get_string(checksum));
+
+        g_variant_unref(payload);
+        g_hash_table_remove(state.on_stack, GSIZE_TO_POINTER(frame->id));
+        g_variant_unref(frame->entity);
+        g_array_unref(frame->refs);
+        g_array_set_size(stack, stack->len - 1);
+    }
+
+    g_hash_table_destroy(state.on_stack);
+    g_array_unref(stack);
+    g_checksum_free(checksum);
+}
+
+/* Returns the hex digest of @value as hashed into its entity's hash, so
+ * references compare by the hashes of their targets */
+char *
+_gvs_view_hash_value(GvsView *view, GVariant *value)
+{
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    HashState state;
+    GArray *refs = g_array_new(FALSE, FALSE, sizeof(gsize));
+    char *digest;
+    guint i;
+
+    /* Make sure everything @value refers to has been hashed */
+    state.view = view;
+    state.checksum = NULL;
+    state.refs = refs;
+    state.on_stack = NULL;
+    state.depth = 0;
+    hash_value(&state, value);
+
+    for (i = 0; i < refs->len; i++)
+        gvs_view_get_entity_hash(view, g_array_index(refs, gsize, i));
+
+    state.checksum = checksum;
+    hash_value(&state, value);
+    digest = g_strdup(g_checksum_get_string(checksum));
+
+    g_array_unref(refs);
+    g_checksum_free(checksum);
+
+    return digest;
+}
+
+/******************************************************************************
+ *
+ * Public API
+ *
+ ******************************************************************************/
+
+/**
+ * gvs_view_new:
+ * @document: A document returned by gvs_serializer_serialize_object()
+ *
+ * Creates a view of @document, which answers questions about its contents
+ * without creating any objects. Documents written with
+ * %GVS_SERIALIZER_COLUMNAR can't be viewed.
+ *
+ * Returns: (transfer full): A new #GvsView
+ */
+GvsView *
+gvs_view_new(GVariant *document)
+{
+    GVariant *entities = _gvs_document_get_entity_array(document);
+
+    if (!entities)
+        return NULL;
+
+    return view_new(g_variant_n_children(entities),
+                    _gvs_document_get_string_table(document),
+                    _gvs_entity_array_fetch, entities,
+                    (GDestroyNotify) g_variant_unref);
+}
+
+/**
+ * gvs_view_new_for_archive:
+ * @archive: A #GvsArchive
+ *
+ * Creates a view of the document in @archive, reading only the entities
+ * each query touches.
+ *
+ * Returns: (transfer full): A new #GvsView
+ */
+GvsView *
+gvs_view_new_for_archive(GvsArchive *archive)
+{
+    g_return_val_if_fail(GVS_IS_ARCHIVE(archive), NULL);
+
+    return view_new(gvs_archive_get_n_entities(archive),
+                    _gvs_archive_get_string_table(archive),
+                    _gvs_archive_fetch_entity, g_object_ref(archive),
+                    g_object_unref);
+}
+
+/**
+ * gvs_view_get_n_entities:
+ * @view: A #GvsView
+ *
+ * Returns: The number of entities in the document, whose ids run from 0,
+ *  the root, to one less than this
+ */
+gsize
+gvs_view_get_n_entities(GvsView *view)
+{
+    g_return_val_if_fail(GVS_IS_VIEW(view), 0);
+
+    return view->priv->n_entities;
+}
+
+/**
+ * gvs_view_get_entity:
+ * @view: A #GvsView
+ * @id: An entity id
+ *
+ * Returns: (transfer full) (nullable): The serialized entity, an "(sv)" of
+ *  its type name and state, or %NULL if there is no entity @id
+ */
+GVariant *
+gvs_view_get_entity(GvsView *view, gsize id)
+{
+    g_return_val_if_fail(GVS_IS_VIEW(view), NULL);
+
+    if (id >= view->priv->n_entities)
+        return NULL;
+
+    return view->priv->fetch(view->priv->fetch_data, id);
+}
+
+/**
+ * gvs_view_get_entity_type:
+ * @view: A #GvsView
+ * @id: An entity id
+ *
+ * Returns: The type of entity @id, or 0 if there is no such entity or its
+ *  type isn't registered
+ */
+GType
+gvs_view_get_entity_type(GvsView *view, gsize id)
+{
+    GVariant *entity = gvs_view_get_entity(view, id);
+    const char *type_name;
+    GType type;
+
+    if (!entity)
+        return 0;
+
+    g_variant_get_child(entity, 0, "&s", &type_name);
+    type = g_type_from_name(type_name);
+    g_variant_unref(entity);
+
+    return type;
+}
+
+/**
+ * gvs_view_get_property:
+ * @view: A #GvsView
+ * @id: An entity id
+ * @name: A property name
+ *
+ * Returns property @name of entity @id as it was serialized: strings are
+ * maybe types, read through the string table of documents written with
+ * %GVS_SERIALIZER_VALUE_TABLE, object references are maybe entity ids (see
+ * gvs_view_read_ref()), and in compact documents numbers may be narrower
+ * than the property itself. Properties left out by
+ * %GVS_SERIALIZER_SKIP_DEFAULTS, and entities with a custom serialization,
+ * have nothing to return. Items of a #GListStore can be got by giving
+ * their position as @name.
+ *
+ * Returns: (transfer full) (nullable): The serialized value, or %NULL
+ */
+GVariant *
+gvs_view_get_property(GvsView *view, gsize id, const char *name)
+{
+    GVariant *payload, *value;
+
+    g_return_val_if_fail(GVS_IS_VIEW(view), NULL);
+    g_return_val_if_fail(name != NULL, NULL);
+
+    payload = get_payload(view, id);
+    if (!payload)
+        return NULL;
+
+    value = get_member(payload, name);
+    g_variant_unref(payload);
+
+    if (value && g_variant_is_of_type(value, GVS_STRING_REF_TYPE))
+    {
+        GVariant *string = _gvs_string_table_resolve(view->priv->strings, value);
+
+        g_variant_unref(value);
+        value = string;
+    }
+
+    return value;
+}
+
+/**
+ * gvs_view_lookup_entity:
+ * @view: A #GvsView
+ * @id: The entity to start from, 0 for the root
+ * @path: Property names separated by '/'
+ * @out_id: (out) (optional): Return location for the id of the entity found
+ *
+ * Follows the object properties named in @path from entity @id: for
+ * example "child/owner" is the owner of the child of entity @id. A
+ * component may also be the position of an item in a #GListStore. An empty
+ * path finds entity @id itself.
+ *
+ * Returns: %TRUE if every property in @path exists and refers to an entity
+ */
+gboolean
+gvs_view_lookup_entity(GvsView *view, gsize id, const char *path, gsize *out_id)
+{
+    char **names;
+    guint i;
+
+    g_return_val_if_fail(GVS_IS_VIEW(view), FALSE);
+    g_return_val_if_fail(path != NULL, FALSE);
+
+    if (id >= view->priv->n_entities)
+        return FALSE;
+
+    names = g_strsplit(path, "/", -1);
+
+    for (i = 0; names[i]; i++)
+    {
+        GVariant *value;
+        gboolean found;
+
+        if (names[i][0] == '\0')
+            continue;
+
+        value = gvs_view_get_property(view, id, names[i]);
+        found = value && gvs_view_read_ref(value, &id) && id < view->priv->n_entities;
+
+        if (value)
+            g_variant_unref(value);
+
+        if (!found)
+        {
+            g_strfreev(names);
+            return FALSE;
+        }
+    }
+
+    g_strfreev(names);
+
+    if (out_id)
+        *out_id = id;
+
+    return TRUE;
+}
+
+/**
+ * gvs_view_lookup:
+ * @view: A #GvsView
+ * @id: The entity to start from, 0 for the root
+ * @path: Property names separated by '/'
+ *
+ * Finds the entity reached by all but the last component of @path, as
+ * gvs_view_lookup_entity() does, and returns the property named by the last
+ * as gvs_view_get_property() does. For example, "child/name" is the name of
+ * the child of entity @id.
+ *
+ * Returns: (transfer full) (nullable): The serialized value, or %NULL if
+ *  @path leads nowhere
+ */
+GVariant *
+gvs_view_lookup(GvsView *view, gsize id, const char *path)
+{
+    const char *name;
+    gboolean found;
+
+    g_return_val_if_fail(GVS_IS_VIEW(view), NULL);
+    g_return_val_if_fail(path != NULL, NULL);
+
+    name = strrchr(path, '/');
+
+    if (name)
+    {
+        char *parent = g_strndup(path, name - path);
+
+        found = gvs_view_lookup_entity(view, id, parent, &id);
+        g_free(parent);
+        name++;
+    }
+    else
+    {
+        found = TRUE;
+        name = path;
+    }
+
+    return found ? gvs_view_get_property(view, id, name) : NULL;
+}
+
+/**
+ * gvs_view_select:
+ * @view: A #GvsView
+ * @type: The type of entity to look for, including subtypes, or 0 for all
+ * @filter: (scope call) (nullable): A function deciding which of them to
+ *  include, or %NULL for all
+ * @user_data: User data for @filter
+ *
+ * Finds the entities of @type for which @filter returns %TRUE, in order of
+ * id. Only the type name of each entity is read before @filter is called,
+ * and type names are only looked up once each; entities whose type isn't
+ * registered never match a nonzero @type.
+ *
+ * Returns: (transfer full) (element-type gsize): The ids of the entities
+ *  found. Free with g_array_unref()
+ */
+GArray *
+gvs_view_select(GvsView *view, GType type, GvsViewFilterFunc filter, gpointer user_data)
+{
+    GHashTable *matches;
+    GArray *result;
+    gsize id;
+
+    g_return_val_if_fail(GVS_IS_VIEW(view), NULL);
+
+    result = g_array_new(FALSE, FALSE, sizeof(gsize));
+
+    /* Type name -> GINT_TO_POINTER(1 + whether it is a @type) */
+    matches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    for (id = 0; id < view->priv->n_entities; id++)
+    {
+        GVariant *entity = view->priv->fetch(view->priv->fetch_data, id);
+        const char *type_name;
+        gint match;
+
+        g_variant_get_child(entity, 0, "&s", &type_name);
+        match = GPOINTER_TO_INT(g_hash_table_lookup(matches, type_name));
+
+        if (match == 0)
+        {
+            GType entity_type = g_type_from_name(type_name);
+
+            match = 1 + (type == 0 || (entity_type != 0 && g_type_is_a(entity_type, type)));
+            g_hash_table_insert(matches, g_strdup(type_name), GINT_TO_POINTER(match));
+        }
+
+        g_variant_unref(entity);
+
+        if (match == 2 && (!filter || filter(view, id, user_data)))
+            g_array_append_val(result, id);
+    }
+
+    g_hash_table_destroy(matches);
+
+    return result;
+}
+
+/**
+ * gvs_view_get_entity_hash:
+ * @view: A #GvsView
+ * @id: An entity id
+ *
+ * Returns a SHA-256 hash of entity @id and everything it refers to. The
+ * hash covers the entity's type name and serialized state, with each
+ * reference standing for the hash of the entity it refers to rather than
+ * its id, so that equal subgraphs have equal hashes wherever they appear,
+ * in this document or any other. Documents written with
+ * %GVS_SERIALIZER_CANONICAL give equal graphs equal hashes; otherwise the
+ * order of properties and hash table entries counts too. In a cycle, the
+ * hashes depend on which entity the cycle was first reached from.
+ *
+ * Hashes are worked out on first use, and kept for the lifetime of @view.
+ *
+ * Returns: (nullable): The hash as a hex string, or %NULL if there is no
+ *  entity @id
+ */
+const char *
+gvs_view_get_entity_hash(GvsView *view, gsize id)
+{
+    GvsViewPrivate *priv;
+
+    g_return_val_if_fail(GVS_IS_VIEW(view), NULL);
+
+    priv = view->priv;
+
+    if (id >= priv->n_entities)
+        return NULL;
+
+    if (!priv->hashes)
+        priv->hashes = g_new0(char *, priv->n_entities);
+
+    if (!priv->hashes[id])
+        compute_hashes(view, id);
+
+    return priv->hashes[id];
+}
+
+/**
+ * gvs_view_read_ref:
+ * @value: A serialized object property, or any other #GVariant
+ * @id: (out) (optional): Return location for the entity id
+ *
+ * Reads a serialized reference to an entity, as held by object properties.
+ *
+ * Returns: %TRUE if @value is a reference to an entity, or %FALSE if it
+ *  is a %NULL reference or not a reference at all
+ */
+gboolean
+gvs_view_read_ref(GVariant *value, gsize *id)
+{
+    GVariant *child;
+    gsize ref;
+
+    g_return_val_if_fail(value != NULL, FALSE);
+
+    if (!g_variant_is_of_type(value, G_VARIANT_TYPE("mt")) &&
+        !g_variant_is_of_type(value, G_VARIANT_TYPE("mu")))
+    {
+        return FALSE;
+    }
+
+    child = g_variant_get_maybe(value);
+    if (!child)
+        return FALSE;
+
+    if (g_variant_is_of_type(child, G_VARIANT_TYPE_UINT32))
+        ref = g_variant_get_uint32(child);
+    else
+        ref = g_variant_get_uint64(child);
+
+    g_variant_unref(child);
+
+    if (id)
+        *id = ref;
+
+    return TRUE;
+}
+
+/******************************************************************************
+ *
+ * GObject boilerplate
+ *
+ ******************************************************************************/
+
+static void
+gvs_view_finalize(GObject *object)
+{
+    GvsViewPrivate *priv = GVS_VIEW(object)->priv;
+    gsize i;
+
+    if (priv->hashes)
+    {
+        for (i = 0; i < priv->n_entities; i++)
+            g_free(priv->hashes[i]);
+        g_free(priv->hashes);
+    }
+
+    if (priv->fetch_destroy)
+        priv->fetch_destroy(priv->fetch_data);
+
+    g_clear_pointer(&priv->strings, g_variant_unref);
+
+    G_OBJECT_CLASS(gvs_view_parent_class)->finalize(object);
+}
+
+static void
+gvs_view_class_init(GvsViewClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = gvs_view_finalize;
+}
+
+static void
+gvs_view_init(GvsView *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, GVS_TYPE_VIEW, GvsViewPrivate);
+}
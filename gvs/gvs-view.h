@@ -0,0 +1,106 @@
+/* gvs-view.h: Read-only queries over serialized documents
+ *
+ * Copyright (c) 2014 Tristan Brindle <t.c.brindle@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GVS_VIEW_H__
+#define __GVS_VIEW_H__
+
+#if !defined (__GVS_INSIDE__)
+#error "Only <gvs.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+
+#include "gvs-archive.h"
+
+G_BEGIN_DECLS
+
+#define GVS_TYPE_VIEW             (gvs_view_get_type ())
+#define GVS_VIEW(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), GVS_TYPE_VIEW, GvsView))
+#define GVS_IS_VIEW(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GVS_TYPE_VIEW))
+
+typedef struct _GvsView             GvsView;
+typedef struct _GvsViewClass        GvsViewClass;
+typedef struct _GvsViewPrivate      GvsViewPrivate;
+
+struct _GvsView
+{
+    /*<private>*/
+    GObject    parent;
+
+    GvsViewPrivate *priv;
+};
+
+struct _GvsViewClass
+{
+    /*<private>*/
+    GObjectClass    parent_class;
+};
+
+/**
+ * GvsViewFilterFunc:
+ * @view: The #GvsView being searched
+ * @id: The id of an entity of the type being searched for
+ * @user_data: User data passed to gvs_view_select()
+ *
+ * Returns: %TRUE to include entity @id in the result
+ */
+typedef gboolean (*GvsViewFilterFunc) (GvsView  *view,
+                                       gsize     id,
+                                       gpointer  user_data);
+
+GType             gvs_view_get_type                   (void) G_GNUC_CONST;
+
+GvsView          *gvs_view_new                        (GVariant          *document);
+
+GvsView          *gvs_view_new_for_archive            (GvsArchive        *archive);
+
+gsize             gvs_view_get_n_entities             (GvsView           *view);
+
+GVariant         *gvs_view_get_entity                 (GvsView           *view,
+                                                       gsize              id);
+
+GType             gvs_view_get_entity_type            (GvsView           *view,
+                                                       gsize              id);
+
+GVariant         *gvs_view_get_property               (GvsView           *view,
+                                                       gsize              id,
+                                                       const char        *name);
+
+gboolean          gvs_view_lookup_entity              (GvsView           *view,
+                                                       gsize              id,
+                                                       const char        *path,
+                                                       gsize             *out_id);
+
+GVariant         *gvs_view_lookup                     (GvsView           *view,
+                                                       gsize              id,
+                                                       const char        *path);
+
+GArray           *gvs_view_select                     (GvsView           *view,
+                                                       GType              type,
+                                                       GvsViewFilterFunc  filter,
+                                                       gpointer           user_data);
+
+const char       *gvs_view_get_entity_hash            (GvsView           *view,
+                                                       gsize              id);
+
+gboolean          gvs_view_read_ref                   (GVariant          *value,
+                                                       gsize             *id);
+
+G_END_DECLS
+
+#endif
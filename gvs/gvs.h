@@ -25,10 +25,17 @@ G_BEGIN_DECLS
 
 #define __GVS_INSIDE__
 
+#include "gvs-archive.h"
+#include "gvs-boxed.h"
 #include "gvs-deserializer.h"
+#include "gvs-diff.h"
 #include "gvs-gobject.h"
+#include "gvs-list-model.h"
 #include "gvs-serializable.h"
 #include "gvs-serializer.h"
+#include "gvs-stats.h"
+#include "gvs-stream.h"
+#include "gvs-view.h"
 
 #undef __GVS_INSIDE__
 
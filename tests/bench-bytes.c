@@ -0,0 +1,219 @@
+/*
+ * Benchmarks [de]serialization of objects holding large GBytes payloads
+ *
+ * Run with -m=perf (or "make perf-report") for full-size payloads.
+ */
+
+#include "bench-common.h"
+
+/* BenchBlob object, a chain of byte payloads */
+
+#define BENCH_TYPE_BLOB           (bench_blob_get_type())
+#define BENCH_BLOB(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), BENCH_TYPE_BLOB, BenchBlob))
+
+typedef struct _BenchBlob      BenchBlob;
+typedef struct _BenchBlobClass BenchBlobClass;
+
+struct _BenchBlob
+{
+    GObject parent;
+
+    BenchBlob *next;
+    GBytes *data;
+};
+
+struct _BenchBlobClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(BenchBlob, bench_blob, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NEXT,
+    PROP_DATA
+};
+
+static void
+bench_blob_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    BenchBlob *self = BENCH_BLOB(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        case PROP_DATA:
+            g_clear_pointer(&self->data, g_bytes_unref);
+            self->data = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_blob_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    BenchBlob *self = BENCH_BLOB(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_value_set_object(value, self->next);
+            break;
+
+        case PROP_DATA:
+            g_value_set_boxed(value, self->data);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_blob_dispose(GObject *obj)
+{
+    BenchBlob *next = BENCH_BLOB(obj)->next;
+
+    BENCH_BLOB(obj)->next = NULL;
+    g_clear_pointer(&BENCH_BLOB(obj)->data, g_bytes_unref);
+
+    /* Unlink the rest of the chain here rather than recursing through it */
+    while (next && G_OBJECT(next)->ref_count == 1)
+    {
+        BenchBlob *after = next->next;
+
+        next->next = NULL;
+        g_object_unref(next);
+        next = after;
+    }
+
+    if (next)
+        g_object_unref(next);
+
+    G_OBJECT_CLASS(bench_blob_parent_class)->dispose(obj);
+}
+
+static void
+bench_blob_class_init(BenchBlobClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = bench_blob_set_property;
+    gobject_class->get_property = bench_blob_get_property;
+    gobject_class->dispose = bench_blob_dispose;
+
+    g_object_class_install_property(gobject_class, PROP_NEXT,
+            g_param_spec_object("next", "next", "next", BENCH_TYPE_BLOB,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_DATA,
+            g_param_spec_boxed("data", "data", "data", G_TYPE_BYTES,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+bench_blob_init(BenchBlob *self)
+{
+}
+
+static BenchBlob *
+make_blobs(guint n_blobs,
+           gsize blob_size)
+{
+    BenchBlob *head = NULL;
+    guint i;
+
+    for (i = n_blobs; i > 0; i--)
+    {
+        guint8 *data = g_malloc(blob_size);
+        GBytes *bytes = NULL;
+        BenchBlob *blob = NULL;
+        gsize j;
+
+        for (j = 0; j < blob_size; j++)
+            data[j] = (guint8) (i * 31 + j);
+
+        bytes = g_bytes_new_take(data, blob_size);
+        blob = g_object_new(BENCH_TYPE_BLOB, "next", head, "data", bytes, NULL);
+
+        g_bytes_unref(bytes);
+        g_clear_object(&head);
+        head = blob;
+    }
+
+    return head;
+}
+
+static guint expected_blobs;
+static gsize expected_size;
+
+static void
+check_blobs(GObject *created)
+{
+    BenchBlob *blob = BENCH_BLOB(created);
+    guint n_blobs = 0;
+
+    for (; blob; blob = blob->next)
+    {
+        const guint8 *data;
+        gsize size;
+
+        data = g_bytes_get_data(blob->data, &size);
+        g_assert_cmpuint(size, ==, expected_size);
+        g_assert_cmpuint(data[size - 1], ==, (guint8) ((n_blobs + 1) * 31 + size - 1));
+        n_blobs++;
+    }
+
+    g_assert_cmpuint(n_blobs, ==, expected_blobs);
+}
+
+/* Each blob is one entity for the object and one for its GBytes */
+static void
+bench_blobs(guint n_blobs,
+            gsize blob_size)
+{
+    BenchBlob *head = make_blobs(n_blobs, blob_size);
+
+    expected_blobs = n_blobs;
+    expected_size = blob_size;
+    bench_run(g_test_get_path(), G_OBJECT(head), n_blobs * 2, n_blobs * 2,
+              GVS_SERIALIZER_FLAGS_NONE, check_blobs);
+
+    g_object_unref(head);
+}
+
+static void
+bench_large(void)
+{
+    bench_blobs(BENCH_SIZE(8, 2), BENCH_SIZE(8 * 1024 * 1024, 64 * 1024));
+}
+
+static void
+bench_medium(void)
+{
+    bench_blobs(BENCH_SIZE(5000, 100), 4096);
+}
+
+int
+main(int argc, char *argv[])
+{
+   bench_init(&argc, &argv);
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Bench/Bytes/Large", bench_large);
+   g_test_add_func("/Gvs/Bench/Bytes/Medium", bench_medium);
+   return g_test_run();
+}
@@ -0,0 +1,821 @@
+/*
+ * Helpers shared by the bench-*.c programs
+ *
+ * Each benchmark builds a graph of objects, then repeatedly serializes it to
+ * a flat GVariant and deserializes that again, reporting throughput, the
+ * size of the document and the number of allocations made. Results are
+ * reported with g_test_minimized_result() and g_test_maximized_result(), so
+ * they appear in the output of "make perf-report".
+ *
+ * Without -m=perf the graphs are shrunk and run once, so the benchmarks
+ * still check that every shape round-trips as part of "make test".
+ *
+ * Under -m=perf, each result is the median of BENCH_ITERATIONS runs. If
+ * GVS_BENCH_BASELINE names a key file, the medians are compared against the
+ * ones saved there and the test fails if any has regressed by more than the
+ * noise seen in either run; cases missing from the file (or all of them, if
+ * GVS_BENCH_UPDATE is set) are recorded instead. "make bench-check" and
+ * "make bench-baseline" drive this.
+ *
+ * Passing --perf-counters (or setting GVS_BENCH_PERF_COUNTERS) also counts
+ * CPU cycles, instructions, cache misses and branch misses over each phase,
+ * reported per entity and per property, where the kernel allows it.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <gvs/gvs.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_ITERATIONS 7
+
+/* Picks the full size of a graph under -m=perf, a small one otherwise */
+#define BENCH_SIZE(perf, quick) (g_test_perf() ? (perf) : (quick))
+
+/*****
+ *
+ * Allocation counting
+ *
+ *****/
+
+/*
+ * With glibc the allocator entry points are interposed by the benchmark
+ * executable itself, which catches allocations made by GLib, GObject and
+ * GVS alike. Elsewhere allocations are simply not reported.
+ */
+#if defined(__GLIBC__) && !defined(BENCH_NO_ALLOCATION_COUNT)
+
+#define BENCH_HAVE_ALLOCATION_COUNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n_members, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void  __libc_free(void *ptr);
+
+static gsize bench_n_allocations;
+
+void *
+malloc(size_t size)
+{
+    __sync_fetch_and_add(&bench_n_allocations, 1);
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t n_members, size_t size)
+{
+    __sync_fetch_and_add(&bench_n_allocations, 1);
+    return __libc_calloc(n_members, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    __sync_fetch_and_add(&bench_n_allocations, 1);
+    return __libc_realloc(ptr, size);
+}
+
+void
+free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+static gsize
+bench_get_allocations(void)
+{
+    return __sync_fetch_and_add(&bench_n_allocations, 0);
+}
+
+#else
+
+static gsize
+bench_get_allocations(void)
+{
+    return 0;
+}
+
+#endif
+
+/*****
+ *
+ * Peak RSS
+ *
+ *****/
+
+/*
+ * On Linux the peak RSS of the process can be reset by writing 5 to
+ * /proc/self/clear_refs, which lets each iteration be measured on its own.
+ * Where that is not possible (elsewhere, or on kernels which refuse it) the
+ * peak would cover the whole process, so none is reported and the baseline
+ * check leaves it out.
+ */
+static gboolean bench_peak_rss_reset = FALSE;
+
+static void
+bench_reset_peak_rss(void)
+{
+#ifdef __linux__
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+
+    bench_peak_rss_reset = fd >= 0 && write(fd, "5", 1) == 1;
+
+    if (fd >= 0)
+        close(fd);
+#endif
+
+    if (!bench_peak_rss_reset)
+    {
+        static gboolean warned = FALSE;
+
+        if (!warned)
+            g_test_message("Cannot reset the peak RSS, not measuring it");
+        warned = TRUE;
+    }
+}
+
+/* Returns the peak RSS since the last reset in kilobytes, or 0 if unknown */
+static gsize
+bench_get_peak_rss(void)
+{
+    char *status = NULL;
+    char *line;
+    gsize peak = 0;
+
+    if (!bench_peak_rss_reset ||
+        !g_file_get_contents("/proc/self/status", &status, NULL, NULL))
+        return 0;
+
+    line = strstr(status, "VmHWM:");
+    if (line)
+        peak = g_ascii_strtoull(line + strlen("VmHWM:"), NULL, 10);
+
+    g_free(status);
+
+    return peak;
+}
+
+/*****
+ *
+ * Hardware performance counters
+ *
+ *****/
+
+typedef enum
+{
+    BENCH_CYCLES,
+    BENCH_INSTRUCTIONS,
+    BENCH_CACHE_MISSES,
+    BENCH_BRANCH_MISSES,
+    BENCH_N_COUNTERS
+} BenchCounter;
+
+static const char * const bench_counter_names[BENCH_N_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "cache misses",
+    "branch misses"
+};
+
+/* -1 for counters which are disabled or could not be opened */
+static int bench_counter_fds[BENCH_N_COUNTERS] = { -1, -1, -1, -1 };
+
+#ifdef __linux__
+
+static int
+bench_counter_open(BenchCounter counter)
+{
+    static const guint64 configs[BENCH_N_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void
+bench_counters_start(void)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+    {
+        if (bench_counter_fds[i] < 0)
+            continue;
+
+        ioctl(bench_counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(bench_counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/*
+ * Stores each counter's value since bench_counters_start() in @values, or -1
+ * for counters which aren't available. Values are scaled up if the kernel had
+ * to multiplex the counters.
+ */
+static void
+bench_counters_stop(double values[BENCH_N_COUNTERS])
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+    {
+        guint64 data[3];    /* value, time enabled, time running */
+
+        values[i] = -1;
+
+        if (bench_counter_fds[i] < 0)
+            continue;
+
+        ioctl(bench_counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(bench_counter_fds[i], data, sizeof(data)) != sizeof(data) ||
+            data[2] == 0)
+            continue;
+
+        values[i] = (double) data[0] * data[1] / data[2];
+    }
+}
+
+#else
+
+static int
+bench_counter_open(BenchCounter counter)
+{
+    return -1;
+}
+
+static void
+bench_counters_start(void)
+{
+}
+
+static void
+bench_counters_stop(double values[BENCH_N_COUNTERS])
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+        values[i] = -1;
+}
+
+#endif
+
+/*
+ * Opens whichever counters the kernel and hardware allow (perf_event_paranoid,
+ * containers and virtual machines often forbid some or all of them), and
+ * says which are missing.
+ */
+static void
+bench_counters_open(void)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+    {
+        bench_counter_fds[i] = bench_counter_open(i);
+
+        if (bench_counter_fds[i] < 0)
+            g_printerr("perf counter for %s unavailable, not reporting it\n",
+                       bench_counter_names[i]);
+    }
+}
+
+static gboolean
+bench_counters_enabled(void)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+    {
+        if (bench_counter_fds[i] >= 0)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*****
+ *
+ * Results
+ *
+ *****/
+
+/* Every metric is one where lower is better */
+typedef enum
+{
+    BENCH_SERIALIZE_TIME,
+    BENCH_DESERIALIZE_TIME,
+    BENCH_SERIALIZE_ALLOCATIONS,
+    BENCH_DESERIALIZE_ALLOCATIONS,
+    BENCH_PEAK_RSS,
+    BENCH_N_METRICS
+} BenchMetric;
+
+/*
+ * The key each metric is saved under in the baseline, and how far its median
+ * may rise above the baseline before it counts as a regression even when both
+ * runs were completely steady: the larger of a fraction of the baseline and
+ * an absolute amount (seconds, allocations or kilobytes).
+ */
+static const struct
+{
+    const char *key;
+    double tolerance;
+    double slack;
+} bench_metrics[BENCH_N_METRICS] = {
+    { "serialize-time", 0.05, 0.001 },
+    { "deserialize-time", 0.05, 0.001 },
+    { "serialize-allocations", 0.01, 0 },
+    { "deserialize-allocations", 0.01, 0 },
+    { "peak-rss", 0.10, 1024 }
+};
+
+/*
+ * How many (normal-consistent) MADs the median may rise by before it counts
+ * as a regression
+ */
+#define BENCH_MAD_THRESHOLD 3.0
+#define BENCH_MAD_SCALE 1.4826
+
+typedef enum
+{
+    BENCH_SERIALIZE,
+    BENCH_DESERIALIZE,
+    BENCH_N_PHASES
+} BenchPhase;
+
+typedef struct
+{
+    gsize size;
+    guint n_samples[BENCH_N_METRICS];
+    double samples[BENCH_N_METRICS][BENCH_ITERATIONS];
+    double median[BENCH_N_METRICS];
+    double mad[BENCH_N_METRICS];
+
+    /* Hardware counters, if enabled; never compared against a baseline */
+    guint n_counter_samples[BENCH_N_PHASES];
+    double counter_samples[BENCH_N_PHASES][BENCH_N_COUNTERS][BENCH_ITERATIONS];
+    double counters[BENCH_N_PHASES][BENCH_N_COUNTERS];
+} BenchResult;
+
+static void
+bench_result_add(BenchResult *result,
+                 BenchMetric metric,
+                 double value)
+{
+    g_assert_cmpuint(result->n_samples[metric], <, BENCH_ITERATIONS);
+
+    result->samples[metric][result->n_samples[metric]++] = value;
+}
+
+static void
+bench_result_add_counters(BenchResult *result,
+                          BenchPhase phase,
+                          const double values[BENCH_N_COUNTERS])
+{
+    const guint sample = result->n_counter_samples[phase]++;
+    guint i;
+
+    g_assert_cmpuint(sample, <, BENCH_ITERATIONS);
+
+    for (i = 0; i < BENCH_N_COUNTERS; i++)
+        result->counter_samples[phase][i][sample] = values[i];
+}
+
+static int
+bench_compare_doubles(const void *a,
+                      const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double
+bench_median(double *values,
+             guint n_values)
+{
+    qsort(values, n_values, sizeof(double), bench_compare_doubles);
+
+    if (n_values % 2)
+        return values[n_values / 2];
+
+    return (values[n_values / 2 - 1] + values[n_values / 2]) / 2;
+}
+
+/* Works out the median and median absolute deviation of each metric */
+static void
+bench_result_summarize(BenchResult *result)
+{
+    guint metric, phase, counter;
+
+    for (phase = 0; phase < BENCH_N_PHASES; phase++)
+    {
+        for (counter = 0; counter < BENCH_N_COUNTERS; counter++)
+        {
+            double values[BENCH_ITERATIONS];
+            const guint n_values = result->n_counter_samples[phase];
+
+            result->counters[phase][counter] = -1;
+
+            if (n_values == 0)
+                continue;
+
+            memcpy(values, result->counter_samples[phase][counter],
+                   n_values * sizeof(double));
+            result->counters[phase][counter] = bench_median(values, n_values);
+        }
+    }
+
+    for (metric = 0; metric < BENCH_N_METRICS; metric++)
+    {
+        double values[BENCH_ITERATIONS];
+        const guint n_values = result->n_samples[metric];
+        guint i;
+
+        if (n_values == 0)
+            continue;
+
+        memcpy(values, result->samples[metric], n_values * sizeof(double));
+        result->median[metric] = bench_median(values, n_values);
+
+        for (i = 0; i < n_values; i++)
+            values[i] = ABS(result->samples[metric][i] - result->median[metric]);
+
+        result->mad[metric] = bench_median(values, n_values) * BENCH_MAD_SCALE;
+    }
+}
+
+static void
+bench_report_counters(const char *name,
+                      guint n_entities,
+                      guint n_properties,
+                      const BenchResult *result)
+{
+    static const char * const phase_names[BENCH_N_PHASES] = {
+        "serialize", "deserialize"
+    };
+    guint phase, counter;
+
+    for (phase = 0; phase < BENCH_N_PHASES; phase++)
+    {
+        for (counter = 0; counter < BENCH_N_COUNTERS; counter++)
+        {
+            const double value = result->counters[phase][counter];
+
+            if (value < 0)
+                continue;
+
+            g_test_minimized_result(value / n_entities,
+                                    "%s: %s %.1f %s per entity, %.1f per property",
+                                    name, phase_names[phase],
+                                    value / n_entities,
+                                    bench_counter_names[counter],
+                                    n_properties ? value / n_properties : 0.0);
+        }
+    }
+}
+
+/*
+ * bench_report:
+ * @name: The name of the benchmark, used as a prefix for each result
+ * @n_entities: The number of entities in the benchmarked graph
+ * @n_properties: The number of properties over all those entities
+ * @result: A summarized result
+ */
+static void
+bench_report(const char *name,
+             guint n_entities,
+             guint n_properties,
+             const BenchResult *result)
+{
+    const double megabytes = result->size / (1024.0 * 1024.0);
+    const double serialize_time = result->median[BENCH_SERIALIZE_TIME];
+    const double deserialize_time = result->median[BENCH_DESERIALIZE_TIME];
+
+    g_test_maximized_result(n_entities / serialize_time,
+                            "%s: serialize %.0f entities/s, %.1f MB/s",
+                            name,
+                            n_entities / serialize_time,
+                            megabytes / serialize_time);
+    g_test_maximized_result(n_entities / deserialize_time,
+                            "%s: deserialize %.0f entities/s, %.1f MB/s",
+                            name,
+                            n_entities / deserialize_time,
+                            megabytes / deserialize_time);
+    g_test_minimized_result((double) result->size / n_entities,
+                            "%s: %.1f bytes per entity (%" G_GSIZE_FORMAT " bytes)",
+                            name,
+                            (double) result->size / n_entities,
+                            result->size);
+
+#ifdef BENCH_HAVE_ALLOCATION_COUNT
+    g_test_minimized_result(result->median[BENCH_SERIALIZE_ALLOCATIONS] / n_entities,
+                            "%s: serialize %.2f allocations per entity",
+                            name,
+                            result->median[BENCH_SERIALIZE_ALLOCATIONS] / n_entities);
+    g_test_minimized_result(result->median[BENCH_DESERIALIZE_ALLOCATIONS] / n_entities,
+                            "%s: deserialize %.2f allocations per entity",
+                            name,
+                            result->median[BENCH_DESERIALIZE_ALLOCATIONS] / n_entities);
+#endif
+
+    if (result->median[BENCH_PEAK_RSS] > 0)
+        g_test_minimized_result(result->median[BENCH_PEAK_RSS],
+                                "%s: peak RSS %.0f kB",
+                                name,
+                                result->median[BENCH_PEAK_RSS]);
+
+    bench_report_counters(name, n_entities, n_properties, result);
+}
+
+/*****
+ *
+ * Baselines
+ *
+ *****/
+
+static char *
+bench_baseline_key(BenchMetric metric,
+                   const char *suffix)
+{
+    return g_strconcat(bench_metrics[metric].key, "-", suffix, NULL);
+}
+
+static void
+bench_baseline_record(GKeyFile *baseline,
+                      const char *name,
+                      const BenchResult *result)
+{
+    guint metric;
+
+    for (metric = 0; metric < BENCH_N_METRICS; metric++)
+    {
+        char *median_key = bench_baseline_key(metric, "median");
+        char *mad_key = bench_baseline_key(metric, "mad");
+
+        g_key_file_set_double(baseline, name, median_key, result->median[metric]);
+        g_key_file_set_double(baseline, name, mad_key, result->mad[metric]);
+
+        g_free(mad_key);
+        g_free(median_key);
+    }
+}
+
+static void
+bench_baseline_compare(GKeyFile *baseline,
+                       const char *name,
+                       const BenchResult *result)
+{
+    guint metric;
+
+    for (metric = 0; metric < BENCH_N_METRICS; metric++)
+    {
+        char *median_key = bench_baseline_key(metric, "median");
+        char *mad_key = bench_baseline_key(metric, "mad");
+        double base_median, base_mad, noise, tolerance, limit;
+
+        base_median = g_key_file_get_double(baseline, name, median_key, NULL);
+        base_mad = g_key_file_get_double(baseline, name, mad_key, NULL);
+
+        g_free(mad_key);
+        g_free(median_key);
+
+        /* Not measured on one side or the other */
+        if (base_median <= 0 || result->median[metric] <= 0)
+            continue;
+
+        noise = BENCH_MAD_THRESHOLD * MAX(base_mad, result->mad[metric]);
+        tolerance = MAX(bench_metrics[metric].tolerance * base_median,
+                        bench_metrics[metric].slack);
+        limit = base_median + MAX(noise, tolerance);
+
+        if (result->median[metric] > limit)
+        {
+            g_test_message("%s: %s regressed from %g to %g (limit %g)",
+                           name, bench_metrics[metric].key,
+                           base_median, result->median[metric], limit);
+            g_test_fail();
+        }
+    }
+}
+
+/*
+ * bench_check_baseline:
+ *
+ * Compares @result against the baseline saved in $GVS_BENCH_BASELINE, or
+ * records it there if there is none yet. Only full-size runs are checked.
+ */
+static void
+bench_check_baseline(const char *name,
+                     const BenchResult *result)
+{
+    const char *path = g_getenv("GVS_BENCH_BASELINE");
+    GKeyFile *baseline = NULL;
+    GError *error = NULL;
+
+    if (!path || !g_test_perf())
+        return;
+
+    baseline = g_key_file_new();
+
+    if (!g_key_file_load_from_file(baseline, path, G_KEY_FILE_KEEP_COMMENTS, &error))
+    {
+        g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+        g_clear_error(&error);
+    }
+
+    if (g_key_file_has_group(baseline, name) && !g_getenv("GVS_BENCH_UPDATE"))
+    {
+        bench_baseline_compare(baseline, name, result);
+    }
+    else
+    {
+        bench_baseline_record(baseline, name, result);
+        g_key_file_save_to_file(baseline, path, &error);
+        g_assert_no_error(error);
+        g_test_message("%s: recorded baseline in %s", name, path);
+    }
+
+    g_key_file_free(baseline);
+}
+
+/*****
+ *
+ * Running a benchmark
+ *
+ *****/
+
+/*
+ * bench_init:
+ *
+ * Call before g_test_init(). Makes GSlice hand out memory with malloc(),
+ * so that slice allocations are counted along with everything else, and
+ * removes --perf-counters from the command line, opening the counters if
+ * it was given.
+ */
+static void
+bench_init(int *argc,
+           char ***argv)
+{
+    gboolean use_counters = g_getenv("GVS_BENCH_PERF_COUNTERS") != NULL;
+    int i, j;
+
+    g_setenv("G_SLICE", "always-malloc", TRUE);
+
+    for (i = j = 1; i < *argc; i++)
+    {
+        if (g_strcmp0((*argv)[i], "--perf-counters") == 0)
+            use_counters = TRUE;
+        else
+            (*argv)[j++] = (*argv)[i];
+    }
+
+    (*argv)[j] = NULL;
+    *argc = j;
+
+    if (use_counters)
+        bench_counters_open();
+}
+
+/*
+ * bench_finish:
+ * @name: The name of the benchmark
+ * @n_entities: The number of entities in the benchmarked graph
+ * @n_properties: The number of properties over all those entities
+ * @result: The samples collected over all iterations
+ *
+ * Summarizes, reports and checks @result.
+ */
+static void
+bench_finish(const char *name,
+             guint n_entities,
+             guint n_properties,
+             BenchResult *result)
+{
+    bench_result_summarize(result);
+    bench_report(name, n_entities, n_properties, result);
+    bench_check_baseline(name, result);
+}
+
+/*
+ * bench_run:
+ * @name: The name of the benchmark
+ * @root: The root of the graph to serialize
+ * @n_entities: The number of entities reachable from @root
+ * @n_properties: The number of properties over all those entities
+ * @flags: Flags for the serializer
+ * @check: (allow-none): Called with each deserialized root, to check that the
+ *  graph survived the round trip
+ *
+ * Serialization is timed up to and including flattening the document into
+ * its serialized form; deserialization starts from those bytes, and stops
+ * once the new graph has been constructed. Dropping the graph again is not
+ * included. Hardware counters cover the same two phases.
+ */
+static void
+bench_run(const char *name,
+          GObject *root,
+          guint n_entities,
+          guint n_properties,
+          GvsSerializerFlags flags,
+          void (*check)(GObject *created))
+{
+    const guint n_iterations = g_test_perf() ? BENCH_ITERATIONS : 1;
+    BenchResult result = { 0, };
+    guint i;
+
+    for (i = 0; i < n_iterations; i++)
+    {
+        GvsSerializer *serializer = NULL;
+        GvsDeserializer *deserializer = NULL;
+        GVariantType *type = NULL;
+        GVariant *variant = NULL;
+        GBytes *bytes = NULL;
+        GObject *created = NULL;
+        double counters[BENCH_N_COUNTERS];
+        gsize allocations;
+
+        bench_reset_peak_rss();
+
+        allocations = bench_get_allocations();
+        bench_counters_start();
+        g_test_timer_start();
+
+        serializer = gvs_serializer_new();
+        gvs_serializer_set_flags(serializer, flags);
+        variant = gvs_serializer_serialize_object(serializer, root);
+        bytes = g_variant_get_data_as_bytes(variant);
+        g_object_unref(serializer);
+
+        bench_result_add(&result, BENCH_SERIALIZE_TIME, g_test_timer_elapsed());
+        bench_counters_stop(counters);
+        bench_result_add(&result, BENCH_SERIALIZE_ALLOCATIONS,
+                         bench_get_allocations() - allocations);
+        result.size = g_bytes_get_size(bytes);
+
+        if (bench_counters_enabled())
+            bench_result_add_counters(&result, BENCH_SERIALIZE, counters);
+
+        type = g_variant_type_copy(g_variant_get_type(variant));
+        g_variant_unref(variant);
+
+        allocations = bench_get_allocations();
+        bench_counters_start();
+        g_test_timer_start();
+
+        variant = g_variant_new_from_bytes(type, bytes, FALSE);
+        deserializer = gvs_deserializer_new();
+        created = gvs_deserializer_deserialize(deserializer, variant);
+        g_object_unref(deserializer);
+
+        bench_result_add(&result, BENCH_DESERIALIZE_TIME, g_test_timer_elapsed());
+        bench_counters_stop(counters);
+        bench_result_add(&result, BENCH_DESERIALIZE_ALLOCATIONS,
+                         bench_get_allocations() - allocations);
+        bench_result_add(&result, BENCH_PEAK_RSS, bench_get_peak_rss());
+
+        if (bench_counters_enabled())
+            bench_result_add_counters(&result, BENCH_DESERIALIZE, counters);
+
+        g_assert(created);
+        g_assert(G_OBJECT_TYPE(created) == G_OBJECT_TYPE(root));
+
+        if (check)
+            check(created);
+
+        g_object_unref(created);
+        g_variant_unref(variant);
+        g_variant_type_free(type);
+        g_bytes_unref(bytes);
+    }
+
+    bench_finish(name, n_entities, n_properties, &result);
+}
+
+#endif /* BENCH_COMMON_H */
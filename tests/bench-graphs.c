@@ -0,0 +1,812 @@
+/*
+ * Benchmarks [de]serialization of synthetic object graphs: wide flat objects,
+ * deep chains, cyclic structures and many small objects
+ *
+ * Run with -m=perf (or "make perf-report") for full-size graphs. When built
+ * against json-glib, the same wide objects and chains are also run through
+ * json_gobject_to_data() and json_gobject_from_data() for comparison.
+ */
+
+#include "bench-common.h"
+
+#ifdef HAVE_JSON_GLIB
+#include <json-glib/json-glib.h>
+#endif
+
+/* BenchNode object, for chains and cycles */
+
+#define BENCH_TYPE_NODE           (bench_node_get_type())
+#define BENCH_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), BENCH_TYPE_NODE, BenchNode))
+#define BENCH_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BENCH_TYPE_NODE))
+
+typedef struct _BenchNode      BenchNode;
+typedef struct _BenchNodeClass BenchNodeClass;
+
+struct _BenchNode
+{
+    GObject parent;
+
+    BenchNode *next;    /* owned */
+    BenchNode *other;   /* not owned, may point back along the chain */
+    int id;
+    double weight;
+    char *label;
+};
+
+struct _BenchNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(BenchNode, bench_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NEXT,
+    PROP_OTHER,
+    PROP_ID,
+    PROP_WEIGHT,
+    PROP_LABEL,
+    PROP_ITEMS
+};
+
+#define BENCH_NODE_N_PROPERTIES (PROP_LABEL - PROP_0)
+
+static void
+bench_node_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    BenchNode *self = BENCH_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        case PROP_OTHER:
+            self->other = g_value_get_object(value);
+            break;
+
+        case PROP_ID:
+            self->id = g_value_get_int(value);
+            break;
+
+        case PROP_WEIGHT:
+            self->weight = g_value_get_double(value);
+            break;
+
+        case PROP_LABEL:
+            g_free(self->label);
+            self->label = g_value_dup_string(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_node_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    BenchNode *self = BENCH_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_value_set_object(value, self->next);
+            break;
+
+        case PROP_OTHER:
+            g_value_set_object(value, self->other);
+            break;
+
+        case PROP_ID:
+            g_value_set_int(value, self->id);
+            break;
+
+        case PROP_WEIGHT:
+            g_value_set_double(value, self->weight);
+            break;
+
+        case PROP_LABEL:
+            g_value_set_string(value, self->label);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_node_dispose(GObject *obj)
+{
+    BenchNode *next = BENCH_NODE(obj)->next;
+
+    BENCH_NODE(obj)->next = NULL;
+
+    /* Unlink the rest of the chain here rather than recursing through it */
+    while (next && G_OBJECT(next)->ref_count == 1)
+    {
+        BenchNode *after = next->next;
+
+        next->next = NULL;
+        g_object_unref(next);
+        next = after;
+    }
+
+    if (next)
+        g_object_unref(next);
+
+    G_OBJECT_CLASS(bench_node_parent_class)->dispose(obj);
+}
+
+static void
+bench_node_finalize(GObject *obj)
+{
+    g_free(BENCH_NODE(obj)->label);
+
+    G_OBJECT_CLASS(bench_node_parent_class)->finalize(obj);
+}
+
+static void
+bench_node_class_init(BenchNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = bench_node_set_property;
+    gobject_class->get_property = bench_node_get_property;
+    gobject_class->dispose = bench_node_dispose;
+    gobject_class->finalize = bench_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NEXT,
+            g_param_spec_object("next", "next", "next", BENCH_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_OTHER,
+            g_param_spec_object("other", "other", "other", BENCH_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_ID,
+            g_param_spec_int("id", "id", "id", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_WEIGHT,
+            g_param_spec_double("weight", "weight", "weight",
+                                -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_LABEL,
+            g_param_spec_string("label", "label", "label", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+bench_node_init(BenchNode *self)
+{
+}
+
+/* BenchWide object, with many plain properties */
+
+#define BENCH_TYPE_WIDE           (bench_wide_get_type())
+#define BENCH_WIDE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), BENCH_TYPE_WIDE, BenchWide))
+
+#define BENCH_WIDE_N_FIELDS 32
+
+typedef struct _BenchWide      BenchWide;
+typedef struct _BenchWideClass BenchWideClass;
+
+struct _BenchWide
+{
+    GObject parent;
+
+    GValue fields[BENCH_WIDE_N_FIELDS];
+};
+
+struct _BenchWideClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(BenchWide, bench_wide, G_TYPE_OBJECT);
+
+static GType
+bench_wide_field_type(guint field)
+{
+    static const GType types[] = {
+        G_TYPE_INT, G_TYPE_DOUBLE, G_TYPE_STRING, G_TYPE_BOOLEAN
+    };
+
+    return types[field % G_N_ELEMENTS(types)];
+}
+
+static void
+bench_wide_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    if (prop_id == 0 || prop_id > BENCH_WIDE_N_FIELDS)
+    {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        return;
+    }
+
+    g_value_copy(value, &BENCH_WIDE(obj)->fields[prop_id - 1]);
+}
+
+static void
+bench_wide_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    if (prop_id == 0 || prop_id > BENCH_WIDE_N_FIELDS)
+    {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        return;
+    }
+
+    g_value_copy(&BENCH_WIDE(obj)->fields[prop_id - 1], value);
+}
+
+static void
+bench_wide_finalize(GObject *obj)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_WIDE_N_FIELDS; i++)
+        g_value_unset(&BENCH_WIDE(obj)->fields[i]);
+
+    G_OBJECT_CLASS(bench_wide_parent_class)->finalize(obj);
+}
+
+static void
+bench_wide_class_init(BenchWideClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    guint i;
+
+    gobject_class->set_property = bench_wide_set_property;
+    gobject_class->get_property = bench_wide_get_property;
+    gobject_class->finalize = bench_wide_finalize;
+
+    for (i = 0; i < BENCH_WIDE_N_FIELDS; i++)
+    {
+        char *name = g_strdup_printf("field-%u", i);
+        GParamSpec *pspec = NULL;
+
+        switch (bench_wide_field_type(i))
+        {
+            case G_TYPE_INT:
+                pspec = g_param_spec_int(name, NULL, NULL, G_MININT, G_MAXINT, 0,
+                                         G_PARAM_READWRITE);
+                break;
+
+            case G_TYPE_DOUBLE:
+                pspec = g_param_spec_double(name, NULL, NULL,
+                                            -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                            G_PARAM_READWRITE);
+                break;
+
+            case G_TYPE_STRING:
+                pspec = g_param_spec_string(name, NULL, NULL, NULL,
+                                            G_PARAM_READWRITE);
+                break;
+
+            default:
+                pspec = g_param_spec_boolean(name, NULL, NULL, FALSE,
+                                             G_PARAM_READWRITE);
+                break;
+        }
+
+        g_object_class_install_property(gobject_class, i + 1, pspec);
+        g_free(name);
+    }
+}
+
+static void
+bench_wide_init(BenchWide *self)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_WIDE_N_FIELDS; i++)
+        g_value_init(&self->fields[i], bench_wide_field_type(i));
+}
+
+/* BenchLeaf object, as small as an object gets */
+
+#define BENCH_TYPE_LEAF           (bench_leaf_get_type())
+#define BENCH_LEAF(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), BENCH_TYPE_LEAF, BenchLeaf))
+
+typedef struct _BenchLeaf      BenchLeaf;
+typedef struct _BenchLeafClass BenchLeafClass;
+
+struct _BenchLeaf
+{
+    GObject parent;
+
+    int id;
+};
+
+struct _BenchLeafClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(BenchLeaf, bench_leaf, G_TYPE_OBJECT);
+
+static void
+bench_leaf_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_ID:
+            BENCH_LEAF(obj)->id = g_value_get_int(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_leaf_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_ID:
+            g_value_set_int(value, BENCH_LEAF(obj)->id);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_leaf_class_init(BenchLeafClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = bench_leaf_set_property;
+    gobject_class->get_property = bench_leaf_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_ID,
+            g_param_spec_int("id", "id", "id", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+bench_leaf_init(BenchLeaf *self)
+{
+}
+
+/* BenchBag object, holding an array of other objects */
+
+#define BENCH_TYPE_BAG            (bench_bag_get_type())
+#define BENCH_BAG(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), BENCH_TYPE_BAG, BenchBag))
+
+typedef struct _BenchBag      BenchBag;
+typedef struct _BenchBagClass BenchBagClass;
+
+struct _BenchBag
+{
+    GObject parent;
+
+    GPtrArray *items;
+};
+
+struct _BenchBagClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(BenchBag, bench_bag, G_TYPE_OBJECT);
+
+static void
+bench_bag_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    BenchBag *self = BENCH_BAG(obj);
+
+    switch (prop_id)
+    {
+        case PROP_ITEMS:
+            g_clear_pointer(&self->items, g_ptr_array_unref);
+            self->items = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_bag_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_ITEMS:
+            g_value_set_boxed(value, BENCH_BAG(obj)->items);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+bench_bag_dispose(GObject *obj)
+{
+    g_clear_pointer(&BENCH_BAG(obj)->items, g_ptr_array_unref);
+
+    G_OBJECT_CLASS(bench_bag_parent_class)->dispose(obj);
+}
+
+static void
+bench_bag_class_init(BenchBagClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = bench_bag_set_property;
+    gobject_class->get_property = bench_bag_get_property;
+    gobject_class->dispose = bench_bag_dispose;
+
+    pspec = g_param_spec_boxed("items", "items", "items", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_ITEMS, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_OBJECT);
+}
+
+static void
+bench_bag_init(BenchBag *self)
+{
+}
+
+/* Graph builders */
+
+static BenchNode *
+make_chain(guint length)
+{
+    BenchNode *head = NULL;
+    guint i;
+
+    /* Built back to front, so each node can take ownership of the next */
+    for (i = length; i > 0; i--)
+    {
+        char *label = g_strdup_printf("node %u", i - 1);
+        BenchNode *node = g_object_new(BENCH_TYPE_NODE,
+                                       "next", head,
+                                       "id", i - 1,
+                                       "weight", (i - 1) * 0.25,
+                                       "label", label,
+                                       NULL);
+
+        g_clear_object(&head);
+        head = node;
+        g_free(label);
+    }
+
+    return head;
+}
+
+/* Points each node's "other" at its predecessor, and the head at the tail */
+static void
+make_cycles(BenchNode *head)
+{
+    BenchNode *node = head;
+
+    while (node->next)
+    {
+        node->next->other = node;
+        node = node->next;
+    }
+
+    head->other = node;
+}
+
+static BenchBag *
+make_bag(GObject *(*make_item)(guint index),
+         guint n_items)
+{
+    BenchBag *bag = g_object_new(BENCH_TYPE_BAG, NULL);
+    guint i;
+
+    bag->items = g_ptr_array_new_full(n_items, g_object_unref);
+
+    for (i = 0; i < n_items; i++)
+        g_ptr_array_add(bag->items, make_item(i));
+
+    return bag;
+}
+
+static GObject *
+make_wide(guint index)
+{
+    BenchWide *wide = g_object_new(BENCH_TYPE_WIDE, NULL);
+    guint i;
+
+    for (i = 0; i < BENCH_WIDE_N_FIELDS; i++)
+    {
+        GValue *field = &wide->fields[i];
+
+        switch (bench_wide_field_type(i))
+        {
+            case G_TYPE_INT:
+                g_value_set_int(field, index * i);
+                break;
+
+            case G_TYPE_DOUBLE:
+                g_value_set_double(field, index / (i + 1.0));
+                break;
+
+            case G_TYPE_STRING:
+                g_value_take_string(field, g_strdup_printf("wide %u.%u", index, i));
+                break;
+
+            default:
+                g_value_set_boolean(field, (index + i) % 2);
+                break;
+        }
+    }
+
+    return G_OBJECT(wide);
+}
+
+static GObject *
+make_leaf(guint index)
+{
+    return g_object_new(BENCH_TYPE_LEAF, "id", index, NULL);
+}
+
+/* Checks */
+
+static guint
+chain_length(BenchNode *head)
+{
+    guint length = 0;
+
+    for (; head; head = head->next)
+    {
+        g_assert_cmpint(head->id, ==, length);
+        length++;
+    }
+
+    return length;
+}
+
+static guint expected_length;
+
+static void
+check_chain(GObject *created)
+{
+    g_assert_cmpuint(chain_length(BENCH_NODE(created)), ==, expected_length);
+}
+
+static void
+check_cycles(GObject *created)
+{
+    BenchNode *head = BENCH_NODE(created);
+
+    check_chain(created);
+
+    g_assert(head->other);
+    g_assert_cmpint(head->other->id, ==, expected_length - 1);
+    g_assert(head->next->other == head);
+}
+
+static void
+check_bag(GObject *created)
+{
+    g_assert_cmpuint(BENCH_BAG(created)->items->len, ==, expected_length);
+}
+
+/* Benchmarks */
+
+static void
+bench_wide(gconstpointer data)
+{
+    const guint n_items = BENCH_SIZE(2000, 100);
+    BenchBag *bag = make_bag(make_wide, n_items);
+
+    expected_length = n_items;
+    bench_run(g_test_get_path(), G_OBJECT(bag), n_items + 1,
+              n_items * BENCH_WIDE_N_FIELDS + 1,
+              GPOINTER_TO_UINT(data), check_bag);
+
+    g_object_unref(bag);
+}
+
+static void
+bench_chain(void)
+{
+    const guint length = BENCH_SIZE(20000, 1000);
+    BenchNode *head = make_chain(length);
+
+    expected_length = length;
+    bench_run(g_test_get_path(), G_OBJECT(head), length,
+              length * BENCH_NODE_N_PROPERTIES,
+              GVS_SERIALIZER_FLAGS_NONE, check_chain);
+
+    g_object_unref(head);
+}
+
+static void
+bench_cycles(void)
+{
+    const guint length = BENCH_SIZE(20000, 1000);
+    BenchNode *head = make_chain(length);
+
+    make_cycles(head);
+
+    expected_length = length;
+    bench_run(g_test_get_path(), G_OBJECT(head), length,
+              length * BENCH_NODE_N_PROPERTIES,
+              GVS_SERIALIZER_FLAGS_NONE, check_cycles);
+
+    g_object_unref(head);
+}
+
+static void
+bench_small(gconstpointer data)
+{
+    const guint n_items = BENCH_SIZE(50000, 1000);
+    BenchBag *bag = make_bag(make_leaf, n_items);
+
+    expected_length = n_items;
+    bench_run(g_test_get_path(), G_OBJECT(bag), n_items + 1, n_items + 1,
+              GPOINTER_TO_UINT(data), check_bag);
+
+    g_object_unref(bag);
+}
+
+#ifdef HAVE_JSON_GLIB
+
+/*
+ * json-glib serializes object properties by nesting them, so it can handle
+ * neither cycles nor containers; the wide objects are written one document
+ * per object instead.
+ */
+static void
+bench_json_run(const char *name,
+               GObject **objects,
+               guint n_objects,
+               guint n_entities,
+               guint n_properties)
+{
+    const guint n_iterations = g_test_perf() ? BENCH_ITERATIONS : 1;
+    char **documents = g_new0(char *, n_objects);
+    gsize *lengths = g_new0(gsize, n_objects);
+    GObject **created = g_new0(GObject *, n_objects);
+    BenchResult result = { 0, };
+    guint i, j;
+
+    for (i = 0; i < n_iterations; i++)
+    {
+        double counters[BENCH_N_COUNTERS];
+        gsize allocations;
+
+        bench_reset_peak_rss();
+
+        allocations = bench_get_allocations();
+        bench_counters_start();
+        g_test_timer_start();
+
+        result.size = 0;
+        for (j = 0; j < n_objects; j++)
+        {
+            documents[j] = json_gobject_to_data(objects[j], &lengths[j]);
+            result.size += lengths[j];
+        }
+
+        bench_result_add(&result, BENCH_SERIALIZE_TIME, g_test_timer_elapsed());
+        bench_counters_stop(counters);
+        bench_result_add(&result, BENCH_SERIALIZE_ALLOCATIONS,
+                         bench_get_allocations() - allocations);
+
+        if (bench_counters_enabled())
+            bench_result_add_counters(&result, BENCH_SERIALIZE, counters);
+
+        allocations = bench_get_allocations();
+        bench_counters_start();
+        g_test_timer_start();
+
+        for (j = 0; j < n_objects; j++)
+        {
+            GError *error = NULL;
+
+            created[j] = json_gobject_from_data(G_OBJECT_TYPE(objects[j]),
+                                                documents[j], lengths[j],
+                                                &error);
+            g_assert_no_error(error);
+        }
+
+        bench_result_add(&result, BENCH_DESERIALIZE_TIME, g_test_timer_elapsed());
+        bench_counters_stop(counters);
+        bench_result_add(&result, BENCH_DESERIALIZE_ALLOCATIONS,
+                         bench_get_allocations() - allocations);
+        bench_result_add(&result, BENCH_PEAK_RSS, bench_get_peak_rss());
+
+        if (bench_counters_enabled())
+            bench_result_add_counters(&result, BENCH_DESERIALIZE, counters);
+
+        for (j = 0; j < n_objects; j++)
+        {
+            g_clear_object(&created[j]);
+            g_clear_pointer(&documents[j], g_free);
+        }
+    }
+
+    bench_finish(name, n_entities, n_properties, &result);
+
+    g_free(created);
+    g_free(lengths);
+    g_free(documents);
+}
+
+static void
+bench_json_wide(void)
+{
+    const guint n_items = BENCH_SIZE(2000, 100);
+    BenchBag *bag = make_bag(make_wide, n_items);
+
+    bench_json_run(g_test_get_path(), (GObject **) bag->items->pdata,
+                   n_items, n_items, n_items * BENCH_WIDE_N_FIELDS);
+
+    g_object_unref(bag);
+}
+
+/* Kept short, as json-glib recurses once per link */
+static void
+bench_json_chain(void)
+{
+    const guint length = BENCH_SIZE(1000, 100);
+    BenchNode *head = make_chain(length);
+
+    bench_json_run(g_test_get_path(), (GObject **) &head, 1, length,
+                   length * BENCH_NODE_N_PROPERTIES);
+
+    g_object_unref(head);
+}
+
+#endif /* HAVE_JSON_GLIB */
+
+int
+main(int argc, char *argv[])
+{
+   bench_init(&argc, &argv);
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_data_func("/Gvs/Bench/Graphs/Wide",
+                        GUINT_TO_POINTER(GVS_SERIALIZER_FLAGS_NONE), bench_wide);
+   g_test_add_data_func("/Gvs/Bench/Graphs/Wide/Columnar",
+                        GUINT_TO_POINTER(GVS_SERIALIZER_COLUMNAR |
+                                         GVS_SERIALIZER_COMPACT), bench_wide);
+   g_test_add_func("/Gvs/Bench/Graphs/Chain", bench_chain);
+   g_test_add_func("/Gvs/Bench/Graphs/Cycles", bench_cycles);
+   g_test_add_data_func("/Gvs/Bench/Graphs/Small",
+                        GUINT_TO_POINTER(GVS_SERIALIZER_FLAGS_NONE), bench_small);
+   g_test_add_data_func("/Gvs/Bench/Graphs/Small/Columnar",
+                        GUINT_TO_POINTER(GVS_SERIALIZER_COLUMNAR |
+                                         GVS_SERIALIZER_COMPACT), bench_small);
+#ifdef HAVE_JSON_GLIB
+   g_test_add_func("/Gvs/Bench/Graphs/Wide/Json", bench_json_wide);
+   g_test_add_func("/Gvs/Bench/Graphs/Chain/Json", bench_json_chain);
+#endif
+   return g_test_run();
+}
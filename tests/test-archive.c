@@ -0,0 +1,351 @@
+/*
+ * Tests archives written with gvs_archive_write() and read with GvsArchive
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+/* TestNode object, a named node in a chain */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    TestNode *next;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_NEXT
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_NEXT:
+            g_value_set_object(value, self->next);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->next);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_NEXT,
+            g_param_spec_object("next", "next", "next", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+#define N_NODES 100
+
+/* node-0 -> node-1 -> ... -> node-99 */
+static TestNode *
+make_chain(void)
+{
+    TestNode *next = NULL;
+    int i;
+
+    for (i = N_NODES - 1; i >= 0; i--)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+        TestNode *node = g_object_new(TEST_TYPE_NODE, "name", name, "next", next, NULL);
+
+        if (next)
+            g_object_unref(next);
+        next = node;
+        g_free(name);
+    }
+
+    return next;
+}
+
+static GBytes *
+write_archive(GvsSerializerFlags flags, const char *key_property)
+{
+    TestNode *chain = make_chain();
+    GvsSerializer *serializer = gvs_serializer_new();
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GVariant *document;
+    GError *error = NULL;
+    GBytes *bytes;
+
+    gvs_serializer_set_flags(serializer, flags);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(chain));
+
+    g_assert(gvs_archive_write(stream, document, key_property, NULL, &error));
+    g_assert_no_error(error);
+    g_assert(g_output_stream_close(stream, NULL, &error));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+
+    g_object_unref(stream);
+    g_variant_unref(document);
+    g_object_unref(serializer);
+    g_object_unref(chain);
+
+    return bytes;
+}
+
+/* Checks that @node is node-@first, followed by the rest of the chain */
+static void
+check_chain(TestNode *node, int first)
+{
+    int i;
+
+    for (i = first; i < N_NODES; i++)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+
+        g_assert(TEST_IS_NODE(node));
+        g_assert_cmpstr(node->name, ==, name);
+        g_free(name);
+        node = node->next;
+    }
+
+    g_assert(node == NULL);
+}
+
+static void
+check_lookup(GvsSerializerFlags flags)
+{
+    GBytes *bytes = write_archive(flags, "name");
+    GvsArchive *archive;
+    GvsStats *stats;
+    GError *error = NULL;
+    TestNode *node;
+
+    archive = gvs_archive_new(bytes, &error);
+    g_assert_no_error(error);
+    g_assert_cmpuint(gvs_archive_get_n_entities(archive), ==, N_NODES);
+    g_assert_cmpstr(gvs_archive_get_key_property(archive), ==, "name");
+
+    /* Only the ten nodes reachable from node-90 are created */
+    node = gvs_archive_lookup(archive, "node-90");
+    check_chain(node, 90);
+    g_object_unref(node);
+
+    stats = gvs_deserializer_get_stats(gvs_archive_get_deserializer(archive));
+    g_assert_cmpuint(gvs_stats_get_n_entities(stats), ==, 10);
+    gvs_stats_free(stats);
+
+    node = gvs_archive_lookup(archive, "node-99");
+    check_chain(node, 99);
+    g_object_unref(node);
+
+    g_assert(gvs_archive_lookup(archive, "node-100") == NULL);
+    g_assert(gvs_archive_lookup(archive, "") == NULL);
+    g_assert(gvs_archive_lookup(archive, "zzz") == NULL);
+
+    /* The root is entity 0 */
+    node = gvs_archive_lookup_id(archive, 0);
+    check_chain(node, 0);
+    g_object_unref(node);
+
+    g_object_unref(archive);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_archive_lookup(void)
+{
+    check_lookup(GVS_SERIALIZER_FLAGS_NONE);
+}
+
+static void
+test_archive_compact(void)
+{
+    check_lookup(GVS_SERIALIZER_COMPACT);
+}
+
+static void
+test_archive_document(void)
+{
+    GBytes *bytes = write_archive(GVS_SERIALIZER_FLAGS_NONE, NULL);
+    GvsArchive *archive = gvs_archive_new(bytes, NULL);
+    GVariant *document;
+    TestNode *node;
+
+    g_assert(gvs_archive_get_key_property(archive) == NULL);
+    g_assert(gvs_archive_lookup(archive, "node-0") == NULL);
+
+    document = gvs_archive_get_document(archive);
+    node = gvs_gobject_new_deserialize(document);
+    check_chain(node, 0);
+
+    g_object_unref(node);
+    g_variant_unref(document);
+    g_object_unref(archive);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_archive_path(void)
+{
+    GBytes *bytes = write_archive(GVS_SERIALIZER_FLAGS_NONE, "name");
+    GvsArchive *archive;
+    GError *error = NULL;
+    TestNode *node;
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("test-archive-XXXXXX", &path, &error);
+    g_assert_no_error(error);
+    close(fd);
+    g_assert(g_file_set_contents(path, g_bytes_get_data(bytes, NULL),
+                                 g_bytes_get_size(bytes), &error));
+
+    archive = gvs_archive_new_for_path(path, &error);
+    g_assert_no_error(error);
+
+    node = gvs_archive_lookup(archive, "node-50");
+    check_chain(node, 50);
+    g_object_unref(node);
+
+    g_object_unref(archive);
+    g_unlink(path);
+    g_free(path);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_archive_errors(void)
+{
+    GBytes *bytes = write_archive(GVS_SERIALIZER_FLAGS_NONE, "name");
+    gsize size = g_bytes_get_size(bytes);
+    GBytes *damaged;
+    GvsArchive *archive;
+    GError *error = NULL;
+    TestNode *chain = make_chain();
+    GvsSerializer *serializer = gvs_serializer_new();
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GVariant *document;
+
+    /* Cut short, so the trailer is missing */
+    damaged = g_bytes_new_from_bytes(bytes, 0, size - 4);
+    archive = gvs_archive_new(damaged, &error);
+    g_assert(archive == NULL);
+    g_assert_error(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_INVALID);
+    g_clear_error(&error);
+    g_bytes_unref(damaged);
+
+    /* Not an archive at all */
+    damaged = g_bytes_new_from_bytes(bytes, 8, size - 8);
+    archive = gvs_archive_new(damaged, &error);
+    g_assert(archive == NULL);
+    g_assert_error(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_INVALID);
+    g_clear_error(&error);
+    g_bytes_unref(damaged);
+
+    /* Column groups can't be archived */
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_COLUMNAR);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(chain));
+    g_assert(!gvs_archive_write(stream, document, "name", NULL, &error));
+    g_assert_error(error, GVS_ARCHIVE_ERROR, GVS_ARCHIVE_ERROR_UNSUPPORTED);
+    g_clear_error(&error);
+
+    g_variant_unref(document);
+    g_object_unref(stream);
+    g_object_unref(serializer);
+    g_object_unref(chain);
+    g_bytes_unref(bytes);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Archive/Lookup", test_archive_lookup);
+   g_test_add_func("/Gvs/Archive/Compact", test_archive_compact);
+   g_test_add_func("/Gvs/Archive/Document", test_archive_document);
+   g_test_add_func("/Gvs/Archive/Path", test_archive_path);
+   g_test_add_func("/Gvs/Archive/Errors", test_archive_errors);
+   return g_test_run();
+}
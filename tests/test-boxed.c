@@ -0,0 +1,264 @@
+/*
+ * Tests [de]serialization of boxed properties, both built-in and registered
+ * with gvs_register_boxed_transform()
+ */
+
+#include <gvs/gvs.h>
+
+/* TestPoint boxed type */
+
+typedef struct
+{
+    int x;
+    int y;
+} TestPoint;
+
+static TestPoint *
+test_point_copy(const TestPoint *point)
+{
+    return g_slice_dup(TestPoint, point);
+}
+
+static void
+test_point_free(TestPoint *point)
+{
+    g_slice_free(TestPoint, point);
+}
+
+#define TEST_TYPE_POINT (test_point_get_type())
+
+GType test_point_get_type(void);
+
+G_DEFINE_BOXED_TYPE(TestPoint, test_point, test_point_copy, test_point_free);
+
+static GVariant *
+test_point_serialize(GvsSerializer *serializer, const GValue *value, gpointer user_data)
+{
+    const TestPoint *point = g_value_get_boxed(value);
+
+    return g_variant_new("(ii)", point->x, point->y);
+}
+
+static void
+test_point_deserialize(GvsDeserializer *deserializer, GVariant *variant,
+                       GValue *value, gpointer user_data)
+{
+    TestPoint point;
+
+    g_variant_get(variant, "(ii)", &point.x, &point.y);
+    g_value_set_boxed(value, &point);
+}
+
+/* TestHolder object */
+
+#define TEST_TYPE_HOLDER          (test_holder_get_type())
+#define TEST_HOLDER(obj)          (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_HOLDER, TestHolder))
+#define TEST_IS_HOLDER(obj)       (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_HOLDER))
+
+typedef struct _TestHolder      TestHolder;
+typedef struct _TestHolderClass TestHolderClass;
+
+struct _TestHolder
+{
+    GObject parent;
+
+    GStrv strv;
+    GBytes *bytes;
+    TestPoint *start;
+    TestPoint *end;
+};
+
+struct _TestHolderClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestHolder, test_holder, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_STRV,
+    PROP_BYTES,
+    PROP_START,
+    PROP_END
+};
+
+static void
+test_holder_set_property(GObject *obj,
+                         guint prop_id,
+                         const GValue *value,
+                         GParamSpec *pspec)
+{
+    TestHolder *self = TEST_HOLDER(obj);
+
+    switch (prop_id)
+    {
+        case PROP_STRV:
+            g_strfreev(self->strv);
+            self->strv = g_value_dup_boxed(value);
+            break;
+
+        case PROP_BYTES:
+            g_clear_pointer(&self->bytes, g_bytes_unref);
+            self->bytes = g_value_dup_boxed(value);
+            break;
+
+        case PROP_START:
+            g_clear_pointer(&self->start, test_point_free);
+            self->start = g_value_dup_boxed(value);
+            break;
+
+        case PROP_END:
+            g_clear_pointer(&self->end, test_point_free);
+            self->end = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_holder_get_property(GObject *obj,
+                         guint prop_id,
+                         GValue *value,
+                         GParamSpec *pspec)
+{
+    TestHolder *self = TEST_HOLDER(obj);
+
+    switch (prop_id)
+    {
+        case PROP_STRV:
+            g_value_set_boxed(value, self->strv);
+            break;
+
+        case PROP_BYTES:
+            g_value_set_boxed(value, self->bytes);
+            break;
+
+        case PROP_START:
+            g_value_set_boxed(value, self->start);
+            break;
+
+        case PROP_END:
+            g_value_set_boxed(value, self->end);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_holder_finalize(GObject *obj)
+{
+    TestHolder *self = TEST_HOLDER(obj);
+
+    g_strfreev(self->strv);
+    g_clear_pointer(&self->bytes, g_bytes_unref);
+    g_clear_pointer(&self->start, test_point_free);
+    g_clear_pointer(&self->end, test_point_free);
+
+    G_OBJECT_CLASS(test_holder_parent_class)->finalize(obj);
+}
+
+static void
+test_holder_class_init(TestHolderClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_holder_set_property;
+    gobject_class->get_property = test_holder_get_property;
+    gobject_class->finalize = test_holder_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_STRV,
+            g_param_spec_boxed("strv", "strv", "strv", G_TYPE_STRV,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_BYTES,
+            g_param_spec_boxed("bytes", "bytes", "bytes", G_TYPE_BYTES,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_START,
+            g_param_spec_boxed("start", "start", "start", TEST_TYPE_POINT,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_END,
+            g_param_spec_boxed("end", "end", "end", TEST_TYPE_POINT,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_holder_init(TestHolder *self)
+{
+}
+
+static const char serialized_object[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestHolder', <{"
+"     'strv': <@mt 1>,"
+"     'bytes': <@mt 2>,"
+"     'start': <@mt 3>,"
+"     'end': <@mt nothing>"
+"   }>),"
+"  ('GStrv', <['one', 'two']>),"
+"  ('GBytes', <[byte 0x61, 0x00, 0x62]>),"
+"  ('TestPoint', <(3, -4)>)])";
+
+static void
+test_boxed(void)
+{
+    const char * const strv[] = { "one", "two", NULL };
+    TestPoint point = { 3, -4 };
+    TestHolder *holder = NULL;
+    TestHolder *created = NULL;
+    GBytes *bytes = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    bytes = g_bytes_new("a\0b", 3);
+    holder = g_object_new(TEST_TYPE_HOLDER,
+                          "strv", strv,
+                          "bytes", bytes,
+                          "start", &point,
+                          NULL);
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(holder));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_object, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_HOLDER(created));
+    g_assert(g_strv_equal((const char * const *) created->strv, strv));
+    g_assert(g_bytes_equal(created->bytes, bytes));
+    g_assert_cmpint(created->start->x, ==, 3);
+    g_assert_cmpint(created->start->y, ==, -4);
+    g_assert(created->end == NULL);
+
+    g_object_unref(created);
+    g_object_unref(holder);
+    g_bytes_unref(bytes);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+
+   gvs_register_boxed_transform(TEST_TYPE_POINT,
+                                test_point_serialize,
+                                test_point_deserialize,
+                                G_VARIANT_TYPE("(ii)"));
+
+   g_test_add_func("/Gvs/Boxed/Transforms", test_boxed);
+   return g_test_run();
+}
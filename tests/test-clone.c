@@ -0,0 +1,552 @@
+/*
+ * Tests gvs_gobject_clone()
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+#include <string.h>
+
+/* TestNode object, with a construct-only serial number, a name, a value
+ * stored as a plain field, a child, a list of children, a transient cache
+ * and a peer held without a reference */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    int serial;
+    char *name;
+    int value;
+    TestNode *child;
+    GPtrArray *children;
+    int cache;
+    TestNode *peer;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_SERIAL,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD,
+    PROP_CHILDREN,
+    PROP_CACHE,
+    PROP_PEER
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_SERIAL:
+            self->serial = g_value_get_int(value);
+            break;
+
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        case PROP_CHILDREN:
+            g_clear_pointer(&self->children, g_ptr_array_unref);
+            self->children = g_value_dup_boxed(value);
+            break;
+
+        case PROP_CACHE:
+            self->cache = g_value_get_int(value);
+            break;
+
+        case PROP_PEER:
+            self->peer = g_value_get_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_SERIAL:
+            g_value_set_int(value, self->serial);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        case PROP_CHILDREN:
+            g_value_set_boxed(value, self->children);
+            break;
+
+        case PROP_CACHE:
+            g_value_set_int(value, self->cache);
+            break;
+
+        case PROP_PEER:
+            g_value_set_object(value, self->peer);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    g_clear_object(&self->child);
+    g_clear_pointer(&self->children, g_ptr_array_unref);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_SERIAL,
+            g_param_spec_int("serial", "serial", "serial", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                             G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_VALUE, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestNode, value), GVS_FIELD_INT);
+
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_boxed("children", "children", "children", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CHILDREN, pspec);
+    gvs_register_property_element_type(pspec, TEST_TYPE_NODE);
+
+    pspec = g_param_spec_int("cache", "cache", "cache", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CACHE, pspec);
+    gvs_register_property_transient(pspec);
+
+    pspec = g_param_spec_object("peer", "peer", "peer", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_PEER, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestNode, peer),
+                                 GVS_FIELD_OBJECT_UNOWNED);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* TestTag object, whose label is serialized in upper case */
+
+#define TEST_TYPE_TAG            (test_tag_get_type())
+#define TEST_TAG(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_TAG, TestTag))
+
+typedef struct _TestTag      TestTag;
+typedef struct _TestTagClass TestTagClass;
+
+struct _TestTag
+{
+    GObject parent;
+
+    char *label;
+};
+
+struct _TestTagClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestTag, test_tag, G_TYPE_OBJECT);
+
+static void
+test_tag_set_property(GObject *obj,
+                      guint prop_id,
+                      const GValue *value,
+                      GParamSpec *pspec)
+{
+    g_free(TEST_TAG(obj)->label);
+    TEST_TAG(obj)->label = g_value_dup_string(value);
+}
+
+static void
+test_tag_get_property(GObject *obj,
+                      guint prop_id,
+                      GValue *value,
+                      GParamSpec *pspec)
+{
+    g_value_set_string(value, TEST_TAG(obj)->label);
+}
+
+static void
+test_tag_finalize(GObject *obj)
+{
+    g_free(TEST_TAG(obj)->label);
+
+    G_OBJECT_CLASS(test_tag_parent_class)->finalize(obj);
+}
+
+static GVariant *
+serialize_label(GvsSerializer *serializer, const GValue *value, gpointer user_data)
+{
+    char *upper = g_ascii_strup(g_value_get_string(value), -1);
+    GVariant *variant = g_variant_new("ms", upper);
+
+    g_free(upper);
+
+    return variant;
+}
+
+static void
+test_tag_class_init(TestTagClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_tag_set_property;
+    gobject_class->get_property = test_tag_get_property;
+    gobject_class->finalize = test_tag_finalize;
+
+    pspec = g_param_spec_string("label", "label", "label", "",
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, 1, pspec);
+    gvs_register_property_serialize_func(pspec, serialize_label);
+}
+
+static void
+test_tag_init(TestTag *self)
+{
+}
+
+/* TestLink object, whose construct-only owner is itself unless given */
+
+#define TEST_TYPE_LINK           (test_link_get_type())
+#define TEST_LINK(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_LINK, TestLink))
+
+typedef struct _TestLink      TestLink;
+typedef struct _TestLinkClass TestLinkClass;
+
+struct _TestLink
+{
+    GObject parent;
+
+    TestLink *owner;
+};
+
+struct _TestLinkClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestLink, test_link, G_TYPE_OBJECT);
+
+static void
+test_link_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TEST_LINK(obj)->owner = g_value_dup_object(value);
+}
+
+static void
+test_link_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestLink *self = TEST_LINK(obj);
+
+    g_value_set_object(value, self->owner ? self->owner : self);
+}
+
+static void
+test_link_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_LINK(obj)->owner);
+
+    G_OBJECT_CLASS(test_link_parent_class)->dispose(obj);
+}
+
+static void
+test_link_class_init(TestLinkClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_link_set_property;
+    gobject_class->get_property = test_link_get_property;
+    gobject_class->dispose = test_link_dispose;
+
+    g_object_class_install_property(gobject_class, 1,
+            g_param_spec_object("owner", "owner", "owner", TEST_TYPE_LINK,
+                                G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                                G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_link_init(TestLink *self)
+{
+}
+
+/* Tests */
+
+static TestNode *
+node_new(int serial, const char *name, int value, TestNode *child)
+{
+    return g_object_new(TEST_TYPE_NODE, "serial", serial, "name", name,
+                        "value", value, "child", child, "cache", 42, NULL);
+}
+
+static void
+test_clone_values(void)
+{
+    TestNode *leaf = node_new(2, "leaf", 20, NULL);
+    TestNode *root = node_new(1, "root", 10, leaf);
+    TestNode *copy;
+
+    copy = gvs_gobject_clone(G_OBJECT(root));
+    g_assert(TEST_IS_NODE(copy));
+    g_assert(copy != root);
+    g_assert_cmpint(copy->serial, ==, 1);
+    g_assert_cmpstr(copy->name, ==, "root");
+    g_assert(copy->name != root->name);
+    g_assert_cmpint(copy->value, ==, 10);
+    g_assert_cmpint(copy->cache, ==, 0);
+    g_assert(copy->children == NULL);
+
+    g_assert(copy->child != NULL && copy->child != leaf);
+    g_assert_cmpint(copy->child->serial, ==, 2);
+    g_assert_cmpstr(copy->child->name, ==, "leaf");
+    g_assert_cmpint(copy->child->value, ==, 20);
+    g_assert(copy->child->child == NULL);
+
+    /* The copy owns its graph */
+    g_object_unref(root);
+    g_object_unref(leaf);
+    g_assert_cmpint(G_OBJECT(copy)->ref_count, ==, 1);
+    g_assert_cmpint(G_OBJECT(copy->child)->ref_count, ==, 1);
+    g_object_unref(copy);
+}
+
+static void
+test_clone_shared(void)
+{
+    TestNode *shared = node_new(3, "shared", 30, NULL);
+    TestNode *root = node_new(1, "root", 10, shared);
+    TestNode *copy;
+
+    root->children = g_ptr_array_new_with_free_func(g_object_unref);
+    g_ptr_array_add(root->children, g_object_ref(shared));
+    g_ptr_array_add(root->children, node_new(4, "other", 40, shared));
+
+    copy = gvs_gobject_clone(G_OBJECT(root));
+    g_assert_cmpuint(copy->children->len, ==, 2);
+    g_assert(g_ptr_array_index(copy->children, 0) == copy->child);
+    g_assert(TEST_NODE(g_ptr_array_index(copy->children, 1))->child == copy->child);
+    g_assert(copy->child != shared);
+    g_assert_cmpstr(TEST_NODE(g_ptr_array_index(copy->children, 1))->name, ==, "other");
+
+    g_object_unref(copy);
+    g_object_unref(root);
+    g_object_unref(shared);
+}
+
+static void
+test_clone_cycle(void)
+{
+    TestNode *first = node_new(1, "first", 1, NULL);
+    TestNode *second = node_new(2, "second", 2, first);
+    TestNode *copy;
+
+    g_object_set(first, "child", second, NULL);
+
+    copy = gvs_gobject_clone(G_OBJECT(first));
+    g_assert(copy->child != second);
+    g_assert_cmpstr(copy->child->name, ==, "second");
+    g_assert(copy->child->child == copy);
+
+    g_object_set(copy, "child", NULL, NULL);
+    g_object_unref(copy);
+    g_object_set(first, "child", NULL, NULL);
+    g_object_unref(first);
+    g_object_unref(second);
+}
+
+static void
+test_clone_list_store(void)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_NODE);
+    TestNode *node = node_new(1, "node", 1, NULL);
+    GListStore *copy;
+    TestNode *first, *second;
+
+    g_list_store_append(store, node);
+    g_list_store_append(store, node);
+
+    copy = gvs_gobject_clone(G_OBJECT(store));
+    g_assert(G_IS_LIST_STORE(copy));
+    g_assert(g_list_model_get_item_type(G_LIST_MODEL(copy)) == TEST_TYPE_NODE);
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(copy)), ==, 2);
+
+    first = g_list_model_get_item(G_LIST_MODEL(copy), 0);
+    second = g_list_model_get_item(G_LIST_MODEL(copy), 1);
+    g_assert(first == second && first != node);
+    g_assert_cmpstr(first->name, ==, "node");
+
+    g_object_unref(first);
+    g_object_unref(second);
+    g_object_unref(copy);
+    g_object_unref(node);
+    g_object_unref(store);
+}
+
+/* A copy held only through an unowned field lives as long as the copy of
+ * the root */
+static void
+test_clone_unowned(void)
+{
+    TestNode *peer = node_new(2, "peer", 20, NULL);
+    TestNode *root = node_new(1, "root", 10, NULL);
+    TestNode *copy, *peer_copy;
+
+    root->peer = peer;
+
+    copy = gvs_gobject_clone(G_OBJECT(root));
+    g_object_unref(root);
+    g_object_unref(peer);
+
+    peer_copy = copy->peer;
+    g_assert(peer_copy != NULL && peer_copy != peer);
+    g_assert_cmpstr(peer_copy->name, ==, "peer");
+    g_assert_cmpint(G_OBJECT(peer_copy)->ref_count, ==, 1);
+
+    g_object_add_weak_pointer(G_OBJECT(peer_copy), (gpointer *) &peer_copy);
+    g_object_unref(copy);
+    g_assert(peer_copy == NULL);
+}
+
+/* A cycle through construct-only properties can't be copied directly, and
+ * comes out as a round trip would */
+static void
+test_clone_construct_cycle(void)
+{
+    TestLink *link = g_object_new(TEST_TYPE_LINK, NULL);
+    TestLink *copy;
+
+    g_test_expect_message("Gvs", G_LOG_LEVEL_CRITICAL,
+                          "*refers to itself through construct-only properties");
+    copy = gvs_gobject_clone(G_OBJECT(link));
+    g_test_assert_expected_messages();
+
+    g_assert(copy != link);
+    g_assert(copy->owner == NULL);
+
+    g_object_unref(copy);
+    g_object_unref(link);
+}
+
+/* A graph holding custom serialization comes out as a round trip would */
+static void
+test_clone_custom(void)
+{
+    TestTag *tag = g_object_new(TEST_TYPE_TAG, "label", "hello", NULL);
+    GListStore *store = g_list_store_new(TEST_TYPE_TAG);
+    GListStore *copy;
+    TestTag *tag_copy;
+
+    g_list_store_append(store, tag);
+
+    copy = gvs_gobject_clone(G_OBJECT(store));
+    tag_copy = g_list_model_get_item(G_LIST_MODEL(copy), 0);
+    g_assert(tag_copy != tag);
+    g_assert_cmpstr(tag_copy->label, ==, "HELLO");
+
+    g_object_unref(tag_copy);
+    g_object_unref(copy);
+    g_object_unref(store);
+    g_object_unref(tag);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Clone/Values", test_clone_values);
+   g_test_add_func("/Gvs/Clone/Shared", test_clone_shared);
+   g_test_add_func("/Gvs/Clone/Cycle", test_clone_cycle);
+   g_test_add_func("/Gvs/Clone/ListStore", test_clone_list_store);
+   g_test_add_func("/Gvs/Clone/Unowned", test_clone_unowned);
+   g_test_add_func("/Gvs/Clone/ConstructCycle", test_clone_construct_cycle);
+   g_test_add_func("/Gvs/Clone/Custom", test_clone_custom);
+   return g_test_run();
+}
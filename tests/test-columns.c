@@ -0,0 +1,449 @@
+/*
+ * Tests the columnar layout enabled by GVS_SERIALIZER_COLUMNAR
+ */
+
+#include <gvs/gvs.h>
+
+/* TestCell object: only plain properties, so it is stored as columns */
+
+#define TEST_TYPE_CELL            (test_cell_get_type())
+#define TEST_CELL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_CELL, TestCell))
+#define TEST_IS_CELL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_CELL))
+
+typedef struct _TestCell      TestCell;
+typedef struct _TestCellClass TestCellClass;
+
+struct _TestCell
+{
+    GObject parent;
+
+    int row;
+    double weight;
+    char *label;
+    TestCell *next;
+    guint id;
+};
+
+struct _TestCellClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestCell, test_cell, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_ROW,
+    PROP_WEIGHT,
+    PROP_LABEL,
+    PROP_NEXT,
+    PROP_ID
+};
+
+static void
+test_cell_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestCell *self = TEST_CELL(obj);
+
+    switch (prop_id)
+    {
+        case PROP_WEIGHT:
+            self->weight = g_value_get_double(value);
+            break;
+
+        case PROP_LABEL:
+            g_free(self->label);
+            self->label = g_value_dup_string(value);
+            break;
+
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        case PROP_ID:
+            self->id = g_value_get_uint(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_cell_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestCell *self = TEST_CELL(obj);
+
+    switch (prop_id)
+    {
+        case PROP_WEIGHT:
+            g_value_set_double(value, self->weight);
+            break;
+
+        case PROP_LABEL:
+            g_value_set_string(value, self->label);
+            break;
+
+        case PROP_NEXT:
+            g_value_set_object(value, self->next);
+            break;
+
+        case PROP_ID:
+            g_value_set_uint(value, self->id);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_cell_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_CELL(obj)->next);
+
+    G_OBJECT_CLASS(test_cell_parent_class)->dispose(obj);
+}
+
+static void
+test_cell_finalize(GObject *obj)
+{
+    g_free(TEST_CELL(obj)->label);
+
+    G_OBJECT_CLASS(test_cell_parent_class)->finalize(obj);
+}
+
+static void
+test_cell_class_init(TestCellClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_cell_set_property;
+    gobject_class->get_property = test_cell_get_property;
+    gobject_class->dispose = test_cell_dispose;
+    gobject_class->finalize = test_cell_finalize;
+
+    pspec = g_param_spec_int("row", "row", "row", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_ROW, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestCell, row),
+                                 GVS_FIELD_INT);
+
+    g_object_class_install_property(gobject_class, PROP_WEIGHT,
+            g_param_spec_double("weight", "weight", "weight",
+                                -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_LABEL,
+            g_param_spec_string("label", "label", "label", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_NEXT,
+            g_param_spec_object("next", "next", "next", TEST_TYPE_CELL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_ID,
+            g_param_spec_uint("id", "id", "id", 0, G_MAXUINT, 0,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_cell_init(TestCell *self)
+{
+}
+
+/* TestSheet object: has a container property, so it is stored as a row */
+
+#define TEST_TYPE_SHEET           (test_sheet_get_type())
+#define TEST_SHEET(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_SHEET, TestSheet))
+#define TEST_IS_SHEET(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_SHEET))
+
+typedef struct _TestSheet      TestSheet;
+typedef struct _TestSheetClass TestSheetClass;
+
+struct _TestSheet
+{
+    GObject parent;
+
+    GPtrArray *cells;
+};
+
+struct _TestSheetClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestSheet, test_sheet, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_SHEET_0,
+    PROP_CELLS
+};
+
+static void
+test_sheet_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    TestSheet *self = TEST_SHEET(obj);
+
+    switch (prop_id)
+    {
+        case PROP_CELLS:
+            g_clear_pointer(&self->cells, g_ptr_array_unref);
+            self->cells = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_sheet_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    TestSheet *self = TEST_SHEET(obj);
+
+    switch (prop_id)
+    {
+        case PROP_CELLS:
+            g_value_set_boxed(value, self->cells);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_sheet_dispose(GObject *obj)
+{
+    g_clear_pointer(&TEST_SHEET(obj)->cells, g_ptr_array_unref);
+
+    G_OBJECT_CLASS(test_sheet_parent_class)->dispose(obj);
+}
+
+static void
+test_sheet_class_init(TestSheetClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_sheet_set_property;
+    gobject_class->get_property = test_sheet_get_property;
+    gobject_class->dispose = test_sheet_dispose;
+
+    pspec = g_param_spec_boxed("cells", "cells", "cells", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CELLS, pspec);
+    gvs_register_property_element_type(pspec, TEST_TYPE_CELL);
+}
+
+static void
+test_sheet_init(TestSheet *self)
+{
+}
+
+/* Tests */
+
+static TestSheet *
+make_sheet(guint n_cells)
+{
+    GPtrArray *cells = g_ptr_array_new_with_free_func(g_object_unref);
+    TestSheet *sheet;
+    TestCell *next = NULL;
+    guint i;
+
+    /* Built backwards, so that each cell can point at the one after it */
+    for (i = n_cells; i > 0; i--)
+    {
+        char *label = (i % 2) ? g_strdup_printf("cell %u", i - 1) : NULL;
+        TestCell *cell = g_object_new(TEST_TYPE_CELL,
+                                      "id", i - 1,
+                                      "weight", (i - 1) * 0.5,
+                                      "label", label,
+                                      "next", next,
+                                      NULL);
+        cell->row = -(int) i;
+
+        g_ptr_array_add(cells, cell);
+        next = cell;
+        g_free(label);
+    }
+
+    /* Reverse into order */
+    for (i = 0; i < n_cells / 2; i++)
+    {
+        gpointer tmp = cells->pdata[i];
+        cells->pdata[i] = cells->pdata[n_cells - 1 - i];
+        cells->pdata[n_cells - 1 - i] = tmp;
+    }
+
+    sheet = g_object_new(TEST_TYPE_SHEET, "cells", cells, NULL);
+    g_ptr_array_unref(cells);
+
+    return sheet;
+}
+
+static GVariant *
+serialize_columnar(GObject *object)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *variant;
+
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_COLUMNAR);
+    variant = gvs_serializer_serialize_object(serializer, object);
+    g_object_unref(serializer);
+
+    return variant;
+}
+
+static const char serialized_sheet[] =
+"(uint32 1735816047,"
+" uint16 2,"
+" uint32 1,"
+" [('TestSheet', <{'cells': <@mamt [1, 2]>}>)],"
+" [('TestCell', [uint64 1, 2],"
+"   {'row': <[-1, -2]>,"
+"    'weight': <[0.0, 0.5]>,"
+"    'label': <[@ms 'cell 0', nothing]>,"
+"    'next': <[@mt 2, nothing]>,"
+"    'id': <[uint32 0, 1]>})])";
+
+static void
+test_columns_format(void)
+{
+    TestSheet *sheet = make_sheet(2);
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    variant1 = serialize_columnar(G_OBJECT(sheet));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_sheet, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    g_object_unref(sheet);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+static void
+test_columns_round_trip(void)
+{
+    const guint n_cells = 5000;
+    TestSheet *sheet = make_sheet(n_cells);
+    TestSheet *created = NULL;
+    GVariant *variant = NULL;
+    guint i;
+
+    variant = serialize_columnar(G_OBJECT(sheet));
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert(TEST_IS_SHEET(created));
+    g_assert_cmpuint(created->cells->len, ==, n_cells);
+
+    for (i = 0; i < n_cells; i++)
+    {
+        TestCell *cell = g_ptr_array_index(created->cells, i);
+        TestCell *original = g_ptr_array_index(sheet->cells, i);
+
+        g_assert(TEST_IS_CELL(cell));
+        g_assert_cmpuint(cell->id, ==, i);
+        g_assert_cmpint(cell->row, ==, original->row);
+        g_assert_cmpfloat(cell->weight, ==, original->weight);
+        g_assert_cmpstr(cell->label, ==, original->label);
+
+        if (i + 1 < n_cells)
+            g_assert(cell->next == g_ptr_array_index(created->cells, i + 1));
+        else
+            g_assert(cell->next == NULL);
+    }
+
+    g_object_unref(created);
+    g_object_unref(sheet);
+    g_variant_unref(variant);
+}
+
+/* The root object may itself live in a column group */
+static void
+test_columns_root(void)
+{
+    TestCell *tail = g_object_new(TEST_TYPE_CELL, "id", 7, NULL);
+    TestCell *head = g_object_new(TEST_TYPE_CELL, "id", 3, "next", tail,
+                                  "label", "head", NULL);
+    TestCell *created = NULL;
+    GVariant *variant = NULL;
+    GVariant *rows = NULL;
+
+    variant = serialize_columnar(G_OBJECT(head));
+
+    rows = g_variant_get_child_value(variant, 3);
+    g_assert_cmpuint(g_variant_n_children(rows), ==, 0);
+    g_variant_unref(rows);
+
+    created = gvs_gobject_new_deserialize(variant);
+    g_assert(TEST_IS_CELL(created));
+    g_assert_cmpuint(created->id, ==, 3);
+    g_assert_cmpstr(created->label, ==, "head");
+    g_assert(TEST_IS_CELL(created->next));
+    g_assert_cmpuint(created->next->id, ==, 7);
+
+    g_object_unref(created);
+    g_object_unref(head);
+    g_object_unref(tail);
+    g_variant_unref(variant);
+}
+
+static void
+test_columns_invalid(void)
+{
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    GVariant *variant = NULL;
+    gpointer object;
+
+    /* Entity 1 is claimed by the group twice */
+    variant = g_variant_parse(NULL,
+            "(uint32 1735816047, uint16 2, uint32 1,"
+            " [('TestSheet', <{'cells': <@mamt [1]>}>)],"
+            " [('TestCell', [uint64 1, 1], {'row': <[1, 2]>})])",
+            NULL, NULL, NULL);
+    g_assert(variant);
+
+    g_test_expect_message("Gvs", G_LOG_LEVEL_CRITICAL, "*Invalid entity id*");
+    object = gvs_deserializer_deserialize(deserializer, variant);
+    g_test_assert_expected_messages();
+    g_assert(object == NULL);
+
+    g_variant_unref(variant);
+    g_object_unref(deserializer);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Columns/Format", test_columns_format);
+   g_test_add_func("/Gvs/Columns/RoundTrip", test_columns_round_trip);
+   g_test_add_func("/Gvs/Columns/Root", test_columns_root);
+   g_test_add_func("/Gvs/Columns/Invalid", test_columns_invalid);
+   return g_test_run();
+}
@@ -0,0 +1,507 @@
+/*
+ * Tests the compact profile enabled by GVS_SERIALIZER_COMPACT
+ */
+
+#include <gvs/gvs.h>
+
+/* TestColour enum and TestStyle flags */
+
+typedef enum
+{
+    TEST_COLOUR_RED,
+    TEST_COLOUR_GREEN,
+    TEST_COLOUR_BLUE
+} TestColour;
+
+typedef enum
+{
+    TEST_STYLE_BOLD      = 1 << 0,
+    TEST_STYLE_ITALIC    = 1 << 1,
+    TEST_STYLE_UNDERLINE = 1 << 2
+} TestStyle;
+
+#define TEST_TYPE_COLOUR (test_colour_get_type())
+#define TEST_TYPE_STYLE  (test_style_get_type())
+
+static GType
+test_colour_get_type(void)
+{
+    static GType type = 0;
+    static const GEnumValue values[] = {
+        { TEST_COLOUR_RED, "TEST_COLOUR_RED", "red" },
+        { TEST_COLOUR_GREEN, "TEST_COLOUR_GREEN", "green" },
+        { TEST_COLOUR_BLUE, "TEST_COLOUR_BLUE", "blue" },
+        { 0, NULL, NULL }
+    };
+
+    if (!type)
+        type = g_enum_register_static("TestColour", values);
+
+    return type;
+}
+
+static GType
+test_style_get_type(void)
+{
+    static GType type = 0;
+    static const GFlagsValue values[] = {
+        { TEST_STYLE_BOLD, "TEST_STYLE_BOLD", "bold" },
+        { TEST_STYLE_ITALIC, "TEST_STYLE_ITALIC", "italic" },
+        { TEST_STYLE_UNDERLINE, "TEST_STYLE_UNDERLINE", "underline" },
+        { 0, NULL, NULL }
+    };
+
+    if (!type)
+        type = g_flags_register_static("TestStyle", values);
+
+    return type;
+}
+
+/* TestShape object */
+
+#define TEST_TYPE_SHAPE           (test_shape_get_type())
+#define TEST_SHAPE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_SHAPE, TestShape))
+#define TEST_IS_SHAPE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_SHAPE))
+
+typedef struct _TestShape      TestShape;
+typedef struct _TestShapeClass TestShapeClass;
+
+struct _TestShape
+{
+    GObject parent;
+
+    int percent;
+    int offset;
+    int any;
+    guint64 count;
+    TestColour colour;
+    TestStyle style;
+    float scale;
+    double angle;
+    TestShape *parent_shape;
+    GArray *points;
+};
+
+struct _TestShapeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestShape, test_shape, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_PERCENT,
+    PROP_OFFSET,
+    PROP_ANY,
+    PROP_COUNT,
+    PROP_COLOUR,
+    PROP_STYLE,
+    PROP_SCALE,
+    PROP_ANGLE,
+    PROP_PARENT,
+    PROP_POINTS
+};
+
+static void
+test_shape_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    TestShape *self = TEST_SHAPE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_OFFSET:
+            self->offset = g_value_get_int(value);
+            break;
+
+        case PROP_ANY:
+            self->any = g_value_get_int(value);
+            break;
+
+        case PROP_COUNT:
+            self->count = g_value_get_uint64(value);
+            break;
+
+        case PROP_COLOUR:
+            self->colour = g_value_get_enum(value);
+            break;
+
+        case PROP_STYLE:
+            self->style = g_value_get_flags(value);
+            break;
+
+        case PROP_ANGLE:
+            self->angle = g_value_get_double(value);
+            break;
+
+        case PROP_PARENT:
+            g_clear_object(&self->parent_shape);
+            self->parent_shape = g_value_dup_object(value);
+            break;
+
+        case PROP_POINTS:
+            g_clear_pointer(&self->points, g_array_unref);
+            self->points = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_shape_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    TestShape *self = TEST_SHAPE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_OFFSET:
+            g_value_set_int(value, self->offset);
+            break;
+
+        case PROP_ANY:
+            g_value_set_int(value, self->any);
+            break;
+
+        case PROP_COUNT:
+            g_value_set_uint64(value, self->count);
+            break;
+
+        case PROP_COLOUR:
+            g_value_set_enum(value, self->colour);
+            break;
+
+        case PROP_STYLE:
+            g_value_set_flags(value, self->style);
+            break;
+
+        case PROP_ANGLE:
+            g_value_set_double(value, self->angle);
+            break;
+
+        case PROP_PARENT:
+            g_value_set_object(value, self->parent_shape);
+            break;
+
+        case PROP_POINTS:
+            g_value_set_boxed(value, self->points);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_shape_dispose(GObject *obj)
+{
+    TestShape *self = TEST_SHAPE(obj);
+
+    g_clear_object(&self->parent_shape);
+    g_clear_pointer(&self->points, g_array_unref);
+
+    G_OBJECT_CLASS(test_shape_parent_class)->dispose(obj);
+}
+
+static void
+test_shape_class_init(TestShapeClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_shape_set_property;
+    gobject_class->get_property = test_shape_get_property;
+    gobject_class->dispose = test_shape_dispose;
+
+    pspec = g_param_spec_int("percent", "percent", "percent", 0, 100, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_PERCENT, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestShape, percent),
+                                 GVS_FIELD_INT);
+
+    g_object_class_install_property(gobject_class, PROP_OFFSET,
+            g_param_spec_int("offset", "offset", "offset", -1000, 1000, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_ANY,
+            g_param_spec_int("any", "any", "any", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_COUNT,
+            g_param_spec_uint64("count", "count", "count", 0, 100000, 0,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_COLOUR,
+            g_param_spec_enum("colour", "colour", "colour", TEST_TYPE_COLOUR,
+                              TEST_COLOUR_RED,
+                              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_STYLE,
+            g_param_spec_flags("style", "style", "style", TEST_TYPE_STYLE, 0,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_float("scale", "scale", "scale", -G_MAXFLOAT, G_MAXFLOAT, 0.0f,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_SCALE, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestShape, scale),
+                                 GVS_FIELD_FLOAT);
+
+    g_object_class_install_property(gobject_class, PROP_ANGLE,
+            g_param_spec_double("angle", "angle", "angle", -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_PARENT,
+            g_param_spec_object("parent", "parent", "parent", TEST_TYPE_SHAPE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_boxed("points", "points", "points", G_TYPE_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_POINTS, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_FLOAT);
+}
+
+static void
+test_shape_init(TestShape *self)
+{
+}
+
+/* Tests */
+
+static GVariant *
+serialize_with_flags(GObject *object, GvsSerializerFlags flags)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *variant;
+
+    gvs_serializer_set_flags(serializer, flags);
+    variant = gvs_serializer_serialize_object(serializer, object);
+    g_object_unref(serializer);
+
+    return variant;
+}
+
+static TestShape *
+make_shape(void)
+{
+    const float points[] = { 0.25f, -1.5f, 3.1f };
+    TestShape *parent = g_object_new(TEST_TYPE_SHAPE, NULL);
+    GArray *array = g_array_new(FALSE, FALSE, sizeof(float));
+    TestShape *shape;
+
+    g_array_append_vals(array, points, G_N_ELEMENTS(points));
+
+    shape = g_object_new(TEST_TYPE_SHAPE,
+                         "offset", -7,
+                         "any", G_MININT,
+                         "count", G_GUINT64_CONSTANT(70000),
+                         "colour", TEST_COLOUR_BLUE,
+                         "style", TEST_STYLE_BOLD | TEST_STYLE_UNDERLINE,
+                         "angle", 0.1,
+                         "parent", parent,
+                         "points", array,
+                         NULL);
+    shape->percent = 42;
+    shape->scale = 0.1f;
+
+    g_array_unref(array);
+    g_object_unref(parent);
+
+    return shape;
+}
+
+static const char serialized_parent[] =
+"{'percent': <byte 0>,"
+" 'offset': <int16 0>,"
+" 'any': <0>,"
+" 'count': <uint32 0>,"
+" 'colour': <byte 0>,"
+" 'style': <byte 0>,"
+" 'scale': <uint32 0>,"
+" 'angle': <0.0>,"
+" 'parent': <@mu nothing>,"
+" 'points': <@mau nothing>}";
+
+static void
+test_compact_format(void)
+{
+    TestShape *shape = make_shape();
+    GVariant *variant = NULL;
+    GVariant *entities = NULL;
+    GVariant *expected = NULL;
+    GVariant *props = NULL;
+    GVariant *prop = NULL;
+    guint16 version;
+    guint32 features;
+    GError *error = NULL;
+
+    variant = serialize_with_flags(G_OBJECT(shape), GVS_SERIALIZER_COMPACT);
+    g_assert(g_variant_is_of_type(variant, G_VARIANT_TYPE("(uqua(sv)a(sata{sv}))")));
+
+    g_variant_get_child(variant, 1, "q", &version);
+    g_variant_get_child(variant, 2, "u", &features);
+    g_assert_cmpuint(version, ==, 2);
+    g_assert_cmpuint(features, ==, 1 << 1);
+
+    entities = g_variant_get_child_value(variant, 3);
+    g_assert_cmpuint(g_variant_n_children(entities), ==, 2);
+
+    g_variant_get_child(entities, 0, "(&sv)", NULL, &props);
+
+    prop = g_variant_lookup_value(props, "percent", G_VARIANT_TYPE_BYTE);
+    g_assert(prop);
+    g_assert_cmpuint(g_variant_get_byte(prop), ==, 42);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "offset", G_VARIANT_TYPE_INT16);
+    g_assert(prop);
+    g_assert_cmpint(g_variant_get_int16(prop), ==, -7);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "any", G_VARIANT_TYPE_INT32);
+    g_assert(prop);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "count", G_VARIANT_TYPE_UINT32);
+    g_assert(prop);
+    g_assert_cmpuint(g_variant_get_uint32(prop), ==, 70000);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "scale", G_VARIANT_TYPE_UINT32);
+    g_assert(prop);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "parent", G_VARIANT_TYPE("mu"));
+    g_assert(prop);
+    g_variant_unref(prop);
+
+    prop = g_variant_lookup_value(props, "points", G_VARIANT_TYPE("mau"));
+    g_assert(prop);
+    g_variant_unref(prop);
+
+    g_variant_unref(props);
+
+    g_variant_get_child(entities, 1, "(&sv)", NULL, &props);
+    expected = g_variant_parse(NULL, serialized_parent, NULL, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(g_variant_equal(props, expected));
+
+    g_variant_unref(expected);
+    g_variant_unref(props);
+    g_variant_unref(entities);
+    g_variant_unref(variant);
+    g_object_unref(shape);
+}
+
+static void
+check_round_trip(GvsSerializerFlags flags)
+{
+    TestShape *shape = make_shape();
+    TestShape *created = NULL;
+    GVariant *variant = NULL;
+    guint i;
+
+    variant = serialize_with_flags(G_OBJECT(shape), flags);
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert(TEST_IS_SHAPE(created));
+    g_assert_cmpint(created->percent, ==, 42);
+    g_assert_cmpint(created->offset, ==, -7);
+    g_assert_cmpint(created->any, ==, G_MININT);
+    g_assert_cmpuint(created->count, ==, 70000);
+    g_assert_cmpint(created->colour, ==, TEST_COLOUR_BLUE);
+    g_assert_cmpint(created->style, ==, TEST_STYLE_BOLD | TEST_STYLE_UNDERLINE);
+    g_assert(created->scale == shape->scale);
+    g_assert(created->angle == shape->angle);
+    g_assert(TEST_IS_SHAPE(created->parent_shape));
+    g_assert(created->parent_shape->parent_shape == NULL);
+
+    g_assert_cmpuint(created->points->len, ==, shape->points->len);
+    for (i = 0; i < shape->points->len; i++)
+    {
+        g_assert(g_array_index(created->points, float, i) ==
+                 g_array_index(shape->points, float, i));
+    }
+
+    g_object_unref(created);
+    g_object_unref(shape);
+    g_variant_unref(variant);
+}
+
+static void
+test_compact_round_trip(void)
+{
+    check_round_trip(GVS_SERIALIZER_COMPACT);
+}
+
+static void
+test_compact_columns(void)
+{
+    check_round_trip(GVS_SERIALIZER_COMPACT | GVS_SERIALIZER_COLUMNAR);
+}
+
+/* A field holding a value outside the range of its GParamSpec is written at
+ * full width rather than cut down */
+static void
+check_out_of_range(GvsSerializerFlags flags)
+{
+    TestShape *shape = make_shape();
+    TestShape *created = NULL;
+    GVariant *variant = NULL;
+
+    shape->percent = -300;
+    shape->parent_shape->percent = 1000;
+
+    variant = serialize_with_flags(G_OBJECT(shape), flags);
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert_cmpint(created->percent, ==, -300);
+    g_assert_cmpint(created->parent_shape->percent, ==, 1000);
+
+    g_object_unref(created);
+    g_object_unref(shape);
+    g_variant_unref(variant);
+}
+
+static void
+test_compact_out_of_range(void)
+{
+    check_out_of_range(GVS_SERIALIZER_COMPACT);
+    check_out_of_range(GVS_SERIALIZER_COMPACT | GVS_SERIALIZER_COLUMNAR);
+}
+
+static void
+test_compact_size(void)
+{
+    TestShape *shape = make_shape();
+    GVariant *full = NULL;
+    GVariant *compact = NULL;
+
+    full = serialize_with_flags(G_OBJECT(shape), GVS_SERIALIZER_FLAGS_NONE);
+    compact = serialize_with_flags(G_OBJECT(shape), GVS_SERIALIZER_COMPACT);
+
+    g_assert_cmpuint(g_variant_get_size(compact), <, g_variant_get_size(full));
+
+    g_variant_unref(compact);
+    g_variant_unref(full);
+    g_object_unref(shape);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Compact/Format", test_compact_format);
+   g_test_add_func("/Gvs/Compact/RoundTrip", test_compact_round_trip);
+   g_test_add_func("/Gvs/Compact/Columns", test_compact_columns);
+   g_test_add_func("/Gvs/Compact/OutOfRange", test_compact_out_of_range);
+   g_test_add_func("/Gvs/Compact/Size", test_compact_size);
+   return g_test_run();
+}
@@ -0,0 +1,360 @@
+/*
+ * Tests [de]serialization of GArray, GByteArray, GPtrArray and GHashTable
+ * properties
+ */
+
+#include <gvs/gvs.h>
+#include <string.h>
+
+/* TestNode object */
+
+#define TEST_TYPE_NODE            (test_node_get_type())
+#define TEST_NODE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    GArray *ints;
+    GArray *floats;
+    GArray *bools;
+    GByteArray *bytes;
+    GPtrArray *names;
+    GPtrArray *children;
+    GHashTable *counts;
+    GHashTable *lookup;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_INTS,
+    PROP_FLOATS,
+    PROP_BOOLS,
+    PROP_BYTES,
+    PROP_NAMES,
+    PROP_CHILDREN,
+    PROP_COUNTS,
+    PROP_LOOKUP,
+    N_PROPERTIES
+};
+
+/* Boxed pointers are all refcounted here, so property storage is the same
+ * for each of them */
+static gpointer *
+test_node_field(TestNode *self, guint prop_id)
+{
+    switch (prop_id)
+    {
+        case PROP_INTS:     return (gpointer *) &self->ints;
+        case PROP_FLOATS:   return (gpointer *) &self->floats;
+        case PROP_BOOLS:    return (gpointer *) &self->bools;
+        case PROP_BYTES:    return (gpointer *) &self->bytes;
+        case PROP_NAMES:    return (gpointer *) &self->names;
+        case PROP_CHILDREN: return (gpointer *) &self->children;
+        case PROP_COUNTS:   return (gpointer *) &self->counts;
+        case PROP_LOOKUP:   return (gpointer *) &self->lookup;
+        default:            return NULL;
+    }
+}
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    gpointer *field = test_node_field(TEST_NODE(obj), prop_id);
+
+    if (!field)
+    {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        return;
+    }
+
+    if (*field)
+        g_boxed_free(pspec->value_type, *field);
+    *field = g_value_dup_boxed(value);
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    gpointer *field = test_node_field(TEST_NODE(obj), prop_id);
+
+    if (!field)
+    {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        return;
+    }
+
+    g_value_set_boxed(value, *field);
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    g_clear_pointer(&self->ints, g_array_unref);
+    g_clear_pointer(&self->floats, g_array_unref);
+    g_clear_pointer(&self->bools, g_array_unref);
+    g_clear_pointer(&self->bytes, g_byte_array_unref);
+    g_clear_pointer(&self->names, g_ptr_array_unref);
+    g_clear_pointer(&self->children, g_ptr_array_unref);
+    g_clear_pointer(&self->counts, g_hash_table_unref);
+    g_clear_pointer(&self->lookup, g_hash_table_unref);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+
+    pspec = g_param_spec_boxed("ints", "ints", "ints", G_TYPE_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_INTS, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_INT);
+
+    pspec = g_param_spec_boxed("floats", "floats", "floats", G_TYPE_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_FLOATS, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_FLOAT);
+
+    pspec = g_param_spec_boxed("bools", "bools", "bools", G_TYPE_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_BOOLS, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_BOOLEAN);
+
+    pspec = g_param_spec_boxed("bytes", "bytes", "bytes", G_TYPE_BYTE_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_BYTES, pspec);
+
+    pspec = g_param_spec_boxed("names", "names", "names", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_NAMES, pspec);
+    gvs_register_property_element_type(pspec, G_TYPE_STRING);
+
+    pspec = g_param_spec_boxed("children", "children", "children", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CHILDREN, pspec);
+    gvs_register_property_element_type(pspec, TEST_TYPE_NODE);
+
+    pspec = g_param_spec_boxed("counts", "counts", "counts", G_TYPE_HASH_TABLE,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_COUNTS, pspec);
+    gvs_register_property_key_value_types(pspec, G_TYPE_STRING, G_TYPE_INT);
+
+    pspec = g_param_spec_boxed("lookup", "lookup", "lookup", G_TYPE_HASH_TABLE,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_LOOKUP, pspec);
+    gvs_register_property_key_value_types(pspec, G_TYPE_UINT, TEST_TYPE_NODE);
+}
+
+static void
+object_unref0(gpointer object)
+{
+    if (object)
+        g_object_unref(object);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+static const char serialized_object[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestNode', <{"
+"     'ints': <@mai [1, -2, 3]>,"
+"     'floats': <@mad [0.5, -1.5]>,"
+"     'bools': <@mab [true, false, true]>,"
+"     'bytes': <@mt 1>,"
+"     'names': <@mams ['a', nothing, 'c']>,"
+"     'children': <@mamt [2, nothing, 2]>,"
+"     'counts': <@ma{si} {'x': 10}>,"
+"     'lookup': <@ma{umt} {7: 2}>"
+"   }>),"
+"  ('GByteArray', <[byte 0x00, 0xff]>),"
+"  ('TestNode', <{"
+"     'ints': <@mai nothing>,"
+"     'floats': <@mad nothing>,"
+"     'bools': <@mab nothing>,"
+"     'bytes': <@mt nothing>,"
+"     'names': <@mams nothing>,"
+"     'children': <@mamt nothing>,"
+"     'counts': <@ma{si} nothing>,"
+"     'lookup': <@ma{umt} nothing>"
+"   }>)])";
+
+static void
+test_containers(void)
+{
+    static const int ints[] = { 1, -2, 3 };
+    static const float floats[] = { 0.5f, -1.5f };
+    static const gboolean bools[] = { TRUE, FALSE, 42 };
+    static const guint8 bytes[] = { 0x00, 0xff };
+    TestNode *node = NULL;
+    TestNode *child = NULL;
+    TestNode *created = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    child = g_object_new(TEST_TYPE_NODE, NULL);
+    node = g_object_new(TEST_TYPE_NODE, NULL);
+
+    node->ints = g_array_new(FALSE, FALSE, sizeof(int));
+    g_array_append_vals(node->ints, ints, G_N_ELEMENTS(ints));
+    node->floats = g_array_new(FALSE, FALSE, sizeof(float));
+    g_array_append_vals(node->floats, floats, G_N_ELEMENTS(floats));
+    node->bools = g_array_new(FALSE, FALSE, sizeof(gboolean));
+    g_array_append_vals(node->bools, bools, G_N_ELEMENTS(bools));
+    node->bytes = g_byte_array_new();
+    g_byte_array_append(node->bytes, bytes, G_N_ELEMENTS(bytes));
+
+    node->names = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(node->names, g_strdup("a"));
+    g_ptr_array_add(node->names, NULL);
+    g_ptr_array_add(node->names, g_strdup("c"));
+
+    node->children = g_ptr_array_new_with_free_func(object_unref0);
+    g_ptr_array_add(node->children, g_object_ref(child));
+    g_ptr_array_add(node->children, NULL);
+    g_ptr_array_add(node->children, g_object_ref(child));
+
+    node->counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_insert(node->counts, g_strdup("x"), GINT_TO_POINTER(10));
+
+    node->lookup = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, g_object_unref);
+    g_hash_table_insert(node->lookup, GUINT_TO_POINTER(7), g_object_ref(child));
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(node));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_object, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_NODE(created));
+
+    g_assert_cmpuint(created->ints->len, ==, 3);
+    g_assert_cmpint(g_array_index(created->ints, int, 1), ==, -2);
+    g_assert_cmpuint(created->floats->len, ==, 2);
+    g_assert(g_array_index(created->floats, float, 1) == -1.5f);
+    g_assert_cmpuint(created->bools->len, ==, 3);
+    g_assert(g_array_index(created->bools, gboolean, 2) == TRUE);
+    g_assert_cmpuint(created->bytes->len, ==, 2);
+    g_assert_cmpuint(created->bytes->data[1], ==, 0xff);
+
+    g_assert_cmpuint(created->names->len, ==, 3);
+    g_assert_cmpstr(g_ptr_array_index(created->names, 0), ==, "a");
+    g_assert(g_ptr_array_index(created->names, 1) == NULL);
+
+    g_assert_cmpuint(created->children->len, ==, 3);
+    g_assert(TEST_IS_NODE(g_ptr_array_index(created->children, 0)));
+    g_assert(g_ptr_array_index(created->children, 0) ==
+             g_ptr_array_index(created->children, 2));
+
+    g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(created->counts, "x")), ==, 10);
+    g_assert(g_hash_table_lookup(created->lookup, GUINT_TO_POINTER(7)) ==
+             g_ptr_array_index(created->children, 0));
+
+    g_object_unref(created);
+    g_object_unref(node);
+    g_object_unref(child);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+/* A bigger array, to exercise the bulk copy */
+static void
+test_large_array(void)
+{
+    TestNode *node = NULL;
+    TestNode *created = NULL;
+    GVariant *variant = NULL;
+    guint i;
+
+    node = g_object_new(TEST_TYPE_NODE, NULL);
+    node->ints = g_array_sized_new(FALSE, FALSE, sizeof(int), 100000);
+    for (i = 0; i < 100000; i++)
+        g_array_append_val(node->ints, i);
+
+    node->counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (i = 0; i < 1000; i++)
+        g_hash_table_insert(node->counts, g_strdup_printf("%u", i), GUINT_TO_POINTER(i));
+
+    variant = gvs_gobject_serialize(G_OBJECT(node));
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert_cmpuint(created->ints->len, ==, 100000);
+    g_assert(memcmp(created->ints->data, node->ints->data, 100000 * sizeof(int)) == 0);
+    g_assert_cmpuint(g_hash_table_size(created->counts), ==, 1000);
+    g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(created->counts, "999")), ==, 999);
+
+    g_object_unref(created);
+    g_object_unref(node);
+    g_variant_unref(variant);
+}
+
+/* An array of the wrong type is dropped rather than read as ints */
+static void
+test_mismatch(void)
+{
+    TestNode *created = NULL;
+    GVariant *variant = NULL;
+    GError *error = NULL;
+
+    variant = g_variant_parse(NULL,
+                              "(uint32 1735816047, uint16 1,"
+                              " [('TestNode', <{'ints': <@mad [0.5, 1.5]>}>)])",
+                              NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_test_expect_message("Gvs", G_LOG_LEVEL_CRITICAL,
+                          "Expected a serialized GArray*");
+    created = gvs_gobject_new_deserialize(variant);
+    g_test_assert_expected_messages();
+
+    g_assert(TEST_IS_NODE(created));
+    g_assert(created->ints == NULL);
+
+    g_object_unref(created);
+    g_variant_unref(variant);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Containers/Properties", test_containers);
+   g_test_add_func("/Gvs/Containers/LargeArray", test_large_array);
+   g_test_add_func("/Gvs/Containers/Mismatch", test_mismatch);
+   return g_test_run();
+}
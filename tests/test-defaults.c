@@ -0,0 +1,416 @@
+/*
+ * Tests serialization with GVS_SERIALIZER_SKIP_DEFAULTS
+ */
+
+#include <gvs/gvs.h>
+#include <math.h>
+
+/* TestItem object */
+
+#define TEST_TYPE_ITEM            (test_item_get_type())
+#define TEST_ITEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+#define TEST_IS_ITEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_ITEM))
+
+typedef struct _TestItem        TestItem;
+typedef struct _TestItemClass   TestItemClass;
+typedef struct _TestItemPrivate TestItemPrivate;
+
+struct _TestItem
+{
+    GObject parent;
+
+    TestItemPrivate *priv;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+struct _TestItemPrivate
+{
+    int int_prop;
+    double dbl_prop;
+    char *str_prop;
+    char *name;
+    double scale;
+    TestItem *child;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_INT_PROP,
+    PROP_DBL_PROP,
+    PROP_STR_PROP,
+    PROP_NAME,
+    PROP_SCALE,
+    PROP_CHILD
+};
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    switch (prop_id)
+    {
+        case PROP_INT_PROP:
+            priv->int_prop = g_value_get_int(value);
+            break;
+
+        case PROP_DBL_PROP:
+            priv->dbl_prop = g_value_get_double(value);
+            break;
+
+        case PROP_STR_PROP:
+            g_free(priv->str_prop);
+            priv->str_prop = g_value_dup_string(value);
+            break;
+
+        case PROP_NAME:
+            g_free(priv->name);
+            priv->name = g_value_dup_string(value);
+            break;
+
+        case PROP_SCALE:
+            priv->scale = g_value_get_double(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&priv->child);
+            priv->child = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    switch (prop_id)
+    {
+        case PROP_INT_PROP:
+            g_value_set_int(value, priv->int_prop);
+            break;
+
+        case PROP_DBL_PROP:
+            g_value_set_double(value, priv->dbl_prop);
+            break;
+
+        case PROP_STR_PROP:
+            g_value_set_string(value, priv->str_prop);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, priv->name);
+            break;
+
+        case PROP_SCALE:
+            g_value_set_double(value, priv->scale);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, priv->child);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_finalize(GObject *obj)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    g_free(priv->str_prop);
+    g_free(priv->name);
+    g_clear_object(&priv->child);
+
+    G_OBJECT_CLASS(test_item_parent_class)->finalize(obj);
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+    gobject_class->finalize = test_item_finalize;
+
+    /* Properties with plain field storage */
+    pspec = g_param_spec_int("int-prop", "int-prop", "int-prop",
+                             G_MININT, G_MAXINT, 7,
+                             G_PARAM_READWRITE |
+                             G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_INT_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, int_prop),
+                                 GVS_FIELD_INT);
+
+    pspec = g_param_spec_double("dbl-prop", "dbl-prop", "dbl-prop",
+                                -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_DBL_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, dbl_prop),
+                                 GVS_FIELD_DOUBLE);
+
+    pspec = g_param_spec_string("str-prop", "str-prop", "str-prop", "hello",
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_STR_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, str_prop),
+                                 GVS_FIELD_STRING);
+
+    /* ...and without */
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", "unnamed",
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_SCALE,
+            g_param_spec_double("scale", "scale", "scale",
+                                -G_MAXDOUBLE, G_MAXDOUBLE, 1.0,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child",
+                                TEST_TYPE_ITEM,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_item_init(TestItem *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, TEST_TYPE_ITEM, TestItemPrivate);
+
+    /* The same as the paramspec defaults */
+    self->priv->int_prop = 7;
+    self->priv->str_prop = g_strdup("hello");
+    self->priv->name = g_strdup("unnamed");
+    self->priv->scale = 1.0;
+}
+
+/* TestSized object, whose instance init disagrees with its paramspecs */
+
+#define TEST_TYPE_SIZED           (test_sized_get_type())
+#define TEST_SIZED(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_SIZED, TestSized))
+#define TEST_IS_SIZED(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_SIZED))
+
+typedef struct _TestSized      TestSized;
+typedef struct _TestSizedClass TestSizedClass;
+
+struct _TestSized
+{
+    GObject parent;
+
+    int width;
+    int height;
+};
+
+struct _TestSizedClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestSized, test_sized, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_SIZED_0,
+    PROP_WIDTH,
+    PROP_HEIGHT
+};
+
+static void
+test_sized_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_WIDTH:
+            TEST_SIZED(obj)->width = g_value_get_int(value);
+            break;
+
+        case PROP_HEIGHT:
+            TEST_SIZED(obj)->height = g_value_get_int(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_sized_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_WIDTH:
+            g_value_set_int(value, TEST_SIZED(obj)->width);
+            break;
+
+        case PROP_HEIGHT:
+            g_value_set_int(value, TEST_SIZED(obj)->height);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_sized_class_init(TestSizedClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_sized_set_property;
+    gobject_class->get_property = test_sized_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_WIDTH,
+            g_param_spec_int("width", "width", "width", 0, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_int("height", "height", "height", 0, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_HEIGHT, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestSized, height),
+                                 GVS_FIELD_INT);
+}
+
+static void
+test_sized_init(TestSized *self)
+{
+    self->width = 100;
+    self->height = 50;
+}
+
+static const char serialized_object[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestItem', <{"
+"     'dbl-prop': <-0.0>,"
+"     'name': <@ms 'parent'>,"
+"     'child': <@mt 1>"
+"   }>),"
+"  ('TestItem', <@a{sv} {}>)])";
+
+static void
+test_skip_defaults(void)
+{
+    GvsSerializer *serializer = NULL;
+    TestItem *parent = NULL;
+    TestItem *child = NULL;
+    TestItem *created = NULL;
+    TestItemPrivate *priv;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    /* -0.0 compares equal to the default of 0.0, but is not the same value */
+    child = g_object_new(TEST_TYPE_ITEM, NULL);
+    parent = g_object_new(TEST_TYPE_ITEM,
+                          "dbl-prop", -0.0,
+                          "name", "parent",
+                          "child", child,
+                          NULL);
+
+    serializer = gvs_serializer_new();
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_SKIP_DEFAULTS);
+    g_assert_cmpint(gvs_serializer_get_flags(serializer), ==,
+                    GVS_SERIALIZER_SKIP_DEFAULTS);
+
+    variant1 = gvs_serializer_serialize_object(serializer, G_OBJECT(parent));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_object, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_ITEM(created));
+
+    priv = created->priv;
+    g_assert_cmpint(priv->int_prop, ==, 7);
+    g_assert(priv->dbl_prop == 0.0 && signbit(priv->dbl_prop));
+    g_assert_cmpstr(priv->str_prop, ==, "hello");
+    g_assert_cmpstr(priv->name, ==, "parent");
+    g_assert(priv->scale == 1.0);
+    g_assert(TEST_IS_ITEM(priv->child));
+    g_assert_cmpstr(priv->child->priv->name, ==, "unnamed");
+    g_assert(priv->child->priv->child == NULL);
+
+    g_object_unref(created);
+    g_object_unref(serializer);
+    g_object_unref(parent);
+    g_object_unref(child);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+/* Defaults are what a new instance holds, not what the paramspec says */
+static void
+test_instance_defaults(void)
+{
+    GvsSerializer *serializer = NULL;
+    TestSized *sized = NULL;
+    TestSized *created = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    sized = g_object_new(TEST_TYPE_SIZED, "width", 0, NULL);
+
+    serializer = gvs_serializer_new();
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_SKIP_DEFAULTS);
+
+    variant1 = gvs_serializer_serialize_object(serializer, G_OBJECT(sized));
+    variant2 = g_variant_parse(NULL,
+                               "(uint32 1735816047, uint16 1,"
+                               " [('TestSized', <{'width': <0>}>)])",
+                               NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created = gvs_gobject_new_deserialize(variant1);
+    g_assert(TEST_IS_SIZED(created));
+    g_assert_cmpint(created->width, ==, 0);
+    g_assert_cmpint(created->height, ==, 50);
+
+    g_object_unref(created);
+    g_object_unref(serializer);
+    g_object_unref(sized);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/SkipDefaults", test_skip_defaults);
+   g_test_add_func("/Gvs/SkipDefaults/Instance", test_instance_defaults);
+   return g_test_run();
+}
@@ -0,0 +1,479 @@
+/*
+ * Tests canonical documents, entity hashes and document diffs
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestNode object, with a name, a value, a child and a table of counts */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    int value;
+    TestNode *child;
+    GHashTable *counts;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD,
+    PROP_COUNTS
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        case PROP_COUNTS:
+            g_clear_pointer(&self->counts, g_hash_table_unref);
+            self->counts = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        case PROP_COUNTS:
+            g_value_set_boxed(value, self->counts);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->child);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+    g_clear_pointer(&TEST_NODE(obj)->counts, g_hash_table_unref);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    /* Installed out of order of name, which canonical documents fix */
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_boxed("counts", "counts", "counts", G_TYPE_HASH_TABLE,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_COUNTS, pspec);
+    gvs_register_property_key_value_types(pspec, G_TYPE_STRING, G_TYPE_INT);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* Tests */
+
+static TestNode *
+node_new(const char *name, int value, TestNode *child)
+{
+    return g_object_new(TEST_TYPE_NODE, "name", name, "value", value,
+                        "child", child, NULL);
+}
+
+/* A chain of three nodes: root -> middle -> leaf, with @leaf_value */
+static TestNode *
+make_chain(int leaf_value)
+{
+    TestNode *leaf = node_new("leaf", leaf_value, NULL);
+    TestNode *middle = node_new("middle", 2, leaf);
+    TestNode *root = node_new("root", 1, middle);
+
+    g_object_unref(middle);
+    g_object_unref(leaf);
+
+    return root;
+}
+
+static GVariant *
+serialize_with_flags(gpointer object, GvsSerializerFlags flags)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_CANONICAL | flags);
+    document = gvs_serializer_serialize_object(serializer, object);
+    g_object_unref(serializer);
+
+    return document;
+}
+
+static GVariant *
+serialize_canonical(gpointer object)
+{
+    return serialize_with_flags(object, GVS_SERIALIZER_FLAGS_NONE);
+}
+
+static GListStore *
+make_store(guint n_items, ...)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_NODE);
+    va_list args;
+    guint i;
+
+    va_start(args, n_items);
+    for (i = 0; i < n_items; i++)
+        g_list_store_append(store, va_arg(args, gpointer));
+    va_end(args);
+
+    return store;
+}
+
+static void
+test_diff_canonical(void)
+{
+    const char *keys[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    TestNode *first = node_new("node", 1, NULL);
+    TestNode *second = node_new("node", 1, NULL);
+    GVariant *first_document, *second_document;
+    GVariant *payload;
+    GVariantIter iter;
+    const char *name, *last = "";
+    guint i;
+
+    /* The same counts, filled in opposite orders */
+    first->counts = g_hash_table_new(g_str_hash, g_str_equal);
+    second->counts = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < G_N_ELEMENTS(keys); i++)
+    {
+        g_hash_table_insert(first->counts, (gpointer) keys[i], GINT_TO_POINTER(i));
+        g_hash_table_insert(second->counts, (gpointer) keys[G_N_ELEMENTS(keys) - 1 - i],
+                            GINT_TO_POINTER(G_N_ELEMENTS(keys) - 1 - i));
+    }
+
+    first_document = serialize_canonical(first);
+    second_document = serialize_canonical(second);
+    g_assert(g_variant_equal(first_document, second_document));
+
+    /* Properties are in order of name */
+    g_variant_get_child(first_document, 2, "@a(sv)", &payload);
+    g_variant_get_child(payload, 0, "(&sv)", NULL, &payload);
+    g_variant_iter_init(&iter, payload);
+    while (g_variant_iter_next(&iter, "{&s*}", &name, NULL))
+    {
+        g_assert_cmpstr(last, <, name);
+        last = name;
+    }
+
+    g_variant_unref(payload);
+    g_variant_unref(first_document);
+    g_variant_unref(second_document);
+    g_object_unref(first);
+    g_object_unref(second);
+}
+
+static void
+test_diff_hash(void)
+{
+    TestNode *first_chain = make_chain(3), *second_chain = make_chain(3);
+    TestNode *other_chain = make_chain(4);
+    GListStore *first_store = make_store(2, first_chain, other_chain);
+    GListStore *second_store = make_store(2, other_chain, second_chain);
+    GVariant *first_document = serialize_canonical(first_store);
+    GVariant *second_document = serialize_canonical(second_store);
+    GvsView *first_view = gvs_view_new(first_document);
+    GvsView *second_view = gvs_view_new(second_document);
+    gsize first_id, second_id, other_id;
+
+    g_assert(gvs_view_get_entity_hash(first_view, 7) == NULL);
+    g_assert_cmpuint(strlen(gvs_view_get_entity_hash(first_view, 0)), ==, 64);
+    g_assert_cmpstr(gvs_view_get_entity_hash(first_view, 0), !=,
+                    gvs_view_get_entity_hash(second_view, 0));
+
+    /* Equal chains hash the same wherever they are, and different ones
+     * don't, though only their leaves differ */
+    g_assert(gvs_view_lookup_entity(first_view, 0, "0", &first_id));
+    g_assert(gvs_view_lookup_entity(second_view, 0, "1", &second_id));
+    g_assert(gvs_view_lookup_entity(second_view, 0, "0", &other_id));
+    g_assert_cmpuint(first_id, !=, second_id);
+    g_assert_cmpstr(gvs_view_get_entity_hash(first_view, first_id), ==,
+                    gvs_view_get_entity_hash(second_view, second_id));
+    g_assert_cmpstr(gvs_view_get_entity_hash(first_view, first_id), !=,
+                    gvs_view_get_entity_hash(second_view, other_id));
+
+    g_assert(gvs_view_lookup_entity(first_view, 0, "0/child/child", &first_id));
+    g_assert(gvs_view_lookup_entity(second_view, 0, "1/child/child", &second_id));
+    g_assert_cmpstr(gvs_view_get_entity_hash(first_view, first_id), ==,
+                    gvs_view_get_entity_hash(second_view, second_id));
+
+    g_object_unref(first_view);
+    g_object_unref(second_view);
+    g_variant_unref(first_document);
+    g_variant_unref(second_document);
+    g_object_unref(first_store);
+    g_object_unref(second_store);
+    g_object_unref(first_chain);
+    g_object_unref(second_chain);
+    g_object_unref(other_chain);
+}
+
+static void
+test_diff_changed(void)
+{
+    TestNode *old_root = make_chain(3), *new_root = make_chain(4);
+    GVariant *old_document = serialize_canonical(old_root);
+    GVariant *new_document = serialize_canonical(new_root);
+    GPtrArray *diff;
+    GvsDiffEntry *entry;
+
+    diff = gvs_document_diff(old_document, old_document);
+    g_assert_cmpuint(diff->len, ==, 0);
+    g_ptr_array_unref(diff);
+
+    /* Only the leaf changed itself, though every hash above it differs */
+    diff = gvs_document_diff(old_document, new_document);
+    g_assert_cmpuint(diff->len, ==, 1);
+    entry = g_ptr_array_index(diff, 0);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_CHANGED);
+    g_assert_cmpuint(entry->old_id, ==, 2);
+    g_assert_cmpuint(entry->new_id, ==, 2);
+    g_assert_cmpuint(g_strv_length(entry->properties), ==, 1);
+    g_assert_cmpstr(entry->properties[0], ==, "value");
+    g_ptr_array_unref(diff);
+
+    /* Cutting off the leaf removes it, and changes its parent */
+    g_object_set(new_root->child, "child", NULL, NULL);
+    g_variant_unref(new_document);
+    new_document = serialize_canonical(new_root);
+
+    diff = gvs_document_diff(old_document, new_document);
+    g_assert_cmpuint(diff->len, ==, 2);
+    entry = g_ptr_array_index(diff, 0);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_CHANGED);
+    g_assert_cmpuint(entry->old_id, ==, 1);
+    g_assert_cmpstr(entry->properties[0], ==, "child");
+    entry = g_ptr_array_index(diff, 1);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_REMOVED);
+    g_assert_cmpuint(entry->old_id, ==, 2);
+    g_assert_cmpuint(entry->new_id, ==, GVS_DIFF_NO_ENTITY);
+    g_ptr_array_unref(diff);
+
+    g_variant_unref(old_document);
+    g_variant_unref(new_document);
+    g_object_unref(old_root);
+    g_object_unref(new_root);
+}
+
+static void
+test_diff_list(void)
+{
+    TestNode *a = node_new("a", 1, NULL), *b = node_new("b", 2, NULL);
+    TestNode *c = node_new("c", 3, NULL);
+    GListStore *old_store = make_store(2, a, b);
+    GListStore *new_store = make_store(3, a, b, c);
+    GVariant *old_document = serialize_canonical(old_store);
+    GVariant *new_document = serialize_canonical(new_store);
+    GPtrArray *diff;
+    GvsDiffEntry *entry;
+
+    diff = gvs_document_diff(old_document, new_document);
+    g_assert_cmpuint(diff->len, ==, 2);
+    entry = g_ptr_array_index(diff, 0);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_CHANGED);
+    g_assert_cmpuint(entry->old_id, ==, 0);
+    g_assert_cmpuint(g_strv_length(entry->properties), ==, 1);
+    g_assert_cmpstr(entry->properties[0], ==, "2");
+    entry = g_ptr_array_index(diff, 1);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_ADDED);
+    g_assert_cmpuint(entry->old_id, ==, GVS_DIFF_NO_ENTITY);
+    g_assert_cmpuint(entry->new_id, ==, 3);
+    g_ptr_array_unref(diff);
+
+    /* Swapping items changes positions, but adds or removes nothing */
+    g_variant_unref(new_document);
+    g_object_unref(new_store);
+    new_store = make_store(2, b, a);
+    new_document = serialize_canonical(new_store);
+
+    diff = gvs_document_diff(old_document, new_document);
+    g_assert_cmpuint(diff->len, ==, 1);
+    entry = g_ptr_array_index(diff, 0);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_CHANGED);
+    g_assert_cmpuint(g_strv_length(entry->properties), ==, 2);
+    g_ptr_array_unref(diff);
+
+    g_variant_unref(old_document);
+    g_variant_unref(new_document);
+    g_object_unref(old_store);
+    g_object_unref(new_store);
+    g_object_unref(a);
+    g_object_unref(b);
+    g_object_unref(c);
+}
+
+static void
+test_diff_cycle(void)
+{
+    TestNode *first = node_new("first", 1, NULL);
+    TestNode *second = node_new("second", 2, first);
+    GVariant *document;
+    GvsView *view;
+    GPtrArray *diff;
+
+    g_object_set(first, "child", second, NULL);
+    document = serialize_canonical(first);
+    view = gvs_view_new(document);
+
+    g_assert(gvs_view_get_entity_hash(view, 1) != NULL);
+    g_assert_cmpstr(gvs_view_get_entity_hash(view, 0), !=,
+                    gvs_view_get_entity_hash(view, 1));
+
+    diff = gvs_view_diff(view, view);
+    g_assert_cmpuint(diff->len, ==, 0);
+    g_ptr_array_unref(diff);
+
+    g_object_unref(view);
+    g_variant_unref(document);
+    g_object_set(first, "child", NULL, NULL);
+    g_object_unref(first);
+    g_object_unref(second);
+}
+
+/* Strings in a value table are compared as strings, not as the entities
+ * their indices would be in a compact document */
+static void
+test_diff_value_table(void)
+{
+    const GvsSerializerFlags flags = GVS_SERIALIZER_VALUE_TABLE | GVS_SERIALIZER_COMPACT;
+    TestNode *first = node_new("first", 1, NULL), *second = node_new("second", 1, NULL);
+    GVariant *first_document = serialize_with_flags(first, flags);
+    GVariant *second_document = serialize_with_flags(second, flags);
+    GVariant *plain_document = serialize_canonical(first);
+    GvsView *first_view = gvs_view_new(first_document);
+    GvsView *plain_view = gvs_view_new(plain_document);
+    GVariant *name;
+    const char *string = NULL;
+    GPtrArray *diff;
+    GvsDiffEntry *entry;
+
+    /* Views read the string through the table */
+    name = gvs_view_get_property(first_view, 0, "name");
+    g_variant_get(name, "m&s", &string);
+    g_assert_cmpstr(string, ==, "first");
+    g_variant_unref(name);
+
+    g_assert_cmpstr(gvs_view_get_entity_hash(first_view, 0), ==,
+                    gvs_view_get_entity_hash(plain_view, 0));
+
+    diff = gvs_document_diff(first_document, second_document);
+    g_assert_cmpuint(diff->len, ==, 1);
+    entry = g_ptr_array_index(diff, 0);
+    g_assert_cmpint(entry->kind, ==, GVS_DIFF_CHANGED);
+    g_assert_cmpuint(g_strv_length(entry->properties), ==, 1);
+    g_assert_cmpstr(entry->properties[0], ==, "name");
+    g_ptr_array_unref(diff);
+
+    g_object_unref(first_view);
+    g_object_unref(plain_view);
+    g_variant_unref(first_document);
+    g_variant_unref(second_document);
+    g_variant_unref(plain_document);
+    g_object_unref(first);
+    g_object_unref(second);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Diff/Canonical", test_diff_canonical);
+   g_test_add_func("/Gvs/Diff/Hash", test_diff_hash);
+   g_test_add_func("/Gvs/Diff/Changed", test_diff_changed);
+   g_test_add_func("/Gvs/Diff/List", test_diff_list);
+   g_test_add_func("/Gvs/Diff/Cycle", test_diff_cycle);
+   g_test_add_func("/Gvs/Diff/ValueTable", test_diff_value_table);
+   return g_test_run();
+}
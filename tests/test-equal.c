@@ -0,0 +1,506 @@
+/*
+ * Tests gvs_gobject_equal() and gvs_gobject_hash()
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestNode object, with a construct-only serial number, a name, a value
+ * stored as a plain field, a child, a list of children, a table of counts
+ * and a transient cache */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    int serial;
+    char *name;
+    int value;
+    TestNode *child;
+    GPtrArray *children;
+    GHashTable *counts;
+    int cache;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_SERIAL,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD,
+    PROP_CHILDREN,
+    PROP_COUNTS,
+    PROP_CACHE
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_SERIAL:
+            self->serial = g_value_get_int(value);
+            break;
+
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        case PROP_CHILDREN:
+            g_clear_pointer(&self->children, g_ptr_array_unref);
+            self->children = g_value_dup_boxed(value);
+            break;
+
+        case PROP_COUNTS:
+            g_clear_pointer(&self->counts, g_hash_table_unref);
+            self->counts = g_value_dup_boxed(value);
+            break;
+
+        case PROP_CACHE:
+            self->cache = g_value_get_int(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_SERIAL:
+            g_value_set_int(value, self->serial);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        case PROP_CHILDREN:
+            g_value_set_boxed(value, self->children);
+            break;
+
+        case PROP_COUNTS:
+            g_value_set_boxed(value, self->counts);
+            break;
+
+        case PROP_CACHE:
+            g_value_set_int(value, self->cache);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    g_clear_object(&self->child);
+    g_clear_pointer(&self->children, g_ptr_array_unref);
+    g_clear_pointer(&self->counts, g_hash_table_unref);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_SERIAL,
+            g_param_spec_int("serial", "serial", "serial", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                             G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_VALUE, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestNode, value), GVS_FIELD_INT);
+
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_boxed("children", "children", "children", G_TYPE_PTR_ARRAY,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CHILDREN, pspec);
+    gvs_register_property_element_type(pspec, TEST_TYPE_NODE);
+
+    pspec = g_param_spec_boxed("counts", "counts", "counts", G_TYPE_HASH_TABLE,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_COUNTS, pspec);
+    gvs_register_property_key_value_types(pspec, G_TYPE_STRING, G_TYPE_INT);
+
+    pspec = g_param_spec_int("cache", "cache", "cache", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CACHE, pspec);
+    gvs_register_property_transient(pspec);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* TestTag object, whose label is serialized in upper case */
+
+#define TEST_TYPE_TAG            (test_tag_get_type())
+#define TEST_TAG(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_TAG, TestTag))
+
+typedef struct _TestTag      TestTag;
+typedef struct _TestTagClass TestTagClass;
+
+struct _TestTag
+{
+    GObject parent;
+
+    char *label;
+};
+
+struct _TestTagClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestTag, test_tag, G_TYPE_OBJECT);
+
+static void
+test_tag_set_property(GObject *obj,
+                      guint prop_id,
+                      const GValue *value,
+                      GParamSpec *pspec)
+{
+    g_free(TEST_TAG(obj)->label);
+    TEST_TAG(obj)->label = g_value_dup_string(value);
+}
+
+static void
+test_tag_get_property(GObject *obj,
+                      guint prop_id,
+                      GValue *value,
+                      GParamSpec *pspec)
+{
+    g_value_set_string(value, TEST_TAG(obj)->label);
+}
+
+static void
+test_tag_finalize(GObject *obj)
+{
+    g_free(TEST_TAG(obj)->label);
+
+    G_OBJECT_CLASS(test_tag_parent_class)->finalize(obj);
+}
+
+static GVariant *
+serialize_label(GvsSerializer *serializer, const GValue *value, gpointer user_data)
+{
+    char *upper = g_ascii_strup(g_value_get_string(value), -1);
+    GVariant *variant = g_variant_new("ms", upper);
+
+    g_free(upper);
+
+    return variant;
+}
+
+static void
+test_tag_class_init(TestTagClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_tag_set_property;
+    gobject_class->get_property = test_tag_get_property;
+    gobject_class->finalize = test_tag_finalize;
+
+    pspec = g_param_spec_string("label", "label", "label", "",
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, 1, pspec);
+    gvs_register_property_serialize_func(pspec, serialize_label);
+}
+
+static void
+test_tag_init(TestTag *self)
+{
+}
+
+/* Tests */
+
+static TestNode *
+node_new(int serial, const char *name, int value, TestNode *child)
+{
+    return g_object_new(TEST_TYPE_NODE, "serial", serial, "name", name,
+                        "value", value, "child", child, NULL);
+}
+
+/* A chain of three nodes: root -> middle -> leaf, with @leaf_value */
+static TestNode *
+make_chain(int leaf_value)
+{
+    TestNode *leaf = node_new(3, "leaf", leaf_value, NULL);
+    TestNode *middle = node_new(2, "middle", 2, leaf);
+    TestNode *root = node_new(1, "root", 1, middle);
+
+    g_object_unref(middle);
+    g_object_unref(leaf);
+
+    return root;
+}
+
+static void
+assert_equal(gpointer a, gpointer b)
+{
+    g_assert(gvs_gobject_equal(a, b));
+    g_assert(gvs_gobject_equal(b, a));
+    g_assert_cmpuint(gvs_gobject_hash(a), ==, gvs_gobject_hash(b));
+}
+
+static void
+assert_not_equal(gpointer a, gpointer b)
+{
+    g_assert(!gvs_gobject_equal(a, b));
+    g_assert(!gvs_gobject_equal(b, a));
+}
+
+static void
+test_equal_values(void)
+{
+    TestNode *a = make_chain(3), *b = make_chain(3), *c = make_chain(4);
+
+    assert_equal(a, a);
+    assert_equal(a, b);
+    assert_not_equal(a, c);
+
+    /* Transient properties don't count, construct-only ones do */
+    g_object_set(b->child, "cache", 42, NULL);
+    assert_equal(a, b);
+    g_object_unref(b);
+    b = node_new(5, "root", 1, a->child);
+    assert_not_equal(a, b);
+
+    /* Nor do those in plain fields */
+    g_object_set(c->child->child, "value", 3, NULL);
+    assert_equal(a, c);
+    g_object_set(c, "name", NULL, NULL);
+    assert_not_equal(a, c);
+
+    g_object_unref(a);
+    g_object_unref(b);
+    g_object_unref(c);
+}
+
+static void
+test_equal_shared(void)
+{
+    TestNode *shared = node_new(3, "shared", 30, NULL);
+    TestNode *duplicate = node_new(3, "shared", 30, NULL);
+    TestNode *a = node_new(1, "root", 1, shared);
+    TestNode *b = node_new(1, "root", 1, shared);
+
+    a->children = g_ptr_array_new_with_free_func(g_object_unref);
+    g_ptr_array_add(a->children, g_object_ref(shared));
+    b->children = g_ptr_array_new_with_free_func(g_object_unref);
+    g_ptr_array_add(b->children, g_object_ref(shared));
+    assert_equal(a, b);
+
+    /* An equal object in place of a shared one is a different graph */
+    g_ptr_array_remove_index(b->children, 0);
+    g_ptr_array_add(b->children, g_object_ref(duplicate));
+    assert_not_equal(a, b);
+
+    g_object_unref(a);
+    g_object_unref(b);
+    g_object_unref(shared);
+    g_object_unref(duplicate);
+}
+
+static void
+test_equal_cycle(void)
+{
+    TestNode *a1 = node_new(1, "first", 1, NULL), *a2 = node_new(2, "second", 2, a1);
+    TestNode *b1 = node_new(1, "first", 1, NULL), *b2 = node_new(2, "second", 2, b1);
+    TestNode *c = node_new(1, "first", 1, NULL);
+
+    g_object_set(a1, "child", a2, NULL);
+    g_object_set(b1, "child", b2, NULL);
+    assert_equal(a1, b1);
+    assert_not_equal(a1, b2);
+
+    /* first -> second -> first is not first -> second -> first' */
+    g_object_set(b2, "child", c, NULL);
+    assert_not_equal(a1, b1);
+
+    g_object_set(a1, "child", NULL, NULL);
+    g_object_set(b1, "child", NULL, NULL);
+    g_object_unref(a1);
+    g_object_unref(a2);
+    g_object_unref(b1);
+    g_object_unref(b2);
+    g_object_unref(c);
+}
+
+static void
+test_equal_hash_table(void)
+{
+    const char *keys[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    TestNode *a = node_new(1, "node", 1, NULL), *b = node_new(1, "node", 1, NULL);
+    guint i, n = G_N_ELEMENTS(keys);
+
+    a->counts = g_hash_table_new(g_str_hash, g_str_equal);
+    b->counts = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < n; i++)
+    {
+        g_hash_table_insert(a->counts, (gpointer) keys[i], GINT_TO_POINTER(i));
+        g_hash_table_insert(b->counts, (gpointer) keys[n - 1 - i], GINT_TO_POINTER(n - 1 - i));
+    }
+    assert_equal(a, b);
+
+    g_hash_table_insert(b->counts, (gpointer) keys[0], GINT_TO_POINTER(100));
+    assert_not_equal(a, b);
+
+    g_object_unref(a);
+    g_object_unref(b);
+}
+
+static void
+test_equal_list_store(void)
+{
+    GListStore *a = g_list_store_new(TEST_TYPE_NODE), *b = g_list_store_new(TEST_TYPE_NODE);
+    TestNode *first = make_chain(3), *second = make_chain(4), *copy;
+
+    g_list_store_append(a, first);
+    g_list_store_append(a, second);
+    g_list_store_append(b, first);
+    assert_not_equal(a, b);
+
+    copy = gvs_gobject_clone(G_OBJECT(second));
+    g_list_store_append(b, copy);
+    assert_equal(a, b);
+
+    /* Order counts in a list */
+    g_list_store_remove(b, 0);
+    g_list_store_append(b, first);
+    assert_not_equal(a, b);
+
+    g_object_unref(copy);
+    g_object_unref(first);
+    g_object_unref(second);
+    g_object_unref(a);
+    g_object_unref(b);
+}
+
+/* Equality agrees with comparing serialized documents */
+static void
+test_equal_serialized(void)
+{
+    TestNode *a = make_chain(3), *b = make_chain(3), *c = make_chain(4);
+    GVariant *document_a = gvs_gobject_serialize(G_OBJECT(a));
+    GVariant *document_b = gvs_gobject_serialize(G_OBJECT(b));
+    GVariant *document_c = gvs_gobject_serialize(G_OBJECT(c));
+
+    g_assert(g_variant_equal(document_a, document_b));
+    g_assert(gvs_gobject_equal(G_OBJECT(a), G_OBJECT(b)));
+    g_assert(!g_variant_equal(document_a, document_c));
+    g_assert(!gvs_gobject_equal(G_OBJECT(a), G_OBJECT(c)));
+
+    g_variant_unref(document_a);
+    g_variant_unref(document_b);
+    g_variant_unref(document_c);
+    g_object_unref(a);
+    g_object_unref(b);
+    g_object_unref(c);
+}
+
+/* Custom serialization is compared by the documents it produces */
+static void
+test_equal_custom(void)
+{
+    TestTag *a = g_object_new(TEST_TYPE_TAG, "label", "hello", NULL);
+    TestTag *b = g_object_new(TEST_TYPE_TAG, "label", "HELLO", NULL);
+    TestTag *c = g_object_new(TEST_TYPE_TAG, "label", "world", NULL);
+
+    assert_equal(a, b);
+    assert_not_equal(a, c);
+
+    g_object_unref(a);
+    g_object_unref(b);
+    g_object_unref(c);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Equal/Values", test_equal_values);
+   g_test_add_func("/Gvs/Equal/Shared", test_equal_shared);
+   g_test_add_func("/Gvs/Equal/Cycle", test_equal_cycle);
+   g_test_add_func("/Gvs/Equal/HashTable", test_equal_hash_table);
+   g_test_add_func("/Gvs/Equal/ListStore", test_equal_list_store);
+   g_test_add_func("/Gvs/Equal/Serialized", test_equal_serialized);
+   g_test_add_func("/Gvs/Equal/Custom", test_equal_custom);
+   return g_test_run();
+}
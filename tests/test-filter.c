@@ -0,0 +1,436 @@
+/*
+ * Tests selective deserialization with type and property filters
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestOther object, with a name */
+
+#define TEST_TYPE_OTHER          (test_other_get_type())
+#define TEST_OTHER(obj)          (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_OTHER, TestOther))
+#define TEST_IS_OTHER(obj)       (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_OTHER))
+
+typedef struct _TestOther      TestOther;
+typedef struct _TestOtherClass TestOtherClass;
+
+struct _TestOther
+{
+    GObject parent;
+
+    char *name;
+};
+
+struct _TestOtherClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestOther, test_other, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD,
+    PROP_EXTRA
+};
+
+static void
+test_other_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(TEST_OTHER(obj)->name);
+            TEST_OTHER(obj)->name = g_value_dup_string(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_other_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, TEST_OTHER(obj)->name);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_other_finalize(GObject *obj)
+{
+    g_free(TEST_OTHER(obj)->name);
+
+    G_OBJECT_CLASS(test_other_parent_class)->finalize(obj);
+}
+
+static void
+test_other_class_init(TestOtherClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_other_set_property;
+    gobject_class->get_property = test_other_get_property;
+    gobject_class->finalize = test_other_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_other_init(TestOther *self)
+{
+}
+
+/* TestNode object, with a name, a value, a child node and an extra
+ * TestOther, which starts out as one named "initial" */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    int value;
+    TestNode *child;
+    TestOther *extra;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        case PROP_EXTRA:
+            g_clear_object(&self->extra);
+            self->extra = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        case PROP_EXTRA:
+            g_value_set_object(value, self->extra);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->child);
+    g_clear_object(&TEST_NODE(obj)->extra);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_EXTRA,
+            g_param_spec_object("extra", "extra", "extra", TEST_TYPE_OTHER,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_node_init(TestNode *self)
+{
+    self->extra = g_object_new(TEST_TYPE_OTHER, "name", "initial", NULL);
+}
+
+/* Tests */
+
+/* root -> child, each with an extra */
+static GVariant *
+serialize_tree(GvsSerializerFlags flags)
+{
+    TestOther *extra1 = g_object_new(TEST_TYPE_OTHER, "name", "extra-1", NULL);
+    TestOther *extra2 = g_object_new(TEST_TYPE_OTHER, "name", "extra-2", NULL);
+    TestNode *child = g_object_new(TEST_TYPE_NODE, "name", "child", "value", 2,
+                                   "extra", extra2, NULL);
+    TestNode *root = g_object_new(TEST_TYPE_NODE, "name", "root", "value", 1,
+                                  "child", child, "extra", extra1, NULL);
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+
+    gvs_serializer_set_flags(serializer, flags);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(root));
+
+    g_object_unref(serializer);
+    g_object_unref(root);
+    g_object_unref(child);
+    g_object_unref(extra2);
+    g_object_unref(extra1);
+
+    return document;
+}
+
+static guint64
+n_created(GvsDeserializer *deserializer)
+{
+    GvsStats *stats = gvs_deserializer_get_stats(deserializer);
+    guint64 n = gvs_stats_get_n_entities(stats);
+
+    gvs_stats_free(stats);
+    gvs_deserializer_reset_stats(deserializer);
+
+    return n;
+}
+
+static void
+check_types(GvsSerializerFlags flags)
+{
+    GVariant *document = serialize_tree(flags);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    GType types[] = { TEST_TYPE_NODE };
+    TestNode *root;
+
+    gvs_deserializer_include_types(deserializer, types, G_N_ELEMENTS(types));
+
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 2);
+    g_assert_cmpstr(root->name, ==, "root");
+    g_assert_cmpstr(root->child->name, ==, "child");
+    g_assert(root->extra == NULL);
+    g_assert(root->child->extra == NULL);
+    g_object_unref(root);
+
+    /* Left alone rather than set to NULL */
+    gvs_deserializer_set_skip_filtered_refs(deserializer, TRUE);
+    g_assert(gvs_deserializer_get_skip_filtered_refs(deserializer));
+
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 2);
+    g_assert_cmpstr(root->extra->name, ==, "initial");
+    g_assert_cmpstr(root->child->extra->name, ==, "initial");
+    g_object_unref(root);
+
+    /* And back again */
+    gvs_deserializer_include_types(deserializer, NULL, 0);
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 4);
+    g_assert_cmpstr(root->extra->name, ==, "extra-1");
+    g_object_unref(root);
+
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_filter_types(void)
+{
+    check_types(GVS_SERIALIZER_FLAGS_NONE);
+}
+
+static void
+test_filter_columns(void)
+{
+    check_types(GVS_SERIALIZER_COLUMNAR);
+}
+
+/* The root is created whatever its type */
+static void
+test_filter_root(void)
+{
+    TestOther *other = g_object_new(TEST_TYPE_OTHER, "name", "other", NULL);
+    GVariant *document = gvs_gobject_serialize(G_OBJECT(other));
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    GType types[] = { TEST_TYPE_NODE };
+    TestOther *created;
+
+    gvs_deserializer_include_types(deserializer, types, G_N_ELEMENTS(types));
+
+    created = gvs_deserializer_deserialize(deserializer, document);
+    g_assert(TEST_IS_OTHER(created));
+    g_assert_cmpstr(created->name, ==, "other");
+
+    g_object_unref(created);
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+    g_object_unref(other);
+}
+
+static void
+test_filter_properties(void)
+{
+    GVariant *document = serialize_tree(GVS_SERIALIZER_FLAGS_NONE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    const char *names[] = { "name", NULL };
+    const char *value[] = { "value", NULL };
+    TestNode *root;
+
+    /* Without the child, only the root and its extra are created */
+    gvs_deserializer_include_properties(deserializer, TEST_TYPE_NODE, names);
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 1);
+    g_assert_cmpstr(root->name, ==, "root");
+    g_assert_cmpint(root->value, ==, 0);
+    g_assert(root->child == NULL);
+    g_assert_cmpstr(root->extra->name, ==, "initial");
+    g_object_unref(root);
+
+    gvs_deserializer_include_properties(deserializer, TEST_TYPE_NODE, NULL);
+    gvs_deserializer_exclude_properties(deserializer, G_TYPE_OBJECT, value);
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 4);
+    g_assert_cmpint(root->value, ==, 0);
+    g_assert_cmpint(root->child->value, ==, 0);
+    g_assert_cmpstr(root->child->extra->name, ==, "extra-2");
+    g_object_unref(root);
+
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_filter_list(void)
+{
+    GListStore *store = g_list_store_new(G_TYPE_OBJECT);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    GType types[] = { TEST_TYPE_NODE };
+    GListStore *created;
+    GVariant *document;
+    TestNode *node;
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        GObject *item;
+
+        if (i % 2)
+            item = g_object_new(TEST_TYPE_OTHER, NULL);
+        else
+            item = g_object_new(TEST_TYPE_NODE, "value", i, NULL);
+
+        g_list_store_append(store, item);
+        g_object_unref(item);
+    }
+
+    document = gvs_gobject_serialize(G_OBJECT(store));
+
+    gvs_deserializer_include_types(deserializer, types, G_N_ELEMENTS(types));
+    created = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(created)), ==, 5);
+
+    node = g_list_model_get_item(G_LIST_MODEL(created), 4);
+    g_assert(TEST_IS_NODE(node));
+    g_assert_cmpint(node->value, ==, 8);
+    g_object_unref(node);
+
+    g_object_unref(created);
+    g_variant_unref(document);
+    g_object_unref(deserializer);
+    g_object_unref(store);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Filter/Types", test_filter_types);
+   g_test_add_func("/Gvs/Filter/Columns", test_filter_columns);
+   g_test_add_func("/Gvs/Filter/Root", test_filter_root);
+   g_test_add_func("/Gvs/Filter/Properties", test_filter_properties);
+   g_test_add_func("/Gvs/Filter/List", test_filter_list);
+   return g_test_run();
+}
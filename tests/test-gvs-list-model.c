@@ -0,0 +1,326 @@
+/*
+ * Tests GvsListModel, a GListModel over a serialized GListStore
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestItem object, with a name and a group item shared with other items */
+
+#define TEST_TYPE_ITEM           (test_item_get_type())
+#define TEST_ITEM(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+#define TEST_IS_ITEM(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_ITEM))
+
+typedef struct _TestItem      TestItem;
+typedef struct _TestItemClass TestItemClass;
+
+struct _TestItem
+{
+    GObject parent;
+
+    char *name;
+    TestItem *group;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_GROUP
+};
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_GROUP:
+            g_clear_object(&self->group);
+            self->group = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_GROUP:
+            g_value_set_object(value, self->group);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_ITEM(obj)->group);
+
+    G_OBJECT_CLASS(test_item_parent_class)->dispose(obj);
+}
+
+static void
+test_item_finalize(GObject *obj)
+{
+    g_free(TEST_ITEM(obj)->name);
+
+    G_OBJECT_CLASS(test_item_parent_class)->finalize(obj);
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+    gobject_class->dispose = test_item_dispose;
+    gobject_class->finalize = test_item_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_GROUP,
+            g_param_spec_object("group", "group", "group", TEST_TYPE_ITEM,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_item_init(TestItem *self)
+{
+}
+
+#define N_ITEMS 1000
+
+/* A list of items, all in the same group */
+static GVariant *
+serialize_list(GvsSerializerFlags flags)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_ITEM);
+    TestItem *group = g_object_new(TEST_TYPE_ITEM, "name", "group", NULL);
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+    int i;
+
+    for (i = 0; i < N_ITEMS; i++)
+    {
+        char *name = g_strdup_printf("item-%d", i);
+        TestItem *item = g_object_new(TEST_TYPE_ITEM, "name", name, "group", group, NULL);
+
+        g_list_store_append(store, item);
+        g_object_unref(item);
+        g_free(name);
+    }
+
+    gvs_serializer_set_flags(serializer, flags);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+
+    g_object_unref(serializer);
+    g_object_unref(group);
+    g_object_unref(store);
+
+    return document;
+}
+
+static guint64
+n_created(GvsListModel *model)
+{
+    GvsStats *stats = gvs_deserializer_get_stats(gvs_list_model_get_deserializer(model));
+    guint64 n = gvs_stats_get_n_entities(stats);
+
+    gvs_stats_free(stats);
+
+    return n;
+}
+
+static void
+check_item(GListModel *model, guint position, int number)
+{
+    TestItem *item = g_list_model_get_item(model, position);
+    char *name = g_strdup_printf("item-%d", number);
+
+    g_assert(TEST_IS_ITEM(item));
+    g_assert_cmpstr(item->name, ==, name);
+    g_assert(item->group != NULL);
+
+    g_free(name);
+    g_object_unref(item);
+}
+
+static void
+check_model(GvsSerializerFlags flags)
+{
+    GVariant *document = serialize_list(flags);
+    GvsListModel *model = gvs_list_model_new(document);
+    TestItem *first, *second;
+
+    g_assert(G_IS_LIST_MODEL(model));
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(model)), ==, N_ITEMS);
+    g_assert(g_list_model_get_item_type(G_LIST_MODEL(model)) == TEST_TYPE_ITEM);
+    g_assert_cmpuint(n_created(model), ==, 0);
+
+    /* An item and its group */
+    first = g_list_model_get_item(G_LIST_MODEL(model), 500);
+    g_assert_cmpstr(first->name, ==, "item-500");
+    g_assert_cmpuint(n_created(model), ==, 2);
+
+    /* The group is still alive, so the next item shares it */
+    second = g_list_model_get_item(G_LIST_MODEL(model), 999);
+    g_assert_cmpstr(second->name, ==, "item-999");
+    g_assert(second->group == first->group);
+    g_assert_cmpuint(n_created(model), ==, 3);
+
+    g_assert(g_list_model_get_item(G_LIST_MODEL(model), N_ITEMS) == NULL);
+
+    g_object_unref(first);
+    g_object_unref(second);
+    g_object_unref(model);
+    g_variant_unref(document);
+}
+
+static void
+test_list_model_items(void)
+{
+    check_model(GVS_SERIALIZER_FLAGS_NONE);
+}
+
+static void
+test_list_model_compact(void)
+{
+    check_model(GVS_SERIALIZER_COMPACT);
+}
+
+static void
+test_list_model_cache(void)
+{
+    GVariant *document = serialize_list(GVS_SERIALIZER_FLAGS_NONE);
+    GvsListModel *model = gvs_list_model_new(document);
+
+    g_assert_cmpuint(gvs_list_model_get_cache_size(model), ==, 256);
+    gvs_list_model_set_cache_size(model, 2);
+
+    check_item(G_LIST_MODEL(model), 0, 0);
+    check_item(G_LIST_MODEL(model), 1, 1);
+    g_assert_cmpuint(n_created(model), ==, 3);
+
+    /* Still cached */
+    check_item(G_LIST_MODEL(model), 0, 0);
+    g_assert_cmpuint(n_created(model), ==, 3);
+
+    /* Pushes out item 1, which is then created afresh */
+    check_item(G_LIST_MODEL(model), 2, 2);
+    g_assert_cmpuint(n_created(model), ==, 4);
+    check_item(G_LIST_MODEL(model), 1, 1);
+    g_assert_cmpuint(n_created(model), ==, 5);
+
+    /* Without a cache, nothing outlives the caller's reference */
+    gvs_list_model_set_cache_size(model, 0);
+    check_item(G_LIST_MODEL(model), 1, 1);
+    check_item(G_LIST_MODEL(model), 1, 1);
+    g_assert_cmpuint(n_created(model), ==, 9);
+
+    g_object_unref(model);
+    g_variant_unref(document);
+}
+
+static void
+test_list_model_slice(void)
+{
+    GVariant *document = serialize_list(GVS_SERIALIZER_FLAGS_NONE);
+    GvsListModel *model = gvs_list_model_new(document);
+    GvsListModel *slice = gvs_list_model_new_slice(model, 100, 10);
+    GvsListModel *inner = gvs_list_model_new_slice(slice, 5, 5);
+    gpointer item;
+
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(slice)), ==, 10);
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(inner)), ==, 5);
+    check_item(G_LIST_MODEL(slice), 0, 100);
+    check_item(G_LIST_MODEL(inner), 4, 109);
+    g_assert(g_list_model_get_item(G_LIST_MODEL(slice), 10) == NULL);
+
+    /* The slice outlives the model, and shares its items */
+    item = g_list_model_get_item(G_LIST_MODEL(model), 105);
+    g_object_unref(model);
+    g_assert(g_list_model_get_item(G_LIST_MODEL(inner), 0) == item);
+    g_object_unref(item);
+    g_object_unref(item);
+
+    g_object_unref(inner);
+    g_object_unref(slice);
+    g_variant_unref(document);
+}
+
+static void
+test_list_model_archive(void)
+{
+    GVariant *document = serialize_list(GVS_SERIALIZER_FLAGS_NONE);
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsArchive *archive;
+    GvsListModel *model;
+    GBytes *bytes;
+
+    g_assert(gvs_archive_write(stream, document, NULL, NULL, NULL));
+    g_assert(g_output_stream_close(stream, NULL, NULL));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    archive = gvs_archive_new(bytes, NULL);
+
+    model = gvs_list_model_new_for_archive(archive);
+    g_assert(gvs_list_model_get_deserializer(model) ==
+             gvs_archive_get_deserializer(archive));
+    g_object_unref(archive);
+
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(model)), ==, N_ITEMS);
+    check_item(G_LIST_MODEL(model), 0, 0);
+    check_item(G_LIST_MODEL(model), N_ITEMS - 1, N_ITEMS - 1);
+    g_assert_cmpuint(n_created(model), ==, 3);
+
+    g_object_unref(model);
+    g_bytes_unref(bytes);
+    g_object_unref(stream);
+    g_variant_unref(document);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/GvsListModel/Items", test_list_model_items);
+   g_test_add_func("/Gvs/GvsListModel/Compact", test_list_model_compact);
+   g_test_add_func("/Gvs/GvsListModel/Cache", test_list_model_cache);
+   g_test_add_func("/Gvs/GvsListModel/Slice", test_list_model_slice);
+   g_test_add_func("/Gvs/GvsListModel/Archive", test_list_model_archive);
+   return g_test_run();
+}
@@ -0,0 +1,411 @@
+/*
+ * Tests lazy deserialization with gvs_deserializer_set_lazy()
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestNode object, a named node whose "next" property is lazy */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    TestNode *next;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_NEXT
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_NEXT:
+            gvs_resolve_lazy_property(obj, pspec);
+            g_value_set_object(value, self->next);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->next);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_object("next", "next", "next", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_NEXT, pspec);
+    gvs_register_property_lazy(pspec);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+#define N_NODES 100
+
+/* node-0 -> node-1 -> ... -> node-99, and back to node-0 if @cycle */
+static TestNode *
+make_chain(gboolean cycle)
+{
+    TestNode *next = NULL;
+    TestNode *last = NULL;
+    int i;
+
+    for (i = N_NODES - 1; i >= 0; i--)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+        TestNode *node = g_object_new(TEST_TYPE_NODE, "name", name, "next", next, NULL);
+
+        if (next)
+            g_object_unref(next);
+        else
+            last = node;
+        next = node;
+        g_free(name);
+    }
+
+    if (cycle)
+        g_object_set(last, "next", next, NULL);
+
+    return next;
+}
+
+/* Breaks the cycle made by make_chain(), resolving the whole chain */
+static void
+break_cycle(TestNode *node)
+{
+    TestNode *last = g_object_ref(node);
+    TestNode *next;
+
+    for (;;)
+    {
+        g_object_get(last, "next", &next, NULL);
+        if (next == node)
+            break;
+
+        g_object_unref(last);
+        last = next;
+    }
+
+    g_object_set(last, "next", NULL, NULL);
+    g_object_unref(next);
+    g_object_unref(last);
+}
+
+static GVariant *
+serialize_chain(gboolean cycle)
+{
+    TestNode *chain = make_chain(cycle);
+    GVariant *document = gvs_gobject_serialize(G_OBJECT(chain));
+
+    if (cycle)
+        break_cycle(chain);
+    g_object_unref(chain);
+
+    return document;
+}
+
+static guint64
+n_created(GvsDeserializer *deserializer)
+{
+    GvsStats *stats = gvs_deserializer_get_stats(deserializer);
+    guint64 n = gvs_stats_get_n_entities(stats);
+
+    gvs_stats_free(stats);
+
+    return n;
+}
+
+/* Follows "next" from @node to node-@last, checking names along the way.
+ * Returns a new reference to node-@last. */
+static TestNode *
+walk(TestNode *node, int first, int last)
+{
+    int i;
+
+    g_object_ref(node);
+
+    for (i = first; i <= last; i++)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+        TestNode *next;
+
+        g_assert(TEST_IS_NODE(node));
+        g_assert_cmpstr(node->name, ==, name);
+        g_free(name);
+
+        if (i == last)
+            break;
+
+        g_object_get(node, "next", &next, NULL);
+        g_object_unref(node);
+        node = next;
+    }
+
+    return node;
+}
+
+static void
+test_lazy_resolve(void)
+{
+    GVariant *document = serialize_chain(FALSE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    TestNode *root, *node;
+
+    gvs_deserializer_set_lazy(deserializer, TRUE);
+    g_assert(gvs_deserializer_get_lazy(deserializer));
+
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, 1);
+    g_assert(root->next == NULL);
+
+    /* Each read creates one more node */
+    node = walk(root, 0, 9);
+    g_assert_cmpuint(n_created(deserializer), ==, 10);
+    g_object_unref(node);
+
+    /* Reading again gives the same objects */
+    node = walk(root, 0, 9);
+    g_assert_cmpuint(n_created(deserializer), ==, 10);
+    g_object_unref(node);
+
+    node = walk(root, 0, N_NODES - 1);
+    g_assert_cmpuint(n_created(deserializer), ==, N_NODES);
+    g_assert(node->next == NULL);
+    g_object_unref(node);
+
+    g_object_unref(root);
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_lazy_eager(void)
+{
+    GVariant *document = serialize_chain(FALSE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    TestNode *root, *node;
+
+    /* Lazy properties are read as usual without lazy mode */
+    root = gvs_deserializer_deserialize(deserializer, document);
+    g_assert_cmpuint(n_created(deserializer), ==, N_NODES);
+    g_assert(root->next != NULL);
+
+    node = walk(root, 0, N_NODES - 1);
+    g_object_unref(node);
+
+    g_object_unref(root);
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_lazy_cycle(void)
+{
+    GVariant *document = serialize_chain(TRUE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    TestNode *root, *node;
+
+    gvs_deserializer_set_lazy(deserializer, TRUE);
+    root = gvs_deserializer_deserialize(deserializer, document);
+
+    /* The reference back to the root is set as soon as the last node is
+     * created, since the root exists already */
+    node = walk(root, 0, N_NODES - 1);
+    g_assert(node->next == root);
+    g_assert_cmpuint(n_created(deserializer), ==, N_NODES);
+    g_object_unref(node);
+
+    break_cycle(root);
+    g_object_unref(root);
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_lazy_set(void)
+{
+    GVariant *document = serialize_chain(FALSE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    TestNode *root, *other, *next;
+
+    gvs_deserializer_set_lazy(deserializer, TRUE);
+    root = gvs_deserializer_deserialize(deserializer, document);
+
+    /* A value set before the property is read wins */
+    other = g_object_new(TEST_TYPE_NODE, "name", "other", NULL);
+    g_object_set(root, "next", other, NULL);
+
+    g_object_get(root, "next", &next, NULL);
+    g_assert(next == other);
+    g_assert_cmpuint(n_created(deserializer), ==, 1);
+
+    g_object_unref(next);
+    g_object_unref(other);
+    g_object_unref(root);
+    g_object_unref(deserializer);
+    g_variant_unref(document);
+}
+
+static void
+test_lazy_release(void)
+{
+    GVariant *document = serialize_chain(FALSE);
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    TestNode *root, *node;
+
+    gvs_deserializer_set_lazy(deserializer, TRUE);
+    root = gvs_deserializer_deserialize(deserializer, document);
+    node = walk(root, 0, 5);
+    g_object_unref(node);
+    g_assert_cmpuint(n_created(deserializer), ==, 6);
+
+    /* Dropping node-1 onwards drops node-5, the only object with anything
+     * left to resolve, and with it the document */
+    g_object_set(root, "next", NULL, NULL);
+    g_object_unref(root);
+
+    /* The deserializer is only kept alive by the document */
+    g_object_add_weak_pointer(G_OBJECT(deserializer), (gpointer *) &deserializer);
+    g_object_unref(deserializer);
+    g_assert(deserializer == NULL);
+
+    g_variant_unref(document);
+}
+
+static void
+test_lazy_archive(void)
+{
+    GVariant *document = serialize_chain(FALSE);
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsDeserializer *deserializer;
+    GvsArchive *archive;
+    GBytes *bytes;
+    TestNode *node, *last;
+
+    g_assert(gvs_archive_write(stream, document, "name", NULL, NULL));
+    g_assert(g_output_stream_close(stream, NULL, NULL));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+
+    archive = gvs_archive_new(bytes, NULL);
+    deserializer = g_object_ref(gvs_archive_get_deserializer(archive));
+    gvs_deserializer_set_lazy(deserializer, TRUE);
+
+    node = gvs_archive_lookup(archive, "node-50");
+    g_assert_cmpuint(n_created(deserializer), ==, 1);
+
+    /* The node keeps the archive alive until it has been read */
+    g_object_add_weak_pointer(G_OBJECT(archive), (gpointer *) &archive);
+    g_object_unref(archive);
+    g_assert(archive != NULL);
+
+    last = walk(node, 50, N_NODES - 1);
+    g_assert_cmpuint(n_created(deserializer), ==, 50);
+    g_assert(archive == NULL);
+
+    g_object_unref(last);
+    g_object_unref(node);
+    g_object_unref(deserializer);
+    g_bytes_unref(bytes);
+    g_object_unref(stream);
+    g_variant_unref(document);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Lazy/Resolve", test_lazy_resolve);
+   g_test_add_func("/Gvs/Lazy/Eager", test_lazy_eager);
+   g_test_add_func("/Gvs/Lazy/Cycle", test_lazy_cycle);
+   g_test_add_func("/Gvs/Lazy/Set", test_lazy_set);
+   g_test_add_func("/Gvs/Lazy/Release", test_lazy_release);
+   g_test_add_func("/Gvs/Lazy/Archive", test_lazy_archive);
+   return g_test_run();
+}
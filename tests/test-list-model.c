@@ -0,0 +1,468 @@
+/*
+ * Tests [de]serialization of GListStore roots and GListModel properties
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestItem object */
+
+#define TEST_TYPE_ITEM            (test_item_get_type())
+#define TEST_ITEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+#define TEST_IS_ITEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_ITEM))
+
+typedef struct _TestItem      TestItem;
+typedef struct _TestItemClass TestItemClass;
+
+struct _TestItem
+{
+    GObject parent;
+
+    int value;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_VALUE,
+    PROP_MODEL
+};
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_VALUE:
+            TEST_ITEM(obj)->value = g_value_get_int(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    switch (prop_id)
+    {
+        case PROP_VALUE:
+            g_value_set_int(value, TEST_ITEM(obj)->value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_item_init(TestItem *self)
+{
+}
+
+/* TestOwner object, holding a GListModel property */
+
+#define TEST_TYPE_OWNER           (test_owner_get_type())
+#define TEST_OWNER(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_OWNER, TestOwner))
+#define TEST_IS_OWNER(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_OWNER))
+
+typedef struct _TestOwner      TestOwner;
+typedef struct _TestOwnerClass TestOwnerClass;
+
+struct _TestOwner
+{
+    GObject parent;
+
+    GListModel *model;
+};
+
+struct _TestOwnerClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestOwner, test_owner, G_TYPE_OBJECT);
+
+static void
+test_owner_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    TestOwner *self = TEST_OWNER(obj);
+
+    switch (prop_id)
+    {
+        case PROP_MODEL:
+            g_clear_object(&self->model);
+            self->model = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_owner_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    TestOwner *self = TEST_OWNER(obj);
+
+    switch (prop_id)
+    {
+        case PROP_MODEL:
+            g_value_set_object(value, self->model);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_owner_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_OWNER(obj)->model);
+
+    G_OBJECT_CLASS(test_owner_parent_class)->dispose(obj);
+}
+
+static void
+test_owner_class_init(TestOwnerClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_owner_set_property;
+    gobject_class->get_property = test_owner_get_property;
+    gobject_class->dispose = test_owner_dispose;
+
+    g_object_class_install_property(gobject_class, PROP_MODEL,
+            g_param_spec_object("model", "model", "model", G_TYPE_LIST_MODEL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_owner_init(TestOwner *self)
+{
+}
+
+/* TestArrayModel, a GListModel other than GListStore */
+
+#define TEST_TYPE_ARRAY_MODEL     (test_array_model_get_type())
+#define TEST_ARRAY_MODEL(obj)     (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ARRAY_MODEL, TestArrayModel))
+
+typedef struct _TestArrayModel      TestArrayModel;
+typedef struct _TestArrayModelClass TestArrayModelClass;
+
+struct _TestArrayModel
+{
+    GObject parent;
+
+    GPtrArray *items;
+};
+
+struct _TestArrayModelClass
+{
+    GObjectClass parent_class;
+};
+
+static void test_array_model_iface_init(GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(TestArrayModel, test_array_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL,
+                                              test_array_model_iface_init));
+
+static GType
+test_array_model_get_item_type(GListModel *list)
+{
+    return TEST_TYPE_ITEM;
+}
+
+static guint
+test_array_model_get_n_items(GListModel *list)
+{
+    return TEST_ARRAY_MODEL(list)->items->len;
+}
+
+static gpointer
+test_array_model_get_item(GListModel *list, guint position)
+{
+    GPtrArray *items = TEST_ARRAY_MODEL(list)->items;
+
+    return position < items->len ? g_object_ref(g_ptr_array_index(items, position)) : NULL;
+}
+
+static void
+test_array_model_iface_init(GListModelInterface *iface)
+{
+    iface->get_item_type = test_array_model_get_item_type;
+    iface->get_n_items = test_array_model_get_n_items;
+    iface->get_item = test_array_model_get_item;
+}
+
+static void
+test_array_model_finalize(GObject *obj)
+{
+    g_ptr_array_unref(TEST_ARRAY_MODEL(obj)->items);
+
+    G_OBJECT_CLASS(test_array_model_parent_class)->finalize(obj);
+}
+
+static void
+test_array_model_class_init(TestArrayModelClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = test_array_model_finalize;
+}
+
+static void
+test_array_model_init(TestArrayModel *self)
+{
+    self->items = g_ptr_array_new_with_free_func(g_object_unref);
+}
+
+/* Tests */
+
+static GListStore *
+make_store(guint n_items)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_ITEM);
+    guint i;
+
+    for (i = 0; i < n_items; i++)
+    {
+        TestItem *item = g_object_new(TEST_TYPE_ITEM, "value", i * 3, NULL);
+        g_list_store_append(store, item);
+        g_object_unref(item);
+    }
+
+    return store;
+}
+
+static const char serialized_store[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('GListStore', <('TestItem', [uint64 1, 2, 1])>),"
+"  ('TestItem', <{'value': <0>}>),"
+"  ('TestItem', <{'value': <3>}>)])";
+
+static void
+test_store_format(void)
+{
+    GListStore *store = make_store(2);
+    TestItem *first = g_list_model_get_item(G_LIST_MODEL(store), 0);
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    /* The same item twice is written as two references to one entity */
+    g_list_store_append(store, first);
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(store));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_store, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    g_object_unref(first);
+    g_object_unref(store);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+static void
+test_store_root(void)
+{
+    const guint n_items = 10000;
+    GListStore *store = make_store(n_items);
+    GListStore *created = NULL;
+    GVariant *variant = NULL;
+    guint i;
+
+    variant = gvs_gobject_serialize(G_OBJECT(store));
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert(G_IS_LIST_STORE(created));
+    g_assert(g_list_model_get_item_type(G_LIST_MODEL(created)) == TEST_TYPE_ITEM);
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(created)), ==, n_items);
+
+    for (i = 0; i < n_items; i++)
+    {
+        TestItem *item = g_list_model_get_item(G_LIST_MODEL(created), i);
+        g_assert_cmpint(item->value, ==, i * 3);
+        g_object_unref(item);
+    }
+
+    g_object_unref(created);
+    g_object_unref(store);
+    g_variant_unref(variant);
+}
+
+static void
+test_model_property(void)
+{
+    GListStore *store = make_store(50);
+    GListStore *empty = g_list_store_new(TEST_TYPE_ITEM);
+    TestOwner *owner = NULL;
+    TestOwner *created = NULL;
+    GVariant *variant = NULL;
+    GVariant *variant2 = NULL;
+    TestItem *item = NULL;
+
+    owner = g_object_new(TEST_TYPE_OWNER, "model", store, NULL);
+
+    variant = gvs_gobject_serialize(G_OBJECT(owner));
+    created = gvs_gobject_new_deserialize(variant);
+
+    g_assert(TEST_IS_OWNER(created));
+    g_assert(G_IS_LIST_STORE(created->model));
+    g_assert_cmpuint(g_list_model_get_n_items(created->model), ==, 50);
+
+    item = g_list_model_get_item(created->model, 49);
+    g_assert_cmpint(item->value, ==, 49 * 3);
+    g_object_unref(item);
+
+    g_object_unref(created);
+
+    /* Empty stores still record their item type */
+    g_object_set(owner, "model", empty, NULL);
+
+    variant2 = gvs_gobject_serialize(G_OBJECT(owner));
+    created = gvs_gobject_new_deserialize(variant2);
+
+    g_assert(G_IS_LIST_STORE(created->model));
+    g_assert_cmpuint(g_list_model_get_n_items(created->model), ==, 0);
+    g_assert(g_list_model_get_item_type(created->model) == TEST_TYPE_ITEM);
+
+    g_object_unref(created);
+    g_object_unref(owner);
+    g_object_unref(empty);
+    g_object_unref(store);
+    g_variant_unref(variant2);
+    g_variant_unref(variant);
+}
+
+/* Other GListModels are written as a GListStore holding the same items */
+static void
+test_other_model(void)
+{
+    TestArrayModel *model = g_object_new(TEST_TYPE_ARRAY_MODEL, NULL);
+    GListStore *store = make_store(5);
+    TestOwner *owner = NULL;
+    TestOwner *created = NULL;
+    GListStore *created_root = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GVariant *variant3 = NULL;
+    TestItem *item = NULL;
+    guint i;
+
+    for (i = 0; i < 5; i++)
+        g_ptr_array_add(model->items, g_list_model_get_item(G_LIST_MODEL(store), i));
+
+    /* Byte for byte what the equivalent GListStore gives */
+    variant1 = gvs_gobject_serialize(G_OBJECT(model));
+    variant2 = gvs_gobject_serialize(G_OBJECT(store));
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created_root = gvs_gobject_new_deserialize(variant1);
+    g_assert(G_IS_LIST_STORE(created_root));
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(created_root)), ==, 5);
+
+    owner = g_object_new(TEST_TYPE_OWNER, "model", model, NULL);
+    variant3 = gvs_gobject_serialize(G_OBJECT(owner));
+    created = gvs_gobject_new_deserialize(variant3);
+
+    g_assert(G_IS_LIST_STORE(created->model));
+    g_assert(g_list_model_get_item_type(created->model) == TEST_TYPE_ITEM);
+    g_assert_cmpuint(g_list_model_get_n_items(created->model), ==, 5);
+
+    item = g_list_model_get_item(created->model, 4);
+    g_assert_cmpint(item->value, ==, 4 * 3);
+    g_object_unref(item);
+
+    g_object_unref(created);
+    g_object_unref(owner);
+    g_object_unref(created_root);
+    g_object_unref(store);
+    g_object_unref(model);
+    g_variant_unref(variant3);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+/* Items are written as one packed array of entity ids */
+static void
+test_packed_refs(void)
+{
+    GListStore *store = make_store(1000);
+    GVariant *variant = NULL;
+    GVariant *toplevel = NULL;
+    GVariant *payload = NULL;
+    GVariant *ids = NULL;
+    const guint64 *id;
+    gsize n_ids;
+
+    variant = gvs_gobject_serialize(G_OBJECT(store));
+
+    toplevel = g_variant_get_child_value(variant, 2);
+    g_assert_cmpuint(g_variant_n_children(toplevel), ==, 1001);
+
+    g_variant_get_child(toplevel, 0, "(&sv)", NULL, &payload);
+    g_assert(g_variant_is_of_type(payload, G_VARIANT_TYPE("(sat)")));
+
+    ids = g_variant_get_child_value(payload, 1);
+    id = g_variant_get_fixed_array(ids, &n_ids, sizeof(guint64));
+    g_assert_cmpuint(n_ids, ==, 1000);
+    g_assert_cmpuint(id[0], ==, 1);
+    g_assert_cmpuint(id[999], ==, 1000);
+
+    g_variant_unref(ids);
+    g_variant_unref(payload);
+    g_variant_unref(toplevel);
+    g_object_unref(store);
+    g_variant_unref(variant);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/ListModel/Format", test_store_format);
+   g_test_add_func("/Gvs/ListModel/Root", test_store_root);
+   g_test_add_func("/Gvs/ListModel/Property", test_model_property);
+   g_test_add_func("/Gvs/ListModel/OtherModel", test_other_model);
+   g_test_add_func("/Gvs/ListModel/Packed", test_packed_refs);
+   return g_test_run();
+}
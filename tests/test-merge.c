@@ -0,0 +1,455 @@
+/*
+ * Tests merging of value-like objects with GVS_SERIALIZER_MERGE_VALUES
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestStyle object, a value with a name, a size, a base style and an owner */
+
+#define TEST_TYPE_STYLE          (test_style_get_type())
+#define TEST_STYLE(obj)          (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_STYLE, TestStyle))
+
+typedef struct _TestStyle      TestStyle;
+typedef struct _TestStyleClass TestStyleClass;
+
+struct _TestStyle
+{
+    GObject parent;
+
+    char *name;
+    int size;
+    TestStyle *base;
+    GObject *owner;
+};
+
+struct _TestStyleClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestStyle, test_style, G_TYPE_OBJECT);
+
+GType test_item_get_type(void);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_SIZE,
+    PROP_BASE,
+    PROP_OWNER
+};
+
+static void
+test_style_set_property(GObject *obj,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+    TestStyle *self = TEST_STYLE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_SIZE:
+            self->size = g_value_get_int(value);
+            break;
+
+        case PROP_BASE:
+            g_clear_object(&self->base);
+            self->base = g_value_dup_object(value);
+            break;
+
+        case PROP_OWNER:
+            g_clear_object(&self->owner);
+            self->owner = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_style_get_property(GObject *obj,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+    TestStyle *self = TEST_STYLE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_SIZE:
+            g_value_set_int(value, self->size);
+            break;
+
+        case PROP_BASE:
+            g_value_set_object(value, self->base);
+            break;
+
+        case PROP_OWNER:
+            g_value_set_object(value, self->owner);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_style_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_STYLE(obj)->base);
+    g_clear_object(&TEST_STYLE(obj)->owner);
+
+    G_OBJECT_CLASS(test_style_parent_class)->dispose(obj);
+}
+
+static void
+test_style_finalize(GObject *obj)
+{
+    g_free(TEST_STYLE(obj)->name);
+
+    G_OBJECT_CLASS(test_style_parent_class)->finalize(obj);
+}
+
+static void
+test_style_class_init(TestStyleClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_style_set_property;
+    gobject_class->get_property = test_style_get_property;
+    gobject_class->dispose = test_style_dispose;
+    gobject_class->finalize = test_style_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_SIZE,
+            g_param_spec_int("size", "size", "size", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_BASE,
+            g_param_spec_object("base", "base", "base", TEST_TYPE_STYLE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_OWNER,
+            g_param_spec_object("owner", "owner", "owner", test_item_get_type(),
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    gvs_register_class_value_like(TEST_TYPE_STYLE);
+}
+
+static void
+test_style_init(TestStyle *self)
+{
+}
+
+/* TestItem object, with a value and a style */
+
+#define TEST_TYPE_ITEM           (test_item_get_type())
+#define TEST_ITEM(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+
+typedef struct _TestItem      TestItem;
+typedef struct _TestItemClass TestItemClass;
+
+struct _TestItem
+{
+    GObject parent;
+
+    int value;
+    TestStyle *style;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_ITEM_0,
+    PROP_ITEM_VALUE,
+    PROP_ITEM_STYLE
+};
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_ITEM_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_ITEM_STYLE:
+            g_clear_object(&self->style);
+            self->style = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_ITEM_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_ITEM_STYLE:
+            g_value_set_object(value, self->style);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_ITEM(obj)->style);
+
+    G_OBJECT_CLASS(test_item_parent_class)->dispose(obj);
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+    gobject_class->dispose = test_item_dispose;
+
+    g_object_class_install_property(gobject_class, PROP_ITEM_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_ITEM_STYLE,
+            g_param_spec_object("style", "style", "style", TEST_TYPE_STYLE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_item_init(TestItem *self)
+{
+}
+
+/* Tests */
+
+#define N_ITEMS 10
+
+static TestStyle *
+style_new(const char *name, int size, TestStyle *base)
+{
+    return g_object_new(TEST_TYPE_STYLE, "name", name, "size", size,
+                        "base", base, NULL);
+}
+
+/* A list of items, each with a style of its own: "even" or "odd", both
+ * based on a "plain" style of their own as well */
+static GListStore *
+make_store(void)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_ITEM);
+    int i;
+
+    for (i = 0; i < N_ITEMS; i++)
+    {
+        TestStyle *base = style_new("plain", 10, NULL);
+        TestStyle *style = style_new(i % 2 ? "odd" : "even", 12, base);
+        TestItem *item = g_object_new(TEST_TYPE_ITEM, "value", i, "style", style, NULL);
+
+        g_list_store_append(store, item);
+        g_object_unref(item);
+        g_object_unref(style);
+        g_object_unref(base);
+    }
+
+    return store;
+}
+
+static gsize
+n_entities(GVariant *document)
+{
+    GvsView *view = gvs_view_new(document);
+    gsize n = gvs_view_get_n_entities(view);
+
+    g_object_unref(view);
+
+    return n;
+}
+
+static TestItem *
+get_item(GListStore *store, guint i)
+{
+    TestItem *item = g_list_model_get_item(G_LIST_MODEL(store), i);
+
+    /* The store holds a reference */
+    g_object_unref(item);
+
+    return item;
+}
+
+static void
+test_merge_values(void)
+{
+    GListStore *store = make_store();
+    GvsSerializer *serializer = gvs_serializer_new();
+    GListStore *created;
+    GVariant *document;
+    int i;
+
+    /* The store, its items, and each item's style and base style */
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+    g_assert_cmpuint(n_entities(document), ==, 1 + 3 * N_ITEMS);
+    g_variant_unref(document);
+
+    /* The store, its items, "even", "odd" and one "plain" */
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_MERGE_VALUES);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+    g_assert_cmpuint(n_entities(document), ==, 1 + N_ITEMS + 3);
+
+    created = gvs_gobject_new_deserialize(document);
+    for (i = 0; i < N_ITEMS; i++)
+    {
+        TestItem *item = get_item(created, i);
+
+        g_assert_cmpint(item->value, ==, i);
+        g_assert_cmpstr(item->style->name, ==, i % 2 ? "odd" : "even");
+        g_assert_cmpint(item->style->size, ==, 12);
+        g_assert(item->style == get_item(created, i % 2)->style);
+        g_assert_cmpstr(item->style->base->name, ==, "plain");
+        g_assert(item->style->base == get_item(created, 0)->style->base);
+    }
+
+    g_object_unref(created);
+    g_variant_unref(document);
+    g_object_unref(serializer);
+    g_object_unref(store);
+}
+
+/* Only value-like objects are merged, and only if they refer to the same
+ * entities */
+static void
+test_merge_references(void)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_ITEM);
+    TestItem *first = g_object_new(TEST_TYPE_ITEM, NULL);
+    TestItem *second = g_object_new(TEST_TYPE_ITEM, NULL);
+    TestStyle *style;
+    GListStore *created;
+    GVariant *document;
+    GvsSerializer *serializer = gvs_serializer_new();
+
+    /* Equal items with styles owned by different items */
+    style = g_object_new(TEST_TYPE_STYLE, "owner", first, NULL);
+    g_object_set(first, "style", style, NULL);
+    g_object_unref(style);
+    style = g_object_new(TEST_TYPE_STYLE, "owner", second, NULL);
+    g_object_set(second, "style", style, NULL);
+    g_object_unref(style);
+
+    g_list_store_append(store, first);
+    g_list_store_append(store, second);
+
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_MERGE_VALUES);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+    g_assert_cmpuint(n_entities(document), ==, 5);
+
+    created = gvs_gobject_new_deserialize(document);
+    g_assert(gvs_gobject_equal(G_OBJECT(store), G_OBJECT(created)));
+    g_variant_unref(document);
+    g_object_unref(created);
+
+    /* Styles owned by the same item are merged */
+    g_object_set(second->style, "owner", first, NULL);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+    g_assert_cmpuint(n_entities(document), ==, 4);
+
+    created = gvs_gobject_new_deserialize(document);
+    g_assert(get_item(created, 0)->style == get_item(created, 1)->style);
+    g_assert(get_item(created, 0)->style->owner == G_OBJECT(get_item(created, 0)));
+
+    /* Break the cycles through the owners */
+    g_object_set(get_item(created, 0)->style, "owner", NULL, NULL);
+    g_object_set(first->style, "owner", NULL, NULL);
+    g_object_set(second->style, "owner", NULL, NULL);
+
+    g_object_unref(created);
+    g_variant_unref(document);
+    g_object_unref(serializer);
+    g_object_unref(first);
+    g_object_unref(second);
+    g_object_unref(store);
+}
+
+/* A value which refers back to itself is written separately */
+static void
+test_merge_cycle(void)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    TestStyle *style = style_new("loop", 1, NULL);
+    TestStyle *copy = style_new("copy", 1, NULL);
+    TestItem *item = g_object_new(TEST_TYPE_ITEM, "style", copy, NULL);
+    TestItem *created;
+    GVariant *document;
+
+    g_object_set(style, "base", style, NULL);
+    g_object_set(copy, "base", style, NULL);
+
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_MERGE_VALUES);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(item));
+    g_assert_cmpuint(n_entities(document), ==, 3);
+
+    created = gvs_gobject_new_deserialize(document);
+    g_assert_cmpstr(created->style->name, ==, "copy");
+    g_assert_cmpstr(created->style->base->name, ==, "loop");
+    g_assert(created->style->base->base == created->style->base);
+
+    g_object_set(created->style->base, "base", NULL, NULL);
+    g_object_set(style, "base", NULL, NULL);
+
+    g_object_unref(created);
+    g_variant_unref(document);
+    g_object_unref(item);
+    g_object_unref(copy);
+    g_object_unref(style);
+    g_object_unref(serializer);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Merge/Values", test_merge_values);
+   g_test_add_func("/Gvs/Merge/References", test_merge_references);
+   g_test_add_func("/Gvs/Merge/Cycle", test_merge_cycle);
+   return g_test_run();
+}
@@ -0,0 +1,302 @@
+/*
+ * Tests [de]serialization of properties registered with
+ * gvs_register_property_offset()
+ */
+
+#include <gvs/gvs.h>
+
+/* TestItem object */
+
+#define TEST_TYPE_ITEM            (test_item_get_type())
+#define TEST_ITEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+#define TEST_ITEM_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  TEST_TYPE_ITEM, TestItemClass))
+#define TEST_IS_ITEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_ITEM))
+#define TEST_IS_ITEM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  TEST_TYPE_ITEM))
+#define TEST_ITEM_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  TEST_TYPE_ITEM, TestItemClass))
+
+typedef struct _TestItem        TestItem;
+typedef struct _TestItemClass   TestItemClass;
+typedef struct _TestItemPrivate TestItemPrivate;
+
+struct _TestItem
+{
+    GObject parent;
+
+    TestItemPrivate *priv;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+struct _TestItemPrivate
+{
+    int int_prop;
+    double dbl_prop;
+    char *str_prop;
+    TestItem *child;
+    TestItem *peer;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_INT_PROP,
+    PROP_DBL_PROP,
+    PROP_STR_PROP,
+    PROP_CHILD,
+    PROP_PEER
+};
+
+/* Number of times set_property() has been called */
+static guint n_set_property_calls = 0;
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    n_set_property_calls++;
+
+    switch (prop_id)
+    {
+        case PROP_INT_PROP:
+            priv->int_prop = g_value_get_int(value);
+            break;
+
+        case PROP_DBL_PROP:
+            priv->dbl_prop = g_value_get_double(value);
+            break;
+
+        case PROP_STR_PROP:
+            g_free(priv->str_prop);
+            priv->str_prop = g_value_dup_string(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&priv->child);
+            priv->child = g_value_dup_object(value);
+            break;
+
+        case PROP_PEER:
+            priv->peer = g_value_get_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    switch (prop_id)
+    {
+        case PROP_INT_PROP:
+            g_value_set_int(value, priv->int_prop);
+            break;
+
+        case PROP_DBL_PROP:
+            g_value_set_double(value, priv->dbl_prop);
+            break;
+
+        case PROP_STR_PROP:
+            g_value_set_string(value, priv->str_prop);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, priv->child);
+            break;
+
+        case PROP_PEER:
+            g_value_set_object(value, priv->peer);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_finalize(GObject *obj)
+{
+    TestItemPrivate *priv = TEST_ITEM(obj)->priv;
+
+    g_free(priv->str_prop);
+    g_clear_object(&priv->child);
+
+    G_OBJECT_CLASS(test_item_parent_class)->finalize(obj);
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GParamSpec *pspec;
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+    gobject_class->finalize = test_item_finalize;
+
+    pspec = g_param_spec_int("int-prop", "int-prop", "int-prop",
+                             G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE |
+                             G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_INT_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, int_prop),
+                                 GVS_FIELD_INT);
+
+    pspec = g_param_spec_double("dbl-prop", "dbl-prop", "dbl-prop",
+                                -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_DBL_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, dbl_prop),
+                                 GVS_FIELD_DOUBLE);
+
+    pspec = g_param_spec_string("str-prop", "str-prop", "str-prop", NULL,
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_STR_PROP, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, str_prop),
+                                 GVS_FIELD_STRING);
+
+    pspec = g_param_spec_object("child", "child", "child",
+                                TEST_TYPE_ITEM,
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CHILD, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, child),
+                                 GVS_FIELD_OBJECT);
+
+    /* Holds no reference */
+    pspec = g_param_spec_object("peer", "peer", "peer",
+                                TEST_TYPE_ITEM,
+                                G_PARAM_READWRITE |
+                                G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_PEER, pspec);
+    gvs_register_property_offset(pspec, G_PRIVATE_OFFSET(TestItem, peer),
+                                 GVS_FIELD_OBJECT_UNOWNED);
+}
+
+static void
+test_item_init(TestItem *self)
+{
+    self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, TEST_TYPE_ITEM, TestItemPrivate);
+}
+
+static const char serialized_object[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestItem', <{"
+"     'int-prop': <-4>,"
+"     'dbl-prop': <2.5>,"
+"     'str-prop': <@ms 'parent'>,"
+"     'child': <@mt 1>,"
+"     'peer': <@mt nothing>"
+"   }>),"
+"  ('TestItem', <{"
+"     'int-prop': <42>,"
+"     'dbl-prop': <0.0>,"
+"     'str-prop': <@ms nothing>,"
+"     'child': <@mt nothing>,"
+"     'peer': <@mt nothing>"
+"   }>)])";
+
+static void
+test_serialize(void)
+{
+    TestItem *parent = NULL;
+    TestItem *child = NULL;
+    TestItem *created = NULL;
+    TestItemPrivate *priv;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    child = g_object_new(TEST_TYPE_ITEM, "int-prop", 42, NULL);
+    parent = g_object_new(TEST_TYPE_ITEM,
+                          "int-prop", -4,
+                          "dbl-prop", 2.5,
+                          "str-prop", "parent",
+                          "child", child,
+                          NULL);
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(parent));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_object, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    /* None of the properties should go through set_property() */
+    n_set_property_calls = 0;
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_ITEM(created));
+    g_assert_cmpuint(n_set_property_calls, ==, 0);
+
+    priv = created->priv;
+    g_assert_cmpint(priv->int_prop, ==, -4);
+    g_assert(priv->dbl_prop == 2.5);
+    g_assert_cmpstr(priv->str_prop, ==, "parent");
+    g_assert(TEST_IS_ITEM(priv->child));
+    g_assert_cmpint(priv->child->priv->int_prop, ==, 42);
+    g_assert(priv->child->priv->str_prop == NULL);
+    g_assert(priv->child->priv->child == NULL);
+
+    g_object_unref(created);
+    g_object_unref(parent);
+    g_object_unref(child);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+/* An object only held through an unowned field lives as long as the root of
+ * the deserialized graph */
+static void
+test_unowned(void)
+{
+    TestItem *peer = g_object_new(TEST_TYPE_ITEM, "int-prop", 7, NULL);
+    TestItem *root = g_object_new(TEST_TYPE_ITEM, "peer", peer, NULL);
+    TestItem *created = NULL;
+    TestItem *created_peer = NULL;
+    GVariant *variant = NULL;
+
+    variant = gvs_gobject_serialize(G_OBJECT(root));
+    g_object_unref(root);
+    g_object_unref(peer);
+
+    created = gvs_gobject_new_deserialize(variant);
+    created_peer = created->priv->peer;
+    g_assert(TEST_IS_ITEM(created_peer));
+    g_assert_cmpint(created_peer->priv->int_prop, ==, 7);
+    g_assert_cmpint(G_OBJECT(created_peer)->ref_count, ==, 1);
+
+    g_object_add_weak_pointer(G_OBJECT(created_peer), (gpointer *) &created_peer);
+    g_object_unref(created);
+    g_assert(created_peer == NULL);
+
+    g_variant_unref(variant);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/FieldOffsets", test_serialize);
+   g_test_add_func("/Gvs/FieldOffsets/Unowned", test_unowned);
+   return g_test_run();
+}
@@ -0,0 +1,352 @@
+/*
+ * Tests partial serialization: projections, limits and transient properties
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestNode object, with a name, a value, a child and a transient cache */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    int value;
+    TestNode *child;
+    int cache;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD,
+    PROP_CACHE
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        case PROP_CACHE:
+            self->cache = g_value_get_int(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        case PROP_CACHE:
+            g_value_set_int(value, self->cache);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->child);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_int("cache", "cache", "cache", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_CACHE, pspec);
+    gvs_register_property_transient(pspec);
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* Tests */
+
+#define N_NODES 5
+
+/* A chain of nodes, node-0 -> node-1 -> ... */
+static TestNode *
+make_chain(void)
+{
+    TestNode *child = NULL;
+    int i;
+
+    for (i = N_NODES - 1; i >= 0; i--)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+        TestNode *node = g_object_new(TEST_TYPE_NODE, "name", name, "value", i + 1,
+                                      "child", child, "cache", 42, NULL);
+
+        if (child)
+            g_object_unref(child);
+        child = node;
+        g_free(name);
+    }
+
+    return child;
+}
+
+static gsize
+n_entities(GVariant *document)
+{
+    GvsView *view = gvs_view_new(document);
+    gsize n = gvs_view_get_n_entities(view);
+
+    g_object_unref(view);
+
+    return n;
+}
+
+/* Serializes a chain with @serializer, and checks the copy has @depth nodes */
+static TestNode *
+round_trip(GvsSerializer *serializer, guint depth)
+{
+    TestNode *root = make_chain();
+    TestNode *created, *node;
+    GVariant *document;
+    guint i;
+
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(root));
+    g_assert_cmpuint(n_entities(document), ==, depth);
+
+    created = gvs_gobject_new_deserialize(document);
+    for (i = 0, node = created; node; i++, node = node->child)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+
+        g_assert_cmpstr(node->name, ==, name);
+        g_assert_cmpint(node->cache, ==, 0);
+        g_free(name);
+    }
+    g_assert_cmpuint(i, ==, depth);
+
+    g_variant_unref(document);
+    g_object_unref(root);
+
+    return created;
+}
+
+static void
+test_projection_include(void)
+{
+    const char *names[] = { "name", NULL };
+    GvsSerializer *serializer = gvs_serializer_new();
+    TestNode *created;
+
+    gvs_serializer_include_properties(serializer, TEST_TYPE_NODE, names);
+
+    /* Leaving out the child leaves out the rest of the chain */
+    created = round_trip(serializer, 1);
+    g_assert_cmpint(created->value, ==, 0);
+    g_object_unref(created);
+
+    /* And back again */
+    gvs_serializer_include_properties(serializer, TEST_TYPE_NODE, NULL);
+    created = round_trip(serializer, N_NODES);
+    g_assert_cmpint(created->value, ==, 1);
+    g_object_unref(created);
+
+    g_object_unref(serializer);
+}
+
+static void
+test_projection_exclude(void)
+{
+    const char *names[] = { "value", NULL };
+    GvsSerializer *serializer = gvs_serializer_new();
+    TestNode *created;
+
+    gvs_serializer_exclude_properties(serializer, G_TYPE_OBJECT, names);
+    created = round_trip(serializer, N_NODES);
+    g_assert_cmpint(created->value, ==, 0);
+    g_assert_cmpint(created->child->value, ==, 0);
+    g_object_unref(created);
+
+    /* Projections of columnar classes are written as entities */
+    gvs_serializer_set_flags(serializer, GVS_SERIALIZER_COLUMNAR);
+    created = round_trip(serializer, N_NODES);
+    g_assert_cmpint(created->value, ==, 0);
+    g_object_unref(created);
+
+    g_object_unref(serializer);
+}
+
+static void
+test_projection_transient(void)
+{
+    TestNode *root = make_chain();
+    GVariant *document = gvs_gobject_serialize(G_OBJECT(root));
+    GvsView *view = gvs_view_new(document);
+    GVariant *value;
+
+    value = gvs_view_get_property(view, 0, "value");
+    g_assert(value != NULL);
+    g_variant_unref(value);
+    g_assert(gvs_view_get_property(view, 0, "cache") == NULL);
+
+    g_object_unref(view);
+    g_variant_unref(document);
+    g_object_unref(root);
+}
+
+static void
+test_projection_depth(void)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    TestNode *created;
+
+    g_assert_cmpuint(gvs_serializer_get_max_depth(serializer), ==, 0);
+
+    gvs_serializer_set_max_depth(serializer, 2);
+    created = round_trip(serializer, 3);
+    g_assert_cmpint(created->child->child->value, ==, 3);
+    g_object_unref(created);
+
+    gvs_serializer_set_max_depth(serializer, 0);
+    created = round_trip(serializer, N_NODES);
+    g_object_unref(created);
+
+    g_object_unref(serializer);
+}
+
+static void
+test_projection_entities(void)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GListStore *store = g_list_store_new(TEST_TYPE_NODE);
+    GListStore *created_store;
+    TestNode *created;
+    GVariant *document;
+    int i;
+
+    gvs_serializer_set_max_entities(serializer, 4);
+    g_assert_cmpuint(gvs_serializer_get_max_entities(serializer), ==, 4);
+
+    created = round_trip(serializer, 4);
+    g_object_unref(created);
+
+    /* The store takes one entity, and the items past the limit are dropped */
+    for (i = 0; i < 10; i++)
+    {
+        TestNode *node = g_object_new(TEST_TYPE_NODE, "value", i, NULL);
+        g_list_store_append(store, node);
+        g_object_unref(node);
+    }
+
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(store));
+    created_store = gvs_gobject_new_deserialize(document);
+    g_assert_cmpuint(g_list_model_get_n_items(G_LIST_MODEL(created_store)), ==, 3);
+
+    created = g_list_model_get_item(G_LIST_MODEL(created_store), 2);
+    g_assert_cmpint(created->value, ==, 2);
+    g_object_unref(created);
+
+    g_object_unref(created_store);
+    g_variant_unref(document);
+    g_object_unref(store);
+    g_object_unref(serializer);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Projection/Include", test_projection_include);
+   g_test_add_func("/Gvs/Projection/Exclude", test_projection_exclude);
+   g_test_add_func("/Gvs/Projection/Transient", test_projection_transient);
+   g_test_add_func("/Gvs/Projection/Depth", test_projection_depth);
+   g_test_add_func("/Gvs/Projection/Entities", test_projection_entities);
+   return g_test_run();
+}
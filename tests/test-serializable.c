@@ -0,0 +1,394 @@
+/*
+ * Tests objects which customise their serialization by implementing
+ * GvsSerializable
+ */
+
+#include <gvs/gvs.h>
+
+/* TestPoint object: uses the write()/read() fast path */
+
+#define TEST_TYPE_POINT            (test_point_get_type())
+#define TEST_POINT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_POINT, TestPoint))
+#define TEST_IS_POINT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_POINT))
+
+typedef struct _TestPoint      TestPoint;
+typedef struct _TestPointClass TestPointClass;
+
+struct _TestPoint
+{
+    GObject parent;
+
+    int x;
+    int y;
+    char *label;
+    TestPoint *next;
+};
+
+struct _TestPointClass
+{
+    GObjectClass parent_class;
+};
+
+static void test_point_serializable_init(GvsSerializableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(TestPoint, test_point, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GVS_TYPE_SERIALIZABLE,
+                                              test_point_serializable_init));
+
+static void
+test_point_finalize(GObject *obj)
+{
+    TestPoint *self = TEST_POINT(obj);
+
+    g_free(self->label);
+    g_clear_object(&self->next);
+
+    G_OBJECT_CLASS(test_point_parent_class)->finalize(obj);
+}
+
+static void
+test_point_class_init(TestPointClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = test_point_finalize;
+}
+
+static void
+test_point_init(TestPoint *self)
+{
+}
+
+static void
+test_point_write(GvsSerializable *serializable,
+                 GvsSerializer   *serializer,
+                 GVariantBuilder *writer)
+{
+    TestPoint *self = TEST_POINT(serializable);
+
+    g_variant_builder_add(writer, "i", self->x);
+    g_variant_builder_add(writer, "i", self->y);
+    g_variant_builder_add(writer, "s", self->label ? self->label : "");
+    g_variant_builder_add_value(writer,
+            gvs_serializer_write_object_ref(serializer, G_OBJECT(self->next)));
+}
+
+static void
+test_point_read(GvsSerializable *serializable,
+                GvsDeserializer *deserializer,
+                GVariantIter    *reader)
+{
+    TestPoint *self = TEST_POINT(serializable);
+    GVariant *ref;
+
+    g_variant_iter_next(reader, "i", &self->x);
+    g_variant_iter_next(reader, "i", &self->y);
+    g_variant_iter_next(reader, "s", &self->label);
+
+    ref = g_variant_iter_next_value(reader);
+    self->next = gvs_deserializer_read_object_ref(deserializer, ref);
+    if (self->next)
+        g_object_ref(self->next);
+    g_variant_unref(ref);
+}
+
+static void
+test_point_serializable_init(GvsSerializableInterface *iface)
+{
+    iface->write = test_point_write;
+    iface->read = test_point_read;
+}
+
+/* TestVersioned object: uses the property dictionary hooks */
+
+#define TEST_TYPE_VERSIONED        (test_versioned_get_type())
+#define TEST_VERSIONED(obj)        (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_VERSIONED, TestVersioned))
+#define TEST_IS_VERSIONED(obj)     (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_VERSIONED))
+
+typedef struct _TestVersioned      TestVersioned;
+typedef struct _TestVersionedClass TestVersionedClass;
+
+struct _TestVersioned
+{
+    GObject parent;
+
+    int count;
+    char *name;
+};
+
+struct _TestVersionedClass
+{
+    GObjectClass parent_class;
+};
+
+enum
+{
+    PROP_0,
+    PROP_COUNT,
+    PROP_NAME
+};
+
+static void test_versioned_serializable_init(GvsSerializableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(TestVersioned, test_versioned, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GVS_TYPE_SERIALIZABLE,
+                                              test_versioned_serializable_init));
+
+static void
+test_versioned_set_property(GObject *obj,
+                            guint prop_id,
+                            const GValue *value,
+                            GParamSpec *pspec)
+{
+    TestVersioned *self = TEST_VERSIONED(obj);
+
+    switch (prop_id)
+    {
+        case PROP_COUNT:
+            self->count = g_value_get_int(value);
+            break;
+
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_versioned_get_property(GObject *obj,
+                            guint prop_id,
+                            GValue *value,
+                            GParamSpec *pspec)
+{
+    TestVersioned *self = TEST_VERSIONED(obj);
+
+    switch (prop_id)
+    {
+        case PROP_COUNT:
+            g_value_set_int(value, self->count);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_versioned_finalize(GObject *obj)
+{
+    g_free(TEST_VERSIONED(obj)->name);
+
+    G_OBJECT_CLASS(test_versioned_parent_class)->finalize(obj);
+}
+
+static void
+test_versioned_class_init(TestVersionedClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_versioned_set_property;
+    gobject_class->get_property = test_versioned_get_property;
+    gobject_class->finalize = test_versioned_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_COUNT,
+            g_param_spec_int("count", "count", "count",
+                             G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_versioned_init(TestVersioned *self)
+{
+}
+
+/* Store the count as a string, to check that serialize_property() and
+ * deserialize_property() are consulted */
+static GVariant *
+test_versioned_serialize_property(GvsSerializable *serializable,
+                                  GvsSerializer   *serializer,
+                                  GParamSpec      *pspec,
+                                  const GValue    *value)
+{
+    if (g_strcmp0(g_param_spec_get_name(pspec), "count") == 0)
+    {
+        char *str = g_strdup_printf("%d", g_value_get_int(value));
+        return g_variant_new_take_string(str);
+    }
+
+    return NULL;
+}
+
+static gboolean
+test_versioned_deserialize_property(GvsSerializable *serializable,
+                                    GvsDeserializer *deserializer,
+                                    GParamSpec      *pspec,
+                                    GVariant        *variant,
+                                    GValue          *value)
+{
+    if (g_strcmp0(g_param_spec_get_name(pspec), "count") == 0)
+    {
+        g_value_set_int(value, g_ascii_strtoll(g_variant_get_string(variant, NULL), NULL, 10));
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+test_versioned_post_serialize(GvsSerializable *serializable,
+                              GvsSerializer   *serializer,
+                              GVariantDict    *dict)
+{
+    g_variant_dict_insert(dict, "version", "u", 2);
+}
+
+static void
+test_versioned_pre_deserialize(GvsSerializable *serializable,
+                               GvsDeserializer *deserializer,
+                               GVariantDict    *dict)
+{
+    guint32 version = 0;
+
+    g_assert(g_variant_dict_lookup(dict, "version", "u", &version));
+    g_assert_cmpuint(version, ==, 2);
+    g_variant_dict_remove(dict, "version");
+}
+
+static void
+test_versioned_serializable_init(GvsSerializableInterface *iface)
+{
+    iface->serialize_property = test_versioned_serialize_property;
+    iface->deserialize_property = test_versioned_deserialize_property;
+    iface->post_serialize = test_versioned_post_serialize;
+    iface->pre_deserialize = test_versioned_pre_deserialize;
+}
+
+static const char serialized_points[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestPoint', <(1, 2, 'first', @mt 1)>),"
+"  ('TestPoint', <(3, 4, 'second', @mt 0)>)])";
+
+static void
+test_write_read(void)
+{
+    TestPoint *first = NULL;
+    TestPoint *second = NULL;
+    TestPoint *created = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GError *error = NULL;
+
+    first = g_object_new(TEST_TYPE_POINT, NULL);
+    second = g_object_new(TEST_TYPE_POINT, NULL);
+    first->x = 1; first->y = 2; first->label = g_strdup("first");
+    second->x = 3; second->y = 4; second->label = g_strdup("second");
+
+    /* Make a cycle, to check references are resolved through read() */
+    first->next = g_object_ref(second);
+    second->next = g_object_ref(first);
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(first));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_points, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    g_assert(g_variant_equal(variant1, variant2));
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_POINT(created));
+    g_assert_cmpint(created->x, ==, 1);
+    g_assert_cmpint(created->y, ==, 2);
+    g_assert_cmpstr(created->label, ==, "first");
+    g_assert(TEST_IS_POINT(created->next));
+    g_assert_cmpint(created->next->x, ==, 3);
+    g_assert_cmpstr(created->next->label, ==, "second");
+    g_assert(created->next->next == created);
+
+    /* Break the cycles so everything is freed */
+    g_clear_object(&created->next->next);
+    g_object_unref(created);
+    g_clear_object(&second->next);
+    g_object_unref(first);
+    g_object_unref(second);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+static const char serialized_versioned[] =
+"(uint32 1735816047,"
+" uint16 1,"
+" [('TestVersioned', <{"
+"     'count': <'17'>,"
+"     'name': <@ms 'seventeen'>,"
+"     'version': <uint32 2>"
+"   }>)])";
+
+static void
+test_property_hooks(void)
+{
+    TestVersioned *object = NULL;
+    TestVersioned *created = NULL;
+    GVariant *variant1 = NULL;
+    GVariant *variant2 = NULL;
+    GVariant *payload = NULL;
+    GVariantIter *iter = NULL;
+    GVariantDict dict;
+    const char *str = NULL;
+    guint32 version = 0;
+    GError *error = NULL;
+
+    object = g_object_new(TEST_TYPE_VERSIONED,
+                          "count", 17,
+                          "name", "seventeen",
+                          NULL);
+
+    variant1 = gvs_gobject_serialize(G_OBJECT(object));
+    g_assert(variant1);
+
+    variant2 = g_variant_parse(NULL, serialized_versioned, NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    /* GVariantDict doesn't preserve ordering, so check the members
+     * individually rather than comparing with variant2 */
+    g_variant_get(variant1, "(uqa(sv))", NULL, NULL, &iter);
+    g_assert(g_variant_iter_next(iter, "(&sv)", NULL, &payload));
+    g_variant_iter_free(iter);
+    g_variant_dict_init(&dict, payload);
+    g_assert(g_variant_dict_lookup(&dict, "count", "&s", &str));
+    g_assert_cmpstr(str, ==, "17");
+    g_assert(g_variant_dict_lookup(&dict, "version", "u", &version));
+    g_assert_cmpuint(version, ==, 2);
+    g_variant_dict_clear(&dict);
+    g_variant_unref(payload);
+
+    created = gvs_gobject_new_deserialize(variant2);
+    g_assert(TEST_IS_VERSIONED(created));
+    g_assert_cmpint(created->count, ==, 17);
+    g_assert_cmpstr(created->name, ==, "seventeen");
+
+    g_object_unref(created);
+    g_object_unref(object);
+    g_variant_unref(variant2);
+    g_variant_unref(variant1);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Serializable/WriteRead", test_write_read);
+   g_test_add_func("/Gvs/Serializable/PropertyHooks", test_property_hooks);
+   return g_test_run();
+}
@@ -0,0 +1,310 @@
+/*
+ * Tests the statistics returned by gvs_serializer_get_stats() and
+ * gvs_deserializer_get_stats()
+ */
+
+#include <gvs/gvs.h>
+
+/* TestNode object, a chain of nodes which may hold some bytes */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    TestNode *next;
+    int value;
+    GBytes *data;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NEXT,
+    PROP_VALUE,
+    PROP_DATA
+};
+
+#define TEST_NODE_N_PROPERTIES 3
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_clear_object(&self->next);
+            self->next = g_value_dup_object(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_DATA:
+            g_clear_pointer(&self->data, g_bytes_unref);
+            self->data = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NEXT:
+            g_value_set_object(value, self->next);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_DATA:
+            g_value_set_boxed(value, self->data);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->next);
+    g_clear_pointer(&TEST_NODE(obj)->data, g_bytes_unref);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+
+    g_object_class_install_property(gobject_class, PROP_NEXT,
+            g_param_spec_object("next", "next", "next", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", 0, 100, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_DATA,
+            g_param_spec_boxed("data", "data", "data", G_TYPE_BYTES,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* Three nodes, the last of which holds some bytes: four entities */
+static TestNode *
+make_chain(void)
+{
+    GBytes *bytes = g_bytes_new_static("stats", 5);
+    TestNode *last, *middle, *first;
+
+    last = g_object_new(TEST_TYPE_NODE, "value", 3, "data", bytes, NULL);
+    middle = g_object_new(TEST_TYPE_NODE, "value", 2, "next", last, NULL);
+    first = g_object_new(TEST_TYPE_NODE, "value", 1, "next", middle, NULL);
+
+    g_object_unref(middle);
+    g_object_unref(last);
+    g_bytes_unref(bytes);
+
+    return first;
+}
+
+static gdouble
+total_phase_time(GvsStats *stats)
+{
+    gdouble total = 0.0;
+    guint i;
+
+    for (i = 0; i < GVS_STATS_N_PHASES; i++)
+    {
+        g_assert_cmpfloat(gvs_stats_get_phase_time(stats, i), >=, 0.0);
+        total += gvs_stats_get_phase_time(stats, i);
+    }
+
+    return total;
+}
+
+/* Checks the counts for @n_chains chains, and that the time charged to each
+ * type fits inside the total */
+static void
+check_stats(GvsStats *stats, guint n_chains, gsize n_bytes)
+{
+    GType *types;
+    guint n_types, i;
+    gdouble type_time = 0.0;
+
+    g_assert_cmpuint(gvs_stats_get_n_entities(stats), ==, n_chains * 4);
+    g_assert_cmpuint(gvs_stats_get_n_properties(stats), ==,
+                     n_chains * 3 * TEST_NODE_N_PROPERTIES);
+    g_assert_cmpuint(gvs_stats_get_n_bytes(stats), ==, n_chains * n_bytes);
+
+    g_assert_cmpuint(gvs_stats_get_type_count(stats, TEST_TYPE_NODE), ==, n_chains * 3);
+    g_assert_cmpuint(gvs_stats_get_type_count(stats, G_TYPE_BYTES), ==, n_chains);
+    g_assert_cmpuint(gvs_stats_get_type_count(stats, G_TYPE_OBJECT), ==, 0);
+    g_assert_cmpfloat(gvs_stats_get_type_time(stats, G_TYPE_OBJECT), ==, 0.0);
+
+    types = gvs_stats_list_types(stats, &n_types);
+    g_assert_cmpuint(n_types, ==, 2);
+    g_assert(types[n_types] == G_TYPE_INVALID);
+    g_assert(types[0] == TEST_TYPE_NODE || types[0] == G_TYPE_BYTES);
+    g_assert(types[1] == TEST_TYPE_NODE || types[1] == G_TYPE_BYTES);
+    g_assert(types[0] != types[1]);
+
+    /* Most expensive first */
+    g_assert_cmpfloat(gvs_stats_get_type_time(stats, types[0]), >=,
+                      gvs_stats_get_type_time(stats, types[1]));
+
+    for (i = 0; i < n_types; i++)
+        type_time += gvs_stats_get_type_time(stats, types[i]);
+
+    g_assert_cmpfloat(total_phase_time(stats), >, 0.0);
+    g_assert_cmpfloat(type_time, <=, total_phase_time(stats));
+
+    g_free(types);
+}
+
+static void
+check_round_trip(GvsSerializerFlags flags)
+{
+    TestNode *chain = make_chain();
+    GvsSerializer *serializer = gvs_serializer_new();
+    GvsDeserializer *deserializer = gvs_deserializer_new();
+    GvsStats *stats = NULL;
+    GVariant *variant = NULL;
+    TestNode *created = NULL;
+
+    gvs_serializer_set_flags(serializer, flags);
+    variant = gvs_serializer_serialize_object(serializer, G_OBJECT(chain));
+    created = gvs_deserializer_deserialize(deserializer, variant);
+
+    g_assert(TEST_IS_NODE(created));
+    g_assert_cmpint(created->next->next->value, ==, 3);
+
+    stats = gvs_serializer_get_stats(serializer);
+    check_stats(stats, 1, g_variant_get_size(variant));
+    g_assert_cmpfloat(gvs_stats_get_phase_time(stats, GVS_STATS_CONSTRUCT), ==, 0.0);
+    g_assert_cmpfloat(gvs_stats_get_phase_time(stats, GVS_STATS_PROPERTY_SET), ==, 0.0);
+    gvs_stats_free(stats);
+
+    stats = gvs_deserializer_get_stats(deserializer);
+    check_stats(stats, 1, g_variant_get_size(variant));
+    g_assert_cmpfloat(gvs_stats_get_phase_time(stats, GVS_STATS_PROPERTY_READ), ==, 0.0);
+    g_assert_cmpfloat(gvs_stats_get_phase_time(stats, GVS_STATS_ENCODE), ==, 0.0);
+    gvs_stats_free(stats);
+
+    g_object_unref(created);
+    g_variant_unref(variant);
+    g_object_unref(deserializer);
+    g_object_unref(serializer);
+    g_object_unref(chain);
+}
+
+static void
+test_stats_round_trip(void)
+{
+    check_round_trip(GVS_SERIALIZER_FLAGS_NONE);
+}
+
+static void
+test_stats_columns(void)
+{
+    check_round_trip(GVS_SERIALIZER_COLUMNAR);
+}
+
+static void
+test_stats_cumulative(void)
+{
+    TestNode *chain = make_chain();
+    GvsSerializer *serializer = gvs_serializer_new();
+    GvsStats *stats = NULL;
+    GvsStats *copy = NULL;
+    GVariant *variant = NULL;
+    TestNode *created = NULL;
+    gsize size;
+
+    variant = gvs_serializer_serialize_object(serializer, G_OBJECT(chain));
+    size = g_variant_get_size(variant);
+    g_variant_unref(variant);
+
+    stats = gvs_serializer_get_stats(serializer);
+
+    /* Entity ids start again from 0 for each document */
+    variant = gvs_serializer_serialize_object(serializer, G_OBJECT(chain));
+    created = gvs_gobject_new_deserialize(variant);
+    g_assert(TEST_IS_NODE(created));
+    g_assert_cmpint(created->next->next->value, ==, 3);
+    g_object_unref(created);
+    g_variant_unref(variant);
+
+    /* Snapshots don't change after they are taken */
+    check_stats(stats, 1, size);
+    gvs_stats_free(stats);
+
+    stats = gvs_serializer_get_stats(serializer);
+    check_stats(stats, 2, size);
+
+    copy = g_boxed_copy(GVS_TYPE_STATS, stats);
+    check_stats(copy, 2, size);
+    g_boxed_free(GVS_TYPE_STATS, copy);
+    gvs_stats_free(stats);
+
+    gvs_serializer_reset_stats(serializer);
+    stats = gvs_serializer_get_stats(serializer);
+    g_assert_cmpuint(gvs_stats_get_n_entities(stats), ==, 0);
+    g_assert_cmpuint(gvs_stats_get_n_bytes(stats), ==, 0);
+    g_assert_cmpfloat(total_phase_time(stats), ==, 0.0);
+    g_assert_cmpuint(gvs_stats_get_type_count(stats, TEST_TYPE_NODE), ==, 0);
+    gvs_stats_free(stats);
+
+    g_object_unref(serializer);
+    g_object_unref(chain);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Stats/RoundTrip", test_stats_round_trip);
+   g_test_add_func("/Gvs/Stats/Columns", test_stats_columns);
+   g_test_add_func("/Gvs/Stats/Cumulative", test_stats_cumulative);
+   return g_test_run();
+}
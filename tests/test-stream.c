@@ -0,0 +1,397 @@
+/*
+ * Tests writing and reading GVS streams with GvsStreamWriter and
+ * GvsStreamReader
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+#include <string.h>
+
+/* TestItem object */
+
+#define TEST_TYPE_ITEM            (test_item_get_type())
+#define TEST_ITEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_ITEM, TestItem))
+#define TEST_IS_ITEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_ITEM))
+
+typedef struct _TestItem      TestItem;
+typedef struct _TestItemClass TestItemClass;
+
+struct _TestItem
+{
+    GObject parent;
+
+    int value;
+    char *name;
+};
+
+struct _TestItemClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestItem, test_item, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_VALUE,
+    PROP_NAME
+};
+
+static void
+test_item_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestItem *self = TEST_ITEM(obj);
+
+    switch (prop_id)
+    {
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_item_finalize(GObject *obj)
+{
+    g_free(TEST_ITEM(obj)->name);
+
+    G_OBJECT_CLASS(test_item_parent_class)->finalize(obj);
+}
+
+static void
+test_item_class_init(TestItemClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_item_set_property;
+    gobject_class->get_property = test_item_get_property;
+    gobject_class->finalize = test_item_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", 0, 1000, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_item_init(TestItem *self)
+{
+}
+
+#define N_RECORDS 10
+
+/* Writes N_RECORDS items, with values 0 to N_RECORDS - 1 */
+static GBytes *
+write_stream(GvsStreamFlags flags, GvsSerializerFlags serializer_flags)
+{
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsStreamWriter *writer = gvs_stream_writer_new(stream, flags);
+    GError *error = NULL;
+    GBytes *bytes;
+    int i;
+
+    gvs_serializer_set_flags(gvs_stream_writer_get_serializer(writer),
+                             serializer_flags);
+
+    for (i = 0; i < N_RECORDS; i++)
+    {
+        TestItem *item = g_object_new(TEST_TYPE_ITEM, "value", i,
+                                      "name", "item", NULL);
+
+        g_assert(gvs_stream_writer_write_object(writer, G_OBJECT(item), NULL, &error));
+        g_assert_no_error(error);
+        g_object_unref(item);
+    }
+
+    g_assert(gvs_stream_writer_flush(writer, NULL, &error));
+    g_assert_no_error(error);
+    g_object_unref(writer);
+
+    g_assert(g_output_stream_close(stream, NULL, &error));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    g_object_unref(stream);
+
+    return bytes;
+}
+
+static GvsStreamReader *
+reader_new(GBytes *bytes)
+{
+    GInputStream *stream = g_memory_input_stream_new_from_bytes(bytes);
+    GvsStreamReader *reader = gvs_stream_reader_new(stream);
+
+    g_object_unref(stream);
+
+    return reader;
+}
+
+static void
+check_read_all(GvsStreamFlags flags, GvsSerializerFlags serializer_flags)
+{
+    GBytes *bytes = write_stream(flags, serializer_flags);
+    GvsStreamReader *reader = reader_new(bytes);
+    GError *error = NULL;
+    TestItem *item;
+    int i;
+
+    for (i = 0; i < N_RECORDS; i++)
+    {
+        item = gvs_stream_reader_read_object(reader, NULL, &error);
+        g_assert_no_error(error);
+        g_assert(TEST_IS_ITEM(item));
+        g_assert_cmpint(item->value, ==, i);
+        g_assert_cmpstr(item->name, ==, "item");
+        g_object_unref(item);
+    }
+
+    /* End of stream, twice */
+    g_assert(gvs_stream_reader_read_object(reader, NULL, &error) == NULL);
+    g_assert_no_error(error);
+    g_assert(!gvs_stream_reader_skip(reader, NULL, &error));
+    g_assert_no_error(error);
+
+    g_object_unref(reader);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_stream_round_trip(void)
+{
+    check_read_all(GVS_STREAM_FLAGS_NONE, GVS_SERIALIZER_FLAGS_NONE);
+    check_read_all(GVS_STREAM_CHECKSUMS, GVS_SERIALIZER_FLAGS_NONE);
+    check_read_all(GVS_STREAM_CHECKSUMS, GVS_SERIALIZER_COLUMNAR | GVS_SERIALIZER_COMPACT);
+}
+
+static void
+test_stream_skip(void)
+{
+    GBytes *bytes = write_stream(GVS_STREAM_CHECKSUMS, GVS_SERIALIZER_FLAGS_NONE);
+    GvsStreamReader *reader = reader_new(bytes);
+    GError *error = NULL;
+    TestItem *item;
+    int i;
+
+    /* Read every third record */
+    for (i = 0; i < N_RECORDS; i++)
+    {
+        if (i % 3 != 0)
+        {
+            g_assert(gvs_stream_reader_skip(reader, NULL, &error));
+            g_assert_no_error(error);
+            continue;
+        }
+
+        item = gvs_stream_reader_read_object(reader, NULL, &error);
+        g_assert_no_error(error);
+        g_assert_cmpint(item->value, ==, i);
+        g_object_unref(item);
+    }
+
+    g_assert(!gvs_stream_reader_skip(reader, NULL, &error));
+    g_assert_no_error(error);
+
+    g_object_unref(reader);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_stream_batching(void)
+{
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsStreamWriter *writer = gvs_stream_writer_new(stream, GVS_STREAM_FLAGS_NONE);
+    TestItem *item = g_object_new(TEST_TYPE_ITEM, "value", 1, NULL);
+    GError *error = NULL;
+    gsize size;
+
+    /* Small records wait for a flush */
+    g_assert(gvs_stream_writer_write_object(writer, G_OBJECT(item), NULL, &error));
+    g_assert(gvs_stream_writer_write_object(writer, G_OBJECT(item), NULL, &error));
+    g_assert_cmpuint(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), ==, 0);
+
+    g_assert(gvs_stream_writer_flush(writer, NULL, &error));
+    size = g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream));
+    g_assert_cmpuint(size, >, 0);
+
+    /* Unless batching is off */
+    gvs_stream_writer_set_batch_size(writer, 0);
+    g_assert(gvs_stream_writer_write_object(writer, G_OBJECT(item), NULL, &error));
+    g_assert_no_error(error);
+    g_assert_cmpuint(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), >, size);
+
+    g_object_unref(writer);
+    g_object_unref(item);
+    g_object_unref(stream);
+}
+
+static void
+test_stream_empty(void)
+{
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsStreamWriter *writer = gvs_stream_writer_new(stream, GVS_STREAM_CHECKSUMS);
+    GvsStreamReader *reader;
+    GError *error = NULL;
+    GBytes *bytes;
+
+    /* A flushed writer with no records leaves just the header */
+    g_assert(gvs_stream_writer_flush(writer, NULL, &error));
+    g_object_unref(writer);
+    g_assert(g_output_stream_close(stream, NULL, &error));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    g_object_unref(stream);
+    g_assert_cmpuint(g_bytes_get_size(bytes), ==, 8);
+
+    reader = reader_new(bytes);
+    g_assert(gvs_stream_reader_read_document(reader, NULL, &error) == NULL);
+    g_assert_no_error(error);
+    g_object_unref(reader);
+    g_bytes_unref(bytes);
+
+    /* ...and a completely empty stream holds no records either */
+    bytes = g_bytes_new_static("", 0);
+    reader = reader_new(bytes);
+    g_assert(gvs_stream_reader_read_document(reader, NULL, &error) == NULL);
+    g_assert_no_error(error);
+    g_object_unref(reader);
+    g_bytes_unref(bytes);
+}
+
+/* Reads the first record of a copy of @bytes which is cut short at
+ * @truncate_at, or if that is negative has the byte at @offset flipped, and
+ * checks that it fails with @code */
+static void
+check_read_error(GBytes *bytes, gsize offset, gssize truncate_at, gint code)
+{
+    gsize size = g_bytes_get_size(bytes);
+    guint8 *data = g_malloc(size);
+    GBytes *changed;
+    GvsStreamReader *reader;
+    GError *error = NULL;
+
+    memcpy(data, g_bytes_get_data(bytes, NULL), size);
+
+    if (truncate_at >= 0)
+        size = truncate_at;
+    else
+        data[offset] ^= 0xFF;
+
+    changed = g_bytes_new_take(data, size);
+    reader = reader_new(changed);
+
+    g_assert(gvs_stream_reader_read_object(reader, NULL, &error) == NULL);
+    g_assert_error(error, GVS_STREAM_ERROR, code);
+    g_error_free(error);
+
+    g_object_unref(reader);
+    g_bytes_unref(changed);
+}
+
+static void
+test_stream_errors(void)
+{
+    GBytes *bytes = write_stream(GVS_STREAM_CHECKSUMS, GVS_SERIALIZER_FLAGS_NONE);
+    GBytes *unchecked = write_stream(GVS_STREAM_FLAGS_NONE, GVS_SERIALIZER_FLAGS_NONE);
+
+    /* Stream header: magic, version */
+    check_read_error(bytes, 0, -1, GVS_STREAM_ERROR_INVALID_HEADER);
+    check_read_error(bytes, 5, -1, GVS_STREAM_ERROR_UNSUPPORTED);
+    check_read_error(bytes, 0, 4, GVS_STREAM_ERROR_INVALID_HEADER);
+
+    /* Record header: document version, then the payload */
+    check_read_error(bytes, 8 + 4, -1, GVS_STREAM_ERROR_UNSUPPORTED);
+    check_read_error(bytes, 8 + 12 + 1, -1, GVS_STREAM_ERROR_CHECKSUM);
+    check_read_error(bytes, 0, 8 + 6, GVS_STREAM_ERROR_TRUNCATED);
+    check_read_error(bytes, 0, 8 + 12 + 4, GVS_STREAM_ERROR_TRUNCATED);
+
+    /* A payload size of gigabytes fails once the stream runs out */
+    check_read_error(bytes, 8 + 3, -1, GVS_STREAM_ERROR_TRUNCATED);
+
+    /* Without checksums a damaged magic number is still caught */
+    check_read_error(unchecked, 8 + 8, -1, GVS_STREAM_ERROR_INVALID_DOCUMENT);
+
+    g_bytes_unref(unchecked);
+    g_bytes_unref(bytes);
+}
+
+static void
+test_stream_documents(void)
+{
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsStreamWriter *writer = gvs_stream_writer_new(stream, GVS_STREAM_CHECKSUMS);
+    TestItem *item = g_object_new(TEST_TYPE_ITEM, "value", 42, NULL);
+    GvsStreamReader *reader;
+    GVariant *document, *read;
+    GError *error = NULL;
+    GBytes *bytes;
+
+    document = gvs_serializer_serialize_object(gvs_stream_writer_get_serializer(writer),
+                                               G_OBJECT(item));
+    g_assert(gvs_stream_writer_write_document(writer, document, NULL, &error));
+    g_assert(gvs_stream_writer_flush(writer, NULL, &error));
+    g_assert_no_error(error);
+    g_object_unref(writer);
+
+    g_assert(g_output_stream_close(stream, NULL, &error));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    g_object_unref(stream);
+
+    reader = reader_new(bytes);
+    read = gvs_stream_reader_read_document(reader, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(g_variant_equal(read, document));
+
+    g_variant_unref(read);
+    g_variant_unref(document);
+    g_object_unref(reader);
+    g_bytes_unref(bytes);
+    g_object_unref(item);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/Stream/RoundTrip", test_stream_round_trip);
+   g_test_add_func("/Gvs/Stream/Skip", test_stream_skip);
+   g_test_add_func("/Gvs/Stream/Batching", test_stream_batching);
+   g_test_add_func("/Gvs/Stream/Empty", test_stream_empty);
+   g_test_add_func("/Gvs/Stream/Errors", test_stream_errors);
+   g_test_add_func("/Gvs/Stream/Documents", test_stream_documents);
+   return g_test_run();
+}
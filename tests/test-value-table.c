@@ -0,0 +1,361 @@
+/*
+ * Tests documents written with GVS_SERIALIZER_VALUE_TABLE
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestRecord object, with a category, a name in a plain field, tags and
+ * data */
+
+#define TEST_TYPE_RECORD         (test_record_get_type())
+#define TEST_RECORD(obj)         (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_RECORD, TestRecord))
+
+typedef struct _TestRecord      TestRecord;
+typedef struct _TestRecordClass TestRecordClass;
+
+struct _TestRecord
+{
+    GObject parent;
+
+    char *category;
+    char *name;
+    char **tags;
+    GBytes *data;
+};
+
+struct _TestRecordClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestRecord, test_record, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_CATEGORY,
+    PROP_NAME,
+    PROP_TAGS,
+    PROP_DATA
+};
+
+static void
+test_record_set_property(GObject *obj,
+                         guint prop_id,
+                         const GValue *value,
+                         GParamSpec *pspec)
+{
+    TestRecord *self = TEST_RECORD(obj);
+
+    switch (prop_id)
+    {
+        case PROP_CATEGORY:
+            g_free(self->category);
+            self->category = g_value_dup_string(value);
+            break;
+
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_TAGS:
+            g_strfreev(self->tags);
+            self->tags = g_value_dup_boxed(value);
+            break;
+
+        case PROP_DATA:
+            g_clear_pointer(&self->data, g_bytes_unref);
+            self->data = g_value_dup_boxed(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_record_get_property(GObject *obj,
+                         guint prop_id,
+                         GValue *value,
+                         GParamSpec *pspec)
+{
+    TestRecord *self = TEST_RECORD(obj);
+
+    switch (prop_id)
+    {
+        case PROP_CATEGORY:
+            g_value_set_string(value, self->category);
+            break;
+
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_TAGS:
+            g_value_set_boxed(value, self->tags);
+            break;
+
+        case PROP_DATA:
+            g_value_set_boxed(value, self->data);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_record_finalize(GObject *obj)
+{
+    TestRecord *self = TEST_RECORD(obj);
+
+    g_free(self->category);
+    g_free(self->name);
+    g_strfreev(self->tags);
+    g_clear_pointer(&self->data, g_bytes_unref);
+
+    G_OBJECT_CLASS(test_record_parent_class)->finalize(obj);
+}
+
+static void
+test_record_class_init(TestRecordClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    GParamSpec *pspec;
+
+    gobject_class->set_property = test_record_set_property;
+    gobject_class->get_property = test_record_get_property;
+    gobject_class->finalize = test_record_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_CATEGORY,
+            g_param_spec_string("category", "category", "category", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    pspec = g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_property(gobject_class, PROP_NAME, pspec);
+    gvs_register_property_offset(pspec, G_STRUCT_OFFSET(TestRecord, name),
+                                 GVS_FIELD_STRING);
+
+    g_object_class_install_property(gobject_class, PROP_TAGS,
+            g_param_spec_boxed("tags", "tags", "tags", G_TYPE_STRV,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_DATA,
+            g_param_spec_boxed("data", "data", "data", G_TYPE_BYTES,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_record_init(TestRecord *self)
+{
+}
+
+/* Tests */
+
+#define N_RECORDS 30
+
+static const char *categories[] = {
+    "a category name long enough to be worth sharing",
+    "another category name, also repeated many times",
+    "and a third"
+};
+
+/* Records in one of three categories, with a name of their own, a copy of
+ * one of two lists of tags and, for every other record, some data */
+static GListStore *
+make_store(void)
+{
+    const char *tags[][3] = { { "red", "green", NULL }, { "blue", NULL, NULL } };
+    GListStore *store = g_list_store_new(TEST_TYPE_RECORD);
+    int i;
+
+    for (i = 0; i < N_RECORDS; i++)
+    {
+        char *name = g_strdup_printf("record-%d", i);
+        GBytes *data = g_bytes_new("\1\2\3\4", 4);
+        TestRecord *record = g_object_new(TEST_TYPE_RECORD,
+                                          "category", categories[i % 3],
+                                          "name", name,
+                                          "tags", tags[i % 2],
+                                          "data", i % 2 ? NULL : data,
+                                          NULL);
+
+        g_list_store_append(store, record);
+        g_object_unref(record);
+        g_bytes_unref(data);
+        g_free(name);
+    }
+
+    return store;
+}
+
+static GVariant *
+serialize(GObject *object, GvsSerializerFlags flags)
+{
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+
+    gvs_serializer_set_flags(serializer, flags);
+    document = gvs_serializer_serialize_object(serializer, object);
+    g_object_unref(serializer);
+
+    return document;
+}
+
+static void
+check_records(GListModel *model)
+{
+    int i;
+
+    g_assert_cmpuint(g_list_model_get_n_items(model), ==, N_RECORDS);
+
+    for (i = 0; i < N_RECORDS; i++)
+    {
+        TestRecord *record = g_list_model_get_item(model, i);
+        char *name = g_strdup_printf("record-%d", i);
+
+        g_assert_cmpstr(record->category, ==, categories[i % 3]);
+        g_assert_cmpstr(record->name, ==, name);
+        g_assert_cmpstr(record->tags[0], ==, i % 2 ? "blue" : "red");
+        g_assert((record->data != NULL) == (i % 2 == 0));
+
+        g_object_unref(record);
+        g_free(name);
+    }
+}
+
+static void
+test_value_table_strings(void)
+{
+    GListStore *store = make_store();
+    GVariant *plain = serialize(G_OBJECT(store), GVS_SERIALIZER_FLAGS_NONE);
+    GVariant *document = serialize(G_OBJECT(store), GVS_SERIALIZER_VALUE_TABLE);
+    GvsView *view = gvs_view_new(document);
+    GVariant *entity, *payload, *table, *value;
+    const char *category = NULL;
+    GListStore *created;
+
+    g_assert_cmpuint(g_variant_get_size(document), <, g_variant_get_size(plain));
+
+    /* The table ends the document, and properties refer to it by handle */
+    g_assert(g_variant_is_of_type(document, G_VARIANT_TYPE("(uqua(sv)a(sata{sv})as)")));
+    table = g_variant_get_child_value(document, 5);
+    g_assert_cmpuint(g_variant_n_children(table), ==, 3 + N_RECORDS);
+
+    entity = gvs_view_get_entity(view, 2);
+    g_variant_get_child(entity, 1, "v", &payload);
+    value = g_variant_lookup_value(payload, "category", NULL);
+    g_assert(g_variant_is_of_type(value, G_VARIANT_TYPE("mh")));
+    g_variant_unref(value);
+    g_variant_unref(payload);
+    g_variant_unref(entity);
+
+    /* ...which views read through the table */
+    value = gvs_view_lookup(view, 0, "1/category");
+    g_variant_get(value, "m&s", &category);
+    g_assert_cmpstr(category, ==, categories[1]);
+    g_variant_unref(value);
+
+    created = gvs_gobject_new_deserialize(document);
+    check_records(G_LIST_MODEL(created));
+    g_assert(gvs_gobject_equal(G_OBJECT(store), G_OBJECT(created)));
+
+    g_object_unref(created);
+    g_variant_unref(table);
+    g_object_unref(view);
+    g_variant_unref(document);
+    g_variant_unref(plain);
+    g_object_unref(store);
+}
+
+/* Equal tags and data are written once each */
+static void
+test_value_table_boxed(void)
+{
+    GListStore *store = make_store();
+    GVariant *plain = serialize(G_OBJECT(store), GVS_SERIALIZER_FLAGS_NONE);
+    GVariant *document = serialize(G_OBJECT(store), GVS_SERIALIZER_VALUE_TABLE);
+    GvsView *plain_view = gvs_view_new(plain);
+    GvsView *view = gvs_view_new(document);
+    GListStore *created;
+
+    /* The store, its records, tags for each, and data for every other one */
+    g_assert_cmpuint(gvs_view_get_n_entities(plain_view), ==,
+                     1 + 2 * N_RECORDS + N_RECORDS / 2);
+
+    /* ...against two lists of tags and one of data */
+    g_assert_cmpuint(gvs_view_get_n_entities(view), ==, 1 + N_RECORDS + 2 + 1);
+
+    created = gvs_gobject_new_deserialize(document);
+    check_records(G_LIST_MODEL(created));
+
+    g_object_unref(created);
+    g_object_unref(view);
+    g_object_unref(plain_view);
+    g_variant_unref(document);
+    g_variant_unref(plain);
+    g_object_unref(store);
+}
+
+static void
+test_value_table_columns(void)
+{
+    GListStore *store = make_store();
+    GVariant *document = serialize(G_OBJECT(store), GVS_SERIALIZER_VALUE_TABLE |
+                                                    GVS_SERIALIZER_COLUMNAR |
+                                                    GVS_SERIALIZER_COMPACT);
+    GListStore *created = gvs_gobject_new_deserialize(document);
+
+    check_records(G_LIST_MODEL(created));
+
+    g_object_unref(created);
+    g_variant_unref(document);
+    g_object_unref(store);
+}
+
+/* Archives index keys held in the table, and read it when first needed */
+static void
+test_value_table_archive(void)
+{
+    GListStore *store = make_store();
+    GVariant *document = serialize(G_OBJECT(store), GVS_SERIALIZER_VALUE_TABLE);
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsArchive *archive;
+    TestRecord *record;
+    GListStore *created;
+    GBytes *bytes;
+
+    g_assert(gvs_archive_write(stream, document, "category", NULL, NULL));
+    g_assert(g_output_stream_close(stream, NULL, NULL));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    archive = gvs_archive_new(bytes, NULL);
+
+    record = gvs_archive_lookup(archive, categories[2]);
+    g_assert(record != NULL);
+    g_assert_cmpstr(record->category, ==, categories[2]);
+    g_assert_cmpstr(record->name, ==, "record-2");
+    g_object_unref(record);
+
+    created = gvs_archive_lookup_id(archive, 0);
+    check_records(G_LIST_MODEL(created));
+    g_object_unref(created);
+
+    g_object_unref(archive);
+    g_bytes_unref(bytes);
+    g_object_unref(stream);
+    g_variant_unref(document);
+    g_object_unref(store);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/ValueTable/Strings", test_value_table_strings);
+   g_test_add_func("/Gvs/ValueTable/Boxed", test_value_table_boxed);
+   g_test_add_func("/Gvs/ValueTable/Columns", test_value_table_columns);
+   g_test_add_func("/Gvs/ValueTable/Archive", test_value_table_archive);
+   return g_test_run();
+}
@@ -0,0 +1,356 @@
+/*
+ * Tests GvsView, queries over serialized documents
+ */
+
+#include <gvs/gvs.h>
+#include <gio/gio.h>
+
+/* TestNode object, with a name, a value and a child */
+
+#define TEST_TYPE_NODE           (test_node_get_type())
+#define TEST_NODE(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_NODE, TestNode))
+#define TEST_IS_NODE(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TEST_TYPE_NODE))
+
+typedef struct _TestNode      TestNode;
+typedef struct _TestNodeClass TestNodeClass;
+
+struct _TestNode
+{
+    GObject parent;
+
+    char *name;
+    int value;
+    TestNode *child;
+};
+
+struct _TestNodeClass
+{
+    GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(TestNode, test_node, G_TYPE_OBJECT);
+
+enum
+{
+    PROP_0,
+    PROP_NAME,
+    PROP_VALUE,
+    PROP_CHILD
+};
+
+static void
+test_node_set_property(GObject *obj,
+                       guint prop_id,
+                       const GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_free(self->name);
+            self->name = g_value_dup_string(value);
+            break;
+
+        case PROP_VALUE:
+            self->value = g_value_get_int(value);
+            break;
+
+        case PROP_CHILD:
+            g_clear_object(&self->child);
+            self->child = g_value_dup_object(value);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_get_property(GObject *obj,
+                       guint prop_id,
+                       GValue *value,
+                       GParamSpec *pspec)
+{
+    TestNode *self = TEST_NODE(obj);
+
+    switch (prop_id)
+    {
+        case PROP_NAME:
+            g_value_set_string(value, self->name);
+            break;
+
+        case PROP_VALUE:
+            g_value_set_int(value, self->value);
+            break;
+
+        case PROP_CHILD:
+            g_value_set_object(value, self->child);
+            break;
+
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+    }
+}
+
+static void
+test_node_dispose(GObject *obj)
+{
+    g_clear_object(&TEST_NODE(obj)->child);
+
+    G_OBJECT_CLASS(test_node_parent_class)->dispose(obj);
+}
+
+static void
+test_node_finalize(GObject *obj)
+{
+    g_free(TEST_NODE(obj)->name);
+
+    G_OBJECT_CLASS(test_node_parent_class)->finalize(obj);
+}
+
+static void
+test_node_class_init(TestNodeClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = test_node_set_property;
+    gobject_class->get_property = test_node_get_property;
+    gobject_class->dispose = test_node_dispose;
+    gobject_class->finalize = test_node_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_NAME,
+            g_param_spec_string("name", "name", "name", NULL,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_VALUE,
+            g_param_spec_int("value", "value", "value", G_MININT, G_MAXINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(gobject_class, PROP_CHILD,
+            g_param_spec_object("child", "child", "child", TEST_TYPE_NODE,
+                                G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+test_node_init(TestNode *self)
+{
+}
+
+/* Tests */
+
+/* A chain of three nodes: root -> middle -> leaf */
+static GVariant *
+serialize_chain(GvsSerializerFlags flags)
+{
+    TestNode *leaf = g_object_new(TEST_TYPE_NODE, "name", "leaf", "value", 3, NULL);
+    TestNode *middle = g_object_new(TEST_TYPE_NODE, "name", "middle", "value", 2,
+                                    "child", leaf, NULL);
+    TestNode *root = g_object_new(TEST_TYPE_NODE, "name", "root", "value", 1,
+                                  "child", middle, NULL);
+    GvsSerializer *serializer = gvs_serializer_new();
+    GVariant *document;
+
+    gvs_serializer_set_flags(serializer, flags);
+    document = gvs_serializer_serialize_object(serializer, G_OBJECT(root));
+
+    g_object_unref(serializer);
+    g_object_unref(root);
+    g_object_unref(middle);
+    g_object_unref(leaf);
+
+    return document;
+}
+
+static void
+assert_string(GVariant *value, const char *expected)
+{
+    GVariant *string;
+
+    g_assert(value != NULL);
+    string = g_variant_get_maybe(value);
+    g_assert(string != NULL);
+    g_assert_cmpstr(g_variant_get_string(string, NULL), ==, expected);
+
+    g_variant_unref(string);
+    g_variant_unref(value);
+}
+
+static void
+check_paths(GvsView *view)
+{
+    GVariant *value;
+    gsize id;
+
+    g_assert_cmpuint(gvs_view_get_n_entities(view), ==, 3);
+    g_assert(gvs_view_get_entity_type(view, 0) == TEST_TYPE_NODE);
+    g_assert(gvs_view_get_entity(view, 3) == NULL);
+
+    assert_string(gvs_view_get_property(view, 0, "name"), "root");
+    assert_string(gvs_view_lookup(view, 0, "name"), "root");
+    assert_string(gvs_view_lookup(view, 0, "child/name"), "middle");
+    assert_string(gvs_view_lookup(view, 0, "child/child/name"), "leaf");
+
+    g_assert(gvs_view_lookup_entity(view, 0, "child/child", &id));
+    assert_string(gvs_view_lookup(view, id, "name"), "leaf");
+    g_assert(gvs_view_lookup_entity(view, id, "", &id));
+    assert_string(gvs_view_get_property(view, id, "name"), "leaf");
+
+    /* The leaf's child is a NULL reference, and there is no such property */
+    value = gvs_view_lookup(view, 0, "child/child/child");
+    g_assert(value != NULL);
+    g_assert(!gvs_view_read_ref(value, NULL));
+    g_variant_unref(value);
+    g_assert(!gvs_view_lookup_entity(view, 0, "child/child/child", NULL));
+    g_assert(gvs_view_lookup(view, 0, "child/child/child/name") == NULL);
+    g_assert(gvs_view_lookup(view, 0, "parent/name") == NULL);
+    g_assert(gvs_view_lookup(view, 0, "name/name") == NULL);
+}
+
+static void
+test_view_paths(void)
+{
+    GVariant *document = serialize_chain(GVS_SERIALIZER_FLAGS_NONE);
+    GvsView *view = gvs_view_new(document);
+    GVariant *value;
+
+    check_paths(view);
+
+    value = gvs_view_lookup(view, 0, "child/value");
+    g_assert(g_variant_is_of_type(value, G_VARIANT_TYPE_INT32));
+    g_assert_cmpint(g_variant_get_int32(value), ==, 2);
+    g_variant_unref(value);
+
+    g_object_unref(view);
+    g_variant_unref(document);
+}
+
+static void
+test_view_compact(void)
+{
+    GVariant *document = serialize_chain(GVS_SERIALIZER_COMPACT);
+    GvsView *view = gvs_view_new(document);
+
+    check_paths(view);
+
+    g_object_unref(view);
+    g_variant_unref(document);
+}
+
+/* Values of a document in serialized form are slices of it, not copies */
+static void
+test_view_zero_copy(void)
+{
+    GVariant *document = serialize_chain(GVS_SERIALIZER_FLAGS_NONE);
+    const char *start = g_variant_get_data(document);
+    GvsView *view = gvs_view_new(document);
+    GVariant *value = gvs_view_lookup(view, 0, "child/name");
+    const char *data = g_variant_get_data(value);
+
+    g_assert(data >= start && data < start + g_variant_get_size(document));
+
+    g_variant_unref(value);
+    g_object_unref(view);
+    g_variant_unref(document);
+}
+
+static gboolean
+value_is_even(GvsView *view, gsize id, gpointer user_data)
+{
+    GVariant *value = gvs_view_get_property(view, id, "value");
+    gboolean even = value && g_variant_get_int32(value) % 2 == 0;
+
+    if (value)
+        g_variant_unref(value);
+
+    return even;
+}
+
+static void
+test_view_select(void)
+{
+    GListStore *store = g_list_store_new(TEST_TYPE_NODE);
+    GVariant *document;
+    GvsView *view;
+    GArray *ids;
+    gsize id;
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        char *name = g_strdup_printf("node-%d", i);
+        TestNode *node = g_object_new(TEST_TYPE_NODE, "name", name, "value", i, NULL);
+
+        g_list_store_append(store, node);
+        g_object_unref(node);
+        g_free(name);
+    }
+
+    document = gvs_gobject_serialize(G_OBJECT(store));
+    view = gvs_view_new(document);
+
+    /* Items of the root list */
+    assert_string(gvs_view_lookup(view, 0, "3/name"), "node-3");
+    g_assert(gvs_view_lookup_entity(view, 0, "9", &id));
+    g_assert(gvs_view_get_entity_type(view, id) == TEST_TYPE_NODE);
+    g_assert(gvs_view_lookup(view, 0, "10/name") == NULL);
+
+    ids = gvs_view_select(view, 0, NULL, NULL);
+    g_assert_cmpuint(ids->len, ==, 11);
+    g_array_unref(ids);
+
+    ids = gvs_view_select(view, TEST_TYPE_NODE, NULL, NULL);
+    g_assert_cmpuint(ids->len, ==, 10);
+    g_array_unref(ids);
+
+    ids = gvs_view_select(view, G_TYPE_OBJECT, value_is_even, NULL);
+    g_assert_cmpuint(ids->len, ==, 5);
+    for (i = 0; i < 5; i++)
+    {
+        GVariant *value = gvs_view_get_property(view, g_array_index(ids, gsize, i), "value");
+
+        g_assert_cmpint(g_variant_get_int32(value), ==, 2 * i);
+        g_variant_unref(value);
+    }
+    g_array_unref(ids);
+
+    g_object_unref(view);
+    g_variant_unref(document);
+    g_object_unref(store);
+}
+
+static void
+test_view_archive(void)
+{
+    GVariant *document = serialize_chain(GVS_SERIALIZER_FLAGS_NONE);
+    GOutputStream *stream = g_memory_output_stream_new_resizable();
+    GvsArchive *archive;
+    GvsView *view;
+    GBytes *bytes;
+
+    g_assert(gvs_archive_write(stream, document, NULL, NULL, NULL));
+    g_assert(g_output_stream_close(stream, NULL, NULL));
+    bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(stream));
+    archive = gvs_archive_new(bytes, NULL);
+
+    view = gvs_view_new_for_archive(archive);
+    g_object_unref(archive);
+
+    check_paths(view);
+
+    g_object_unref(view);
+    g_bytes_unref(bytes);
+    g_object_unref(stream);
+    g_variant_unref(document);
+}
+
+int
+main(int argc, char *argv[])
+{
+   g_test_init(&argc, &argv, NULL);
+   g_test_add_func("/Gvs/View/Paths", test_view_paths);
+   g_test_add_func("/Gvs/View/Compact", test_view_compact);
+   g_test_add_func("/Gvs/View/ZeroCopy", test_view_zero_copy);
+   g_test_add_func("/Gvs/View/Select", test_view_select);
+   g_test_add_func("/Gvs/View/Archive", test_view_archive);
+   return g_test_run();
+}